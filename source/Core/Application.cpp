@@ -3,12 +3,21 @@
 #include <backends/imgui_impl_glfw.h>
 #include <backends/imgui_impl_opengl3.h>
 #include "imgui.h"
+#include <algorithm>
+#include <cfloat>
 
 Application* Application::s_Instance = nullptr;
 
+static const float REBUILD_DEBOUNCE_SECONDS = 0.3f;
+static const std::vector<NavAgentProfile> AGENT_PROFILES = {
+    {"Infantry", 2.0f, 0.6f, 0.9f},
+    {"Vehicle", 2.5f, 1.5f, 0.5f},
+    {"Large creature", 5.0f, 3.0f, 1.5f},
+};
+
 Application::Application()
     : m_Window(nullptr), m_Shader(nullptr), m_Scene(nullptr), m_NavSystem(nullptr),
-        m_Camera(), m_DeltaTime(0.0f), m_LastFrame(0.0f), m_LastX(640.0f), m_LastY(360.0f), m_bFirstMouse(true)
+        m_Camera(), m_PathStart(-10.0f, 0.0f, -10.0f), m_PathEnd(10.0f, 0.0f, 10.0f), m_PathBudgetMicroseconds(1000.0f), m_SimulateCrowd(false), m_OffMeshBidirectional(true), m_BuildConfig(), m_RebuildDelay(-1.0f), m_DeltaTime(0.0f), m_LastFrame(0.0f), m_LastX(640.0f), m_LastY(360.0f), m_bFirstMouse(true)
 {
     s_Instance = this;
 }
@@ -30,6 +39,20 @@ void Application::Run()
     {
         CalculateDeltaTime();
         InputManager();
+        if (m_NavSystem)
+        {
+            if (m_RebuildDelay >= 0.0f)
+            {
+                m_RebuildDelay -= m_DeltaTime;
+                if (m_RebuildDelay < 0.0f && m_Scene)
+                    m_NavSystem->BuildNavMesh(*m_Scene);
+            }
+            m_NavSystem->UpdateNavMeshStreaming({m_Camera.Position});
+            m_NavSystem->UpdateObstacles();
+            m_NavSystem->UpdatePathRequests(m_PathBudgetMicroseconds, m_Camera.Position);
+            if (m_SimulateCrowd)
+                m_NavSystem->UpdateCrowd(std::min(m_DeltaTime, 0.1f));
+        }
         Render();
 
         glfwSwapBuffers(m_Window);
@@ -85,6 +108,7 @@ bool Application::Init()
     m_Shader = new Shader("../source/shaders/simple.vert", "../source/shaders/simple.frag");
     m_Scene = new Scene();
     m_NavSystem = new NavigationSystem();
+    m_BuildConfig = m_NavSystem->GetBuildConfig();
     
     return true;
 }
@@ -139,9 +163,224 @@ void Application::RenderImGui()
     if (ImGui::Button("Build NavMesh"))
         if (m_NavSystem && m_Scene)
             m_NavSystem->BuildNavMesh(*m_Scene);
+    ImGui::SameLine();
+    if (ImGui::Button("Save NavMesh") && m_NavSystem)
+        m_NavSystem->SaveNavMesh("navmesh.bin");
+    ImGui::SameLine();
+    if (ImGui::Button("Load NavMesh") && m_NavSystem)
+        m_NavSystem->LoadNavMesh("navmesh.bin");
+    ImGui::SameLine();
+    if (ImGui::Button("Stream NavMesh") && m_NavSystem)
+        m_NavSystem->StartNavMeshStreaming("navmesh.bin");
+    if (m_NavSystem && m_NavSystem->GetNavMeshStreamer().IsOpen())
+    {
+        const NavMeshStreamer& streamer = m_NavSystem->GetNavMeshStreamer();
+        ImGui::Text("Streaming: %d tiles loaded, %d pending, %.1f of %.1f KB", streamer.GetLoadedTileCount(), streamer.GetPendingTileCount(),
+                    streamer.GetResidentBytes() / 1024.0f, streamer.GetMemoryBudget() / 1024.0f);
+    }
+    if (m_NavSystem && ImGui::CollapsingHeader("Build Settings"))
+    {
+        // Rebuilds once the sliders have been still for a moment, rerunning only the stages that read a changed value
+        bool changed = false;
+        changed |= ImGui::SliderFloat("Cell Size", &m_BuildConfig.cellSize, 0.25f, 2.0f);
+        changed |= ImGui::SliderFloat("Cell Height", &m_BuildConfig.cellHeight, 0.1f, 2.0f);
+        changed |= ImGui::SliderFloat("Agent Height", &m_BuildConfig.agentHeight, 0.5f, 4.0f);
+        changed |= ImGui::SliderFloat("Agent Radius", &m_BuildConfig.agentRadius, 0.1f, 3.0f);
+        changed |= ImGui::SliderFloat("Max Climb", &m_BuildConfig.maxClimb, 0.0f, 3.0f);
+        changed |= ImGui::SliderInt("Tile Size", &m_BuildConfig.tileSize, 8, 128);
+        if (changed)
+        {
+            m_NavSystem->SetBuildConfig(m_BuildConfig);
+            m_RebuildDelay = REBUILD_DEBOUNCE_SECONDS;
+        }
+        if (ImGui::Button("Build Agent Profiles") && m_Scene)
+            m_NavSystem->BuildNavMeshProfiles(*m_Scene, AGENT_PROFILES);
+        for (int i = 0; i < m_NavSystem->GetProfileCount(); ++i)
+            ImGui::Text("%s: %d polys", m_NavSystem->GetAgentProfile(i).name.c_str(), m_NavSystem->GetProfileNavMesh(i).GetPolyCount());
+    }
     if (m_NavSystem) {
-        const char* items[] = { "None", "Input Triangles", "Voxels (Solid)", "Walkable Surfaces", "Regions", "Connections", "Contours" };
+        const char* items[] = { "None", "Input Triangles", "Voxels (Solid)", "Walkable Surfaces", "Regions", "Connections", "Contours", "NavMesh" };
         ImGui::Combo("Debug Draw", (int*)&m_NavSystem->m_DebugDrawMode, items, IM_ARRAYSIZE(items));
+
+        ImGui::Separator();
+        ImGui::DragFloat3("Path Start", &m_PathStart.x, 0.1f);
+        ImGui::DragFloat3("Path End", &m_PathEnd.x, 0.1f);
+        if (ImGui::Button("Find Path"))
+        {
+            std::vector<glm::vec3> path;
+            m_NavSystem->FindPath(m_PathStart, m_PathEnd, path);
+        }
+        ImGui::SameLine();
+        if (ImGui::Button("Find Span Path (JPS)"))
+        {
+            std::vector<glm::vec3> path;
+            m_NavSystem->FindSpanPath(m_PathStart, m_PathEnd, path);
+        }
+        ImGui::SameLine();
+        if (ImGui::Button("Find Path (HPA*)"))
+        {
+            std::vector<glm::vec3> path;
+            m_NavSystem->FindHierarchicalPath(m_PathStart, m_PathEnd, path);
+        }
+        ImGui::SameLine();
+        if (ImGui::Button("Find Path (Flow Field)"))
+        {
+            std::vector<glm::vec3> path;
+            m_NavSystem->FindFlowFieldPath(m_PathStart, m_PathEnd, path);
+        }
+        NavQueryFilter filter = m_NavSystem->GetQueryFilter();
+        bool filterChanged = false;
+        float roadCost = filter.GetAreaCost(NAVAREA_ROAD), waterCost = filter.GetAreaCost(NAVAREA_WATER);
+        if (ImGui::SliderFloat("Road Cost", &roadCost, 0.1f, 4.0f))
+        {
+            filter.SetAreaCost(NAVAREA_ROAD, roadCost);
+            filterChanged = true;
+        }
+        if (ImGui::SliderFloat("Water Cost", &waterCost, 0.1f, 10.0f))
+        {
+            filter.SetAreaCost(NAVAREA_WATER, waterCost);
+            filterChanged = true;
+        }
+        bool avoidWater = (filter.GetExcludeFlags() & NAVPOLYFLAG_SWIM) != 0;
+        if (ImGui::Checkbox("Avoid Water", &avoidWater))
+        {
+            filter.SetExcludeFlags(avoidWater ? NAVPOLYFLAG_SWIM : 0);
+            filterChanged = true;
+        }
+        if (filterChanged)
+            m_NavSystem->SetQueryFilter(filter);
+        bool useLandmarks = m_NavSystem->AreLandmarksEnabled();
+        if (ImGui::Checkbox("ALT Landmarks", &useLandmarks))
+            m_NavSystem->SetLandmarksEnabled(useLandmarks);
+        ImGui::SameLine();
+        if (ImGui::Button("Request Path"))
+            m_NavSystem->RequestPath(m_PathStart, m_PathEnd);
+        ImGui::DragFloat("Path Budget (us)", &m_PathBudgetMicroseconds, 10.0f, 50.0f, 16000.0f);
+        if (ImGui::Button("Request 1000 Random Paths"))
+            m_NavSystem->RequestRandomPaths(1000);
+        const PathRequestManager& requests = m_NavSystem->GetPathRequestManager();
+        ImGui::Text("Pending paths: %d, last update %.0f us, %d iterations", requests.GetPendingCount(),
+                    requests.GetLastUpdateMicroseconds(), requests.GetLastUpdateIterations());
+
+        ImGui::Separator();
+        if (ImGui::Button("Add Off-Mesh Link"))
+            m_NavSystem->AddOffMeshConnection(m_PathStart, m_PathEnd, 1.0f, m_OffMeshBidirectional);
+        ImGui::SameLine();
+        ImGui::Checkbox("Bidirectional", &m_OffMeshBidirectional);
+        ImGui::SameLine();
+        if (ImGui::Button("Clear Links"))
+            m_NavSystem->ClearOffMeshConnections();
+        ImGui::Text("Off-mesh links: %d, from Path Start to Path End, applied on the next build", (int)m_NavSystem->GetOffMeshConnections().size());
+
+        ImGui::Separator();
+        if (ImGui::Button("Add 10 Obstacles"))
+            m_NavSystem->AddRandomObstacles(10);
+        ImGui::SameLine();
+        if (ImGui::Button("Remove Obstacles"))
+            m_NavSystem->RemoveAllObstacles();
+        const NavMeshTileCache& tileCache = m_NavSystem->GetTileCache();
+        ImGui::Text("Obstacles: %d, tile layers %.1f KB compressed from %.1f KB", tileCache.GetObstacleCount(),
+                    tileCache.GetCompressedBytes() / 1024.0f, tileCache.GetRawBytes() / 1024.0f);
+
+        ImGui::Separator();
+        if (ImGui::Button("Spawn 500 Agents"))
+            m_NavSystem->SpawnCrowdAgents(500);
+        ImGui::SameLine();
+        if (ImGui::Button("Move Crowd To Path End"))
+            m_NavSystem->SetCrowdTarget(m_PathEnd);
+        ImGui::SameLine();
+        ImGui::Checkbox("Simulate Crowd", &m_SimulateCrowd);
+        const Crowd& crowd = m_NavSystem->GetCrowd();
+        const CrowdTimings& timings = crowd.GetLastTimings();
+        ImGui::Text("Agents: %d, update %.2f ms (replan %.2f, steer %.2f, avoid %.2f), %d replans", crowd.GetActiveAgentCount(),
+                    timings.totalMs, timings.replanMs, timings.steerMs, timings.avoidanceMs, timings.replans);
+        if (crowd.GetActiveAgentCount() > 0 && ImGui::CollapsingHeader("Crowd View"))
+        {
+            // Top down view fitted to the agents, moving agents are green, agents on off-mesh links magenta and idle ones grey.
+            glm::vec2 bmin(FLT_MAX), bmax(-FLT_MAX);
+            for (int i = 0; i < crowd.GetMaxAgents(); ++i)
+            {
+                if (!crowd.IsAgentActive(i))
+                    continue;
+                const glm::vec3& pos = crowd.GetAgentPosition(i);
+                bmin = glm::min(bmin, glm::vec2(pos.x, pos.z));
+                bmax = glm::max(bmax, glm::vec2(pos.x, pos.z));
+            }
+            const ImVec2 canvasSize(300.0f, 300.0f);
+            const ImVec2 origin = ImGui::GetCursorScreenPos();
+            ImGui::InvisibleButton("CrowdCanvas", canvasSize);
+            ImDrawList* drawList = ImGui::GetWindowDrawList();
+            drawList->AddRectFilled(origin, ImVec2(origin.x + canvasSize.x, origin.y + canvasSize.y), IM_COL32(30, 30, 30, 255));
+            const float scale = canvasSize.x / std::max(std::max(bmax.x - bmin.x, bmax.y - bmin.y), 1.0f);
+            for (int i = 0; i < crowd.GetMaxAgents(); ++i)
+            {
+                if (!crowd.IsAgentActive(i))
+                    continue;
+                const glm::vec3& pos = crowd.GetAgentPosition(i);
+                const ImVec2 center(origin.x + (pos.x - bmin.x) * scale, origin.y + (pos.z - bmin.y) * scale);
+                const CrowdAgentState state = crowd.GetAgentState(i);
+                const ImU32 color = state == CROWDAGENT_MOVING    ? IM_COL32(80, 220, 80, 255)
+                                    : state == CROWDAGENT_OFFMESH ? IM_COL32(230, 90, 230, 255)
+                                                                  : IM_COL32(160, 160, 160, 255);
+                drawList->AddCircleFilled(center, std::max(crowd.GetAgentRadius(i) * scale, 1.0f), color);
+            }
+        }
+
+        if (ImGui::Button("Benchmark Queries"))
+            m_NavSystem->RunQueryBenchmark(10000);
+        ImGui::SameLine();
+        if (ImGui::Button("Benchmark Span Paths"))
+            m_NavSystem->RunSpanPathBenchmark(100);
+        ImGui::SameLine();
+        if (ImGui::Button("Benchmark BV Tree"))
+            m_NavSystem->RunBVTreeBenchmark(20000);
+        if (ImGui::Button("Benchmark Batch Queries"))
+            m_NavSystem->RunBatchQueryBenchmark(100000);
+        ImGui::SameLine();
+        if (ImGui::Button("Benchmark HPA*"))
+            m_NavSystem->RunHierarchicalPathBenchmark(50);
+        ImGui::SameLine();
+        if (ImGui::Button("Benchmark ALT"))
+            m_NavSystem->RunLandmarkBenchmark(200);
+        ImGui::SameLine();
+        if (ImGui::Button("Benchmark Flow Field"))
+            m_NavSystem->RunFlowFieldBenchmark(1000);
+        if (ImGui::Button("Benchmark Crowd"))
+            m_NavSystem->RunCrowdBenchmark(5000);
+        ImGui::SameLine();
+        if (ImGui::Button("Benchmark Path Corridors"))
+            m_NavSystem->RunPathCorridorBenchmark(1000);
+        ImGui::SameLine();
+        if (ImGui::Button("Benchmark Raycast"))
+            m_NavSystem->RunRaycastBenchmark(20000);
+        ImGui::SameLine();
+        if (ImGui::Button("Benchmark Height Pyramid"))
+            m_NavSystem->RunHeightPyramidBenchmark(20000);
+        if (ImGui::Button("Benchmark NavMesh File"))
+            m_NavSystem->RunNavMeshFileBenchmark();
+        if (ImGui::Button("Benchmark Tile Cache"))
+            m_NavSystem->RunTileCacheBenchmark(1000);
+        ImGui::SameLine();
+        if (ImGui::Button("Benchmark Compression"))
+            m_NavSystem->RunCompressionBenchmark();
+        if (ImGui::Button("Benchmark Streaming"))
+            m_NavSystem->RunStreamingBenchmark();
+        ImGui::SameLine();
+        if (ImGui::Button("Benchmark Agent Profiles"))
+            m_NavSystem->RunAgentProfileBenchmark();
+        if (ImGui::Button("Benchmark Area Costs"))
+            m_NavSystem->RunAreaCostBenchmark(2000);
+        ImGui::SameLine();
+        if (ImGui::Button("Benchmark Off-Mesh Links"))
+            m_NavSystem->RunOffMeshBenchmark(4000);
+        if (ImGui::Button("Benchmark Chunky Tri Mesh"))
+            m_NavSystem->RunChunkyTriMeshBenchmark();
+        ImGui::SameLine();
+        if (ImGui::Button("Benchmark Input Geometry"))
+            m_NavSystem->RunInputGeometryBenchmark(20000);
+        ImGui::SameLine();
+        if (ImGui::Button("Benchmark Box Rasterization"))
+            m_NavSystem->RunBoxRasterizationBenchmark(4000);
     }
     
     ImGui::End();
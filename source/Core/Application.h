@@ -32,6 +32,12 @@ private:
     NavigationSystem* m_NavSystem;
 
     Camera m_Camera;
+    glm::vec3 m_PathStart, m_PathEnd;
+    float m_PathBudgetMicroseconds;
+    bool m_SimulateCrowd;
+    bool m_OffMeshBidirectional;
+    NavBuildConfig m_BuildConfig;
+    float m_RebuildDelay; // Seconds until a settings change triggers a rebuild, negative when none is pending
 
     float m_DeltaTime, m_LastFrame;
     float m_LastX, m_LastY;
@@ -0,0 +1,87 @@
+#include "JobSystem.h"
+#include <algorithm>
+
+JobSystem::JobSystem(int threadCount) : m_Job(nullptr), m_Count(0), m_BatchSize(1), m_NextBatch(0), m_ActiveWorkers(0),
+                                        m_Generation(0), m_bShutdown(false)
+{
+    if (threadCount <= 0)
+        threadCount = (int)std::thread::hardware_concurrency();
+    threadCount = std::max(threadCount, 1);
+
+    for (int i = 1; i < threadCount; ++i)
+        m_Threads.emplace_back(&JobSystem::WorkerLoop, this, i);
+}
+
+JobSystem::~JobSystem()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_bShutdown = true;
+    }
+    m_WakeCondition.notify_all();
+    for (auto& thread : m_Threads)
+        thread.join();
+}
+
+void JobSystem::ParallelFor(int count, int batchSize, const RangeJob& job)
+{
+    if (count <= 0)
+        return;
+    batchSize = std::max(batchSize, 1);
+    if (m_Threads.empty() || count <= batchSize)
+    {
+        job(0, count, 0);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Job = &job;
+        m_Count = count;
+        m_BatchSize = batchSize;
+        m_NextBatch.store(0);
+        m_ActiveWorkers = (int)m_Threads.size();
+        m_Generation++;
+    }
+    m_WakeCondition.notify_all();
+
+    RunBatches(0);
+
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    m_DoneCondition.wait(lock, [this] { return m_ActiveWorkers == 0; });
+    m_Job = nullptr;
+}
+
+void JobSystem::WorkerLoop(int workerIndex)
+{
+    unsigned int seenGeneration = 0;
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_Mutex);
+            m_WakeCondition.wait(lock, [&] { return m_bShutdown || m_Generation != seenGeneration; });
+            if (m_bShutdown)
+                return;
+            seenGeneration = m_Generation;
+        }
+
+        RunBatches(workerIndex);
+
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        if (--m_ActiveWorkers == 0)
+            m_DoneCondition.notify_one();
+    }
+}
+
+void JobSystem::RunBatches(int workerIndex)
+{
+    const int batchCount = (m_Count + m_BatchSize - 1) / m_BatchSize;
+    while (true)
+    {
+        const int batch = m_NextBatch.fetch_add(1);
+        if (batch >= batchCount)
+            return;
+        const int begin = batch * m_BatchSize;
+        (*m_Job)(begin, std::min(begin + m_BatchSize, m_Count), workerIndex);
+    }
+}
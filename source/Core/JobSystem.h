@@ -0,0 +1,38 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed pool of worker threads running one parallel-for at a time.
+// The calling thread joins in as worker 0, so worker indices run from 0 to GetWorkerCount() - 1
+// and can be used to address per-worker scratch data without locking.
+class JobSystem
+{
+public:
+    typedef std::function<void(int begin, int end, int workerIndex)> RangeJob;
+
+    explicit JobSystem(int threadCount = 0); // 0 = one thread per hardware core
+    ~JobSystem();
+
+    // Splits [0, count) into ranges of batchSize and blocks until every range has run.
+    void ParallelFor(int count, int batchSize, const RangeJob& job);
+
+    int GetWorkerCount() const { return (int)m_Threads.size() + 1; }
+private:
+    std::vector<std::thread> m_Threads;
+    std::mutex m_Mutex;
+    std::condition_variable m_WakeCondition, m_DoneCondition;
+
+    const RangeJob* m_Job;
+    int m_Count, m_BatchSize;
+    std::atomic<int> m_NextBatch;
+    int m_ActiveWorkers;
+    unsigned int m_Generation;
+    bool m_bShutdown;
+
+    void WorkerLoop(int workerIndex);
+    void RunBatches(int workerIndex);
+};
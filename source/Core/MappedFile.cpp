@@ -0,0 +1,100 @@
+#include "MappedFile.h"
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+MappedFile::MappedFile() : m_Data(nullptr), m_Size(0), m_File(INVALID_HANDLE_VALUE), m_Mapping(nullptr)
+{
+}
+#else
+MappedFile::MappedFile() : m_Data(nullptr), m_Size(0)
+{
+}
+#endif
+
+MappedFile::~MappedFile()
+{
+    Close();
+}
+
+#ifdef _WIN32
+bool MappedFile::Open(const char* path)
+{
+    Close();
+    m_File = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (m_File == INVALID_HANDLE_VALUE)
+        return false;
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(m_File, &size) || size.QuadPart == 0)
+    {
+        Close();
+        return false;
+    }
+    m_Mapping = CreateFileMappingA(m_File, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+    if (!m_Mapping)
+    {
+        Close();
+        return false;
+    }
+    m_Data = (unsigned char*)MapViewOfFile(m_Mapping, FILE_MAP_COPY, 0, 0, 0);
+    if (!m_Data)
+    {
+        Close();
+        return false;
+    }
+    m_Size = (size_t)size.QuadPart;
+    return true;
+}
+
+void MappedFile::Close()
+{
+    if (m_Data)
+        UnmapViewOfFile(m_Data);
+    if (m_Mapping)
+        CloseHandle(m_Mapping);
+    if (m_File != INVALID_HANDLE_VALUE)
+        CloseHandle(m_File);
+    m_Data = nullptr;
+    m_Size = 0;
+    m_Mapping = nullptr;
+    m_File = INVALID_HANDLE_VALUE;
+}
+#else
+bool MappedFile::Open(const char* path)
+{
+    Close();
+    const int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size == 0)
+    {
+        close(fd);
+        return false;
+    }
+    // The mapping keeps its own reference to the file.
+    void* data = mmap(nullptr, (size_t)info.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED)
+        return false;
+    m_Data = (unsigned char*)data;
+    m_Size = (size_t)info.st_size;
+    return true;
+}
+
+void MappedFile::Close()
+{
+    if (m_Data)
+        munmap(m_Data, m_Size);
+    m_Data = nullptr;
+    m_Size = 0;
+}
+#endif
@@ -0,0 +1,27 @@
+#pragma once
+#include <cstddef>
+
+// Read only file mapped into memory. Pages are copy on write, so data in the mapping can be patched in
+// place without touching the file.
+class MappedFile
+{
+public:
+    MappedFile();
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool Open(const char* path);
+    void Close();
+
+    bool IsOpen() const { return m_Data != nullptr; }
+    unsigned char* GetData() const { return m_Data; }
+    size_t GetSize() const { return m_Size; }
+private:
+    unsigned char* m_Data;
+    size_t m_Size;
+#ifdef _WIN32
+    void* m_File;
+    void* m_Mapping;
+#endif
+};
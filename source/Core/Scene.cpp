@@ -1,4 +1,5 @@
 #include "Scene.h"
+#include "NavSystem/NavMesh.h"
 
 #include <iostream>
 #include <glm/ext/matrix_transform.hpp>
@@ -39,6 +40,19 @@ void Scene::SetupDefaultScene()
     obstacleTransform2 = glm::translate(obstacleTransform2, glm::vec3(5.0f, 1.0f, 5.0f));
     obstacleTransform2 = glm::scale(obstacleTransform2, glm::vec3(2.0f, 2.0f, 2.0f));
     AddObject("Obstacle2", "Cube", obstacleTransform2);
+
+    // Road and pond, thin slabs on the ground that only tag its surface
+    glm::mat4 roadTransform = glm::mat4(1.0f);
+    roadTransform = glm::translate(roadTransform, glm::vec3(0.0f, 0.01f, -9.0f));
+    roadTransform = glm::scale(roadTransform, glm::vec3(30.0f, 0.02f, 3.0f));
+    if (SceneObject* road = AddObject("Road", "Cube", roadTransform))
+        road->navArea = NAVAREA_ROAD;
+
+    glm::mat4 pondTransform = glm::mat4(1.0f);
+    pondTransform = glm::translate(pondTransform, glm::vec3(-8.0f, 0.01f, 7.0f));
+    pondTransform = glm::scale(pondTransform, glm::vec3(8.0f, 0.02f, 8.0f));
+    if (SceneObject* pond = AddObject("Pond", "Cube", pondTransform))
+        pond->navArea = NAVAREA_WATER;
 }
 
 void Scene::Render(Shader* shader)
@@ -57,6 +71,10 @@ void Scene::Render(Shader* shader)
         
         if (object.name == "Ground")
             shader->setVec4("ourColor", glm::vec4(0.4f, 0.4f, 0.4f, 1.0f));
+        else if (object.navArea == NAVAREA_ROAD)
+            shader->setVec4("ourColor", glm::vec4(0.25f, 0.25f, 0.25f, 1.0f));
+        else if (object.navArea == NAVAREA_WATER)
+            shader->setVec4("ourColor", glm::vec4(0.2f, 0.4f, 0.8f, 1.0f));
         else
             shader->setVec4("ourColor", glm::vec4(0.8f, 0.2f, 0.2f, 1.0f));
         
@@ -77,6 +95,7 @@ SceneObject* Scene::AddObject(const std::string& name, const std::string& meshNa
     newObj.name = name;
     newObj.mesh = &m_Meshes.at(meshName);
     newObj.modelMatrix = modelMatrix;
+    newObj.navArea = NAVAREA_GROUND;
     m_Objects.push_back(newObj);
     return &m_Objects.back();
 }
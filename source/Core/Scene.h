@@ -25,6 +25,7 @@ struct SceneObject
     std::string name;
     MeshData* mesh;
     glm::mat4 modelMatrix;
+    unsigned char navArea; // NavAreaType of the object's walkable surfaces
 };
 
 class Scene
@@ -0,0 +1,270 @@
+#include "ChunkyTriMesh.h"
+#include "NavInputGeometry.h"
+#include "Core/JobSystem.h"
+#include <algorithm>
+
+static const int CHUNKY_BOUNDS_BATCH = 4096;
+static const int CHUNKY_SUBTREES_PER_WORKER = 4; // Spare subtrees keep every worker busy while the larger ones finish
+
+struct ChunkyItem
+{
+    glm::vec2 bmin, bmax;
+    int i;
+};
+
+// Range of items in the top levels, it either has two child splits or is a subtree built by a job.
+struct ChunkySplit
+{
+    int begin, end;
+    int left, right;
+    int subtree; // -1 when split further
+};
+
+static void CalcExtents(const ChunkyItem* items, int imin, int imax, glm::vec2& bmin, glm::vec2& bmax)
+{
+    bmin = items[imin].bmin;
+    bmax = items[imin].bmax;
+    for (int i = imin + 1; i < imax; ++i)
+    {
+        bmin = glm::min(bmin, items[i].bmin);
+        bmax = glm::max(bmax, items[i].bmax);
+    }
+}
+
+// Moves the lower half of the centroids along the longer axis in front of the returned split.
+static int SplitItems(ChunkyItem* items, int imin, int imax, const glm::vec2& bmin, const glm::vec2& bmax)
+{
+    const int axis = bmax.y - bmin.y > bmax.x - bmin.x ? 1 : 0;
+    const int split = imin + (imax - imin) / 2;
+    std::nth_element(items + imin, items + split, items + imax,
+                     [axis](const ChunkyItem& a, const ChunkyItem& b) { return a.bmin[axis] + a.bmax[axis] < b.bmin[axis] + b.bmax[axis]; });
+    return split;
+}
+
+static void Subdivide(ChunkyItem* items, int imin, int imax, int trisPerChunk, std::vector<ChunkyTriNode>& nodes)
+{
+    const int nodeIndex = (int)nodes.size();
+    nodes.emplace_back();
+    glm::vec2 bmin, bmax;
+    CalcExtents(items, imin, imax, bmin, bmax);
+    nodes[nodeIndex].bmin = bmin;
+    nodes[nodeIndex].bmax = bmax;
+
+    if (imax - imin <= trisPerChunk)
+    {
+        nodes[nodeIndex].i = imin;
+        nodes[nodeIndex].n = imax - imin;
+        return;
+    }
+
+    const int split = SplitItems(items, imin, imax, bmin, bmax);
+    Subdivide(items, imin, split, trisPerChunk, nodes);
+    Subdivide(items, split, imax, trisPerChunk, nodes);
+    nodes[nodeIndex].i = -((int)nodes.size() - nodeIndex);
+    nodes[nodeIndex].n = 0;
+}
+
+// Splits like Subdivide until every range fits subtreeSize, so the tree comes out the same as a sequential build.
+// The ranges of one level are independent and split in parallel.
+static void SplitTop(ChunkyItem* items, int count, int subtreeSize, JobSystem* jobSystem, std::vector<ChunkySplit>& splits, int& subtreeCount)
+{
+    splits.assign(1, {0, count, -1, -1, -1});
+    std::vector<int> level(1, 0), nextLevel, splitPos;
+    while (!level.empty())
+    {
+        splitPos.assign(level.size(), -1);
+        const JobSystem::RangeJob splitLevel = [&](int begin, int end, int)
+        {
+            for (int k = begin; k < end; ++k)
+            {
+                const ChunkySplit& split = splits[level[k]];
+                if (split.end - split.begin <= subtreeSize)
+                    continue;
+                glm::vec2 bmin, bmax;
+                CalcExtents(items, split.begin, split.end, bmin, bmax);
+                splitPos[k] = SplitItems(items, split.begin, split.end, bmin, bmax);
+            }
+        };
+        if (jobSystem && level.size() > 1)
+            jobSystem->ParallelFor((int)level.size(), 1, splitLevel);
+        else
+            splitLevel(0, (int)level.size(), 0);
+
+        nextLevel.clear();
+        for (size_t k = 0; k < level.size(); ++k)
+        {
+            const int index = level[k];
+            if (splitPos[k] < 0)
+            {
+                splits[index].subtree = subtreeCount++;
+                continue;
+            }
+            const ChunkySplit split = splits[index];
+            splits[index].left = (int)splits.size();
+            splits.push_back({split.begin, splitPos[k], -1, -1, -1});
+            splits[index].right = (int)splits.size();
+            splits.push_back({splitPos[k], split.end, -1, -1, -1});
+            nextLevel.push_back(splits[index].left);
+            nextLevel.push_back(splits[index].right);
+        }
+        level.swap(nextLevel);
+    }
+}
+
+static void EmitSplit(const std::vector<ChunkySplit>& splits, int index, const std::vector<std::vector<ChunkyTriNode>>& subtrees,
+                      std::vector<ChunkyTriNode>& nodes)
+{
+    const ChunkySplit& split = splits[index];
+    if (split.subtree >= 0)
+    {
+        // Escape offsets are relative, the subtree's nodes copy over unchanged.
+        nodes.insert(nodes.end(), subtrees[split.subtree].begin(), subtrees[split.subtree].end());
+        return;
+    }
+    const int nodeIndex = (int)nodes.size();
+    nodes.emplace_back();
+    EmitSplit(splits, split.left, subtrees, nodes);
+    const int rightIndex = (int)nodes.size();
+    EmitSplit(splits, split.right, subtrees, nodes);
+    ChunkyTriNode& node = nodes[nodeIndex];
+    node.bmin = glm::min(nodes[nodeIndex + 1].bmin, nodes[rightIndex].bmin);
+    node.bmax = glm::max(nodes[nodeIndex + 1].bmax, nodes[rightIndex].bmax);
+    node.i = -((int)nodes.size() - nodeIndex);
+    node.n = 0;
+}
+
+ChunkyTriMesh::ChunkyTriMesh() : m_ChunkCount(0), m_MaxTrisPerChunk(0)
+{
+}
+
+void ChunkyTriMesh::Clear()
+{
+    m_Nodes.clear();
+    m_Triangles.clear();
+    m_Bounds.clear();
+    m_ChunkCount = 0;
+    m_MaxTrisPerChunk = 0;
+}
+
+void ChunkyTriMesh::Build(const NavInputGeometry& geometry, int trisPerChunk, JobSystem* jobSystem)
+{
+    Clear();
+    const int triangleCount = geometry.GetTriangleCount();
+    if (triangleCount <= 0 || trisPerChunk <= 0)
+        return;
+
+    std::vector<ChunkyItem> items(triangleCount);
+    const JobSystem::RangeJob calcBounds = [&](int begin, int end, int)
+    {
+        for (int i = begin; i < end; ++i)
+        {
+            glm::vec3 tri[3];
+            geometry.GetTriangle(i, tri);
+            ChunkyItem& item = items[i];
+            item.bmin = glm::vec2(std::min(tri[0].x, std::min(tri[1].x, tri[2].x)), std::min(tri[0].z, std::min(tri[1].z, tri[2].z)));
+            item.bmax = glm::vec2(std::max(tri[0].x, std::max(tri[1].x, tri[2].x)), std::max(tri[0].z, std::max(tri[1].z, tri[2].z)));
+            item.i = i;
+        }
+    };
+    const int workerCount = jobSystem ? jobSystem->GetWorkerCount() : 1;
+    if (workerCount > 1)
+        jobSystem->ParallelFor(triangleCount, CHUNKY_BOUNDS_BATCH, calcBounds);
+    else
+        calcBounds(0, triangleCount, 0);
+
+    const int subtreeSize = workerCount > 1 ? std::max(trisPerChunk, triangleCount / (workerCount * CHUNKY_SUBTREES_PER_WORKER)) : triangleCount;
+    std::vector<ChunkySplit> splits;
+    int subtreeCount = 0;
+    SplitTop(items.data(), triangleCount, subtreeSize, workerCount > 1 ? jobSystem : nullptr, splits, subtreeCount);
+    std::vector<int> subtreeSplits(subtreeCount);
+    for (int i = 0; i < (int)splits.size(); ++i)
+        if (splits[i].subtree >= 0)
+            subtreeSplits[splits[i].subtree] = i;
+
+    std::vector<std::vector<ChunkyTriNode>> subtrees(subtreeCount);
+    const JobSystem::RangeJob buildSubtrees = [&](int begin, int end, int)
+    {
+        for (int s = begin; s < end; ++s)
+        {
+            const ChunkySplit& split = splits[subtreeSplits[s]];
+            subtrees[s].reserve(2 * ((split.end - split.begin) / trisPerChunk + 1));
+            Subdivide(items.data(), split.begin, split.end, trisPerChunk, subtrees[s]);
+        }
+    };
+    if (workerCount > 1 && subtreeCount > 1)
+        jobSystem->ParallelFor(subtreeCount, 1, buildSubtrees);
+    else
+        buildSubtrees(0, subtreeCount, 0);
+
+    size_t nodeCount = splits.size();
+    for (const auto& subtree : subtrees)
+        nodeCount += subtree.size();
+    m_Nodes.reserve(nodeCount);
+    EmitSplit(splits, 0, subtrees, m_Nodes);
+
+    m_Triangles.resize(triangleCount);
+    m_Bounds.resize(triangleCount);
+    for (int i = 0; i < triangleCount; ++i)
+    {
+        m_Triangles[i] = items[i].i;
+        m_Bounds[i] = glm::vec4(items[i].bmin, items[i].bmax);
+    }
+    for (const ChunkyTriNode& node : m_Nodes)
+    {
+        if (node.i < 0)
+            continue;
+        m_ChunkCount++;
+        m_MaxTrisPerChunk = std::max(m_MaxTrisPerChunk, node.n);
+    }
+}
+
+void ChunkyTriMesh::QueryChunks(const glm::vec2& bmin, const glm::vec2& bmax, std::vector<int>& chunks) const
+{
+    chunks.clear();
+    const int nodeCount = (int)m_Nodes.size();
+    int cur = 0;
+    while (cur < nodeCount)
+    {
+        const ChunkyTriNode& node = m_Nodes[cur];
+        const bool overlap = bmin.x <= node.bmax.x && bmax.x >= node.bmin.x && bmin.y <= node.bmax.y && bmax.y >= node.bmin.y;
+        const bool isLeaf = node.i >= 0;
+
+        if (isLeaf && overlap)
+            chunks.push_back(cur);
+
+        if (overlap || isLeaf)
+            cur++;
+        else
+            cur += -node.i;
+    }
+}
+
+void ChunkyTriMesh::QueryTriangles(const glm::vec2& bmin, const glm::vec2& bmax, std::vector<int>& triangles) const
+{
+    triangles.clear();
+    const int nodeCount = (int)m_Nodes.size();
+    int cur = 0;
+    while (cur < nodeCount)
+    {
+        const ChunkyTriNode& node = m_Nodes[cur];
+        const bool overlap = bmin.x <= node.bmax.x && bmax.x >= node.bmin.x && bmin.y <= node.bmax.y && bmax.y >= node.bmin.y;
+        const bool isLeaf = node.i >= 0;
+
+        if (isLeaf && overlap)
+        {
+            for (int i = node.i; i < node.i + node.n; ++i)
+            {
+                const glm::vec4& bounds = m_Bounds[i];
+                if (bmin.x <= bounds.z && bmax.x >= bounds.x && bmin.y <= bounds.w && bmax.y >= bounds.y)
+                    triangles.push_back(m_Triangles[i]);
+            }
+        }
+
+        if (overlap || isLeaf)
+            cur++;
+        else
+            cur += -node.i;
+    }
+    // Input order, so a tile's triangle list does not depend on how the tree was split.
+    std::sort(triangles.begin(), triangles.end());
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include <vector>
+#include <glm/glm.hpp>
+
+struct NavInputGeometry;
+class JobSystem;
+
+// Node with xz bounds, stored in skip-list order like NavBVNode: a leaf holds the position of its first triangle in
+// leaf order (i >= 0) and its triangle count n, an inner node holds the negated offset to the node following its subtree (i < 0).
+struct ChunkyTriNode
+{
+    glm::vec2 bmin, bmax;
+    int i, n;
+};
+
+// 2D AABB tree over a triangle soup, split at the median centroid along the longer xz axis until a chunk holds at most
+// trisPerChunk triangles. Built once per geometry set, it answers which triangles overlap a tile's xz rectangle by
+// visiting only the chunks that do. The top levels are split level by level and the subtrees below them build in parallel.
+class ChunkyTriMesh
+{
+public:
+    ChunkyTriMesh();
+
+    void Build(const NavInputGeometry& geometry, int trisPerChunk, JobSystem* jobSystem);
+    void Clear();
+
+    // Leaf nodes whose bounds overlap the rectangle.
+    void QueryChunks(const glm::vec2& bmin, const glm::vec2& bmax, std::vector<int>& chunks) const;
+    // Input indices of the triangles whose xz bounds overlap the rectangle, ascending.
+    void QueryTriangles(const glm::vec2& bmin, const glm::vec2& bmax, std::vector<int>& triangles) const;
+
+    const std::vector<ChunkyTriNode>& GetNodes() const { return m_Nodes; }
+    const int* GetChunkTriangles(int chunk) const { return &m_Triangles[m_Nodes[chunk].i]; }
+    int GetTriangleCount() const { return (int)m_Triangles.size(); }
+    int GetChunkCount() const { return m_ChunkCount; }
+    int GetMaxTrisPerChunk() const { return m_MaxTrisPerChunk; }
+private:
+    std::vector<ChunkyTriNode> m_Nodes;
+    std::vector<int> m_Triangles;      // Input index of each triangle in leaf order
+    std::vector<glm::vec4> m_Bounds;   // xz bounds of each triangle in leaf order, min x, min z, max x, max z
+    int m_ChunkCount, m_MaxTrisPerChunk;
+};
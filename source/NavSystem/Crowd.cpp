@@ -0,0 +1,666 @@
+#include "Crowd.h"
+#include "Core/JobSystem.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+static const int CROWD_MAX_CORRIDOR = 256;
+static const int CROWD_MAX_NEIGHBORS = 8;
+static const int CROWD_MAX_CANDIDATES = 64;
+static const int CROWD_MAX_REPLANS_PER_UPDATE = 64;
+static const int CROWD_CORRIDOR_LOOKAHEAD = 8;       // Corridor polys checked for rebuilt tiles every update
+static const int CROWD_BATCH_SIZE = 64;
+static const float CROWD_REPLAN_INTERVAL = 2.0f;   // Seconds between checks of the whole corridor of a moving agent
+static const float CROWD_TIME_HORIZON = 2.0f;      // Seconds of look ahead for the velocity obstacles
+static const float CROWD_SLOWDOWN_DISTANCE = 2.0f;
+static const float CROWD_OPTIMIZE_RANGE_SCALE = 30.0f; // Visibility shortcut range in agent radii
+static const float CROWD_MAX_HEIGHT_DIFFERENCE = 2.0f;
+static const float CROWD_OFFMESH_TRIGGER_SCALE = 1.5f; // Distance to an off-mesh entry in agent radii that starts the crossing
+// Floors for zero sized agents, which would otherwise get a zero sized grid and never arrive.
+static const float CROWD_MIN_GRID_CELL_SIZE = 1.0f;
+static const float CROWD_MIN_ARRIVAL_DISTANCE = 0.05f;
+static const float ORCA_EPSILON = 1e-5f;
+
+// --- ORCA, two dimensional over x/z ---
+
+struct OrcaLine
+{
+    glm::vec2 point;
+    glm::vec2 direction;
+};
+
+static float Det(const glm::vec2& a, const glm::vec2& b)
+{
+    return a.x * b.y - a.y * b.x;
+}
+
+// Optimum on line lineNo subject to the lines before it and the speed circle.
+static bool LinearProgram1(const OrcaLine* lines, int lineNo, float radius, const glm::vec2& optVelocity, bool directionOpt,
+                           glm::vec2& result)
+{
+    const OrcaLine& line = lines[lineNo];
+    const float dotProduct = glm::dot(line.point, line.direction);
+    const float discriminant = dotProduct * dotProduct + radius * radius - glm::dot(line.point, line.point);
+    if (discriminant < 0.0f)
+        return false;
+
+    const float sqrtDiscriminant = sqrtf(discriminant);
+    float tLeft = -dotProduct - sqrtDiscriminant;
+    float tRight = -dotProduct + sqrtDiscriminant;
+    for (int i = 0; i < lineNo; ++i)
+    {
+        const float denominator = Det(line.direction, lines[i].direction);
+        const float numerator = Det(lines[i].direction, line.point - lines[i].point);
+        if (fabsf(denominator) <= ORCA_EPSILON)
+        {
+            if (numerator < 0.0f)
+                return false;
+            continue;
+        }
+        const float t = numerator / denominator;
+        if (denominator >= 0.0f)
+            tRight = std::min(tRight, t);
+        else
+            tLeft = std::max(tLeft, t);
+        if (tLeft > tRight)
+            return false;
+    }
+
+    if (directionOpt)
+        result = line.point + (glm::dot(optVelocity, line.direction) > 0.0f ? tRight : tLeft) * line.direction;
+    else
+        result = line.point + glm::clamp(glm::dot(line.direction, optVelocity - line.point), tLeft, tRight) * line.direction;
+    return true;
+}
+
+// Returns lineCount on success, otherwise the index of the line that could not be satisfied.
+static int LinearProgram2(const OrcaLine* lines, int lineCount, float radius, const glm::vec2& optVelocity, bool directionOpt,
+                          glm::vec2& result)
+{
+    if (directionOpt)
+        result = optVelocity * radius;
+    else if (glm::dot(optVelocity, optVelocity) > radius * radius)
+        result = glm::normalize(optVelocity) * radius;
+    else
+        result = optVelocity;
+
+    for (int i = 0; i < lineCount; ++i)
+    {
+        if (Det(lines[i].direction, lines[i].point - result) > 0.0f)
+        {
+            const glm::vec2 tempResult = result;
+            if (!LinearProgram1(lines, i, radius, optVelocity, directionOpt, result))
+            {
+                result = tempResult;
+                return i;
+            }
+        }
+    }
+    return lineCount;
+}
+
+// Infeasible case: minimizes the largest penetration into the constraints from beginLine on.
+static void LinearProgram3(const OrcaLine* lines, int lineCount, int beginLine, float radius, glm::vec2& result)
+{
+    OrcaLine projLines[CROWD_MAX_NEIGHBORS];
+    float distance = 0.0f;
+    for (int i = beginLine; i < lineCount; ++i)
+    {
+        if (Det(lines[i].direction, lines[i].point - result) <= distance)
+            continue;
+
+        int projLineCount = 0;
+        for (int j = 0; j < i; ++j)
+        {
+            OrcaLine line;
+            const float determinant = Det(lines[i].direction, lines[j].direction);
+            if (fabsf(determinant) <= ORCA_EPSILON)
+            {
+                if (glm::dot(lines[i].direction, lines[j].direction) > 0.0f)
+                    continue;
+                line.point = 0.5f * (lines[i].point + lines[j].point);
+            }
+            else
+            {
+                line.point = lines[i].point + (Det(lines[j].direction, lines[i].point - lines[j].point) / determinant) * lines[i].direction;
+            }
+            line.direction = glm::normalize(lines[j].direction - lines[i].direction);
+            projLines[projLineCount++] = line;
+        }
+
+        const glm::vec2 tempResult = result;
+        if (LinearProgram2(projLines, projLineCount, radius, glm::vec2(-lines[i].direction.y, lines[i].direction.x), true, result) <
+            projLineCount)
+            result = tempResult;
+        distance = Det(lines[i].direction, lines[i].point - result);
+    }
+}
+
+// --- Crowd ---
+
+Crowd::Crowd() : m_NavMesh(nullptr), m_JobSystem(nullptr), m_NeighborRange(0.0f), m_ReplanCursor(0), m_GridOrigin(0.0f), m_GridCellSize(1.0f),
+                 m_GridWidth(0), m_GridDepth(0), m_Timings()
+{
+}
+
+Crowd::~Crowd()
+{
+    for (auto& worker : m_Workers)
+        delete worker.query;
+}
+
+bool Crowd::Init(const NavMesh* navMesh, JobSystem* jobSystem, int maxAgents, float maxAgentRadius, int maxQueryNodes)
+{
+    if (!navMesh || !jobSystem || maxAgents <= 0)
+        return false;
+    m_NavMesh = navMesh;
+    m_JobSystem = jobSystem;
+
+    for (auto& worker : m_Workers)
+        delete worker.query;
+    m_Workers.assign(jobSystem->GetWorkerCount(), WorkerContext());
+    for (auto& worker : m_Workers)
+    {
+        worker.query = new NavMeshQuery();
+        worker.query->Init(navMesh, maxQueryNodes);
+        worker.path.resize(CROWD_MAX_CORRIDOR);
+    }
+
+    m_State.assign(maxAgents, CROWDAGENT_INACTIVE);
+    m_Position.assign(maxAgents, glm::vec3(0.0f));
+    m_Velocity.assign(maxAgents, glm::vec3(0.0f));
+    m_DesiredVelocity.assign(maxAgents, glm::vec3(0.0f));
+    m_NewVelocity.assign(maxAgents, glm::vec3(0.0f));
+    m_Target.assign(maxAgents, glm::vec3(0.0f));
+    m_Radius.assign(maxAgents, 0.0f);
+    m_MaxSpeed.assign(maxAgents, 0.0f);
+    m_MaxAcceleration.assign(maxAgents, 0.0f);
+    m_ReplanTimer.assign(maxAgents, 0.0f);
+    m_TargetRef.assign(maxAgents, 0);
+    m_Corridors.assign(maxAgents, PathCorridor());
+    for (auto& corridor : m_Corridors)
+        corridor.Init(CROWD_MAX_CORRIDOR);
+    m_NeedsReplan.assign(maxAgents, 0);
+    m_OffMesh.assign(maxAgents, OffMeshTraversal());
+    m_AgentCell.assign(maxAgents, 0);
+    m_ActiveAgents.clear();
+    m_FreeAgents.clear();
+    m_ReplanCursor = 0;
+    for (int i = maxAgents - 1; i >= 0; --i)
+        m_FreeAgents.push_back(i);
+
+    // The neighbor range covers what two agents can close in on each other within the time horizon.
+    m_NeighborRange = maxAgentRadius * 12.0f;
+    m_GridCellSize = std::max(m_NeighborRange, CROWD_MIN_GRID_CELL_SIZE);
+    m_GridOrigin = navMesh->bmin;
+    const float worldSize = navMesh->tileSize * navMesh->cellSize;
+    m_GridWidth = std::max(1, (int)ceilf(navMesh->tilesX * worldSize / m_GridCellSize));
+    m_GridDepth = std::max(1, (int)ceilf(navMesh->tilesZ * worldSize / m_GridCellSize));
+    m_CellStart.assign(m_GridWidth * m_GridDepth + 1, 0);
+    m_CellCursor.assign(m_GridWidth * m_GridDepth, 0);
+    m_Timings = CrowdTimings();
+    return true;
+}
+
+int Crowd::AddAgent(const glm::vec3& pos, const CrowdAgentParams& params)
+{
+    if (m_FreeAgents.empty() || m_Workers.empty())
+        return -1;
+
+    NavPolyRef ref;
+    glm::vec3 nearest;
+    const glm::vec3 halfExtents(params.radius * 2.0f, CROWD_MAX_HEIGHT_DIFFERENCE, params.radius * 2.0f);
+    if (m_Workers[0].query->FindNearestPoly(pos, halfExtents, m_Filter, ref, nearest) != NAVQUERY_SUCCESS || !ref)
+        return -1;
+
+    const int agent = m_FreeAgents.back();
+    m_FreeAgents.pop_back();
+    m_State[agent] = CROWDAGENT_IDLE;
+    m_Position[agent] = nearest;
+    m_Velocity[agent] = glm::vec3(0.0f);
+    m_DesiredVelocity[agent] = glm::vec3(0.0f);
+    m_NewVelocity[agent] = glm::vec3(0.0f);
+    m_Target[agent] = nearest;
+    m_Radius[agent] = params.radius;
+    m_MaxSpeed[agent] = params.maxSpeed;
+    m_MaxAcceleration[agent] = params.maxAcceleration;
+    // Staggered so periodic corridor checks of agents added together spread over several updates.
+    m_ReplanTimer[agent] = CROWD_REPLAN_INTERVAL * (float)(agent % 64) / 64.0f;
+    m_TargetRef[agent] = ref;
+    m_Corridors[agent].Reset(ref, nearest);
+    m_NeedsReplan[agent] = 0;
+    m_ActiveAgents.push_back(agent);
+    return agent;
+}
+
+void Crowd::RemoveAgent(int index)
+{
+    if (index < 0 || index >= GetMaxAgents() || m_State[index] == CROWDAGENT_INACTIVE)
+        return;
+    m_State[index] = CROWDAGENT_INACTIVE;
+    m_FreeAgents.push_back(index);
+    RebuildActiveList();
+}
+
+void Crowd::RemoveAllAgents()
+{
+    for (int agent : m_ActiveAgents)
+    {
+        m_State[agent] = CROWDAGENT_INACTIVE;
+        m_FreeAgents.push_back(agent);
+    }
+    m_ActiveAgents.clear();
+}
+
+void Crowd::RebuildActiveList()
+{
+    m_ActiveAgents.clear();
+    for (int i = 0; i < GetMaxAgents(); ++i)
+        if (m_State[i] != CROWDAGENT_INACTIVE)
+            m_ActiveAgents.push_back(i);
+}
+
+bool Crowd::RequestMoveTarget(int index, const glm::vec3& target)
+{
+    if (index < 0 || index >= GetMaxAgents() || m_State[index] == CROWDAGENT_INACTIVE)
+        return false;
+
+    NavPolyRef ref;
+    glm::vec3 nearest;
+    const glm::vec3 halfExtents(m_Radius[index] * 2.0f, CROWD_MAX_HEIGHT_DIFFERENCE, m_Radius[index] * 2.0f);
+    if (m_Workers[0].query->FindNearestPoly(target, halfExtents, m_Filter, ref, nearest) != NAVQUERY_SUCCESS || !ref)
+        return false;
+
+    m_Target[index] = nearest;
+    m_TargetRef[index] = ref;
+    m_NeedsReplan[index] = 1;
+    // An agent on a connection finishes crossing it, the replan is picked up when it lands.
+    if (m_State[index] != CROWDAGENT_OFFMESH)
+        m_State[index] = CROWDAGENT_MOVING;
+    return true;
+}
+
+void Crowd::Update(float dt)
+{
+    m_Timings = CrowdTimings();
+    if (!m_NavMesh || m_ActiveAgents.empty() || dt <= 0.0f)
+        return;
+
+    typedef std::chrono::high_resolution_clock Clock;
+    auto elapsedMs = [](Clock::time_point from) { return std::chrono::duration<float, std::milli>(Clock::now() - from).count(); };
+    const Clock::time_point begin = Clock::now();
+    const int agentCount = (int)m_ActiveAgents.size();
+
+    // Full searches only for new targets, corridors that could not be repaired, and partial corridors whose
+    // periodic check came up. Capped per update.
+    Clock::time_point phase = Clock::now();
+    // The scan starts where the previous one stopped so no agent waits behind the cap for long.
+    m_ReplanAgents.clear();
+    m_ReplanCursor = m_ReplanCursor < agentCount ? m_ReplanCursor : 0;
+    int nextCursor = m_ReplanCursor;
+    for (int i = 0; i < agentCount; ++i)
+    {
+        const int agent = m_ActiveAgents[(m_ReplanCursor + i) % agentCount];
+        if (m_State[agent] != CROWDAGENT_MOVING)
+            continue;
+        m_ReplanTimer[agent] -= dt;
+        const bool partial = m_Corridors[agent].GetLastPoly() != m_TargetRef[agent];
+        if ((m_NeedsReplan[agent] || (partial && m_ReplanTimer[agent] <= 0.0f)) && (int)m_ReplanAgents.size() < CROWD_MAX_REPLANS_PER_UPDATE)
+        {
+            m_ReplanAgents.push_back(agent);
+            nextCursor = (m_ReplanCursor + i + 1) % agentCount;
+        }
+    }
+    m_ReplanCursor = nextCursor;
+    if (!m_ReplanAgents.empty())
+    {
+        m_JobSystem->ParallelFor((int)m_ReplanAgents.size(), 4, [this](int rangeBegin, int rangeEnd, int workerIndex)
+            {
+                for (int i = rangeBegin; i < rangeEnd; ++i)
+                    Replan(m_ReplanAgents[i], m_Workers[workerIndex]);
+            });
+    }
+    m_Timings.replans = (int)m_ReplanAgents.size();
+    m_Timings.replanMs = elapsedMs(phase);
+
+    phase = Clock::now();
+    m_JobSystem->ParallelFor(agentCount, CROWD_BATCH_SIZE, [this, dt](int rangeBegin, int rangeEnd, int workerIndex)
+        {
+            for (int i = rangeBegin; i < rangeEnd; ++i)
+            {
+                UpdateCorridor(m_ActiveAgents[i], *m_Workers[workerIndex].query);
+                Steer(m_ActiveAgents[i], dt, *m_Workers[workerIndex].query);
+            }
+        });
+    m_Timings.steerMs = elapsedMs(phase);
+
+    phase = Clock::now();
+    BuildGrid();
+    m_Timings.gridMs = elapsedMs(phase);
+
+    phase = Clock::now();
+    m_JobSystem->ParallelFor(agentCount, CROWD_BATCH_SIZE, [this, dt](int rangeBegin, int rangeEnd, int)
+        {
+            for (int i = rangeBegin; i < rangeEnd; ++i)
+                ComputeAvoidance(m_ActiveAgents[i], dt);
+        });
+    m_Timings.avoidanceMs = elapsedMs(phase);
+
+    phase = Clock::now();
+    m_JobSystem->ParallelFor(agentCount, CROWD_BATCH_SIZE, [this, dt](int rangeBegin, int rangeEnd, int workerIndex)
+        {
+            for (int i = rangeBegin; i < rangeEnd; ++i)
+                Integrate(m_ActiveAgents[i], dt, *m_Workers[workerIndex].query);
+        });
+    m_Timings.integrateMs = elapsedMs(phase);
+    m_Timings.totalMs = elapsedMs(begin);
+}
+
+void Crowd::Replan(int agent, WorkerContext& worker)
+{
+    PathCorridor& corridor = m_Corridors[agent];
+    const glm::vec3 halfExtents(m_Radius[agent] * 2.0f, CROWD_MAX_HEIGHT_DIFFERENCE, m_Radius[agent] * 2.0f);
+    NavPolyRef startRef = corridor.GetFirstPoly();
+    glm::vec3 nearest;
+    if (!m_NavMesh->IsValidPolyRef(startRef))
+        worker.query->FindNearestPoly(m_Position[agent], halfExtents, m_Filter, startRef, nearest);
+    if (!m_NavMesh->IsValidPolyRef(m_TargetRef[agent]))
+        worker.query->FindNearestPoly(m_Target[agent], halfExtents, m_Filter, m_TargetRef[agent], nearest);
+
+    m_NeedsReplan[agent] = 0;
+    m_ReplanTimer[agent] = CROWD_REPLAN_INTERVAL;
+    int pathCount = 0;
+    if (!startRef || worker.query->FindPath(startRef, m_TargetRef[agent], m_Position[agent], m_Target[agent], m_Filter, worker.path.data(),
+                                            pathCount, (int)worker.path.size()) == NAVQUERY_FAILURE || pathCount == 0)
+    {
+        // Target cannot be reached from here, stand still on the current poly.
+        corridor.Reset(startRef, m_Position[agent]);
+        m_State[agent] = CROWDAGENT_IDLE;
+        return;
+    }
+    if (startRef != corridor.GetFirstPoly())
+        corridor.Reset(startRef, m_Position[agent]);
+    corridor.SetCorridor(m_Target[agent], worker.path.data(), pathCount);
+}
+
+// Repairs the stretches of the corridor on rebuilt tiles, the first polys every update and all of it periodically.
+void Crowd::UpdateCorridor(int agent, NavMeshQuery& query)
+{
+    if (m_State[agent] != CROWDAGENT_MOVING)
+        return;
+    PathCorridor& corridor = m_Corridors[agent];
+    const bool periodic = m_ReplanTimer[agent] <= 0.0f;
+    if (!corridor.IsValid(periodic ? corridor.GetPathCount() : CROWD_CORRIDOR_LOOKAHEAD, *m_NavMesh, m_Filter))
+    {
+        const glm::vec3 halfExtents(m_Radius[agent] * 2.0f, CROWD_MAX_HEIGHT_DIFFERENCE, m_Radius[agent] * 2.0f);
+        if (corridor.Repair(query, m_Filter, halfExtents) == NAVQUERY_SUCCESS)
+        {
+            if (!m_NavMesh->IsValidPolyRef(m_TargetRef[agent]))
+                m_TargetRef[agent] = corridor.GetLastPoly();
+            m_Position[agent] = corridor.GetPos();
+        }
+        else
+        {
+            m_NeedsReplan[agent] = 1;
+        }
+    }
+    if (periodic && corridor.GetLastPoly() == m_TargetRef[agent])
+        m_ReplanTimer[agent] = CROWD_REPLAN_INTERVAL;
+}
+
+// Desired velocity toward the next corner of the corridor, limited by the agent's acceleration.
+void Crowd::Steer(int agent, float dt, NavMeshQuery& query)
+{
+    if (m_State[agent] == CROWDAGENT_OFFMESH)
+    {
+        UpdateOffMesh(agent, dt);
+        return;
+    }
+    glm::vec3 desired(0.0f);
+    PathCorridor& corridor = m_Corridors[agent];
+    // Agents waiting for their search stand still.
+    if (m_State[agent] == CROWDAGENT_MOVING && !m_NeedsReplan[agent] && corridor.GetPathCount() > 0)
+    {
+        const glm::vec3& pos = m_Position[agent];
+        OffMeshTraversal& offMesh = m_OffMesh[agent];
+        if (corridor.MoveOverOffMeshConnection(m_Radius[agent] * CROWD_OFFMESH_TRIGGER_SCALE, query, offMesh.startPos, offMesh.endPos))
+        {
+            const float speed = std::max(m_MaxSpeed[agent], 0.01f);
+            offMesh.initPos = pos;
+            offMesh.time = 0.0f;
+            offMesh.approachTime = glm::distance(pos, offMesh.startPos) / speed;
+            offMesh.duration = offMesh.approachTime + glm::distance(offMesh.startPos, offMesh.endPos) / speed;
+            m_State[agent] = CROWDAGENT_OFFMESH;
+            UpdateOffMesh(agent, dt);
+            return;
+        }
+        glm::vec3 corners[2];
+        const int cornerCount = corridor.FindCorners(corners, 2, query);
+
+        // The end of a partial corridor is the closest reachable point, the periodic check extends it if the search was cut short.
+        glm::vec3 end;
+        query.ClosestPointOnPoly(corridor.GetLastPoly(), corridor.GetTarget(), end);
+        const glm::vec3 steerTarget = cornerCount > 0 ? corners[0] : end;
+        const glm::vec2 offset(steerTarget.x - pos.x, steerTarget.z - pos.z);
+        const bool finalCorner = fabsf(steerTarget.x - end.x) < 0.01f && fabsf(steerTarget.z - end.z) < 0.01f;
+        const float distance = glm::length(offset);
+        if (finalCorner && distance < std::max(m_Radius[agent] * 0.5f, CROWD_MIN_ARRIVAL_DISTANCE))
+        {
+            m_State[agent] = CROWDAGENT_IDLE;
+        }
+        else
+        {
+            float speed = m_MaxSpeed[agent];
+            if (finalCorner)
+                speed *= std::min(1.0f, distance / CROWD_SLOWDOWN_DISTANCE);
+            desired = glm::vec3(offset.x, 0.0f, offset.y) * (speed / std::max(distance, 0.0001f));
+
+            // Cut the corridor short when the corner after the next one is already in sight.
+            if (cornerCount > 0)
+                corridor.OptimizePathVisibility(corners[cornerCount - 1], m_Radius[agent] * CROWD_OPTIMIZE_RANGE_SCALE, query, m_Filter);
+        }
+    }
+
+    glm::vec3 dv = desired - m_Velocity[agent];
+    const float maxDelta = m_MaxAcceleration[agent] * dt;
+    const float deltaLength = glm::length(dv);
+    if (deltaLength > maxDelta)
+        dv *= maxDelta / deltaLength;
+    m_DesiredVelocity[agent] = m_Velocity[agent] + dv;
+}
+
+// Moves the agent along its connection, first onto the entry and then on to the exit, where the corridor already starts.
+void Crowd::UpdateOffMesh(int agent, float dt)
+{
+    OffMeshTraversal& offMesh = m_OffMesh[agent];
+    const glm::vec3 previous = m_Position[agent];
+    offMesh.time += dt;
+    if (offMesh.time >= offMesh.duration)
+    {
+        m_Position[agent] = offMesh.endPos;
+        m_State[agent] = CROWDAGENT_MOVING;
+    }
+    else if (offMesh.time < offMesh.approachTime)
+    {
+        m_Position[agent] = glm::mix(offMesh.initPos, offMesh.startPos, offMesh.time / offMesh.approachTime);
+    }
+    else
+    {
+        m_Position[agent] = glm::mix(offMesh.startPos, offMesh.endPos, (offMesh.time - offMesh.approachTime) / (offMesh.duration - offMesh.approachTime));
+    }
+    // Kept for the neighbors' avoidance, the agent itself does not avoid while crossing.
+    m_Velocity[agent] = glm::vec3(m_Position[agent].x - previous.x, 0.0f, m_Position[agent].z - previous.z) / dt;
+    m_DesiredVelocity[agent] = m_Velocity[agent];
+}
+
+// Counting sort of the agents by grid cell.
+void Crowd::BuildGrid()
+{
+    std::fill(m_CellStart.begin(), m_CellStart.end(), 0);
+    for (int agent : m_ActiveAgents)
+    {
+        const int cx = glm::clamp((int)((m_Position[agent].x - m_GridOrigin.x) / m_GridCellSize), 0, m_GridWidth - 1);
+        const int cz = glm::clamp((int)((m_Position[agent].z - m_GridOrigin.z) / m_GridCellSize), 0, m_GridDepth - 1);
+        m_AgentCell[agent] = cx + cz * m_GridWidth;
+        m_CellStart[m_AgentCell[agent] + 1]++;
+    }
+    for (int i = 0; i < m_GridWidth * m_GridDepth; ++i)
+    {
+        m_CellStart[i + 1] += m_CellStart[i];
+        m_CellCursor[i] = m_CellStart[i];
+    }
+    m_CellAgents.resize(m_ActiveAgents.size());
+    for (int agent : m_ActiveAgents)
+        m_CellAgents[m_CellCursor[m_AgentCell[agent]]++] = agent;
+}
+
+void Crowd::ComputeAvoidance(int agent, float dt)
+{
+    if (m_State[agent] == CROWDAGENT_OFFMESH)
+    {
+        m_NewVelocity[agent] = m_Velocity[agent];
+        return;
+    }
+    const glm::vec3& pos = m_Position[agent];
+    const float range = m_NeighborRange;
+
+    // Candidates are gathered from the neighboring cells into flat arrays in chunks, each chunk gets one
+    // tight distance loop and is merged into the closest few within range, kept sorted by distance.
+    float candidateX[CROWD_MAX_CANDIDATES], candidateZ[CROWD_MAX_CANDIDATES], candidateDistSq[CROWD_MAX_CANDIDATES];
+    int candidates[CROWD_MAX_CANDIDATES];
+    int candidateCount = 0;
+    int neighbors[CROWD_MAX_NEIGHBORS];
+    float neighborDistSq[CROWD_MAX_NEIGHBORS];
+    int neighborCount = 0;
+    auto mergeCandidates = [&]()
+    {
+        for (int i = 0; i < candidateCount; ++i)
+            candidateDistSq[i] = candidateX[i] * candidateX[i] + candidateZ[i] * candidateZ[i];
+        for (int i = 0; i < candidateCount; ++i)
+        {
+            const float distSq = candidateDistSq[i];
+            if (distSq > range * range || (neighborCount == CROWD_MAX_NEIGHBORS && distSq >= neighborDistSq[neighborCount - 1]))
+                continue;
+            int slot = std::min(neighborCount, CROWD_MAX_NEIGHBORS - 1);
+            for (; slot > 0 && neighborDistSq[slot - 1] > distSq; --slot)
+            {
+                neighbors[slot] = neighbors[slot - 1];
+                neighborDistSq[slot] = neighborDistSq[slot - 1];
+            }
+            neighbors[slot] = candidates[i];
+            neighborDistSq[slot] = distSq;
+            neighborCount = std::min(neighborCount + 1, CROWD_MAX_NEIGHBORS);
+        }
+        candidateCount = 0;
+    };
+
+    const int minX = glm::clamp((int)((pos.x - range - m_GridOrigin.x) / m_GridCellSize), 0, m_GridWidth - 1);
+    const int maxX = glm::clamp((int)((pos.x + range - m_GridOrigin.x) / m_GridCellSize), 0, m_GridWidth - 1);
+    const int minZ = glm::clamp((int)((pos.z - range - m_GridOrigin.z) / m_GridCellSize), 0, m_GridDepth - 1);
+    const int maxZ = glm::clamp((int)((pos.z + range - m_GridOrigin.z) / m_GridCellSize), 0, m_GridDepth - 1);
+    for (int z = minZ; z <= maxZ; ++z)
+    {
+        for (int x = minX; x <= maxX; ++x)
+        {
+            const int cell = x + z * m_GridWidth;
+            for (int i = m_CellStart[cell]; i < m_CellStart[cell + 1]; ++i)
+            {
+                const int other = m_CellAgents[i];
+                if (other == agent || fabsf(m_Position[other].y - pos.y) > CROWD_MAX_HEIGHT_DIFFERENCE)
+                    continue;
+                candidates[candidateCount] = other;
+                candidateX[candidateCount] = m_Position[other].x - pos.x;
+                candidateZ[candidateCount] = m_Position[other].z - pos.z;
+                if (++candidateCount == CROWD_MAX_CANDIDATES)
+                    mergeCandidates();
+            }
+        }
+    }
+    mergeCandidates();
+
+    // One ORCA half-plane per neighbor, both agents take half of the avoidance.
+    const glm::vec2 velocity(m_Velocity[agent].x, m_Velocity[agent].z);
+    const float invTimeHorizon = 1.0f / CROWD_TIME_HORIZON;
+    OrcaLine lines[CROWD_MAX_NEIGHBORS];
+    for (int n = 0; n < neighborCount; ++n)
+    {
+        const int other = neighbors[n];
+        const glm::vec2 relativePosition(m_Position[other].x - pos.x, m_Position[other].z - pos.z);
+        const glm::vec2 relativeVelocity = velocity - glm::vec2(m_Velocity[other].x, m_Velocity[other].z);
+        const float distSq = neighborDistSq[n];
+        const float combinedRadius = m_Radius[agent] + m_Radius[other];
+        const float combinedRadiusSq = combinedRadius * combinedRadius;
+
+        OrcaLine& line = lines[n];
+        glm::vec2 u;
+        if (distSq > combinedRadiusSq)
+        {
+            const glm::vec2 w = relativeVelocity - invTimeHorizon * relativePosition;
+            const float wLengthSq = glm::dot(w, w);
+            const float dotProduct = glm::dot(w, relativePosition);
+            if (dotProduct < 0.0f && dotProduct * dotProduct > combinedRadiusSq * wLengthSq)
+            {
+                // Closest point is on the cut-off circle.
+                const float wLength = sqrtf(wLengthSq);
+                const glm::vec2 unitW = w / wLength;
+                line.direction = glm::vec2(unitW.y, -unitW.x);
+                u = (combinedRadius * invTimeHorizon - wLength) * unitW;
+            }
+            else
+            {
+                // Closest point is on one of the legs.
+                const float leg = sqrtf(distSq - combinedRadiusSq);
+                if (Det(relativePosition, w) > 0.0f)
+                    line.direction = glm::vec2(relativePosition.x * leg - relativePosition.y * combinedRadius,
+                                               relativePosition.x * combinedRadius + relativePosition.y * leg) / distSq;
+                else
+                    line.direction = -glm::vec2(relativePosition.x * leg + relativePosition.y * combinedRadius,
+                                                -relativePosition.x * combinedRadius + relativePosition.y * leg) / distSq;
+                u = glm::dot(relativeVelocity, line.direction) * line.direction - relativeVelocity;
+            }
+        }
+        else
+        {
+            // Already overlapping, resolve within one step.
+            const float invTimeStep = 1.0f / dt;
+            const glm::vec2 w = relativeVelocity - invTimeStep * relativePosition;
+            float wLength = glm::length(w);
+            glm::vec2 unitW;
+            if (wLength > ORCA_EPSILON)
+            {
+                unitW = w / wLength;
+            }
+            else
+            {
+                // Same position and velocity, split the pair along a direction both agents derive from their indices.
+                const float angle = (float)(std::min(agent, other) * 7919 + std::max(agent, other)) * 0.618034f;
+                unitW = glm::vec2(cosf(angle), sinf(angle)) * (agent < other ? 1.0f : -1.0f);
+                wLength = 0.0f;
+            }
+            line.direction = glm::vec2(unitW.y, -unitW.x);
+            u = (combinedRadius * invTimeStep - wLength) * unitW;
+        }
+        line.point = velocity + 0.5f * u;
+    }
+
+    const glm::vec2 preferred(m_DesiredVelocity[agent].x, m_DesiredVelocity[agent].z);
+    glm::vec2 result;
+    const int failedLine = LinearProgram2(lines, neighborCount, m_MaxSpeed[agent], preferred, false, result);
+    if (failedLine < neighborCount)
+        LinearProgram3(lines, neighborCount, failedLine, m_MaxSpeed[agent], result);
+    m_NewVelocity[agent] = glm::vec3(result.x, 0.0f, result.y);
+}
+
+// Moves the agent with its avoidance velocity, constrained to the mesh by walking the corridor's first polys.
+void Crowd::Integrate(int agent, float dt, NavMeshQuery& query)
+{
+    if (m_State[agent] == CROWDAGENT_OFFMESH)
+        return;
+    m_Velocity[agent] = m_NewVelocity[agent];
+    PathCorridor& corridor = m_Corridors[agent];
+    if (corridor.MovePosition(m_Position[agent] + m_Velocity[agent] * dt, query, m_Filter))
+        m_Position[agent] = corridor.GetPos();
+    else
+        m_Velocity[agent] = glm::vec3(0.0f); // First poly was rebuilt, the corridor is repaired next update
+}
@@ -0,0 +1,105 @@
+#pragma once
+#include <vector>
+#include "PathCorridor.h"
+
+class JobSystem;
+
+struct CrowdAgentParams
+{
+    float radius;
+    float maxSpeed;
+    float maxAcceleration;
+};
+
+enum CrowdAgentState
+{
+    CROWDAGENT_INACTIVE,
+    CROWDAGENT_IDLE,
+    CROWDAGENT_MOVING,
+    CROWDAGENT_OFFMESH // Crossing an off-mesh connection, off the surface and out of the avoidance
+};
+
+struct CrowdTimings
+{
+    float replanMs, steerMs, gridMs, avoidanceMs, integrateMs, totalMs;
+    int replans;
+};
+
+// Agents moving over the navmesh. Agent state is kept in parallel arrays indexed by agent, a uniform
+// grid over the agents is rebuilt every update for the neighbor queries, and the per agent phases
+// (replanning, corridor steering, ORCA avoidance, integration) run as parallel-for jobs. Each agent
+// follows a PathCorridor from its own A*, kept up to date locally; full searches are only run for new targets,
+// corridors that cannot be repaired and periodically for partial ones. Off-mesh connections in a corridor are
+// crossed at the agent's max speed once it comes within reach of their entry.
+class Crowd
+{
+public:
+    Crowd();
+    ~Crowd();
+
+    bool Init(const NavMesh* navMesh, JobSystem* jobSystem, int maxAgents, float maxAgentRadius, int maxQueryNodes);
+
+    int AddAgent(const glm::vec3& pos, const CrowdAgentParams& params); // -1 when full or not on the navmesh
+    void RemoveAgent(int index);
+    void RemoveAllAgents();
+    bool RequestMoveTarget(int index, const glm::vec3& target);
+    // Area costs and flags of the agents' searches and corridor moves.
+    void SetFilter(const NavQueryFilter& filter) { m_Filter = filter; }
+    void Update(float dt);
+
+    int GetMaxAgents() const { return (int)m_State.size(); }
+    int GetActiveAgentCount() const { return (int)m_ActiveAgents.size(); }
+    bool IsAgentActive(int index) const { return m_State[index] != CROWDAGENT_INACTIVE; }
+    CrowdAgentState GetAgentState(int index) const { return (CrowdAgentState)m_State[index]; }
+    const glm::vec3& GetAgentPosition(int index) const { return m_Position[index]; }
+    const glm::vec3& GetAgentVelocity(int index) const { return m_Velocity[index]; }
+    float GetAgentRadius(int index) const { return m_Radius[index]; }
+    const CrowdTimings& GetLastTimings() const { return m_Timings; }
+private:
+    struct WorkerContext
+    {
+        NavMeshQuery* query;
+        std::vector<NavPolyRef> path;
+    };
+    struct OffMeshTraversal
+    {
+        glm::vec3 initPos, startPos, endPos;
+        float time, approachTime, duration; // Seconds, the approach moves from initPos to the entry
+    };
+
+    const NavMesh* m_NavMesh;
+    JobSystem* m_JobSystem;
+    NavQueryFilter m_Filter;
+    std::vector<WorkerContext> m_Workers;
+    float m_NeighborRange;
+
+    // Agent state, one entry per agent slot
+    std::vector<unsigned char> m_State;
+    std::vector<glm::vec3> m_Position, m_Velocity, m_DesiredVelocity, m_NewVelocity, m_Target;
+    std::vector<float> m_Radius, m_MaxSpeed, m_MaxAcceleration, m_ReplanTimer;
+    std::vector<NavPolyRef> m_TargetRef;
+    std::vector<PathCorridor> m_Corridors;
+    std::vector<unsigned char> m_NeedsReplan;
+    std::vector<OffMeshTraversal> m_OffMesh;
+    std::vector<int> m_ActiveAgents;
+    std::vector<int> m_FreeAgents;
+    std::vector<int> m_ReplanAgents;
+    int m_ReplanCursor;
+
+    // Uniform grid, agents sorted by cell
+    glm::vec3 m_GridOrigin;
+    float m_GridCellSize;
+    int m_GridWidth, m_GridDepth;
+    std::vector<int> m_AgentCell, m_CellStart, m_CellCursor, m_CellAgents;
+
+    CrowdTimings m_Timings;
+
+    void Replan(int agent, WorkerContext& worker);
+    void UpdateCorridor(int agent, NavMeshQuery& query);
+    void Steer(int agent, float dt, NavMeshQuery& query);
+    void UpdateOffMesh(int agent, float dt);
+    void BuildGrid();
+    void ComputeAvoidance(int agent, float dt);
+    void Integrate(int agent, float dt, NavMeshQuery& query);
+    void RebuildActiveList();
+};
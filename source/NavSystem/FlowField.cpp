@@ -0,0 +1,360 @@
+#include "FlowField.h"
+#include "NavigationSystem.h"
+#include <algorithm>
+#include <cfloat>
+#include <cstdlib>
+
+static const float DIAGONAL_COST = 1.41421356f;
+static const int DIRECTION_X[8] = { -1, 0, 1, 0, -1, 1, 1, -1 };
+static const int DIRECTION_Z[8] = { 0, -1, 0, 1, -1, -1, 1, 1 };
+
+FlowFieldCache::FlowFieldCache() : m_HeightField(nullptr), m_TileSize(0), m_TilesX(0), m_GoalRadius(0), m_UseCounter(0)
+{
+}
+
+FlowFieldCache::~FlowFieldCache()
+{
+    Clear();
+    for (FlowField* field : m_Fields)
+        delete field;
+}
+
+void FlowFieldCache::Init(const HeightField* heightField, int tileSize, int maxFields, int goalRadius)
+{
+    Clear();
+    for (FlowField* field : m_Fields)
+        delete field;
+    m_Fields.clear();
+
+    m_HeightField = heightField;
+    m_TileSize = tileSize;
+    m_GoalRadius = goalRadius;
+    m_SpanTile.clear();
+    m_SpanLocal.clear();
+    m_SpanX.clear();
+    m_SpanZ.clear();
+    m_TileSpanCount.clear();
+    m_TileFirstSpan.clear();
+    m_TileSpans.clear();
+    m_UseCounter = 0;
+    if (!heightField || heightField->spanPool.empty() || tileSize <= 0 || maxFields <= 0)
+        return;
+
+    const HeightField& hf = *heightField;
+    const HeightFieldSpan* pool = &hf.spanPool[0];
+    m_TilesX = (hf.width + tileSize - 1) / tileSize;
+    const int tilesZ = (hf.depth + tileSize - 1) / tileSize;
+    m_SpanTile.assign(hf.spanPool.size(), NAV_NULL_SPAN);
+    m_SpanLocal.assign(hf.spanPool.size(), 0);
+    m_SpanX.assign(hf.spanPool.size(), 0);
+    m_SpanZ.assign(hf.spanPool.size(), 0);
+    m_TileSpanCount.assign(m_TilesX * tilesZ, 0);
+    m_TileFirstSpan.assign(m_TilesX * tilesZ, 0);
+
+    // Walkable spans are grouped per tile so a tile's costs and directions are contiguous.
+    for (int tz = 0; tz < tilesZ; ++tz)
+    {
+        for (int tx = 0; tx < m_TilesX; ++tx)
+        {
+            const unsigned int tileIndex = tx + tz * m_TilesX;
+            m_TileFirstSpan[tileIndex] = (unsigned int)m_TileSpans.size();
+            for (int z = tz * tileSize; z < std::min((tz + 1) * tileSize, hf.depth); ++z)
+            {
+                for (int x = tx * tileSize; x < std::min((tx + 1) * tileSize, hf.width); ++x)
+                {
+                    for (const HeightFieldSpan* span = hf.spans[x + z * hf.width]; span; span = span->next)
+                    {
+                        if (span->areaID == 0)
+                            continue;
+                        const unsigned int spanIndex = (unsigned int)(span - pool);
+                        m_SpanTile[spanIndex] = tileIndex;
+                        m_SpanLocal[spanIndex] = (unsigned short)m_TileSpanCount[tileIndex]++;
+                        m_SpanX[spanIndex] = (unsigned short)x;
+                        m_SpanZ[spanIndex] = (unsigned short)z;
+                        m_TileSpans.push_back(spanIndex);
+                    }
+                }
+            }
+        }
+    }
+
+    for (int i = 0; i < maxFields; ++i)
+    {
+        FlowField* field = new FlowField();
+        field->goalSpan = NAV_NULL_SPAN;
+        field->lastUse = 0;
+        field->computedTiles = 0;
+        field->complete = false;
+        m_Fields.push_back(field);
+    }
+}
+
+void FlowFieldCache::Clear()
+{
+    for (FlowField* field : m_Fields)
+    {
+        for (FlowTile* tile : field->tiles)
+            delete tile;
+        field->tiles.clear();
+        field->open.clear();
+        field->goalSpan = NAV_NULL_SPAN;
+        field->lastUse = 0;
+        field->computedTiles = 0;
+        field->complete = false;
+    }
+}
+
+int FlowFieldCache::AcquireField(unsigned int goalSpan)
+{
+    if (goalSpan >= m_SpanTile.size() || m_SpanTile[goalSpan] == NAV_NULL_SPAN)
+        return -1;
+
+    int oldest = 0;
+    for (int i = 0; i < (int)m_Fields.size(); ++i)
+    {
+        if (m_Fields[i]->goalSpan == goalSpan)
+        {
+            m_Fields[i]->lastUse = ++m_UseCounter;
+            return i;
+        }
+        if (m_Fields[i]->lastUse < m_Fields[oldest]->lastUse)
+            oldest = i;
+    }
+
+    ResetField(*m_Fields[oldest], goalSpan);
+    m_Fields[oldest]->lastUse = ++m_UseCounter;
+    return oldest;
+}
+
+// Seeds the search with every span within the goal radius that is connected to the goal span.
+void FlowFieldCache::ResetField(FlowField& field, unsigned int goalSpan)
+{
+    for (FlowTile* tile : field.tiles)
+        delete tile;
+    field.tiles.assign(m_TileSpanCount.size(), nullptr);
+    field.open.clear();
+    field.goalSpan = goalSpan;
+    field.computedTiles = 0;
+    field.complete = false;
+
+    m_Stack.clear();
+    m_Stack.push_back(goalSpan);
+    FlowTile* goalTile = GetTile(field, m_SpanTile[goalSpan]);
+    goalTile->cost[m_SpanLocal[goalSpan]] = 0.0f;
+    while (!m_Stack.empty())
+    {
+        const unsigned int span = m_Stack.back();
+        m_Stack.pop_back();
+        field.open.push_back({0.0f, span});
+        for (int dir = 0; dir < 4; ++dir)
+        {
+            const unsigned int neighbor = GetNeighbor(span, dir);
+            if (neighbor == NAV_NULL_SPAN || abs((int)m_SpanX[neighbor] - (int)m_SpanX[goalSpan]) > m_GoalRadius ||
+                abs((int)m_SpanZ[neighbor] - (int)m_SpanZ[goalSpan]) > m_GoalRadius)
+                continue;
+            FlowTile* tile = GetTile(field, m_SpanTile[neighbor]);
+            if (tile->cost[m_SpanLocal[neighbor]] == 0.0f)
+                continue;
+            tile->cost[m_SpanLocal[neighbor]] = 0.0f;
+            m_Stack.push_back(neighbor);
+        }
+    }
+}
+
+FlowFieldCache::FlowTile* FlowFieldCache::GetTile(FlowField& field, unsigned int tileIndex)
+{
+    FlowTile*& tile = field.tiles[tileIndex];
+    if (!tile)
+    {
+        const int spanCount = (int)m_TileSpanCount[tileIndex];
+        tile = new FlowTile();
+        tile->cost.assign(spanCount, FLT_MAX);
+        tile->direction.assign(spanCount, FLOW_DIRECTION_NONE);
+        tile->settled.assign(spanCount, 0);
+        tile->unsettled = spanCount;
+        tile->directionsBuilt = false;
+        field.computedTiles++;
+    }
+    return tile;
+}
+
+unsigned int FlowFieldCache::GetNeighbor(unsigned int span, int direction) const
+{
+    const HeightFieldSpan* pool = &m_HeightField->spanPool[0];
+    if (direction < 4)
+        return pool[span].connections[direction] ? pool[span].connections[direction] - 1 : NAV_NULL_SPAN;
+
+    const int dirA = direction - 4, dirB = (direction - 3) & 3;
+    const unsigned int a = GetNeighbor(span, dirA);
+    const unsigned int b = GetNeighbor(span, dirB);
+    if (a == NAV_NULL_SPAN || b == NAV_NULL_SPAN)
+        return NAV_NULL_SPAN;
+    const unsigned int diagonal = GetNeighbor(a, dirB);
+    return diagonal != NAV_NULL_SPAN && diagonal == GetNeighbor(b, dirA) ? diagonal : NAV_NULL_SPAN;
+}
+
+void FlowFieldCache::GetNeighbors(unsigned int span, unsigned int* neighbors) const
+{
+    const HeightFieldSpan* pool = &m_HeightField->spanPool[0];
+    for (int dir = 0; dir < 4; ++dir)
+        neighbors[dir] = pool[span].connections[dir] ? pool[span].connections[dir] - 1 : NAV_NULL_SPAN;
+    for (int dir = 0; dir < 4; ++dir)
+    {
+        const unsigned int a = neighbors[dir], b = neighbors[(dir + 1) & 3];
+        neighbors[4 + dir] = NAV_NULL_SPAN;
+        if (a == NAV_NULL_SPAN || b == NAV_NULL_SPAN)
+            continue;
+        const unsigned int connA = pool[a].connections[(dir + 1) & 3], connB = pool[b].connections[dir];
+        if (connA && connA == connB)
+            neighbors[4 + dir] = connA - 1;
+    }
+}
+
+// Resumes the Dijkstra until every span of the tile is settled or the search runs out of spans.
+void FlowFieldCache::SettleTile(FlowField& field, unsigned int tileIndex)
+{
+    const float cellSize = m_HeightField->cellSize;
+    while (!field.complete && (!field.tiles[tileIndex] || field.tiles[tileIndex]->unsettled > 0))
+    {
+        if (field.open.empty())
+        {
+            field.complete = true;
+            break;
+        }
+        std::pop_heap(field.open.begin(), field.open.end(), OpenEntryGreater);
+        const OpenEntry entry = field.open.back();
+        field.open.pop_back();
+
+        FlowTile* tile = field.tiles[m_SpanTile[entry.span]];
+        const unsigned short local = m_SpanLocal[entry.span];
+        if (tile->settled[local] || entry.cost > tile->cost[local])
+            continue;
+        tile->settled[local] = 1;
+        tile->unsettled--;
+
+        unsigned int neighbors[8];
+        GetNeighbors(entry.span, neighbors);
+        for (int dir = 0; dir < 8; ++dir)
+        {
+            const unsigned int neighbor = neighbors[dir];
+            if (neighbor == NAV_NULL_SPAN)
+                continue;
+            FlowTile* neighborTile = GetTile(field, m_SpanTile[neighbor]);
+            const unsigned short neighborLocal = m_SpanLocal[neighbor];
+            const float cost = entry.cost + (dir < 4 ? cellSize : cellSize * DIAGONAL_COST);
+            if (!neighborTile->settled[neighborLocal] && cost < neighborTile->cost[neighborLocal])
+            {
+                neighborTile->cost[neighborLocal] = cost;
+                field.open.push_back({cost, neighbor});
+                std::push_heap(field.open.begin(), field.open.end(), OpenEntryGreater);
+            }
+        }
+    }
+}
+
+float FlowFieldCache::GetCost(const FlowField& field, unsigned int span) const
+{
+    const FlowTile* tile = field.tiles[m_SpanTile[span]];
+    return tile ? tile->cost[m_SpanLocal[span]] : FLT_MAX;
+}
+
+// Neighbors cheaper than a settled span are settled too, Dijkstra pops in cost order.
+void FlowFieldCache::BuildTileDirections(FlowField& field, unsigned int tileIndex)
+{
+    FlowTile& tile = *field.tiles[tileIndex];
+    const unsigned int* spans = &m_TileSpans[m_TileFirstSpan[tileIndex]];
+    for (unsigned int i = 0; i < m_TileSpanCount[tileIndex]; ++i)
+    {
+        const float cost = tile.cost[i];
+        if (cost == 0.0f)
+        {
+            tile.direction[i] = FLOW_DIRECTION_GOAL;
+            continue;
+        }
+
+        float bestCost = cost;
+        unsigned char bestDirection = FLOW_DIRECTION_NONE;
+        unsigned int neighbors[8];
+        GetNeighbors(spans[i], neighbors);
+        for (int dir = 0; dir < 8; ++dir)
+        {
+            const unsigned int neighbor = neighbors[dir];
+            if (neighbor == NAV_NULL_SPAN)
+                continue;
+            const float neighborCost = GetCost(field, neighbor);
+            if (neighborCost < bestCost)
+            {
+                bestCost = neighborCost;
+                bestDirection = (unsigned char)dir;
+            }
+        }
+        tile.direction[i] = bestDirection;
+    }
+    tile.directionsBuilt = true;
+}
+
+unsigned char FlowFieldCache::GetDirection(int fieldIndex, unsigned int span)
+{
+    if (fieldIndex < 0 || span >= m_SpanTile.size() || m_SpanTile[span] == NAV_NULL_SPAN)
+        return FLOW_DIRECTION_NONE;
+
+    FlowField& field = *m_Fields[fieldIndex];
+    const unsigned int tileIndex = m_SpanTile[span];
+    SettleTile(field, tileIndex);
+    FlowTile* tile = field.tiles[tileIndex];
+    if (!tile)
+        return FLOW_DIRECTION_NONE;
+    if (!tile->directionsBuilt)
+        BuildTileDirections(field, tileIndex);
+    return tile->direction[m_SpanLocal[span]];
+}
+
+float FlowFieldCache::GetDistance(int fieldIndex, unsigned int span)
+{
+    if (fieldIndex < 0 || span >= m_SpanTile.size() || m_SpanTile[span] == NAV_NULL_SPAN)
+        return FLT_MAX;
+    FlowField& field = *m_Fields[fieldIndex];
+    SettleTile(field, m_SpanTile[span]);
+    return GetCost(field, span);
+}
+
+glm::vec3 FlowFieldCache::GetDirectionVector(unsigned char direction)
+{
+    if (direction >= 8)
+        return glm::vec3(0.0f);
+    return glm::normalize(glm::vec3((float)DIRECTION_X[direction], 0.0f, (float)DIRECTION_Z[direction]));
+}
+
+void FlowFieldCache::SampleDirections(int field, const unsigned int* spans, glm::vec3* directions, int count)
+{
+    for (int i = 0; i < count; ++i)
+        directions[i] = GetDirectionVector(GetDirection(field, spans[i]));
+}
+
+int FlowFieldCache::TracePath(int field, unsigned int startSpan, unsigned int* path, int maxPath)
+{
+    int count = 0;
+    unsigned int span = startSpan;
+    while (count < maxPath && span != NAV_NULL_SPAN)
+    {
+        path[count++] = span;
+        const unsigned char direction = GetDirection(field, span);
+        if (direction >= 8)
+            break;
+        span = GetNeighbor(span, direction);
+    }
+    return count;
+}
+
+size_t FlowFieldCache::GetMemoryBytes() const
+{
+    size_t bytes = m_SpanTile.size() * (sizeof(unsigned int) * 2 + sizeof(unsigned short) * 3);
+    for (const FlowField* field : m_Fields)
+    {
+        bytes += field->open.capacity() * sizeof(OpenEntry) + field->tiles.size() * sizeof(FlowTile*);
+        for (const FlowTile* tile : field->tiles)
+            if (tile)
+                bytes += sizeof(FlowTile) + tile->cost.size() * (sizeof(float) + 2);
+    }
+    return bytes;
+}
@@ -0,0 +1,86 @@
+#pragma once
+#include <vector>
+#include <glm/glm.hpp>
+#include "SpanPathfinder.h"
+
+static const unsigned char FLOW_DIRECTION_GOAL = 8;    // Span is one of the goal spans
+static const unsigned char FLOW_DIRECTION_NONE = 0xff; // Goal not reachable
+
+// Flow fields over the walkable span graph for many agents sharing a goal. One multi-source Dijkstra
+// from the spans around the goal integrates the distance, and every span stores the direction to its
+// cheapest neighbor, 8-connected without cutting corners. The search is resumable and is advanced only
+// until the tiles agents actually sample are settled, tiles keep their costs and directions in their
+// own contiguous arrays. The fields of recent goals are kept in a small LRU cache.
+class FlowFieldCache
+{
+public:
+    FlowFieldCache();
+    ~FlowFieldCache();
+
+    // tileSize in cells, goalRadius in cells around the goal span that count as arrived.
+    void Init(const HeightField* heightField, int tileSize, int maxFields, int goalRadius);
+    void Clear(); // Drops all fields, call when the heightfield changed
+
+    // Index of the cached field for the goal, evicting the least recently used one. -1 when the goal is not walkable.
+    // The index stays valid until the next AcquireField call.
+    int AcquireField(unsigned int goalSpan);
+
+    // FLOW_DIRECTION_* or 0..7, see GetDirectionVector.
+    unsigned char GetDirection(int field, unsigned int span);
+    float GetDistance(int field, unsigned int span);
+    // Unit xz direction per span, zero at the goal or when it cannot be reached.
+    void SampleDirections(int field, const unsigned int* spans, glm::vec3* directions, int count);
+    // Follows the directions from the span, returns the number of spans written including the start.
+    int TracePath(int field, unsigned int startSpan, unsigned int* path, int maxPath);
+
+    static glm::vec3 GetDirectionVector(unsigned char direction);
+    // Neighbor span in one of the 8 directions, diagonals need both corner spans. NAV_NULL_SPAN if none.
+    unsigned int GetNeighbor(unsigned int span, int direction) const;
+
+    int GetComputedTileCount(int field) const { return m_Fields[field]->computedTiles; }
+    int GetTileCount() const { return (int)m_TileSpanCount.size(); }
+    size_t GetMemoryBytes() const;
+private:
+    struct FlowTile
+    {
+        std::vector<float> cost;               // Per tile local span
+        std::vector<unsigned char> direction;  // Valid once directionsBuilt
+        std::vector<unsigned char> settled;
+        int unsettled;
+        bool directionsBuilt;
+    };
+    struct OpenEntry
+    {
+        float cost;
+        unsigned int span;
+    };
+    struct FlowField
+    {
+        unsigned int goalSpan;
+        unsigned int lastUse;
+        std::vector<FlowTile*> tiles; // nullptr until the search reaches the tile
+        std::vector<OpenEntry> open;
+        int computedTiles;
+        bool complete;                // Search exhausted
+    };
+
+    const HeightField* m_HeightField;
+    int m_TileSize, m_TilesX, m_GoalRadius;
+    std::vector<unsigned int> m_SpanTile;         // NAV_NULL_SPAN for unwalkable spans
+    std::vector<unsigned short> m_SpanLocal;      // Index inside the tile
+    std::vector<unsigned short> m_SpanX, m_SpanZ;
+    std::vector<unsigned int> m_TileSpans;        // Walkable spans grouped per tile
+    std::vector<unsigned int> m_TileFirstSpan, m_TileSpanCount;
+    std::vector<FlowField*> m_Fields;
+    std::vector<unsigned int> m_Stack;
+    unsigned int m_UseCounter;
+
+    void GetNeighbors(unsigned int span, unsigned int* neighbors) const; // All 8 at once, same order as GetNeighbor
+    void ResetField(FlowField& field, unsigned int goalSpan);
+    FlowTile* GetTile(FlowField& field, unsigned int tileIndex);
+    void SettleTile(FlowField& field, unsigned int tileIndex);
+    void BuildTileDirections(FlowField& field, unsigned int tileIndex);
+    float GetCost(const FlowField& field, unsigned int span) const;
+
+    static bool OpenEntryGreater(const OpenEntry& a, const OpenEntry& b) { return a.cost > b.cost; }
+};
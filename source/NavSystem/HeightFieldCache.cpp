@@ -0,0 +1,180 @@
+#include "HeightFieldCache.h"
+#include "NavCompression.h"
+#include <cstdio>
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+
+static const uint32_t HEIGHTFIELD_CACHE_MAGIC = 'N' | ('A' << 8) | ('V' << 16) | ('H' << 24);
+static const uint32_t HEIGHTFIELD_CACHE_VERSION = 3; // Bumped when rasterization changes the spans it produces
+static const uintmax_t DEFAULT_HEIGHTFIELD_CACHE_BYTES = 64 << 20;
+
+struct HeightFieldCacheHeader
+{
+    uint32_t magic, version;
+    uint64_t key;
+    int32_t width, depth;
+    uint32_t spanCount, compressedSize;
+};
+
+// The column offsets and spans as one array of words split into byte planes and delta coded, so the slowly rising
+// offsets and small span heights compress into runs.
+static void PackWords(const HeightFieldTileSpans& tile, std::vector<unsigned char>& bytes)
+{
+    const size_t wordCount = tile.columnStart.size() + tile.spans.size();
+    bytes.resize(wordCount * 4);
+    for (int plane = 0; plane < 4; ++plane)
+    {
+        unsigned char* out = &bytes[plane * wordCount];
+        for (unsigned int word : tile.columnStart)
+            *out++ = (unsigned char)(word >> (plane * 8));
+        for (unsigned int word : tile.spans)
+            *out++ = (unsigned char)(word >> (plane * 8));
+    }
+    DeltaEncode(bytes.data(), bytes.size());
+}
+
+static void UnpackWords(std::vector<unsigned char>& bytes, HeightFieldTileSpans& tile)
+{
+    DeltaDecode(bytes.data(), bytes.size());
+    const size_t wordCount = tile.columnStart.size() + tile.spans.size();
+    for (size_t i = 0; i < wordCount; ++i)
+    {
+        const unsigned int word = bytes[i] | (bytes[wordCount + i] << 8) | (bytes[wordCount * 2 + i] << 16) | ((unsigned int)bytes[wordCount * 3 + i] << 24);
+        if (i < tile.columnStart.size())
+            tile.columnStart[i] = word;
+        else
+            tile.spans[i - tile.columnStart.size()] = word;
+    }
+}
+
+HeightFieldCache::HeightFieldCache() : m_MaxBytes(DEFAULT_HEIGHTFIELD_CACHE_BYTES)
+{
+}
+
+void HeightFieldCache::SetDirectory(const std::string& directory)
+{
+    m_Directory = directory;
+    std::error_code error;
+    std::filesystem::create_directories(m_Directory, error);
+}
+
+bool HeightFieldCache::Load(uint64_t key, int width, int depth, HeightFieldTileSpans& tile) const
+{
+    if (m_Directory.empty())
+        return false;
+    FILE* file = fopen(GetPath(key).c_str(), "rb");
+    if (!file)
+        return false;
+
+    HeightFieldCacheHeader header;
+    bool valid = fread(&header, sizeof(header), 1, file) == 1 && header.magic == HEIGHTFIELD_CACHE_MAGIC &&
+                 header.version == HEIGHTFIELD_CACHE_VERSION && header.key == key && header.width == width && header.depth == depth;
+    if (valid)
+    {
+        tile.width = width;
+        tile.depth = depth;
+        tile.columnStart.resize(width * depth + 1);
+        tile.spans.resize(header.spanCount * 2);
+        std::vector<unsigned char> compressed(header.compressedSize), bytes((tile.columnStart.size() + tile.spans.size()) * 4);
+        valid = fread(compressed.data(), 1, compressed.size(), file) == compressed.size() &&
+                DecompressTileData(compressed.data(), compressed.size(), bytes.data(), bytes.size());
+        if (valid)
+            UnpackWords(bytes, tile);
+        valid = valid && tile.columnStart.back() == header.spanCount;
+        for (size_t i = 0; valid && i + 1 < tile.columnStart.size(); ++i)
+            valid = tile.columnStart[i] <= tile.columnStart[i + 1];
+    }
+    fclose(file);
+    if (valid)
+    {
+        // Marks the file as used for Prune.
+        std::error_code error;
+        std::filesystem::last_write_time(GetPath(key), std::filesystem::file_time_type::clock::now(), error);
+    }
+    return valid;
+}
+
+bool HeightFieldCache::Save(uint64_t key, const HeightFieldTileSpans& tile) const
+{
+    if (m_Directory.empty())
+        return false;
+    FILE* file = fopen(GetPath(key).c_str(), "wb");
+    if (!file)
+        return false;
+
+    std::vector<unsigned char> bytes;
+    PackWords(tile, bytes);
+    std::vector<unsigned char> compressed(GetCompressBound(bytes.size()));
+    compressed.resize(CompressTileData(bytes.data(), bytes.size(), compressed.data()));
+
+    HeightFieldCacheHeader header = HeightFieldCacheHeader();
+    header.magic = HEIGHTFIELD_CACHE_MAGIC;
+    header.version = HEIGHTFIELD_CACHE_VERSION;
+    header.key = key;
+    header.width = tile.width;
+    header.depth = tile.depth;
+    header.spanCount = (uint32_t)(tile.spans.size() / 2);
+    header.compressedSize = (uint32_t)compressed.size();
+    const bool written = fwrite(&header, sizeof(header), 1, file) == 1 &&
+                         fwrite(compressed.data(), 1, compressed.size(), file) == compressed.size();
+    fclose(file);
+    return written;
+}
+
+int HeightFieldCache::Prune() const
+{
+    if (m_Directory.empty())
+        return 0;
+    struct CacheFile
+    {
+        std::filesystem::file_time_type time;
+        uintmax_t size;
+        std::filesystem::path path;
+    };
+    std::vector<CacheFile> files;
+    uintmax_t totalBytes = 0;
+    std::error_code error;
+    for (std::filesystem::directory_iterator it(m_Directory, error), end; !error && it != end; it.increment(error))
+    {
+        if (it->path().extension() != ".hf")
+            continue;
+        std::error_code fileError;
+        CacheFile file = { it->last_write_time(fileError), it->file_size(fileError), it->path() };
+        if (fileError)
+            continue;
+        totalBytes += file.size;
+        files.push_back(file);
+    }
+    if (totalBytes <= m_MaxBytes)
+        return 0;
+
+    std::sort(files.begin(), files.end(), [](const CacheFile& a, const CacheFile& b) { return a.time < b.time; });
+    int removed = 0;
+    for (size_t i = 0; i < files.size() && totalBytes > m_MaxBytes; ++i)
+    {
+        if (!std::filesystem::remove(files[i].path, error))
+            continue;
+        totalBytes -= files[i].size;
+        removed++;
+    }
+    return removed;
+}
+
+uint64_t HeightFieldCache::Hash(const void* data, size_t size, uint64_t hash)
+{
+    const unsigned char* bytes = (const unsigned char*)data;
+    for (size_t i = 0; i < size; ++i)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+std::string HeightFieldCache::GetPath(uint64_t key) const
+{
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.hf", (unsigned long long)key);
+    return m_Directory + "/" + name;
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Solid spans of the columns of one tile, columns ordered by z then x.
+struct HeightFieldTileSpans
+{
+    int width, depth;
+    std::vector<unsigned int> columnStart; // width * depth + 1 offsets into spans
+    std::vector<unsigned int> spans;       // spanMin, spanMax pairs
+};
+
+// Rasterized tiles on disk, one file per key. The key hashes the triangles touching the tile together with
+// the config fields rasterization depends on, so an unchanged tile is loaded instead of rasterized again.
+// Files are little endian, compressed with the tile codec and named by their key. Every geometry or config change
+// writes new files and the stale ones are never looked up again, so Prune keeps the directory under a byte budget by
+// deleting the least recently used files, loads refresh a file's time.
+class HeightFieldCache
+{
+public:
+    HeightFieldCache();
+
+    void SetDirectory(const std::string& directory);
+    const std::string& GetDirectory() const { return m_Directory; }
+    void SetMaxBytes(uintmax_t bytes) { m_MaxBytes = bytes; }
+    uintmax_t GetMaxBytes() const { return m_MaxBytes; }
+    int Prune() const; // Returns the number of files deleted
+
+    bool Load(uint64_t key, int width, int depth, HeightFieldTileSpans& tile) const;
+    bool Save(uint64_t key, const HeightFieldTileSpans& tile) const;
+
+    // FNV-1a, chain calls to hash several blocks.
+    static uint64_t Hash(const void* data, size_t size, uint64_t hash = 14695981039346656037ull);
+private:
+    std::string m_Directory;
+    uintmax_t m_MaxBytes;
+
+    std::string GetPath(uint64_t key) const;
+};
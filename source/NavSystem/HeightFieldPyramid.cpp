@@ -0,0 +1,362 @@
+#include "HeightFieldPyramid.h"
+#include "NavigationSystem.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+static const int PYRAMID_STACK_SIZE = 128;
+
+struct PyramidNode
+{
+    int level, x, z;
+};
+
+// Pushes the cells covering the column rect at the finest level where it spans at most 2x2 of them.
+static int PushRectCells(PyramidNode* stack, int levelCount, int x0, int z0, int x1, int z1)
+{
+    int level = 0;
+    while (level + 1 < levelCount && ((x1 >> level) - (x0 >> level) > 1 || (z1 >> level) - (z0 >> level) > 1))
+        level++;
+    int stackSize = 0;
+    for (int z = z0 >> level; z <= z1 >> level; ++z)
+        for (int x = x0 >> level; x <= x1 >> level; ++x)
+            stack[stackSize++] = {level, x, z};
+    return stackSize;
+}
+
+// Narrows [tEnter, tExit] to where the ray origin + dir * t is inside the xz box, false when it misses.
+static bool ClipRayToBox(float originX, float originZ, float dirX, float dirZ, float x0, float z0, float x1, float z1, float& tEnter,
+                         float& tExit)
+{
+    const float origins[2] = {originX, originZ};
+    const float dirs[2] = {dirX, dirZ};
+    const float mins[2] = {x0, z0};
+    const float maxs[2] = {x1, z1};
+    for (int axis = 0; axis < 2; ++axis)
+    {
+        if (fabsf(dirs[axis]) < 1e-9f)
+        {
+            if (origins[axis] < mins[axis] || origins[axis] > maxs[axis])
+                return false;
+            continue;
+        }
+        float t0 = (mins[axis] - origins[axis]) / dirs[axis];
+        float t1 = (maxs[axis] - origins[axis]) / dirs[axis];
+        if (t0 > t1)
+            std::swap(t0, t1);
+        tEnter = std::max(tEnter, t0);
+        tExit = std::min(tExit, t1);
+    }
+    return tEnter <= tExit;
+}
+
+// Visits the cells of a grid that the ray origin + dir * t crosses between tStart and tEnd, in order, in the xz plane.
+// fn(x, z, tEnter, tExit) returns true to stop the walk, WalkGrid then returns true as well.
+template <typename Fn>
+static bool WalkGrid(float originX, float originZ, float dirX, float dirZ, float cellSize, int width, int depth, float tStart, float tEnd,
+                     Fn&& fn)
+{
+    int x = glm::clamp((int)floorf((originX + dirX * tStart) / cellSize), 0, width - 1);
+    int z = glm::clamp((int)floorf((originZ + dirZ * tStart) / cellSize), 0, depth - 1);
+    const int stepX = dirX > 0.0f ? 1 : -1;
+    const int stepZ = dirZ > 0.0f ? 1 : -1;
+    const float tDeltaX = dirX != 0.0f ? cellSize / fabsf(dirX) : FLT_MAX;
+    const float tDeltaZ = dirZ != 0.0f ? cellSize / fabsf(dirZ) : FLT_MAX;
+    float tMaxX = dirX != 0.0f ? ((x + (dirX > 0.0f ? 1 : 0)) * cellSize - originX) / dirX : FLT_MAX;
+    float tMaxZ = dirZ != 0.0f ? ((z + (dirZ > 0.0f ? 1 : 0)) * cellSize - originZ) / dirZ : FLT_MAX;
+
+    float t = tStart;
+    while (true)
+    {
+        const float tNext = std::min(std::min(tMaxX, tMaxZ), tEnd);
+        if (fn(x, z, t, tNext))
+            return true;
+        if (tNext >= tEnd)
+            return false;
+        if (tMaxX < tMaxZ)
+        {
+            x += stepX;
+            tMaxX += tDeltaX;
+        }
+        else
+        {
+            z += stepZ;
+            tMaxZ += tDeltaZ;
+        }
+        if (x < 0 || x >= width || z < 0 || z >= depth)
+            return false;
+        t = tNext;
+    }
+}
+
+HeightFieldPyramid::HeightFieldPyramid() : m_HeightField(nullptr), m_TileSize(0), m_TilesX(0), m_TilesZ(0)
+{
+}
+
+void HeightFieldPyramid::Init(const HeightField* heightField, int tileSize)
+{
+    m_HeightField = heightField;
+    m_TileSize = std::max(tileSize, 1);
+    m_TilesX = (heightField->width + m_TileSize - 1) / m_TileSize;
+    m_TilesZ = (heightField->depth + m_TileSize - 1) / m_TileSize;
+    m_TileDirty.assign(m_TilesX * m_TilesZ, 0);
+    m_DirtyTiles.clear();
+
+    // Halve until a single cell covers the whole field.
+    m_LevelOffsets.clear();
+    m_LevelWidths.clear();
+    m_LevelDepths.clear();
+    int width = std::max(heightField->width, 1), depth = std::max(heightField->depth, 1), cellCount = 0;
+    while (true)
+    {
+        m_LevelOffsets.push_back(cellCount);
+        m_LevelWidths.push_back(width);
+        m_LevelDepths.push_back(depth);
+        cellCount += width * depth;
+        if (width == 1 && depth == 1)
+            break;
+        width = (width + 1) / 2;
+        depth = (depth + 1) / 2;
+    }
+    m_Cells.resize(cellCount);
+
+    BuildColumns(0, 0, heightField->width, heightField->depth);
+    for (int level = 1; level < GetLevelCount(); ++level)
+        BuildLevel(level, 0, 0, m_LevelWidths[level], m_LevelDepths[level]);
+}
+
+void HeightFieldPyramid::MarkTileDirty(int tileX, int tileZ)
+{
+    if (tileX < 0 || tileZ < 0 || tileX >= m_TilesX || tileZ >= m_TilesZ)
+        return;
+    const int tileIndex = tileX + tileZ * m_TilesX;
+    if (m_TileDirty[tileIndex])
+        return;
+    m_TileDirty[tileIndex] = 1;
+    m_DirtyTiles.push_back(tileIndex);
+}
+
+void HeightFieldPyramid::RebuildDirtyTiles()
+{
+    for (int tileIndex : m_DirtyTiles)
+    {
+        const int tileX = tileIndex % m_TilesX, tileZ = tileIndex / m_TilesX;
+        int x0 = tileX * m_TileSize, z0 = tileZ * m_TileSize;
+        int x1 = std::min(x0 + m_TileSize, m_HeightField->width), z1 = std::min(z0 + m_TileSize, m_HeightField->depth);
+        BuildColumns(x0, z0, x1, z1);
+        for (int level = 1; level < GetLevelCount(); ++level)
+        {
+            x0 >>= 1;
+            z0 >>= 1;
+            x1 = (x1 + 1) >> 1;
+            z1 = (z1 + 1) >> 1;
+            BuildLevel(level, x0, z0, x1, z1);
+        }
+        m_TileDirty[tileIndex] = 0;
+    }
+    m_DirtyTiles.clear();
+}
+
+void HeightFieldPyramid::BuildColumns(int x0, int z0, int x1, int z1)
+{
+    const HeightField& hf = *m_HeightField;
+    for (int z = z0; z < z1; ++z)
+    {
+        for (int x = x0; x < x1; ++x)
+        {
+            HeightPyramidCell& cell = m_Cells[x + z * hf.width];
+            cell.minSolid = FLT_MAX;
+            cell.maxSolid = -FLT_MAX;
+            cell.minWalkable = FLT_MAX;
+            cell.maxWalkable = -FLT_MAX;
+            for (const HeightFieldSpan* span = hf.spans[x + z * hf.width]; span; span = span->next)
+            {
+                const float bottom = hf.bmin.y + span->spanMin * hf.cellHeight;
+                const float top = hf.bmin.y + (span->spanMax + 1) * hf.cellHeight;
+                cell.minSolid = std::min(cell.minSolid, bottom);
+                cell.maxSolid = std::max(cell.maxSolid, top);
+                if (span->areaID == 0)
+                    continue;
+                cell.minWalkable = std::min(cell.minWalkable, top);
+                cell.maxWalkable = std::max(cell.maxWalkable, top);
+            }
+        }
+    }
+}
+
+void HeightFieldPyramid::BuildLevel(int level, int x0, int z0, int x1, int z1)
+{
+    const int childWidth = m_LevelWidths[level - 1], childDepth = m_LevelDepths[level - 1];
+    for (int z = z0; z < z1; ++z)
+    {
+        for (int x = x0; x < x1; ++x)
+        {
+            HeightPyramidCell& cell = m_Cells[m_LevelOffsets[level] + x + z * m_LevelWidths[level]];
+            cell.minSolid = FLT_MAX;
+            cell.maxSolid = -FLT_MAX;
+            cell.minWalkable = FLT_MAX;
+            cell.maxWalkable = -FLT_MAX;
+            for (int cz = z * 2; cz < std::min(z * 2 + 2, childDepth); ++cz)
+            {
+                for (int cx = x * 2; cx < std::min(x * 2 + 2, childWidth); ++cx)
+                {
+                    const HeightPyramidCell& child = GetCell(level - 1, cx, cz);
+                    cell.minSolid = std::min(cell.minSolid, child.minSolid);
+                    cell.maxSolid = std::max(cell.maxSolid, child.maxSolid);
+                    cell.minWalkable = std::min(cell.minWalkable, child.minWalkable);
+                    cell.maxWalkable = std::max(cell.maxWalkable, child.maxWalkable);
+                }
+            }
+        }
+    }
+}
+
+bool HeightFieldPyramid::Raycast(const glm::vec3& start, const glm::vec3& end, float& t) const
+{
+    t = FLT_MAX;
+    if (!m_HeightField || m_Cells.empty())
+        return false;
+
+    // Work in cell units in the xz plane, clip the segment to the heightfield bounds.
+    const HeightField& hf = *m_HeightField;
+    const glm::vec3 origin((start.x - hf.bmin.x) / hf.cellSize, start.y, (start.z - hf.bmin.z) / hf.cellSize);
+    const glm::vec3 dir((end.x - start.x) / hf.cellSize, end.y - start.y, (end.z - start.z) / hf.cellSize);
+    float tMin = 0.0f, tMax = 1.0f;
+    if (!ClipRayToBox(origin.x, origin.z, dir.x, dir.z, 0.0f, 0.0f, (float)hf.width, (float)hf.depth, tMin, tMax))
+        return false;
+
+    // Start at the finest level where the segment still crosses only a couple of cells.
+    const float length = std::max(fabsf(dir.x), fabsf(dir.z)) * (tMax - tMin);
+    int level = 0;
+    while (level + 1 < GetLevelCount() && (float)(1 << level) < length * 0.5f)
+        level++;
+    return RaycastLevel(level, origin, dir, tMin, tMax, t);
+}
+
+// Walks the cells of one level along the ray and descends into those whose height range the ray passes through.
+bool HeightFieldPyramid::RaycastLevel(int level, const glm::vec3& origin, const glm::vec3& dir, float tEnter, float tExit, float& t) const
+{
+    const HeightField& hf = *m_HeightField;
+    return WalkGrid(origin.x, origin.z, dir.x, dir.z, (float)(1 << level), m_LevelWidths[level], m_LevelDepths[level], tEnter, tExit,
+        [&](int x, int z, float cellEnter, float cellExit)
+        {
+            const HeightPyramidCell& cell = GetCell(level, x, z);
+            const float yEnter = origin.y + dir.y * cellEnter;
+            const float yExit = origin.y + dir.y * cellExit;
+            const float rayLow = std::min(yEnter, yExit), rayHigh = std::max(yEnter, yExit);
+            if (rayLow >= cell.maxSolid || rayHigh <= cell.minSolid)
+                return false;
+            if (level > 0)
+                return RaycastLevel(level - 1, origin, dir, cellEnter, cellExit, t);
+
+            for (const HeightFieldSpan* span = hf.spans[x + z * hf.width]; span; span = span->next)
+            {
+                const float bottom = hf.bmin.y + span->spanMin * hf.cellHeight;
+                const float top = hf.bmin.y + (span->spanMax + 1) * hf.cellHeight;
+                if (rayLow >= top || rayHigh <= bottom)
+                    continue;
+                // Where the ray enters the span's height range within the column.
+                float hit = cellEnter;
+                if (yEnter > top)
+                    hit = (top - origin.y) / dir.y;
+                else if (yEnter < bottom)
+                    hit = (bottom - origin.y) / dir.y;
+                t = glm::clamp(hit, cellEnter, cellExit);
+                return true;
+            }
+            return false;
+        });
+}
+
+bool HeightFieldPyramid::IsBoxObstructed(const glm::vec3& bmin, const glm::vec3& bmax) const
+{
+    if (!m_HeightField || m_Cells.empty())
+        return false;
+
+    const HeightField& hf = *m_HeightField;
+    const int x0 = std::max((int)floorf((bmin.x - hf.bmin.x) / hf.cellSize), 0);
+    const int z0 = std::max((int)floorf((bmin.z - hf.bmin.z) / hf.cellSize), 0);
+    const int x1 = std::min((int)ceilf((bmax.x - hf.bmin.x) / hf.cellSize) - 1, hf.width - 1);
+    const int z1 = std::min((int)ceilf((bmax.z - hf.bmin.z) / hf.cellSize) - 1, hf.depth - 1);
+    if (x0 > x1 || z0 > z1)
+        return false;
+
+    PyramidNode stack[PYRAMID_STACK_SIZE];
+    int stackSize = PushRectCells(stack, GetLevelCount(), x0, z0, x1, z1);
+    while (stackSize > 0)
+    {
+        const PyramidNode node = stack[--stackSize];
+        const HeightPyramidCell& cell = GetCell(node.level, node.x, node.z);
+        if (bmax.y <= cell.minSolid || bmin.y >= cell.maxSolid)
+            continue;
+
+        if (node.level == 0)
+        {
+            for (const HeightFieldSpan* span = hf.spans[node.x + node.z * hf.width]; span; span = span->next)
+                if (bmax.y > hf.bmin.y + span->spanMin * hf.cellHeight && bmin.y < hf.bmin.y + (span->spanMax + 1) * hf.cellHeight)
+                    return true;
+            continue;
+        }
+
+        const int childLevel = node.level - 1;
+        for (int cz = node.z * 2; cz < std::min(node.z * 2 + 2, m_LevelDepths[childLevel]); ++cz)
+        {
+            for (int cx = node.x * 2; cx < std::min(node.x * 2 + 2, m_LevelWidths[childLevel]); ++cx)
+            {
+                if ((cx + 1) << childLevel <= x0 || cx << childLevel > x1 || (cz + 1) << childLevel <= z0 || cz << childLevel > z1)
+                    continue;
+                stack[stackSize++] = {childLevel, cx, cz};
+            }
+        }
+    }
+    return false;
+}
+
+bool HeightFieldPyramid::FindSurfaceBelow(const glm::vec3& pos, float radius, float& height) const
+{
+    height = -FLT_MAX;
+    if (!m_HeightField || m_Cells.empty())
+        return false;
+
+    const HeightField& hf = *m_HeightField;
+    const int x0 = std::max((int)floorf((pos.x - radius - hf.bmin.x) / hf.cellSize), 0);
+    const int z0 = std::max((int)floorf((pos.z - radius - hf.bmin.z) / hf.cellSize), 0);
+    const int x1 = std::min((int)floorf((pos.x + radius - hf.bmin.x) / hf.cellSize), hf.width - 1);
+    const int z1 = std::min((int)floorf((pos.z + radius - hf.bmin.z) / hf.cellSize), hf.depth - 1);
+    if (x0 > x1 || z0 > z1)
+        return false;
+
+    // Cells with no walkable top at or below pos, or none above the best found so far, are skipped.
+    PyramidNode stack[PYRAMID_STACK_SIZE];
+    int stackSize = PushRectCells(stack, GetLevelCount(), x0, z0, x1, z1);
+    while (stackSize > 0)
+    {
+        const PyramidNode node = stack[--stackSize];
+        const HeightPyramidCell& cell = GetCell(node.level, node.x, node.z);
+        if (cell.minWalkable > pos.y || cell.maxWalkable <= height)
+            continue;
+
+        if (node.level == 0)
+        {
+            for (const HeightFieldSpan* span = hf.spans[node.x + node.z * hf.width]; span; span = span->next)
+            {
+                const float top = hf.bmin.y + (span->spanMax + 1) * hf.cellHeight;
+                if (span->areaID != 0 && top <= pos.y)
+                    height = std::max(height, top);
+            }
+            continue;
+        }
+
+        const int childLevel = node.level - 1;
+        for (int cz = node.z * 2; cz < std::min(node.z * 2 + 2, m_LevelDepths[childLevel]); ++cz)
+        {
+            for (int cx = node.x * 2; cx < std::min(node.x * 2 + 2, m_LevelWidths[childLevel]); ++cx)
+            {
+                if ((cx + 1) << childLevel <= x0 || cx << childLevel > x1 || (cz + 1) << childLevel <= z0 || cz << childLevel > z1)
+                    continue;
+                stack[stackSize++] = {childLevel, cx, cz};
+            }
+        }
+    }
+    return height > -FLT_MAX;
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include <vector>
+#include <glm/glm.hpp>
+
+struct HeightField;
+
+struct HeightPyramidCell
+{
+    float minSolid, maxSolid;       // Lowest span bottom and highest span top, world y
+    float minWalkable, maxWalkable; // Lowest and highest walkable span top, world y
+};
+
+// Min/max height pyramid over the heightfield columns. Level 0 summarizes single columns and every level
+// above merges 2x2 cells of the one below, so ray marches, box overlap tests and surface lookups descend
+// only into the regions whose height range they can touch. Tiles whose spans changed are marked dirty and
+// only their columns and the cells above them are recomputed. No allocations per query.
+class HeightFieldPyramid
+{
+public:
+    HeightFieldPyramid();
+
+    void Init(const HeightField* heightField, int tileSize);
+    void MarkTileDirty(int tileX, int tileZ);
+    void RebuildDirtyTiles();
+    bool HasDirtyTiles() const { return !m_DirtyTiles.empty(); }
+
+    // True when the segment passes through a solid span, t is then the fraction of the segment at the hit.
+    bool Raycast(const glm::vec3& start, const glm::vec3& end, float& t) const;
+    bool HasLineOfSight(const glm::vec3& start, const glm::vec3& end) const
+    {
+        float t;
+        return !Raycast(start, end, t);
+    }
+    // True when a solid span overlaps the box.
+    bool IsBoxObstructed(const glm::vec3& bmin, const glm::vec3& bmax) const;
+    // Highest walkable surface at or below pos within radius of it in the xz plane.
+    bool FindSurfaceBelow(const glm::vec3& pos, float radius, float& height) const;
+
+    int GetLevelCount() const { return (int)m_LevelOffsets.size(); }
+    size_t GetMemoryBytes() const { return m_Cells.size() * sizeof(HeightPyramidCell); }
+private:
+    const HeightField* m_HeightField;
+    int m_TileSize, m_TilesX, m_TilesZ;
+    std::vector<HeightPyramidCell> m_Cells; // All levels, finest first
+    std::vector<int> m_LevelOffsets, m_LevelWidths, m_LevelDepths;
+    std::vector<int> m_DirtyTiles;
+    std::vector<unsigned char> m_TileDirty;
+
+    void BuildColumns(int x0, int z0, int x1, int z1);
+    void BuildLevel(int level, int x0, int z0, int x1, int z1);
+    bool RaycastLevel(int level, const glm::vec3& origin, const glm::vec3& dir, float tEnter, float tExit, float& t) const;
+    const HeightPyramidCell& GetCell(int level, int x, int z) const { return m_Cells[m_LevelOffsets[level] + x + z * m_LevelWidths[level]]; }
+};
@@ -0,0 +1,481 @@
+#include "HierarchicalPathfinder.h"
+#include <algorithm>
+#include <cfloat>
+
+static const int MAX_ENTRANCE_WIDTH = 8; // In cells, wider border runs are split into several entrances
+static const unsigned int NO_PARENT = 0xffffffff;
+// Inflated heuristic for the entrance search, the corridor refinement recovers most of the lost optimality.
+static const float ABSTRACT_HEURISTIC_WEIGHT = 1.5f;
+
+static bool HasSameCosts(const NavQueryFilter& a, const NavQueryFilter& b)
+{
+    if (a.GetIncludeFlags() != b.GetIncludeFlags() || a.GetExcludeFlags() != b.GetExcludeFlags())
+        return false;
+    for (int area = 0; area < NAV_MAX_AREAS; ++area)
+        if (a.GetAreaCost(area) != b.GetAreaCost(area))
+            return false;
+    return true;
+}
+
+HierarchicalPathfinder::HierarchicalPathfinder()
+    : m_NavMesh(nullptr), m_ClusterSize(1), m_ClustersX(0), m_ClustersZ(0), m_DijkstraStamp(0), m_SearchStamp(0),
+      m_LastAbstractExpansions(0), m_LastRefineExpansions(0)
+{
+}
+
+bool HierarchicalPathfinder::Init(const NavMesh* navMesh, int clusterSize, int maxNodes)
+{
+    if (!navMesh || clusterSize <= 0 || !m_RefineQuery.Init(navMesh, maxNodes))
+        return false;
+    m_NavMesh = navMesh;
+    m_ClusterSize = clusterSize;
+    m_ClustersX = (navMesh->tilesX + clusterSize - 1) / clusterSize;
+    m_ClustersZ = (navMesh->tilesZ + clusterSize - 1) / clusterSize;
+    m_Clusters.assign(m_ClustersX * m_ClustersZ, Cluster());
+    m_Entrances.clear();
+    m_FreeEntrances.clear();
+    m_ChangedClusters.clear();
+    m_CorridorTileStamp.assign(navMesh->tiles.size(), 0);
+    m_SearchStamp = 0;
+    return true;
+}
+
+int HierarchicalPathfinder::GetTileCluster(const NavMeshTile& tile) const
+{
+    return tile.tileX / m_ClusterSize + (tile.tileZ / m_ClusterSize) * m_ClustersX;
+}
+
+void HierarchicalPathfinder::MarkCorridorCluster(int clusterIndex)
+{
+    const int cx = clusterIndex % m_ClustersX, cz = clusterIndex / m_ClustersX;
+    const int tileX1 = std::min(m_NavMesh->tilesX, (cx + 1) * m_ClusterSize);
+    const int tileZ1 = std::min(m_NavMesh->tilesZ, (cz + 1) * m_ClusterSize);
+    for (int tz = cz * m_ClusterSize; tz < tileZ1; ++tz)
+        for (int tx = cx * m_ClusterSize; tx < tileX1; ++tx)
+            m_CorridorTileStamp[tx + tz * m_NavMesh->tilesX] = m_SearchStamp;
+}
+
+int HierarchicalPathfinder::GetPolyCluster(NavPolyRef ref) const
+{
+    return GetTileCluster(m_NavMesh->tiles[DecodePolyRefTile(ref)]);
+}
+
+int HierarchicalPathfinder::GetClusterLocalPoly(int clusterIndex, NavPolyRef ref) const
+{
+    const NavMeshTile& tile = m_NavMesh->tiles[DecodePolyRefTile(ref)];
+    const int localX = tile.tileX - (clusterIndex % m_ClustersX) * m_ClusterSize;
+    const int localZ = tile.tileZ - (clusterIndex / m_ClustersX) * m_ClusterSize;
+    return m_Clusters[clusterIndex].tileOffsets[localX + localZ * m_ClusterSize] + (int)DecodePolyRefPoly(ref);
+}
+
+unsigned int HierarchicalPathfinder::AllocEntrance()
+{
+    if (!m_FreeEntrances.empty())
+    {
+        const unsigned int index = m_FreeEntrances.back();
+        m_FreeEntrances.pop_back();
+        return index;
+    }
+    m_Entrances.push_back(Entrance());
+    return (unsigned int)m_Entrances.size() - 1;
+}
+
+void HierarchicalPathfinder::Build()
+{
+    if (!m_NavMesh)
+        return;
+    for (auto& cluster : m_Clusters)
+        cluster = Cluster();
+    m_Entrances.clear();
+    m_FreeEntrances.clear();
+    m_ChangedClusters.clear();
+
+    // Each border is found from the cluster on its -x/-z side only.
+    for (int i = 0; i < (int)m_Clusters.size(); ++i)
+        FindClusterEntrances(i, false);
+    for (int i = 0; i < (int)m_Clusters.size(); ++i)
+        ComputeClusterCosts(i);
+}
+
+void HierarchicalPathfinder::MarkTileChanged(int tileIndex)
+{
+    if (!m_NavMesh || tileIndex < 0 || tileIndex >= (int)m_NavMesh->tiles.size())
+        return;
+
+    const int clusterIndex = GetTileCluster(m_NavMesh->tiles[tileIndex]);
+    if (m_Clusters[clusterIndex].changed)
+        return;
+    m_Clusters[clusterIndex].changed = true;
+    m_ChangedClusters.push_back(clusterIndex);
+}
+
+void HierarchicalPathfinder::RebuildChangedClusters()
+{
+    for (int clusterIndex : m_ChangedClusters)
+    {
+        ClearCluster(clusterIndex);
+        FindClusterEntrances(clusterIndex, true);
+        m_Clusters[clusterIndex].changed = false;
+    }
+    m_ChangedClusters.clear();
+    for (int i = 0; i < (int)m_Clusters.size(); ++i)
+        if (m_Clusters[i].dirty)
+            ComputeClusterCosts(i);
+}
+
+void HierarchicalPathfinder::ClearCluster(int clusterIndex)
+{
+    Cluster& cluster = m_Clusters[clusterIndex];
+    for (unsigned int entranceIndex : cluster.entrances)
+    {
+        Entrance& entrance = m_Entrances[entranceIndex];
+        const int otherCluster = entrance.clusters[0] == clusterIndex ? entrance.clusters[1] : entrance.clusters[0];
+        std::vector<unsigned int>& others = m_Clusters[otherCluster].entrances;
+        others.erase(std::find(others.begin(), others.end(), entranceIndex));
+        m_Clusters[otherCluster].dirty = true;
+        entrance.used = false;
+        m_FreeEntrances.push_back(entranceIndex);
+    }
+    cluster.entrances.clear();
+    cluster.dirty = true;
+}
+
+void HierarchicalPathfinder::FindClusterEntrances(int clusterIndex, bool allSides)
+{
+    const int cx = clusterIndex % m_ClustersX;
+    const int cz = clusterIndex / m_ClustersX;
+    const int tileX0 = cx * m_ClusterSize, tileX1 = std::min(m_NavMesh->tilesX, tileX0 + m_ClusterSize);
+    const int tileZ0 = cz * m_ClusterSize, tileZ1 = std::min(m_NavMesh->tilesZ, tileZ0 + m_ClusterSize);
+
+    for (int dir = 0; dir < 4; ++dir)
+        m_BorderLinks[dir].clear();
+
+    // Bucket the links leaving the cluster by the side they cross.
+    for (int tz = tileZ0; tz < tileZ1; ++tz)
+    {
+        for (int tx = tileX0; tx < tileX1; ++tx)
+        {
+            const NavMeshTile& tile = m_NavMesh->tiles[tx + tz * m_NavMesh->tilesX];
+            const NavPolyRef base = m_NavMesh->GetPolyRefBase(tile);
+            for (unsigned int polyIndex = 0; polyIndex < tile.polys.size(); ++polyIndex)
+            {
+                const NavPoly& poly = tile.polys[polyIndex];
+                for (unsigned int i = poly.firstLink; i < poly.firstLink + poly.linkCount; ++i)
+                {
+                    const NavPolyLink& link = tile.links[i];
+                    if (!m_NavMesh->IsValidPolyRef(link.neighbor))
+                        continue;
+                    // Entrances are edges on the cluster border, off-mesh links leaving the cluster do not make one.
+                    const NavMeshTile* neighborTile;
+                    const NavPoly* neighborPoly;
+                    m_NavMesh->GetTileAndPoly(link.neighbor, neighborTile, neighborPoly);
+                    if (poly.type != NAVPOLYTYPE_GROUND || neighborPoly->type != NAVPOLYTYPE_GROUND)
+                        continue;
+                    const int neighborCluster = GetPolyCluster(link.neighbor);
+                    if (neighborCluster == clusterIndex)
+                        continue;
+
+                    const int ncx = neighborCluster % m_ClustersX, ncz = neighborCluster / m_ClustersX;
+                    const int dir = ncx < cx ? 0 : ncz < cz ? 1 : ncx > cx ? 2 : 3;
+                    if (!allSides && dir < 2)
+                        continue;
+
+                    const bool alongZ = (dir == 0 || dir == 2);
+                    const float a = alongZ ? link.left.z : link.left.x;
+                    const float b = alongZ ? link.right.z : link.right.x;
+                    BorderLink borderLink;
+                    borderLink.from = std::min(a, b);
+                    borderLink.to = std::max(a, b);
+                    borderLink.y = link.left.y;
+                    borderLink.inner = base | (NavPolyRef)polyIndex;
+                    borderLink.outer = link.neighbor;
+                    borderLink.mid = (link.left + link.right) * 0.5f;
+                    m_BorderLinks[dir].push_back(borderLink);
+                }
+            }
+        }
+    }
+
+    // Group touching links into entrances and place one node in the middle of each.
+    const float maxWidth = MAX_ENTRANCE_WIDTH * m_NavMesh->cellSize;
+    const float maxStep = 2.0f * m_NavMesh->cellHeight;
+    const float touchEpsilon = 0.01f * m_NavMesh->cellSize;
+    for (int dir = 0; dir < 4; ++dir)
+    {
+        std::vector<BorderLink>& links = m_BorderLinks[dir];
+        std::sort(links.begin(), links.end(), [](const BorderLink& a, const BorderLink& b) { return a.from < b.from; });
+
+        size_t first = 0;
+        while (first < links.size())
+        {
+            size_t last = first;
+            while (last + 1 < links.size() && links[last + 1].from <= links[last].to + touchEpsilon &&
+                   fabsf(links[last + 1].y - links[last].y) <= maxStep && links[last + 1].to - links[first].from <= maxWidth)
+                last++;
+
+            const BorderLink& middle = links[(first + last) / 2];
+            const unsigned int entranceIndex = AllocEntrance();
+            Entrance& entrance = m_Entrances[entranceIndex];
+            entrance.pos = middle.mid;
+            entrance.polys[0] = middle.inner;
+            entrance.polys[1] = middle.outer;
+            entrance.clusters[0] = clusterIndex;
+            entrance.clusters[1] = GetPolyCluster(middle.outer);
+            entrance.localIndex[0] = entrance.localIndex[1] = -1;
+            entrance.used = true;
+
+            m_Clusters[clusterIndex].entrances.push_back(entranceIndex);
+            m_Clusters[clusterIndex].dirty = true;
+            m_Clusters[entrance.clusters[1]].entrances.push_back(entranceIndex);
+            m_Clusters[entrance.clusters[1]].dirty = true;
+            first = last + 1;
+        }
+    }
+}
+
+void HierarchicalPathfinder::ComputeClusterCosts(int clusterIndex)
+{
+    Cluster& cluster = m_Clusters[clusterIndex];
+    const int cx = clusterIndex % m_ClustersX;
+    const int cz = clusterIndex / m_ClustersX;
+
+    cluster.tileOffsets.assign(m_ClusterSize * m_ClusterSize, 0);
+    cluster.polyCount = 0;
+    for (int z = 0; z < m_ClusterSize; ++z)
+    {
+        for (int x = 0; x < m_ClusterSize; ++x)
+        {
+            const int tx = cx * m_ClusterSize + x, tz = cz * m_ClusterSize + z;
+            if (tx >= m_NavMesh->tilesX || tz >= m_NavMesh->tilesZ)
+                continue;
+            cluster.tileOffsets[x + z * m_ClusterSize] = cluster.polyCount;
+            cluster.polyCount += (int)m_NavMesh->tiles[tx + tz * m_NavMesh->tilesX].polys.size();
+        }
+    }
+
+    const int count = (int)cluster.entrances.size();
+    for (int i = 0; i < count; ++i)
+    {
+        Entrance& entrance = m_Entrances[cluster.entrances[i]];
+        entrance.localIndex[entrance.clusters[0] == clusterIndex ? 0 : 1] = i;
+    }
+
+    cluster.costs.assign((size_t)count * count, FLT_MAX);
+    for (int i = 0; i < count; ++i)
+    {
+        const Entrance& entrance = m_Entrances[cluster.entrances[i]];
+        const NavPolyRef ref = entrance.polys[entrance.clusters[0] == clusterIndex ? 0 : 1];
+        // An entrance on a poly the filter rejects stays unconnected.
+        const NavMeshTile* tile;
+        const NavPoly* poly;
+        m_NavMesh->GetTileAndPoly(ref, tile, poly);
+        if (m_CostFilter.PassFilter(ref, tile, poly))
+            ClusterDijkstra(clusterIndex, ref, entrance.pos, m_CostFilter, &cluster.costs[(size_t)i * count]);
+    }
+    cluster.dirty = false;
+}
+
+void HierarchicalPathfinder::ClusterDijkstra(int clusterIndex, NavPolyRef startRef, const glm::vec3& startPos, const NavQueryFilter& filter,
+                                             float* entranceCosts)
+{
+    const Cluster& cluster = m_Clusters[clusterIndex];
+    for (size_t i = 0; i < cluster.entrances.size(); ++i)
+        entranceCosts[i] = FLT_MAX;
+    if (!m_NavMesh->IsValidPolyRef(startRef) || GetPolyCluster(startRef) != clusterIndex)
+        return;
+
+    if ((int)m_PolyCost.size() < cluster.polyCount)
+    {
+        m_PolyCost.resize(cluster.polyCount);
+        m_PolyPos.resize(cluster.polyCount);
+        m_PolyRef.resize(cluster.polyCount);
+        m_PolyStamp.resize(cluster.polyCount, 0);
+    }
+    if (++m_DijkstraStamp == 0)
+    {
+        std::fill(m_PolyStamp.begin(), m_PolyStamp.end(), 0);
+        m_DijkstraStamp = 1;
+    }
+
+    const int startLocal = GetClusterLocalPoly(clusterIndex, startRef);
+    m_PolyCost[startLocal] = 0.0f;
+    m_PolyPos[startLocal] = startPos;
+    m_PolyRef[startLocal] = startRef;
+    m_PolyStamp[startLocal] = m_DijkstraStamp;
+    m_PolyOpen.clear();
+    m_PolyOpen.push_back({0.0f, (unsigned int)startLocal});
+
+    while (!m_PolyOpen.empty())
+    {
+        std::pop_heap(m_PolyOpen.begin(), m_PolyOpen.end(), OpenEntryGreater);
+        const OpenEntry entry = m_PolyOpen.back();
+        m_PolyOpen.pop_back();
+        if (entry.total > m_PolyCost[entry.node])
+            continue;
+
+        const NavMeshTile* tile;
+        const NavPoly* poly;
+        m_NavMesh->GetTileAndPoly(m_PolyRef[entry.node], tile, poly);
+        for (unsigned int i = poly->firstLink; i < poly->firstLink + poly->linkCount; ++i)
+        {
+            const NavPolyLink& link = tile->links[i];
+            if (!m_NavMesh->IsValidPolyRef(link.neighbor) || GetPolyCluster(link.neighbor) != clusterIndex)
+                continue;
+            const NavMeshTile* neighborTile;
+            const NavPoly* neighborPoly;
+            m_NavMesh->GetTileAndPoly(link.neighbor, neighborTile, neighborPoly);
+            if (!filter.PassFilter(link.neighbor, neighborTile, neighborPoly))
+                continue;
+
+            // Like the poly A*, a move is charged at the cost of the poly it crosses.
+            const int neighborLocal = GetClusterLocalPoly(clusterIndex, link.neighbor);
+            const glm::vec3 mid = (link.left + link.right) * 0.5f;
+            const float cost = entry.total + filter.GetCost(m_PolyPos[entry.node], mid, poly);
+            if (m_PolyStamp[neighborLocal] == m_DijkstraStamp && cost >= m_PolyCost[neighborLocal])
+                continue;
+
+            m_PolyCost[neighborLocal] = cost;
+            m_PolyPos[neighborLocal] = mid;
+            m_PolyRef[neighborLocal] = link.neighbor;
+            m_PolyStamp[neighborLocal] = m_DijkstraStamp;
+            m_PolyOpen.push_back({cost, (unsigned int)neighborLocal});
+            std::push_heap(m_PolyOpen.begin(), m_PolyOpen.end(), OpenEntryGreater);
+        }
+    }
+
+    for (size_t i = 0; i < cluster.entrances.size(); ++i)
+    {
+        const Entrance& entrance = m_Entrances[cluster.entrances[i]];
+        const NavPolyRef ref = entrance.polys[entrance.clusters[0] == clusterIndex ? 0 : 1];
+        const int local = GetClusterLocalPoly(clusterIndex, ref);
+        if (m_PolyStamp[local] != m_DijkstraStamp)
+            continue;
+        const NavMeshTile* tile;
+        const NavPoly* poly;
+        m_NavMesh->GetTileAndPoly(ref, tile, poly);
+        entranceCosts[i] = m_PolyCost[local] + filter.GetCost(m_PolyPos[local], entrance.pos, poly);
+    }
+}
+
+NavQueryStatus HierarchicalPathfinder::FindPath(NavPolyRef startRef, NavPolyRef endRef, const glm::vec3& startPos, const glm::vec3& endPos,
+                                                const NavQueryFilter& filter, NavPolyRef* path, int& pathCount, int maxPath)
+{
+    pathCount = 0;
+    m_LastAbstractExpansions = 0;
+    m_LastRefineExpansions = 0;
+    if (!m_NavMesh || !m_NavMesh->IsValidPolyRef(startRef) || !m_NavMesh->IsValidPolyRef(endRef))
+        return NAVQUERY_FAILURE;
+
+    auto fullSearch = [&]()
+    {
+        const NavQueryStatus status = m_RefineQuery.FindPath(startRef, endRef, startPos, endPos, filter, path, pathCount, maxPath);
+        m_LastRefineExpansions += m_RefineQuery.GetNodePool()->GetNodeCount();
+        return status;
+    };
+
+    const int startCluster = GetPolyCluster(startRef);
+    const int goalCluster = GetPolyCluster(endRef);
+    if (startCluster == goalCluster)
+        return fullSearch();
+
+    if (!HasSameCosts(filter, m_CostFilter))
+    {
+        m_CostFilter = filter;
+        for (auto& cluster : m_Clusters)
+            cluster.dirty = true;
+    }
+    RebuildChangedClusters();
+
+    const Cluster& start = m_Clusters[startCluster];
+    const Cluster& goal = m_Clusters[goalCluster];
+    m_StartCosts.resize(start.entrances.size());
+    m_GoalCosts.resize(goal.entrances.size());
+    ClusterDijkstra(startCluster, startRef, startPos, filter, m_StartCosts.data());
+    ClusterDijkstra(goalCluster, endRef, endPos, filter, m_GoalCosts.data());
+
+    // A* over the entrances, the goal poly is the extra node after the last entrance.
+    const unsigned int goalNode = (unsigned int)m_Entrances.size();
+    if (m_NodeCost.size() < m_Entrances.size() + 1)
+    {
+        m_NodeCost.resize(m_Entrances.size() + 1);
+        m_NodeParent.resize(m_Entrances.size() + 1);
+        m_NodeStamp.resize(m_Entrances.size() + 1, 0);
+        m_NodeClosed.resize(m_Entrances.size() + 1, 0);
+    }
+    if (++m_SearchStamp == 0)
+    {
+        std::fill(m_NodeStamp.begin(), m_NodeStamp.end(), 0);
+        std::fill(m_NodeClosed.begin(), m_NodeClosed.end(), 0);
+        std::fill(m_CorridorTileStamp.begin(), m_CorridorTileStamp.end(), 0);
+        m_SearchStamp = 1;
+    }
+
+    m_Open.clear();
+    auto relax = [&](unsigned int node, float cost, unsigned int parent)
+    {
+        if (m_NodeClosed[node] == m_SearchStamp || (m_NodeStamp[node] == m_SearchStamp && cost >= m_NodeCost[node]))
+            return;
+        m_NodeCost[node] = cost;
+        m_NodeParent[node] = parent;
+        m_NodeStamp[node] = m_SearchStamp;
+        const float heuristic = node == goalNode ? 0.0f : glm::distance(m_Entrances[node].pos, endPos) * filter.GetMinAreaCost() * ABSTRACT_HEURISTIC_WEIGHT;
+        m_Open.push_back({cost + heuristic, node});
+        std::push_heap(m_Open.begin(), m_Open.end(), OpenEntryGreater);
+    };
+
+    for (size_t i = 0; i < start.entrances.size(); ++i)
+        if (m_StartCosts[i] < FLT_MAX)
+            relax(start.entrances[i], m_StartCosts[i], NO_PARENT);
+
+    bool found = false;
+    while (!m_Open.empty())
+    {
+        std::pop_heap(m_Open.begin(), m_Open.end(), OpenEntryGreater);
+        const unsigned int node = m_Open.back().node;
+        m_Open.pop_back();
+        if (m_NodeClosed[node] == m_SearchStamp)
+            continue;
+        m_NodeClosed[node] = m_SearchStamp;
+        if (node == goalNode)
+        {
+            found = true;
+            break;
+        }
+        m_LastAbstractExpansions++;
+
+        const Entrance& entrance = m_Entrances[node];
+        const float cost = m_NodeCost[node];
+        for (int side = 0; side < 2; ++side)
+        {
+            const int clusterIndex = entrance.clusters[side];
+            const Cluster& cluster = m_Clusters[clusterIndex];
+            const int count = (int)cluster.entrances.size();
+            const int local = entrance.localIndex[side];
+            const float* row = &cluster.costs[(size_t)local * count];
+            for (int j = 0; j < count; ++j)
+                if (j != local && row[j] < FLT_MAX)
+                    relax(cluster.entrances[j], cost + row[j], node);
+            if (clusterIndex == goalCluster && m_GoalCosts[local] < FLT_MAX)
+                relax(goalNode, cost + m_GoalCosts[local], node);
+        }
+    }
+    if (!found)
+        return fullSearch();
+
+    // Refine inside the clusters touched by the abstract path only.
+    MarkCorridorCluster(startCluster);
+    MarkCorridorCluster(goalCluster);
+    for (unsigned int node = m_NodeParent[goalNode]; node != NO_PARENT; node = m_NodeParent[node])
+    {
+        MarkCorridorCluster(m_Entrances[node].clusters[0]);
+        MarkCorridorCluster(m_Entrances[node].clusters[1]);
+    }
+
+    m_RefineQuery.SetTileCorridor(m_CorridorTileStamp.data(), m_SearchStamp);
+    const NavQueryStatus status = m_RefineQuery.FindPath(startRef, endRef, startPos, endPos, filter, path, pathCount, maxPath);
+    m_RefineQuery.SetTileCorridor(nullptr, 0);
+    m_LastRefineExpansions = m_RefineQuery.GetNodePool()->GetNodeCount();
+    if (status != NAVQUERY_SUCCESS)
+        return fullSearch();
+    return status;
+}
@@ -0,0 +1,101 @@
+#pragma once
+#include <vector>
+#include "NavMeshQuery.h"
+
+// HPA* style planner on top of the navmesh. Tiles are grouped into square clusters, every run of ground links
+// crossing a cluster border becomes an entrance node (split when wider than a few cells), and the path
+// costs between the entrances of a cluster are precomputed. A query searches the small entrance graph
+// first and then runs the poly A* restricted to the clusters along the abstract path. The precomputed costs
+// follow the area costs and flags of the last query's filter, a filter that changes them recomputes every cluster.
+class HierarchicalPathfinder
+{
+public:
+    HierarchicalPathfinder();
+
+    bool Init(const NavMesh* navMesh, int clusterSize, int maxNodes); // clusterSize in tiles
+    void Build();
+    // Queues the tile's cluster, so a batch of rebuilt tiles recomputes each cluster once.
+    void MarkTileChanged(int tileIndex);
+    // Recomputes the entrances of the queued clusters and the costs of every cluster they touched. Run by FindPath
+    // before the entrance search.
+    void RebuildChangedClusters();
+
+    NavQueryStatus FindPath(NavPolyRef startRef, NavPolyRef endRef, const glm::vec3& startPos, const glm::vec3& endPos,
+                            const NavQueryFilter& filter, NavPolyRef* path, int& pathCount, int maxPath);
+
+    int GetEntranceCount() const { return (int)(m_Entrances.size() - m_FreeEntrances.size()); }
+    int GetClusterCount() const { return (int)m_Clusters.size(); }
+    int GetLastAbstractExpansions() const { return m_LastAbstractExpansions; }
+    int GetLastRefineExpansions() const { return m_LastRefineExpansions; }
+private:
+    struct Entrance
+    {
+        glm::vec3 pos;          // Midpoint of the portal on the cluster border
+        NavPolyRef polys[2];    // Poly on each side
+        int clusters[2];
+        int localIndex[2];      // Position in each cluster's entrance list
+        bool used;
+    };
+    struct Cluster
+    {
+        std::vector<unsigned int> entrances;
+        std::vector<float> costs;   // entrances x entrances, FLT_MAX when not connected inside the cluster
+        std::vector<int> tileOffsets; // First cluster local poly index of each tile
+        int polyCount;
+        bool dirty;   // Costs out of date
+        bool changed; // Tiles rebuilt, queued in m_ChangedClusters
+    };
+    struct BorderLink
+    {
+        float from, to; // Extent along the border
+        float y;
+        NavPolyRef inner, outer;
+        glm::vec3 mid;
+    };
+    struct OpenEntry
+    {
+        float total;
+        unsigned int node;
+    };
+
+    const NavMesh* m_NavMesh;
+    NavMeshQuery m_RefineQuery;
+    NavQueryFilter m_CostFilter; // Area costs and flags the entrance costs were computed with
+    int m_ClusterSize, m_ClustersX, m_ClustersZ;
+    std::vector<Cluster> m_Clusters;
+    std::vector<Entrance> m_Entrances;
+    std::vector<unsigned int> m_FreeEntrances;
+    std::vector<int> m_ChangedClusters;
+
+    // Cluster local Dijkstra scratch, indexed by cluster local poly
+    std::vector<float> m_PolyCost;
+    std::vector<glm::vec3> m_PolyPos;
+    std::vector<NavPolyRef> m_PolyRef;
+    std::vector<unsigned int> m_PolyStamp;
+    std::vector<OpenEntry> m_PolyOpen;
+    unsigned int m_DijkstraStamp;
+
+    // Abstract search scratch, indexed by entrance, the goal is the extra last node
+    std::vector<float> m_NodeCost;
+    std::vector<unsigned int> m_NodeParent, m_NodeStamp, m_NodeClosed;
+    std::vector<OpenEntry> m_Open;
+    std::vector<float> m_StartCosts, m_GoalCosts;
+    std::vector<BorderLink> m_BorderLinks[4];
+    unsigned int m_SearchStamp;
+
+    std::vector<unsigned int> m_CorridorTileStamp; // Per tile, equal to m_SearchStamp when on the current corridor
+    int m_LastAbstractExpansions, m_LastRefineExpansions;
+
+    int GetTileCluster(const NavMeshTile& tile) const;
+    int GetPolyCluster(NavPolyRef ref) const;
+    void MarkCorridorCluster(int clusterIndex);
+    int GetClusterLocalPoly(int clusterIndex, NavPolyRef ref) const;
+
+    void ClearCluster(int clusterIndex);
+    void FindClusterEntrances(int clusterIndex, bool allSides);
+    void ComputeClusterCosts(int clusterIndex);
+    void ClusterDijkstra(int clusterIndex, NavPolyRef startRef, const glm::vec3& startPos, const NavQueryFilter& filter, float* entranceCosts);
+    unsigned int AllocEntrance();
+
+    static bool OpenEntryGreater(const OpenEntry& a, const OpenEntry& b) { return a.total > b.total; }
+};
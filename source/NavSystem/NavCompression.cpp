@@ -0,0 +1,171 @@
+#include "NavCompression.h"
+#include <cstdint>
+#include <cstring>
+
+static const size_t MIN_MATCH = 4;
+static const size_t MAX_OFFSET = 65535;
+static const int MAX_HASH_BITS = 12;
+static const int MIN_HASH_BITS = 8;
+static const unsigned int SKIP_SHIFT = 5; // Misses before the search starts skipping ahead on incompressible data
+
+static inline uint32_t Read32(const unsigned char* p)
+{
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static inline uint32_t HashSequence(uint32_t sequence, int hashBits)
+{
+    return (sequence * 2654435761u) >> (32 - hashBits);
+}
+
+static unsigned char* WriteLength(unsigned char* op, size_t length)
+{
+    while (length >= 255)
+    {
+        *op++ = 255;
+        length -= 255;
+    }
+    *op++ = (unsigned char)length;
+    return op;
+}
+
+static bool ReadLength(const unsigned char*& ip, const unsigned char* end, size_t& length)
+{
+    unsigned char byte;
+    do
+    {
+        if (ip >= end)
+            return false;
+        byte = *ip++;
+        length += byte;
+    } while (byte == 255);
+    return true;
+}
+
+static unsigned char* WriteSequence(unsigned char* op, const unsigned char* literals, size_t literalCount, size_t offset, size_t matchLength)
+{
+    unsigned char* token = op++;
+    const size_t matchCode = matchLength ? matchLength - MIN_MATCH : 0;
+    *token = (unsigned char)(((literalCount < 15 ? literalCount : 15) << 4) | (matchCode < 15 ? matchCode : 15));
+    if (literalCount >= 15)
+        op = WriteLength(op, literalCount - 15);
+    memcpy(op, literals, literalCount);
+    op += literalCount;
+    if (!matchLength)
+        return op;
+    *op++ = (unsigned char)(offset & 0xff);
+    *op++ = (unsigned char)(offset >> 8);
+    if (matchCode >= 15)
+        op = WriteLength(op, matchCode - 15);
+    return op;
+}
+
+size_t GetCompressBound(size_t size)
+{
+    return size + size / 255 + 16;
+}
+
+size_t CompressTileData(const unsigned char* src, size_t size, unsigned char* dst)
+{
+    // Small inputs get a small table, clearing it costs more than the layer itself otherwise.
+    int hashBits = MIN_HASH_BITS;
+    while (hashBits < MAX_HASH_BITS && ((size_t)1 << hashBits) < size)
+        hashBits++;
+    uint32_t table[1 << MAX_HASH_BITS];
+    memset(table, 0xff, sizeof(uint32_t) << hashBits);
+
+    unsigned char* op = dst;
+    size_t anchor = 0, i = 0;
+    unsigned int misses = 0;
+    while (i + MIN_MATCH <= size)
+    {
+        size_t matchPos = i;
+        const uint32_t sequence = Read32(src + i);
+        if (i > 0 && sequence == src[i - 1] * 0x01010101u)
+        {
+            matchPos = i - 1;
+        }
+        else
+        {
+            const uint32_t hash = HashSequence(sequence, hashBits);
+            const uint32_t candidate = table[hash];
+            table[hash] = (uint32_t)i;
+            if (candidate < i && i - candidate <= MAX_OFFSET && Read32(src + candidate) == sequence)
+                matchPos = candidate;
+        }
+        if (matchPos == i)
+        {
+            i += 1 + (misses++ >> SKIP_SHIFT);
+            continue;
+        }
+
+        size_t length = MIN_MATCH;
+        while (i + length < size && src[matchPos + length] == src[i + length])
+            length++;
+        op = WriteSequence(op, src + anchor, i - anchor, i - matchPos, length);
+        i += length;
+        anchor = i;
+        misses = 0;
+        if (i + MIN_MATCH <= size)
+            table[HashSequence(Read32(src + i - 2), hashBits)] = (uint32_t)(i - 2);
+    }
+    op = WriteSequence(op, src + anchor, size - anchor, 0, 0);
+    return (size_t)(op - dst);
+}
+
+bool DecompressTileData(const unsigned char* src, size_t size, unsigned char* dst, size_t rawSize)
+{
+    const unsigned char* ip = src;
+    const unsigned char* const iend = src + size;
+    unsigned char* op = dst;
+    unsigned char* const oend = dst + rawSize;
+    while (ip < iend)
+    {
+        const unsigned char token = *ip++;
+        size_t literalCount = token >> 4;
+        if (literalCount == 15 && !ReadLength(ip, iend, literalCount))
+            return false;
+        if (literalCount > (size_t)(iend - ip) || literalCount > (size_t)(oend - op))
+            return false;
+        memcpy(op, ip, literalCount);
+        op += literalCount;
+        ip += literalCount;
+        if (ip == iend)
+            break;
+
+        if (iend - ip < 2)
+            return false;
+        const size_t offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        size_t matchLength = (token & 15) + MIN_MATCH;
+        if ((token & 15) == 15 && !ReadLength(ip, iend, matchLength))
+            return false;
+        if (offset == 0 || offset > (size_t)(op - dst) || matchLength > (size_t)(oend - op))
+            return false;
+
+        const unsigned char* match = op - offset;
+        if (offset == 1)
+            memset(op, *match, matchLength);
+        else if (offset >= matchLength)
+            memcpy(op, match, matchLength);
+        else
+            for (size_t k = 0; k < matchLength; ++k)
+                op[k] = match[k];
+        op += matchLength;
+    }
+    return op == oend;
+}
+
+void DeltaEncode(unsigned char* data, size_t size)
+{
+    for (size_t i = size; i-- > 1;)
+        data[i] = (unsigned char)(data[i] - data[i - 1]);
+}
+
+void DeltaDecode(unsigned char* data, size_t size)
+{
+    for (size_t i = 1; i < size; ++i)
+        data[i] = (unsigned char)(data[i] + data[i - 1]);
+}
@@ -0,0 +1,19 @@
+#pragma once
+#include <cstddef>
+
+// Byte oriented LZ77 codec for tile layers and cached heightfield tiles. There is no entropy coding, so decoding
+// is a loop of literal and match copies. A sequence is a token with the literal count in the high nibble and the
+// match length minus 4 in the low nibble, where 15 continues in bytes of 255 up to the first smaller one, then the
+// literals, then the match offset as 16 bit little endian. The last sequence only has literals. Runs are matches at
+// offset 1, which the encoder finds before hashing and the decoder fills with memset.
+
+size_t GetCompressBound(size_t size);
+// Returns the compressed size, dst must hold GetCompressBound(size) bytes.
+size_t CompressTileData(const unsigned char* src, size_t size, unsigned char* dst);
+// False when the data is corrupt or does not decode to exactly rawSize bytes.
+bool DecompressTileData(const unsigned char* src, size_t size, unsigned char* dst, size_t rawSize);
+
+// Prefilter for planes of slowly changing values, every byte becomes the difference to the one before it, so
+// constant stretches and steady slopes turn into runs.
+void DeltaEncode(unsigned char* data, size_t size);
+void DeltaDecode(unsigned char* data, size_t size);
@@ -0,0 +1,202 @@
+#include "NavInputGeometry.h"
+#include "Core/Scene.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+static const unsigned int NAV_INPUT_UNUSED = 0xffffffff;
+static const unsigned int NAV_INPUT_PENDING = 0xfffffffe;
+static const int NAV_INPUT_BOX_TRIANGLES = 12;
+
+static inline unsigned int HashPosition(const Vec3f& v)
+{
+    uint32_t bits[3];
+    memcpy(bits, &v, sizeof(bits));
+    return (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+}
+
+static inline bool ValidTriangle(const unsigned int* tri, int vertCount)
+{
+    return tri[0] < (unsigned int)vertCount && tri[1] < (unsigned int)vertCount && tri[2] < (unsigned int)vertCount;
+}
+
+// Corner of the local bounds a vertex lies on, one bit per axis set at the maximum, -1 when it lies on none.
+static int GetBoxCorner(const Vec3f& v, const Vec3f& lmin, const Vec3f& lmax)
+{
+    const float coords[3] = { v.x, v.y, v.z }, mins[3] = { lmin.x, lmin.y, lmin.z }, maxs[3] = { lmax.x, lmax.y, lmax.z };
+    int corner = 0;
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        if (coords[axis] == maxs[axis])
+            corner |= 1 << axis;
+        else if (coords[axis] != mins[axis])
+            return -1;
+    }
+    return corner;
+}
+
+// Fills corners with the vertex of each corner of the local bounds when the triangles close a box around them: every
+// face is covered by two triangles split along one of its diagonals.
+static bool FindBoxCorners(const Vec3f* verts, const unsigned int* indices, int indexCount, int corners[8])
+{
+    if (indexCount != NAV_INPUT_BOX_TRIANGLES * 3)
+        return false;
+    Vec3f lmin = verts[indices[0]], lmax = verts[indices[0]];
+    for (int i = 1; i < indexCount; ++i)
+    {
+        const Vec3f& v = verts[indices[i]];
+        lmin.x = std::min(lmin.x, v.x); lmin.y = std::min(lmin.y, v.y); lmin.z = std::min(lmin.z, v.z);
+        lmax.x = std::max(lmax.x, v.x); lmax.y = std::max(lmax.y, v.y); lmax.z = std::max(lmax.z, v.z);
+    }
+    if (!(lmin.x < lmax.x && lmin.y < lmax.y && lmin.z < lmax.z))
+        return false;
+
+    int faceTriangles[6] = {}, faceCorners[6][2] = {};
+    for (int i = 0; i < indexCount; i += 3)
+    {
+        int tri[3];
+        for (int k = 0; k < 3; ++k)
+        {
+            tri[k] = GetBoxCorner(verts[indices[i + k]], lmin, lmax);
+            if (tri[k] < 0)
+                return false;
+            corners[tri[k]] = (int)indices[i + k];
+        }
+        if (tri[0] == tri[1] || tri[1] == tri[2] || tri[2] == tri[0])
+            return false;
+        // Distinct corners on one face agree on exactly one axis.
+        const int shared = ~(tri[0] ^ tri[1]) & ~(tri[1] ^ tri[2]) & 7;
+        if (shared != 1 && shared != 2 && shared != 4)
+            return false;
+        const int axis = shared >> 1;
+        const int face = axis * 2 + ((tri[0] >> axis) & 1);
+        if (faceTriangles[face] == 2)
+            return false;
+        faceCorners[face][faceTriangles[face]++] = (1 << tri[0]) | (1 << tri[1]) | (1 << tri[2]);
+    }
+    for (int face = 0; face < 6; ++face)
+    {
+        const int both = faceCorners[face][0] & faceCorners[face][1];
+        if (faceTriangles[face] != 2 || faceCorners[face][0] == faceCorners[face][1])
+            return false;
+        // Two triangles sharing an edge of the face would leave a corner of it uncovered, the shared corners must be opposite.
+        int a = -1, b = -1;
+        for (int c = 0; c < 8; ++c)
+        {
+            if (!(both & (1 << c)))
+                continue;
+            if (a < 0)
+                a = c;
+            else
+                b = c;
+        }
+        const int diff = a ^ b;
+        if (diff == 1 || diff == 2 || diff == 4)
+            return false;
+    }
+    return true;
+}
+
+// The box of the world corners when the transform keeps it upright: flat top and bottom faces over the same footprint.
+static bool MakeInputBox(const glm::vec3 world[8], NavInputBox& box)
+{
+    for (int c = 0; c < 8; ++c)
+    {
+        const glm::vec3& base = world[c & 5];
+        if (world[c].y != world[c & 2].y || world[c].x != base.x || world[c].z != base.z)
+            return false;
+    }
+    const glm::vec3& bottom = world[0];
+    const glm::vec3& top = world[2];
+    if (bottom.y == top.y)
+        return false;
+    // Corners around the footprint, local x and z along its edges.
+    const int order[4] = { 0, 1, 5, 4 };
+    for (int k = 0; k < 4; ++k)
+        box.footprint[k] = glm::vec2(world[order[k]].x, world[order[k]].z);
+    const glm::vec2 u = box.footprint[1] - box.footprint[0], v = box.footprint[3] - box.footprint[0];
+    if (u.x * v.y - u.y * v.x == 0.0f)
+        return false;
+    box.axisAligned = (u.y == 0.0f && v.x == 0.0f) || (u.x == 0.0f && v.y == 0.0f);
+    box.bmin = box.bmax = world[0];
+    for (int c = 1; c < 8; ++c)
+    {
+        box.bmin = glm::min(box.bmin, world[c]);
+        box.bmax = glm::max(box.bmax, world[c]);
+    }
+    return true;
+}
+
+int NavInputGeometry::FindBox(int tri) const
+{
+    auto it = std::upper_bound(boxes.begin(), boxes.end(), tri, [](int t, const NavInputBox& box) { return t < box.firstTriangle; });
+    if (it == boxes.begin())
+        return -1;
+    --it;
+    return tri < it->firstTriangle + it->triangleCount ? (int)(it - boxes.begin()) : -1;
+}
+
+void AppendNavInputMesh(NavInputGeometry& geometry, const Vec3f* verts, int vertCount, const unsigned int* indices, int indexCount,
+                        const glm::mat4& transform, unsigned char area)
+{
+    std::vector<unsigned int> remap(vertCount, NAV_INPUT_UNUSED);
+    for (int i = 0; i + 2 < indexCount; i += 3)
+        if (ValidTriangle(indices + i, vertCount))
+            remap[indices[i]] = remap[indices[i + 1]] = remap[indices[i + 2]] = NAV_INPUT_PENDING;
+
+    // Open addressing over the used local positions, a vertex at a position seen before shares its world vertex.
+    unsigned int tableSize = 16;
+    while (tableSize < (unsigned int)vertCount * 2)
+        tableSize <<= 1;
+    std::vector<unsigned int> table(tableSize, NAV_INPUT_UNUSED);
+    for (int v = 0; v < vertCount; ++v)
+    {
+        if (remap[v] != NAV_INPUT_PENDING)
+            continue;
+        const Vec3f& pos = verts[v];
+        for (unsigned int h = HashPosition(pos) & (tableSize - 1);; h = (h + 1) & (tableSize - 1))
+        {
+            if (table[h] == NAV_INPUT_UNUSED)
+            {
+                table[h] = (unsigned int)v;
+                remap[v] = (unsigned int)geometry.verts.size();
+                geometry.verts.push_back(glm::vec3(transform * glm::vec4(pos.x, pos.y, pos.z, 1.0f)));
+                break;
+            }
+            const Vec3f& other = verts[table[h]];
+            if (other.x == pos.x && other.y == pos.y && other.z == pos.z)
+            {
+                remap[v] = remap[table[h]];
+                break;
+            }
+        }
+    }
+
+    const int firstTriangle = geometry.GetTriangleCount();
+    bool allValid = true;
+    for (int i = 0; i + 2 < indexCount; i += 3)
+    {
+        if (!ValidTriangle(indices + i, vertCount))
+        {
+            allValid = false;
+            continue;
+        }
+        geometry.indices.push_back(remap[indices[i]]);
+        geometry.indices.push_back(remap[indices[i + 1]]);
+        geometry.indices.push_back(remap[indices[i + 2]]);
+        geometry.areas.push_back(area);
+    }
+
+    int corners[8];
+    if (!allValid || !FindBoxCorners(verts, indices, indexCount, corners))
+        return;
+    glm::vec3 world[8];
+    for (int c = 0; c < 8; ++c)
+        world[c] = geometry.verts[remap[corners[c]]];
+    NavInputBox box;
+    if (!MakeInputBox(world, box))
+        return;
+    box.firstTriangle = firstTriangle;
+    box.triangleCount = NAV_INPUT_BOX_TRIANGLES;
+    geometry.boxes.push_back(box);
+}
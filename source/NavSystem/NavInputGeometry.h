@@ -0,0 +1,48 @@
+#pragma once
+#include <vector>
+#include <glm/glm.hpp>
+
+struct Vec3f;
+
+// Upright box recognized among the input meshes: a closed mesh of 12 triangles over the corners of a local box whose
+// transform keeps its top and bottom faces horizontal. Rasterizing it only needs its footprint and heights.
+struct NavInputBox
+{
+    glm::vec3 bmin, bmax;   // World bounds
+    glm::vec2 footprint[4]; // xz corners in order around the footprint, a parallelogram shared by the top and bottom face
+    bool axisAligned;       // Footprint edges run along x and z
+    int firstTriangle;      // The box's triangles follow it
+    int triangleCount;
+};
+
+// Indexed world space input of a build. Each object's vertices are transformed once and shared by its triangles,
+// with three 32-bit indices and the area of the object's walkable surfaces per triangle.
+struct NavInputGeometry
+{
+    std::vector<glm::vec3> verts;
+    std::vector<unsigned int> indices;
+    std::vector<unsigned char> areas; // NavAreaType per triangle
+    std::vector<NavInputBox> boxes;   // Ordered by first triangle
+
+    int GetTriangleCount() const { return (int)areas.size(); }
+    void GetTriangle(int tri, glm::vec3 out[3]) const
+    {
+        out[0] = verts[indices[tri * 3]];
+        out[1] = verts[indices[tri * 3 + 1]];
+        out[2] = verts[indices[tri * 3 + 2]];
+    }
+    void Clear()
+    {
+        verts.clear();
+        indices.clear();
+        areas.clear();
+        boxes.clear();
+    }
+    int FindBox(int tri) const; // Box the triangle belongs to, -1 when it is a plain triangle
+};
+
+// Appends a mesh under a transform. Vertices at the same local position are merged and only the ones the triangles
+// use are transformed, triangles with an index out of range are dropped. Meshes that make up an upright box are
+// also added to the boxes.
+void AppendNavInputMesh(NavInputGeometry& geometry, const Vec3f* verts, int vertCount, const unsigned int* indices, int indexCount,
+                        const glm::mat4& transform, unsigned char area);
@@ -0,0 +1,132 @@
+#include "NavMesh.h"
+#include <algorithm>
+
+struct BVItem
+{
+    unsigned short bmin[3], bmax[3];
+    int i;
+};
+
+static void CalcExtents(const BVItem* items, int imin, int imax, unsigned short* bmin, unsigned short* bmax)
+{
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        bmin[axis] = items[imin].bmin[axis];
+        bmax[axis] = items[imin].bmax[axis];
+    }
+    for (int i = imin + 1; i < imax; ++i)
+    {
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            bmin[axis] = std::min(bmin[axis], items[i].bmin[axis]);
+            bmax[axis] = std::max(bmax[axis], items[i].bmax[axis]);
+        }
+    }
+}
+
+static int LongestAxis(const unsigned short* bmin, const unsigned short* bmax)
+{
+    int axis = 0;
+    int maxSize = bmax[0] - bmin[0];
+    for (int i = 1; i < 3; ++i)
+    {
+        if (bmax[i] - bmin[i] > maxSize)
+        {
+            maxSize = bmax[i] - bmin[i];
+            axis = i;
+        }
+    }
+    return axis;
+}
+
+static void Subdivide(BVItem* items, int imin, int imax, int& curNode, NavBVNode* nodes)
+{
+    const int count = imax - imin;
+    const int nodeIndex = curNode++;
+    NavBVNode& node = nodes[nodeIndex];
+
+    if (count == 1)
+    {
+        for (int axis = 0; axis < 3; ++axis)
+        {
+            node.bmin[axis] = items[imin].bmin[axis];
+            node.bmax[axis] = items[imin].bmax[axis];
+        }
+        node.i = items[imin].i;
+        return;
+    }
+
+    CalcExtents(items, imin, imax, node.bmin, node.bmax);
+    const int axis = LongestAxis(node.bmin, node.bmax);
+    std::sort(items + imin, items + imax, [axis](const BVItem& a, const BVItem& b) { return a.bmin[axis] < b.bmin[axis]; });
+
+    const int split = imin + count / 2;
+    Subdivide(items, imin, split, curNode, nodes);
+    Subdivide(items, split, imax, curNode, nodes);
+
+    nodes[nodeIndex].i = -(curNode - nodeIndex);
+}
+
+void BuildTileBVTree(const NavMesh& navMesh, NavMeshTile& tile)
+{
+    tile.bvTree.clear();
+    if (tile.polys.empty())
+        return;
+
+    const int originX = tile.tileX * navMesh.tileSize;
+    const int originZ = tile.tileZ * navMesh.tileSize;
+    const unsigned int originY = (unsigned int)floorf((tile.bmin.y - navMesh.bmin.y) / navMesh.cellHeight + 0.5f) - 1;
+
+    std::vector<BVItem> items;
+    items.reserve(tile.polys.size());
+    for (size_t i = 0; i < tile.polys.size(); ++i)
+    {
+        const NavPoly& poly = tile.polys[i];
+        if (poly.type != NAVPOLYTYPE_GROUND)
+            continue;
+        items.emplace_back();
+        BVItem& item = items.back();
+        item.bmin[0] = (unsigned short)(poly.minX - originX);
+        item.bmin[1] = (unsigned short)(poly.spanY - originY);
+        item.bmin[2] = (unsigned short)(poly.minZ - originZ);
+        item.bmax[0] = (unsigned short)(poly.maxX + 1 - originX);
+        item.bmax[1] = item.bmin[1];
+        item.bmax[2] = (unsigned short)(poly.maxZ + 1 - originZ);
+        item.i = (int)i;
+    }
+    if (items.empty())
+        return;
+
+    tile.bvTree.resize(items.size() * 2 - 1);
+    int curNode = 0;
+    Subdivide(items.data(), 0, (int)items.size(), curNode, tile.bvTree.data());
+    tile.bvTree.resize(curNode);
+}
+
+void BuildOffMeshIndex(NavMesh& navMesh)
+{
+    const int tileCount = (int)navMesh.tiles.size();
+    const int connectionCount = (int)navMesh.offMeshConnections.size();
+    navMesh.offMeshTileStart.assign(tileCount + 1, 0);
+    navMesh.offMeshTileItems.resize(connectionCount * 2);
+    navMesh.offMeshPolys.assign(connectionCount, 0xffffffff);
+    if (tileCount == 0)
+        return;
+
+    // Counting sort of both ends of every connection by the tile they lie in.
+    std::vector<int> itemTiles(connectionCount * 2);
+    for (int i = 0; i < connectionCount * 2; ++i)
+    {
+        const NavOffMeshConnection& connection = navMesh.offMeshConnections[i >> 1];
+        const glm::vec3& pos = (i & 1) ? connection.end : connection.start;
+        int tileX, tileZ, maxTileX, maxTileZ;
+        navMesh.GetTileRange(pos, pos, tileX, tileZ, maxTileX, maxTileZ);
+        itemTiles[i] = tileX + tileZ * navMesh.tilesX;
+        navMesh.offMeshTileStart[itemTiles[i] + 1]++;
+    }
+    for (int i = 0; i < tileCount; ++i)
+        navMesh.offMeshTileStart[i + 1] += navMesh.offMeshTileStart[i];
+    std::vector<unsigned int> cursor(navMesh.offMeshTileStart.begin(), navMesh.offMeshTileStart.end() - 1);
+    for (int i = 0; i < connectionCount * 2; ++i)
+        navMesh.offMeshTileItems[cursor[itemTiles[i]]++] = (unsigned int)i;
+}
@@ -0,0 +1,269 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+// Polygon references pack salt | tile | poly so a ref stays unique when a tile is rebuilt.
+typedef uint64_t NavPolyRef;
+
+static const unsigned int NAV_SALT_BITS = 16;
+static const unsigned int NAV_TILE_BITS = 28;
+static const unsigned int NAV_POLY_BITS = 20;
+
+inline NavPolyRef EncodePolyRef(unsigned int salt, unsigned int tileIndex, unsigned int polyIndex)
+{
+    return ((NavPolyRef)salt << (NAV_TILE_BITS + NAV_POLY_BITS)) | ((NavPolyRef)tileIndex << NAV_POLY_BITS) | (NavPolyRef)polyIndex;
+}
+inline unsigned int DecodePolyRefSalt(NavPolyRef ref)
+{
+    return (unsigned int)((ref >> (NAV_TILE_BITS + NAV_POLY_BITS)) & ((1ull << NAV_SALT_BITS) - 1));
+}
+inline unsigned int DecodePolyRefTile(NavPolyRef ref)
+{
+    return (unsigned int)((ref >> NAV_POLY_BITS) & ((1ull << NAV_TILE_BITS) - 1));
+}
+inline unsigned int DecodePolyRefPoly(NavPolyRef ref)
+{
+    return (unsigned int)(ref & ((1ull << NAV_POLY_BITS) - 1));
+}
+
+// Surface types of the walkable spans, tagged on scene objects and convex volumes and kept per poly.
+// Query filters turn them into traversal costs, the poly flags derived from them into include/exclude masks.
+enum NavAreaType
+{
+    NAVAREA_GROUND,
+    NAVAREA_ROAD,
+    NAVAREA_WATER
+};
+static const int NAV_MAX_AREAS = 64;
+
+enum NavPolyFlags
+{
+    NAVPOLYFLAG_WALK = 0x01,
+    NAVPOLYFLAG_SWIM = 0x02,
+    NAVPOLYFLAG_OFFMESH = 0x04,
+    NAVPOLYFLAG_ALL = 0xffff
+};
+inline unsigned short GetAreaPolyFlags(unsigned char area)
+{
+    return area == NAVAREA_WATER ? NAVPOLYFLAG_SWIM : NAVPOLYFLAG_WALK;
+}
+
+enum NavPolyType
+{
+    NAVPOLYTYPE_GROUND,
+    NAVPOLYTYPE_OFFMESH
+};
+
+// Link between two points of the mesh that is not walked along the surface: jumps, ladders, teleports. Each one
+// becomes a poly in the tile of its start, linked to the nearest polys within radius of both ends.
+struct NavOffMeshConnection
+{
+    glm::vec3 start, end;
+    float radius;       // Search radius of the polys the ends attach to
+    float cost;         // Added to the area cost of the distance when crossing
+    unsigned char area; // NavAreaType
+    bool bidirectional;
+};
+
+// Axis aligned walkable rectangle merged from heightfield spans of one region and one height. Off-mesh polys
+// follow the ground polys of their tile, their bounds cover both ends and they are left out of the BV tree.
+// Their links are degenerate portals at the attach points, the entry one on the ground poly.
+struct NavPoly
+{
+    glm::vec3 bmin, bmax;
+    int minX, minZ, maxX, maxZ; // Cell bounds, inclusive
+    unsigned int spanY;
+    unsigned int regionID;
+    unsigned int firstLink, linkCount;
+    float cost;           // Extra traversal cost, only off-mesh polys have one
+    unsigned short flags; // NavPolyFlags
+    unsigned char area;   // NavAreaType, regions never cross area types
+    unsigned char type;   // NavPolyType
+};
+// Shared edge segment to a neighbor poly, left/right as seen when leaving this poly.
+struct NavPolyLink
+{
+    NavPolyRef neighbor;
+    glm::vec3 left, right;
+};
+// Bounding volume node with bounds quantized to cells relative to the tile origin.
+// Nodes are stored in skip-list order: a leaf holds a poly index (i >= 0), an inner node holds
+// the negated offset to the node following its subtree (i < 0).
+struct NavBVNode
+{
+    unsigned short bmin[3], bmax[3];
+    int i;
+};
+// Tile data array that either owns its elements or views them in place, in a mapped navmesh file.
+// Modifying the size of a view copies the elements into owned storage first.
+template <typename T>
+class NavTileArray
+{
+public:
+    NavTileArray() : m_Data(nullptr), m_Size(0) {}
+    NavTileArray(const NavTileArray& other) : m_Storage(other.m_Storage) { Attach(other); }
+    NavTileArray(NavTileArray&& other) noexcept : m_Storage(std::move(other.m_Storage)), m_Data(other.m_Data), m_Size(other.m_Size)
+    {
+        other.m_Data = nullptr;
+        other.m_Size = 0;
+    }
+    NavTileArray& operator=(const NavTileArray& other)
+    {
+        if (this != &other)
+        {
+            m_Storage = other.m_Storage;
+            Attach(other);
+        }
+        return *this;
+    }
+    NavTileArray& operator=(NavTileArray&& other) noexcept
+    {
+        if (this != &other)
+        {
+            // Moving the vector keeps its buffer, so the pointer stays valid for owned arrays as well as views.
+            m_Storage = std::move(other.m_Storage);
+            m_Data = other.m_Data;
+            m_Size = other.m_Size;
+            other.m_Data = nullptr;
+            other.m_Size = 0;
+        }
+        return *this;
+    }
+
+    void SetView(T* data, size_t size)
+    {
+        m_Storage.clear();
+        m_Data = data;
+        m_Size = size;
+    }
+    bool IsView() const { return m_Data && m_Data != m_Storage.data(); }
+
+    size_t size() const { return m_Size; }
+    bool empty() const { return m_Size == 0; }
+    T* data() { return m_Data; }
+    const T* data() const { return m_Data; }
+    T& operator[](size_t i) { return m_Data[i]; }
+    const T& operator[](size_t i) const { return m_Data[i]; }
+    T* begin() { return m_Data; }
+    T* end() { return m_Data + m_Size; }
+    const T* begin() const { return m_Data; }
+    const T* end() const { return m_Data + m_Size; }
+
+    void push_back(const T& value)
+    {
+        MakeOwned();
+        m_Storage.push_back(value);
+        Sync();
+    }
+    void resize(size_t size)
+    {
+        MakeOwned();
+        m_Storage.resize(size);
+        Sync();
+    }
+    void clear()
+    {
+        m_Storage.clear();
+        Sync();
+    }
+private:
+    std::vector<T> m_Storage;
+    T* m_Data;
+    size_t m_Size;
+
+    void Attach(const NavTileArray& other)
+    {
+        if (other.IsView())
+        {
+            m_Data = other.m_Data;
+            m_Size = other.m_Size;
+        }
+        else
+        {
+            Sync();
+        }
+    }
+    void MakeOwned()
+    {
+        if (IsView())
+            m_Storage.assign(m_Data, m_Data + m_Size);
+    }
+    void Sync()
+    {
+        m_Data = m_Storage.empty() ? nullptr : m_Storage.data();
+        m_Size = m_Storage.size();
+    }
+};
+
+struct NavMeshTile
+{
+    int tileX, tileZ;
+    unsigned int salt;
+    glm::vec3 bmin, bmax;
+    NavTileArray<NavPoly> polys;
+    NavTileArray<NavPolyLink> links;
+    NavTileArray<NavBVNode> bvTree;
+};
+struct NavMesh
+{
+    glm::vec3 bmin;
+    float cellSize, cellHeight;
+    int tileSize; // In cells
+    int tilesX, tilesZ;
+    std::vector<NavMeshTile> tiles;
+    // Off-mesh connections with their ends bucketed by tile, items are connection << 1 | isEnd, so building a tile
+    // only visits the connections touching it. offMeshPolys holds the poly of each connection in the tile of its start.
+    std::vector<NavOffMeshConnection> offMeshConnections;
+    std::vector<unsigned int> offMeshTileStart, offMeshTileItems, offMeshPolys;
+
+    bool IsValidPolyRef(NavPolyRef ref) const
+    {
+        if (!ref)
+            return false;
+        const unsigned int tileIndex = DecodePolyRefTile(ref);
+        if (tileIndex >= tiles.size())
+            return false;
+        const NavMeshTile& tile = tiles[tileIndex];
+        return tile.salt == DecodePolyRefSalt(ref) && DecodePolyRefPoly(ref) < tile.polys.size();
+    }
+    // Ref must be valid.
+    void GetTileAndPoly(NavPolyRef ref, const NavMeshTile*& tile, const NavPoly*& poly) const
+    {
+        tile = &tiles[DecodePolyRefTile(ref)];
+        poly = &tile->polys[DecodePolyRefPoly(ref)];
+    }
+    NavPolyRef GetPolyRefBase(const NavMeshTile& tile) const
+    {
+        return EncodePolyRef(tile.salt, (unsigned int)(&tile - &tiles[0]), 0);
+    }
+    void GetTileRange(const glm::vec3& qmin, const glm::vec3& qmax, int& minTileX, int& minTileZ, int& maxTileX, int& maxTileZ) const
+    {
+        const float tileWorldSize = tileSize * cellSize;
+        minTileX = glm::clamp((int)floorf((qmin.x - bmin.x) / tileWorldSize), 0, tilesX - 1);
+        minTileZ = glm::clamp((int)floorf((qmin.z - bmin.z) / tileWorldSize), 0, tilesZ - 1);
+        maxTileX = glm::clamp((int)floorf((qmax.x - bmin.x) / tileWorldSize), 0, tilesX - 1);
+        maxTileZ = glm::clamp((int)floorf((qmax.z - bmin.z) / tileWorldSize), 0, tilesZ - 1);
+    }
+    // Bucket of the tile in offMeshTileItems, empty when the index was not built for the current tile grid.
+    int GetOffMeshTileItems(int tileIndex, const unsigned int*& items) const
+    {
+        items = nullptr;
+        if (offMeshTileStart.size() != tiles.size() + 1)
+            return 0;
+        items = offMeshTileItems.data() + offMeshTileStart[tileIndex];
+        return (int)(offMeshTileStart[tileIndex + 1] - offMeshTileStart[tileIndex]);
+    }
+    int GetPolyCount() const
+    {
+        int count = 0;
+        for (const auto& tile : tiles)
+            count += (int)tile.polys.size();
+        return count;
+    }
+};
+
+// Builds the quantized BV tree of a tile from the cell bounds of its ground polys.
+void BuildTileBVTree(const NavMesh& navMesh, NavMeshTile& tile);
+// Buckets the ends of the off-mesh connections by tile, needed again whenever the connections or the tile grid change.
+void BuildOffMeshIndex(NavMesh& navMesh);
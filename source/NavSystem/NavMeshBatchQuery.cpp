@@ -0,0 +1,195 @@
+#include "NavMeshBatchQuery.h"
+#include "Core/JobSystem.h"
+#include <cstring>
+#include <iostream>
+
+static const int BATCH_MAX_PATH_POLYS = 256;
+static const int BATCH_REQUESTS_PER_JOB = 16;
+
+void NavPathBatch::Resize(int requestCount, int maxCornersPerPath)
+{
+    starts.resize(requestCount);
+    ends.resize(requestCount);
+    filters.resize(requestCount, nullptr);
+    maxCorners = maxCornersPerPath;
+    status.resize(requestCount);
+    polyCount.resize(requestCount);
+    cornerCount.resize(requestCount);
+    corners.resize((size_t)requestCount * maxCornersPerPath);
+    resultSource.resize(requestCount);
+}
+
+static const NavQueryFilter* GetRequestFilter(const NavPathBatch& batch, int request)
+{
+    return request < (int)batch.filters.size() ? batch.filters[request] : nullptr;
+}
+
+uint64_t NavMeshBatchQuery::HashRequest(const NavPathBatch& batch, int request)
+{
+    uint32_t bits[6];
+    memcpy(bits, &batch.starts[request], sizeof(float) * 3);
+    memcpy(bits + 3, &batch.ends[request], sizeof(float) * 3);
+    uint64_t h = (uint64_t)(uintptr_t)GetRequestFilter(batch, request);
+    for (int i = 0; i < 6; ++i)
+    {
+        h ^= bits[i];
+        h *= 0x9e3779b97f4a7c15ull;
+        h ^= h >> 29;
+    }
+    return h;
+}
+
+bool NavMeshBatchQuery::SameRequest(const NavPathBatch& batch, int a, int b)
+{
+    return batch.starts[a] == batch.starts[b] && batch.ends[a] == batch.ends[b] && GetRequestFilter(batch, a) == GetRequestFilter(batch, b);
+}
+
+NavMeshBatchQuery::NavMeshBatchQuery() : m_NavMesh(nullptr), m_JobSystem(nullptr)
+{
+}
+
+NavMeshBatchQuery::~NavMeshBatchQuery()
+{
+    ReleaseWorkers();
+}
+
+void NavMeshBatchQuery::ReleaseWorkers()
+{
+    for (auto& worker : m_Workers)
+        delete worker.query;
+    m_Workers.clear();
+}
+
+bool NavMeshBatchQuery::Init(const NavMesh* navMesh, int maxNodes, JobSystem* jobSystem)
+{
+    m_NavMesh = navMesh;
+    m_JobSystem = jobSystem;
+    const int workerCount = jobSystem ? jobSystem->GetWorkerCount() : 1;
+
+    if ((int)m_Workers.size() != workerCount)
+    {
+        ReleaseWorkers();
+        m_Workers.resize(workerCount);
+        for (auto& worker : m_Workers)
+        {
+            worker.query = new NavMeshQuery();
+            worker.path.resize(BATCH_MAX_PATH_POLYS);
+        }
+    }
+    for (auto& worker : m_Workers)
+    {
+        if (!worker.query->Init(navMesh, maxNodes))
+            return false;
+    }
+    return true;
+}
+
+void NavMeshBatchQuery::SetIslands(const NavMeshIslands* islands)
+{
+    for (auto& worker : m_Workers)
+        worker.query->SetIslands(islands);
+}
+
+void NavMeshBatchQuery::SetLandmarks(const NavMeshLandmarks* landmarks)
+{
+    for (auto& worker : m_Workers)
+        worker.query->SetLandmarks(landmarks);
+}
+
+void NavMeshBatchQuery::Run(NavPathBatch& batch)
+{
+    const int requestCount = batch.GetRequestCount();
+    if (!m_NavMesh || m_Workers.empty() || requestCount == 0)
+        return;
+    if ((int)batch.status.size() < requestCount || (size_t)batch.maxCorners * requestCount > batch.corners.size())
+    {
+        std::cout << "NavMeshBatchQuery: batch outputs are not sized, call NavPathBatch::Resize." << std::endl;
+        return;
+    }
+
+    Deduplicate(batch);
+
+    const int uniqueCount = (int)m_UniqueRequests.size();
+    auto solve = [&](int begin, int end, int workerIndex)
+    {
+        WorkerContext& worker = m_Workers[workerIndex];
+        for (int i = begin; i < end; ++i)
+            RunRequest(batch, m_UniqueRequests[i], worker);
+    };
+    if (m_JobSystem)
+        m_JobSystem->ParallelFor(uniqueCount, BATCH_REQUESTS_PER_JOB, solve);
+    else
+        solve(0, uniqueCount, 0);
+
+    if (uniqueCount == requestCount)
+        return;
+
+    for (int i = 0; i < requestCount; ++i)
+    {
+        const int source = batch.resultSource[i];
+        if (source == i)
+            continue;
+        batch.status[i] = batch.status[source];
+        batch.polyCount[i] = batch.polyCount[source];
+        batch.cornerCount[i] = batch.cornerCount[source];
+        memcpy(&batch.corners[(size_t)i * batch.maxCorners], batch.GetCorners(source), sizeof(glm::vec3) * batch.cornerCount[source]);
+    }
+}
+
+void NavMeshBatchQuery::Deduplicate(NavPathBatch& batch)
+{
+    const int requestCount = batch.GetRequestCount();
+    m_UniqueRequests.clear();
+
+    size_t slotCount = 1;
+    while (slotCount < (size_t)requestCount * 2)
+        slotCount <<= 1;
+    m_RequestSlots.assign(slotCount, -1);
+    const size_t mask = slotCount - 1;
+
+    for (int i = 0; i < requestCount; ++i)
+    {
+        size_t slot = (size_t)HashRequest(batch, i) & mask;
+        while (m_RequestSlots[slot] >= 0 && !SameRequest(batch, m_RequestSlots[slot], i))
+            slot = (slot + 1) & mask;
+
+        if (m_RequestSlots[slot] < 0)
+        {
+            m_RequestSlots[slot] = i;
+            m_UniqueRequests.push_back(i);
+        }
+        batch.resultSource[i] = m_RequestSlots[slot];
+    }
+}
+
+void NavMeshBatchQuery::RunRequest(NavPathBatch& batch, int request, WorkerContext& worker)
+{
+    NavMeshQuery& query = *worker.query;
+    const NavQueryFilter* filter = GetRequestFilter(batch, request);
+    if (!filter)
+        filter = &m_DefaultFilter;
+
+    batch.status[request] = NAVQUERY_FAILURE;
+    batch.polyCount[request] = 0;
+    batch.cornerCount[request] = 0;
+
+    NavPolyRef startRef, endRef;
+    glm::vec3 startPos, endPos;
+    query.FindNearestPoly(batch.starts[request], batch.halfExtents, *filter, startRef, startPos);
+    query.FindNearestPoly(batch.ends[request], batch.halfExtents, *filter, endRef, endPos);
+    if (!startRef || !endRef || !query.IsReachable(startRef, endRef))
+        return;
+
+    int pathCount = 0;
+    const NavQueryStatus status = query.FindPath(startRef, endRef, startPos, endPos, *filter, worker.path.data(), pathCount,
+                                                 (int)worker.path.size());
+    if (status == NAVQUERY_FAILURE)
+        return;
+
+    int cornerCount = 0;
+    query.FindStraightPath(startPos, endPos, worker.path.data(), pathCount, &batch.corners[(size_t)request * batch.maxCorners],
+                           cornerCount, batch.maxCorners);
+    batch.status[request] = status;
+    batch.polyCount[request] = pathCount;
+    batch.cornerCount[request] = cornerCount;
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include "NavMeshQuery.h"
+
+class JobSystem;
+
+// Path requests and results stored as parallel arrays so many agents can be resolved in one call.
+// Resize allocates every output once; Run only writes into them.
+struct NavPathBatch
+{
+    std::vector<glm::vec3> starts, ends;
+    std::vector<const NavQueryFilter*> filters; // nullptr uses the default filter
+    glm::vec3 halfExtents;
+
+    int maxCorners;
+    std::vector<NavQueryStatus> status;
+    std::vector<int> polyCount, cornerCount;
+    std::vector<glm::vec3> corners;  // maxCorners slots per request
+    std::vector<int> resultSource;   // Request the result was computed for, differs from i for duplicates
+
+    NavPathBatch() : halfExtents(1.0f, 2.0f, 1.0f), maxCorners(0) {}
+
+    void Resize(int requestCount, int maxCornersPerPath);
+    int GetRequestCount() const { return (int)starts.size(); }
+    const glm::vec3* GetCorners(int request) const { return &corners[(size_t)request * maxCorners]; }
+};
+
+// Runs nearest poly lookup, A* and string pulling for a whole batch across the job system.
+// Every worker owns a NavMeshQuery (node pool and open list) so workers never share search state.
+class NavMeshBatchQuery
+{
+public:
+    NavMeshBatchQuery();
+    ~NavMeshBatchQuery();
+
+    bool Init(const NavMesh* navMesh, int maxNodes, JobSystem* jobSystem);
+    void SetIslands(const NavMeshIslands* islands);
+    void SetLandmarks(const NavMeshLandmarks* landmarks);
+    // Used by the batches that carry no filters of their own.
+    void SetDefaultFilter(const NavQueryFilter& filter) { m_DefaultFilter = filter; }
+    void Run(NavPathBatch& batch);
+
+    int GetUniqueRequestCount() const { return (int)m_UniqueRequests.size(); }
+private:
+    struct WorkerContext
+    {
+        NavMeshQuery* query;
+        std::vector<NavPolyRef> path;
+    };
+
+    const NavMesh* m_NavMesh;
+    JobSystem* m_JobSystem;
+    std::vector<WorkerContext> m_Workers;
+    NavQueryFilter m_DefaultFilter;
+
+    std::vector<int> m_UniqueRequests;
+    std::vector<int> m_RequestSlots; // Open addressing table of request indices, -1 = empty
+
+    static uint64_t HashRequest(const NavPathBatch& batch, int request);
+    static bool SameRequest(const NavPathBatch& batch, int a, int b);
+
+    void Deduplicate(NavPathBatch& batch);
+    void RunRequest(NavPathBatch& batch, int request, WorkerContext& worker);
+    void ReleaseWorkers();
+};
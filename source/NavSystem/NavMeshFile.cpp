@@ -0,0 +1,206 @@
+#include "NavMeshFile.h"
+#include "Core/MappedFile.h"
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+static bool IsLittleEndianHost()
+{
+    const uint32_t value = 1;
+    unsigned char first;
+    memcpy(&first, &value, 1);
+    return first == 1;
+}
+
+static uint64_t AlignOffset(uint64_t offset)
+{
+    return (offset + NAVMESH_FILE_ALIGNMENT - 1) & ~(NAVMESH_FILE_ALIGNMENT - 1);
+}
+
+template <typename T>
+static uint64_t AppendArray(std::vector<unsigned char>& buffer, uint64_t tileStart, const NavTileArray<T>& items)
+{
+    const uint64_t offset = AlignOffset(buffer.size());
+    buffer.resize(offset + items.size() * sizeof(T), 0);
+    if (!items.empty())
+        memcpy(&buffer[offset], items.data(), items.size() * sizeof(T));
+    return offset - tileStart;
+}
+
+bool SaveNavMesh(const NavMesh& navMesh, const char* path)
+{
+    if (!IsLittleEndianHost())
+    {
+        std::cout << "SaveNavMesh: navmesh files are little endian, big endian hosts are not supported." << std::endl;
+        return false;
+    }
+
+    std::vector<unsigned char> buffer(sizeof(NavMeshFileHeader), 0);
+    NavMeshFileHeader header = NavMeshFileHeader();
+    header.magic = NAVMESH_FILE_MAGIC;
+    header.version = NAVMESH_FILE_VERSION;
+    header.endianTag = NAVMESH_FILE_ENDIAN_TAG;
+    header.headerSize = sizeof(NavMeshFileHeader);
+    header.bmin[0] = navMesh.bmin.x;
+    header.bmin[1] = navMesh.bmin.y;
+    header.bmin[2] = navMesh.bmin.z;
+    header.cellSize = navMesh.cellSize;
+    header.cellHeight = navMesh.cellHeight;
+    header.tileSize = navMesh.tileSize;
+    header.tilesX = navMesh.tilesX;
+    header.tilesZ = navMesh.tilesZ;
+    header.tileCount = (uint32_t)navMesh.tiles.size();
+    header.tileTableOffset = AlignOffset(buffer.size());
+
+    std::vector<NavMeshFileTileEntry> entries(navMesh.tiles.size());
+    buffer.resize(header.tileTableOffset + entries.size() * sizeof(NavMeshFileTileEntry), 0);
+    for (size_t i = 0; i < navMesh.tiles.size(); ++i)
+    {
+        const NavMeshTile& tile = navMesh.tiles[i];
+        const uint64_t tileStart = AlignOffset(buffer.size());
+        buffer.resize(tileStart + sizeof(NavMeshFileTile), 0);
+
+        NavMeshFileTile tileHeader = NavMeshFileTile();
+        tileHeader.magic = NAVMESH_FILE_TILE_MAGIC;
+        tileHeader.tileX = tile.tileX;
+        tileHeader.tileZ = tile.tileZ;
+        tileHeader.salt = tile.salt;
+        memcpy(tileHeader.bmin, &tile.bmin, sizeof(tileHeader.bmin));
+        memcpy(tileHeader.bmax, &tile.bmax, sizeof(tileHeader.bmax));
+        tileHeader.polyCount = (uint32_t)tile.polys.size();
+        tileHeader.linkCount = (uint32_t)tile.links.size();
+        tileHeader.bvNodeCount = (uint32_t)tile.bvTree.size();
+        tileHeader.polyOffset = AppendArray(buffer, tileStart, tile.polys);
+        tileHeader.linkOffset = AppendArray(buffer, tileStart, tile.links);
+        tileHeader.bvNodeOffset = AppendArray(buffer, tileStart, tile.bvTree);
+        memcpy(&buffer[tileStart], &tileHeader, sizeof(tileHeader));
+
+        entries[i].offset = tileStart;
+        entries[i].size = buffer.size() - tileStart;
+    }
+    memcpy(&buffer[0], &header, sizeof(header));
+    if (!entries.empty())
+        memcpy(&buffer[header.tileTableOffset], entries.data(), entries.size() * sizeof(NavMeshFileTileEntry));
+
+    FILE* file = fopen(path, "wb");
+    if (!file)
+    {
+        std::cout << "SaveNavMesh: could not open " << path << " for writing." << std::endl;
+        return false;
+    }
+    const bool written = fwrite(buffer.data(), 1, buffer.size(), file) == buffer.size();
+    fclose(file);
+    if (!written)
+        std::cout << "SaveNavMesh: could not write " << path << "." << std::endl;
+    return written;
+}
+
+// Points the tile array at count elements at offset from the tile start, after checking they lie inside the tile.
+template <typename T>
+static bool ViewArray(unsigned char* tileData, uint64_t tileSize, uint64_t offset, uint32_t count, NavTileArray<T>& items)
+{
+    if (offset % NAVMESH_FILE_ALIGNMENT != 0 || offset > tileSize || (tileSize - offset) / sizeof(T) < count)
+        return false;
+    items.SetView(reinterpret_cast<T*>(tileData + offset), count);
+    return true;
+}
+
+bool ValidateNavMeshFileHeader(const NavMeshFileHeader& header, uint64_t fileSize)
+{
+    if (header.magic != NAVMESH_FILE_MAGIC || header.headerSize != sizeof(header))
+    {
+        std::cout << "LoadNavMesh: not a navmesh file." << std::endl;
+        return false;
+    }
+    if (header.version != NAVMESH_FILE_VERSION)
+    {
+        std::cout << "LoadNavMesh: file version " << header.version << ", expected " << NAVMESH_FILE_VERSION << "." << std::endl;
+        return false;
+    }
+    if (header.endianTag != NAVMESH_FILE_ENDIAN_TAG || !IsLittleEndianHost())
+    {
+        std::cout << "LoadNavMesh: byte order does not match the host." << std::endl;
+        return false;
+    }
+    if (header.tilesX <= 0 || header.tilesZ <= 0 || header.tileSize <= 0 || !std::isfinite(header.cellSize) || header.cellSize <= 0.0f ||
+        !std::isfinite(header.cellHeight) || header.cellHeight <= 0.0f)
+    {
+        std::cout << "LoadNavMesh: invalid tile grid." << std::endl;
+        return false;
+    }
+    if (header.tileCount != (uint64_t)header.tilesX * header.tilesZ || header.tileTableOffset > fileSize ||
+        (fileSize - header.tileTableOffset) / sizeof(NavMeshFileTileEntry) < header.tileCount)
+    {
+        std::cout << "LoadNavMesh: tile table is truncated." << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool IsValidNavMeshFileTileEntry(const NavMeshFileTileEntry& entry, uint64_t fileSize)
+{
+    return entry.offset % NAVMESH_FILE_ALIGNMENT == 0 && entry.offset <= fileSize && fileSize - entry.offset >= entry.size &&
+           entry.size >= sizeof(NavMeshFileTile);
+}
+
+bool ReadNavMeshFileTile(unsigned char* tileData, uint64_t tileSize, bool copy, NavMeshTile& tile)
+{
+    NavMeshFileTile tileHeader;
+    memcpy(&tileHeader, tileData, sizeof(tileHeader));
+    tile.tileX = tileHeader.tileX;
+    tile.tileZ = tileHeader.tileZ;
+    tile.salt = tileHeader.salt;
+    memcpy(&tile.bmin, tileHeader.bmin, sizeof(tileHeader.bmin));
+    memcpy(&tile.bmax, tileHeader.bmax, sizeof(tileHeader.bmax));
+    if (tileHeader.magic != NAVMESH_FILE_TILE_MAGIC || !ViewArray(tileData, tileSize, tileHeader.polyOffset, tileHeader.polyCount, tile.polys) ||
+        !ViewArray(tileData, tileSize, tileHeader.linkOffset, tileHeader.linkCount, tile.links) ||
+        !ViewArray(tileData, tileSize, tileHeader.bvNodeOffset, tileHeader.bvNodeCount, tile.bvTree))
+        return false;
+    if (copy)
+    {
+        // Resizing a view moves it into owned storage.
+        tile.polys.resize(tile.polys.size());
+        tile.links.resize(tile.links.size());
+        tile.bvTree.resize(tile.bvTree.size());
+    }
+    return true;
+}
+
+bool LoadNavMesh(const MappedFile& file, NavMesh& navMesh)
+{
+    unsigned char* data = file.GetData();
+    const uint64_t fileSize = file.GetSize();
+    NavMeshFileHeader header;
+    if (!data || fileSize < sizeof(header))
+        return false;
+    memcpy(&header, data, sizeof(header));
+    if (!ValidateNavMeshFileHeader(header, fileSize))
+        return false;
+
+    NavMesh loaded;
+    loaded.bmin = glm::vec3(header.bmin[0], header.bmin[1], header.bmin[2]);
+    loaded.cellSize = header.cellSize;
+    loaded.cellHeight = header.cellHeight;
+    loaded.tileSize = header.tileSize;
+    loaded.tilesX = header.tilesX;
+    loaded.tilesZ = header.tilesZ;
+    loaded.tiles.resize(header.tileCount);
+    const NavMeshFileTileEntry* entries = reinterpret_cast<const NavMeshFileTileEntry*>(data + header.tileTableOffset);
+    for (uint32_t i = 0; i < header.tileCount; ++i)
+    {
+        const NavMeshFileTileEntry& entry = entries[i];
+        if (!IsValidNavMeshFileTileEntry(entry, fileSize))
+        {
+            std::cout << "LoadNavMesh: tile " << i << " is out of bounds." << std::endl;
+            return false;
+        }
+        if (!ReadNavMeshFileTile(data + entry.offset, entry.size, false, loaded.tiles[i]))
+        {
+            std::cout << "LoadNavMesh: tile " << i << " is corrupt." << std::endl;
+            return false;
+        }
+    }
+    navMesh = std::move(loaded);
+    return true;
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <type_traits>
+#include "NavMesh.h"
+
+class MappedFile;
+
+// Binary navmesh file, little endian. The file header is followed by a table with the offset and size of
+// every tile, each tile is a tile header followed by its polys, links and BV nodes. Tiles and their arrays
+// start on 16 byte boundaries and the arrays use the in memory layout of NavPoly, NavPolyLink and NavBVNode,
+// and tiles only refer to each other through poly refs, so a mapped file is used in place.
+static const uint32_t NAVMESH_FILE_MAGIC = 'N' | ('A' << 8) | ('V' << 16) | ('M' << 24);
+static const uint32_t NAVMESH_FILE_TILE_MAGIC = 'N' | ('A' << 8) | ('V' << 16) | ('T' << 24);
+static const uint32_t NAVMESH_FILE_VERSION = 3;
+static const uint32_t NAVMESH_FILE_ENDIAN_TAG = 0x01020304;
+static const uint64_t NAVMESH_FILE_ALIGNMENT = 16;
+
+struct NavMeshFileHeader
+{
+    uint32_t magic, version, endianTag, headerSize;
+    float bmin[3];
+    float cellSize, cellHeight;
+    int32_t tileSize, tilesX, tilesZ;
+    uint32_t tileCount, reserved;
+    uint64_t tileTableOffset; // NavMeshFileTileEntry[tileCount]
+};
+struct NavMeshFileTileEntry
+{
+    uint64_t offset, size; // From the start of the file, size 0 for tiles that were not stored
+};
+struct NavMeshFileTile
+{
+    uint32_t magic;
+    int32_t tileX, tileZ;
+    uint32_t salt;
+    float bmin[3], bmax[3];
+    uint32_t polyCount, linkCount, bvNodeCount, reserved;
+    uint64_t polyOffset, linkOffset, bvNodeOffset; // From the start of the tile
+};
+
+static_assert(sizeof(NavMeshFileHeader) == 64, "NavMeshFileHeader layout changed, bump NAVMESH_FILE_VERSION");
+static_assert(sizeof(NavMeshFileTileEntry) == 16, "NavMeshFileTileEntry layout changed, bump NAVMESH_FILE_VERSION");
+static_assert(sizeof(NavMeshFileTile) == 80, "NavMeshFileTile layout changed, bump NAVMESH_FILE_VERSION");
+static_assert(sizeof(NavPoly) == 64 && alignof(NavPoly) <= NAVMESH_FILE_ALIGNMENT, "NavPoly layout changed, bump NAVMESH_FILE_VERSION");
+static_assert(sizeof(NavPolyLink) == 32 && alignof(NavPolyLink) <= NAVMESH_FILE_ALIGNMENT,
+              "NavPolyLink layout changed, bump NAVMESH_FILE_VERSION");
+static_assert(sizeof(NavBVNode) == 16 && alignof(NavBVNode) <= NAVMESH_FILE_ALIGNMENT, "NavBVNode layout changed, bump NAVMESH_FILE_VERSION");
+static_assert(std::is_trivially_copyable<NavPoly>::value && std::is_trivially_copyable<NavPolyLink>::value &&
+                  std::is_trivially_copyable<NavBVNode>::value,
+              "Tile arrays must be trivially copyable to be used in place");
+
+bool SaveNavMesh(const NavMesh& navMesh, const char* path);
+// Checks a header read from a file of fileSize bytes, printing why the file is rejected.
+bool ValidateNavMeshFileHeader(const NavMeshFileHeader& header, uint64_t fileSize);
+bool IsValidNavMeshFileTileEntry(const NavMeshFileTileEntry& entry, uint64_t fileSize);
+// Reads a stored tile of tileSize bytes. The arrays view tileData, or are copied into owned storage when copy is set.
+bool ReadNavMeshFileTile(unsigned char* tileData, uint64_t tileSize, bool copy, NavMeshTile& tile);
+// Tiles of the loaded mesh view their arrays inside the file, which must stay open while the mesh is used.
+bool LoadNavMesh(const MappedFile& file, NavMesh& navMesh);
@@ -0,0 +1,143 @@
+#include "NavMeshIslands.h"
+#include <algorithm>
+
+static const unsigned int NO_COMPONENT = 0xffffffff;
+
+NavMeshIslands::NavMeshIslands() : m_IslandCount(0)
+{
+}
+
+void NavMeshIslands::Build(const NavMesh& navMesh)
+{
+    m_Tiles.assign(navMesh.tiles.size(), TileComponents());
+    for (int i = 0; i < (int)navMesh.tiles.size(); ++i)
+        LabelTile(navMesh, i);
+    ResolveIslands(navMesh);
+}
+
+void NavMeshIslands::RebuildTile(const NavMesh& navMesh, int tileIndex)
+{
+    if (m_Tiles.size() != navMesh.tiles.size())
+    {
+        Build(navMesh);
+        return;
+    }
+    if (tileIndex < 0 || tileIndex >= (int)m_Tiles.size())
+        return;
+    LabelTile(navMesh, tileIndex);
+    ResolveIslands(navMesh);
+}
+
+unsigned int NavMeshIslands::GetIsland(NavPolyRef ref) const
+{
+    const unsigned int tileIndex = DecodePolyRefTile(ref);
+    if (!ref || tileIndex >= m_Tiles.size())
+        return 0;
+    const TileComponents& tile = m_Tiles[tileIndex];
+    const unsigned int polyIndex = DecodePolyRefPoly(ref);
+    if (tile.salt != DecodePolyRefSalt(ref) || polyIndex >= tile.polyComponent.size())
+        return 0;
+    return m_ComponentIsland[tile.firstComponent + tile.polyComponent[polyIndex]];
+}
+
+void NavMeshIslands::LabelTile(const NavMesh& navMesh, int tileIndex)
+{
+    const NavMeshTile& tile = navMesh.tiles[tileIndex];
+    TileComponents& components = m_Tiles[tileIndex];
+    components.salt = tile.salt;
+    components.polyComponent.assign(tile.polys.size(), NO_COMPONENT);
+    components.componentCount = 0;
+    components.crossLinks.clear();
+
+    for (unsigned int seed = 0; seed < tile.polys.size(); ++seed)
+    {
+        if (components.polyComponent[seed] != NO_COMPONENT)
+            continue;
+
+        const unsigned int component = components.componentCount++;
+        components.polyComponent[seed] = component;
+        m_Stack.clear();
+        m_Stack.push_back(seed);
+        while (!m_Stack.empty())
+        {
+            const NavPoly& poly = tile.polys[m_Stack.back()];
+            m_Stack.pop_back();
+            for (unsigned int i = poly.firstLink; i < poly.firstLink + poly.linkCount; ++i)
+            {
+                const NavPolyRef neighbor = tile.links[i].neighbor;
+                if (!neighbor)
+                    continue;
+                if (DecodePolyRefTile(neighbor) != (unsigned int)tileIndex)
+                {
+                    components.crossLinks.push_back({component, neighbor});
+                    continue;
+                }
+                const unsigned int neighborPoly = DecodePolyRefPoly(neighbor);
+                if (!navMesh.IsValidPolyRef(neighbor))
+                    continue;
+                if (components.polyComponent[neighborPoly] == NO_COMPONENT)
+                {
+                    components.polyComponent[neighborPoly] = component;
+                    m_Stack.push_back(neighborPoly);
+                }
+                else if (components.polyComponent[neighborPoly] != component)
+                {
+                    // One way off-mesh links can lead into a component flooded before, merged like a tile crossing.
+                    components.crossLinks.push_back({component, neighbor});
+                }
+            }
+        }
+    }
+}
+
+unsigned int NavMeshIslands::FindRoot(unsigned int component)
+{
+    while (m_Parent[component] != component)
+    {
+        m_Parent[component] = m_Parent[m_Parent[component]];
+        component = m_Parent[component];
+    }
+    return component;
+}
+
+void NavMeshIslands::ResolveIslands(const NavMesh& navMesh)
+{
+    unsigned int componentCount = 0;
+    for (auto& tile : m_Tiles)
+    {
+        tile.firstComponent = componentCount;
+        componentCount += tile.componentCount;
+    }
+
+    m_Parent.resize(componentCount);
+    for (unsigned int i = 0; i < componentCount; ++i)
+        m_Parent[i] = i;
+
+    for (const auto& tile : m_Tiles)
+    {
+        for (const CrossLink& link : tile.crossLinks)
+        {
+            if (!navMesh.IsValidPolyRef(link.neighbor))
+                continue;
+            const TileComponents& neighborTile = m_Tiles[DecodePolyRefTile(link.neighbor)];
+            if (neighborTile.salt != DecodePolyRefSalt(link.neighbor))
+                continue;
+
+            const unsigned int a = FindRoot(tile.firstComponent + link.component);
+            const unsigned int b = FindRoot(neighborTile.firstComponent + neighborTile.polyComponent[DecodePolyRefPoly(link.neighbor)]);
+            if (a != b)
+                m_Parent[std::max(a, b)] = std::min(a, b);
+        }
+    }
+
+    m_ComponentIsland.assign(componentCount, 0);
+    m_IslandCount = 0;
+    for (unsigned int i = 0; i < componentCount; ++i)
+    {
+        const unsigned int root = FindRoot(i);
+        if (root == i)
+            m_ComponentIsland[i] = ++m_IslandCount;
+        else
+            m_ComponentIsland[i] = m_ComponentIsland[root];
+    }
+}
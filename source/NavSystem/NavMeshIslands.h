@@ -0,0 +1,48 @@
+#pragma once
+#include <vector>
+#include "NavMesh.h"
+
+// Connected island labels over the poly graph, so reachability between two polys is a lookup.
+// Polys are first flood filled into components per tile, then the components are joined across
+// tile borders with a union-find. Rebuilding a tile only relabels that tile and reruns the cheap
+// component join. Links are treated as two-way.
+class NavMeshIslands
+{
+public:
+    NavMeshIslands();
+
+    void Build(const NavMesh& navMesh);
+    void RebuildTile(const NavMesh& navMesh, int tileIndex);
+
+    unsigned int GetIsland(NavPolyRef ref) const; // 0 for stale or invalid refs
+    bool AreConnected(NavPolyRef a, NavPolyRef b) const
+    {
+        const unsigned int island = GetIsland(a);
+        return island != 0 && island == GetIsland(b);
+    }
+    int GetIslandCount() const { return m_IslandCount; }
+private:
+    struct CrossLink
+    {
+        unsigned int component;
+        NavPolyRef neighbor;
+    };
+    struct TileComponents
+    {
+        unsigned int salt;
+        unsigned int firstComponent;      // Global index of the tile's first component
+        std::vector<unsigned int> polyComponent;
+        unsigned int componentCount;
+        std::vector<CrossLink> crossLinks; // Links leaving the tile, and one way links between its components
+    };
+
+    std::vector<TileComponents> m_Tiles;
+    std::vector<unsigned int> m_ComponentIsland;
+    std::vector<unsigned int> m_Parent; // Union-find over components
+    std::vector<unsigned int> m_Stack;
+    int m_IslandCount;
+
+    void LabelTile(const NavMesh& navMesh, int tileIndex);
+    void ResolveIslands(const NavMesh& navMesh);
+    unsigned int FindRoot(unsigned int component);
+};
@@ -0,0 +1,177 @@
+#include "NavMeshLandmarks.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+static const unsigned int NO_POLY = 0xffffffff;
+
+NavMeshLandmarks::NavMeshLandmarks() : m_Step(0.0f)
+{
+}
+
+void NavMeshLandmarks::Clear()
+{
+    m_Tiles.clear();
+    m_LandmarkRefs.clear();
+    m_Distances.clear();
+    m_Step = 0.0f;
+}
+
+void NavMeshLandmarks::Build(const NavMesh& navMesh, int landmarkCount)
+{
+    Clear();
+    landmarkCount = std::min(landmarkCount, NAV_MAX_LANDMARKS);
+
+    unsigned int polyCount = 0;
+    m_Tiles.resize(navMesh.tiles.size());
+    for (size_t i = 0; i < navMesh.tiles.size(); ++i)
+    {
+        m_Tiles[i].salt = navMesh.tiles[i].salt;
+        m_Tiles[i].firstPoly = polyCount;
+        m_Tiles[i].polyCount = (unsigned int)navMesh.tiles[i].polys.size();
+        polyCount += m_Tiles[i].polyCount;
+    }
+    if (polyCount == 0 || landmarkCount <= 0)
+    {
+        Clear();
+        return;
+    }
+
+    // Flatten the links so the portal graph can be walked with plain indices.
+    PortalGraph graph;
+    std::vector<NavPolyRef> refs(polyCount);
+    graph.polyFirstLink.resize(polyCount);
+    graph.polyLinkCount.resize(polyCount);
+    for (size_t i = 0; i < navMesh.tiles.size(); ++i)
+    {
+        const NavMeshTile& tile = navMesh.tiles[i];
+        const NavPolyRef base = navMesh.GetPolyRefBase(tile);
+        const unsigned int firstLink = (unsigned int)graph.linkMid.size();
+        for (const NavPolyLink& link : tile.links)
+        {
+            graph.linkMid.push_back((link.left + link.right) * 0.5f);
+            graph.linkTarget.push_back(GetPolyIndex(link.neighbor));
+        }
+        for (unsigned int p = 0; p < tile.polys.size(); ++p)
+        {
+            refs[m_Tiles[i].firstPoly + p] = base | p;
+            graph.polyFirstLink[m_Tiles[i].firstPoly + p] = firstLink + tile.polys[p].firstLink;
+            graph.polyLinkCount[m_Tiles[i].firstPoly + p] = tile.polys[p].linkCount;
+        }
+    }
+
+    // Farthest point sampling: the first landmark is the poly farthest from an arbitrary poly, every
+    // next one the poly farthest from all landmarks so far. Unreachable polys count as infinitely far
+    // so every island gets a landmark before any island gets a second one.
+    std::vector<float> distances(polyCount), linkDistances(graph.linkMid.size());
+    std::vector<float> minDistances(polyCount, FLT_MAX);
+    std::vector<std::vector<float>> landmarkDistances;
+    std::vector<OpenEntry> open;
+    ComputeDistances(graph, 0, distances, linkDistances, open);
+    unsigned int next = 0;
+    for (unsigned int i = 0; i < polyCount; ++i)
+        if (distances[i] != FLT_MAX && distances[i] > distances[next])
+            next = i;
+
+    float maxDistance = 0.0f;
+    while ((int)m_LandmarkRefs.size() < landmarkCount)
+    {
+        ComputeDistances(graph, next, distances, linkDistances, open);
+        m_LandmarkRefs.push_back(refs[next]);
+        landmarkDistances.push_back(distances);
+
+        for (unsigned int i = 0; i < polyCount; ++i)
+        {
+            if (distances[i] != FLT_MAX)
+                maxDistance = std::max(maxDistance, distances[i]);
+            minDistances[i] = std::min(minDistances[i], distances[i]);
+        }
+        next = NO_POLY;
+        for (unsigned int i = 0; i < polyCount; ++i)
+            if (minDistances[i] > 0.0f && (next == NO_POLY || minDistances[i] > minDistances[next]))
+                next = i;
+        if (next == NO_POLY)
+            break;
+    }
+
+    // Values are rounded down so a decoded distance is at most one step below the real one.
+    const int count = (int)m_LandmarkRefs.size();
+    m_Step = std::max(maxDistance / (NAV_LANDMARK_UNREACHABLE - 1), 1e-6f);
+    m_Distances.resize((size_t)polyCount * count);
+    for (unsigned int i = 0; i < polyCount; ++i)
+    {
+        for (int l = 0; l < count; ++l)
+        {
+            const float distance = landmarkDistances[l][i];
+            m_Distances[(size_t)i * count + l] = distance == FLT_MAX
+                ? NAV_LANDMARK_UNREACHABLE
+                : (unsigned short)std::min(floorf(distance / m_Step), (float)(NAV_LANDMARK_UNREACHABLE - 1));
+        }
+    }
+}
+
+unsigned int NavMeshLandmarks::GetPolyIndex(NavPolyRef ref) const
+{
+    const unsigned int tileIndex = DecodePolyRefTile(ref);
+    if (!ref || tileIndex >= m_Tiles.size())
+        return NO_POLY;
+    const TileRange& tile = m_Tiles[tileIndex];
+    const unsigned int polyIndex = DecodePolyRefPoly(ref);
+    if (tile.salt != DecodePolyRefSalt(ref) || polyIndex >= tile.polyCount)
+        return NO_POLY;
+    return tile.firstPoly + polyIndex;
+}
+
+const unsigned short* NavMeshLandmarks::GetPolyDistances(NavPolyRef ref) const
+{
+    const unsigned int index = GetPolyIndex(ref);
+    if (index == NO_POLY || m_LandmarkRefs.empty())
+        return nullptr;
+    return &m_Distances[(size_t)index * m_LandmarkRefs.size()];
+}
+
+// Dijkstra over the portal graph: a state is a link, reached at the midpoint of its edge, and moves
+// on to the links of the poly it leads into. The distance of a poly is the distance of its closest
+// portal, any other point of the poly is at most the poly diagonal further away.
+void NavMeshLandmarks::ComputeDistances(const PortalGraph& graph, unsigned int source, std::vector<float>& polyDistances,
+                                        std::vector<float>& linkDistances, std::vector<OpenEntry>& open) const
+{
+    std::fill(polyDistances.begin(), polyDistances.end(), FLT_MAX);
+    std::fill(linkDistances.begin(), linkDistances.end(), FLT_MAX);
+    open.clear();
+
+    polyDistances[source] = 0.0f;
+    for (unsigned int i = graph.polyFirstLink[source]; i < graph.polyFirstLink[source] + graph.polyLinkCount[source]; ++i)
+    {
+        if (graph.linkTarget[i] == NO_POLY)
+            continue;
+        linkDistances[i] = 0.0f;
+        open.push_back({0.0f, i});
+    }
+    std::make_heap(open.begin(), open.end(), OpenEntryGreater);
+
+    while (!open.empty())
+    {
+        std::pop_heap(open.begin(), open.end(), OpenEntryGreater);
+        const OpenEntry entry = open.back();
+        open.pop_back();
+        if (entry.cost > linkDistances[entry.link])
+            continue;
+
+        const unsigned int poly = graph.linkTarget[entry.link];
+        polyDistances[poly] = std::min(polyDistances[poly], entry.cost);
+        const glm::vec3& from = graph.linkMid[entry.link];
+        for (unsigned int i = graph.polyFirstLink[poly]; i < graph.polyFirstLink[poly] + graph.polyLinkCount[poly]; ++i)
+        {
+            if (graph.linkTarget[i] == NO_POLY)
+                continue;
+            const float cost = entry.cost + glm::distance(from, graph.linkMid[i]);
+            if (cost < linkDistances[i])
+            {
+                linkDistances[i] = cost;
+                open.push_back({cost, i});
+                std::push_heap(open.begin(), open.end(), OpenEntryGreater);
+            }
+        }
+    }
+}
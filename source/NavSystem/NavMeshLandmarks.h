@@ -0,0 +1,57 @@
+#pragma once
+#include <vector>
+#include "NavMesh.h"
+
+static const int NAV_MAX_LANDMARKS = 32;
+static const unsigned short NAV_LANDMARK_UNREACHABLE = 0xffff;
+
+// Landmark distances for the ALT heuristic. Landmarks are picked by farthest point sampling and
+// the portal graph distance from every landmark to the closest portal of every poly is stored as a
+// 16-bit value, all landmarks of a poly side by side. A* then uses |d(L, n) - d(L, goal)| as a lower bound.
+// The bound takes links to be two-way, past one way off-mesh connections it can overestimate and cost some optimality.
+// Distances are not patched when tiles are rebuilt: polys of rebuilt tiles report no distances
+// and the query falls back to the Euclidean bound, Build again after larger edits.
+class NavMeshLandmarks
+{
+public:
+    NavMeshLandmarks();
+
+    void Build(const NavMesh& navMesh, int landmarkCount);
+    void Clear();
+
+    // Quantized distances of the poly to each landmark, nullptr for stale refs or when not built.
+    const unsigned short* GetPolyDistances(NavPolyRef ref) const;
+    float GetQuantizationStep() const { return m_Step; }
+    int GetLandmarkCount() const { return (int)m_LandmarkRefs.size(); }
+    NavPolyRef GetLandmark(int i) const { return m_LandmarkRefs[i]; }
+    size_t GetMemoryBytes() const { return m_Distances.size() * sizeof(unsigned short) + m_Tiles.size() * sizeof(TileRange); }
+private:
+    struct TileRange
+    {
+        unsigned int salt;
+        unsigned int firstPoly;
+        unsigned int polyCount;
+    };
+    struct OpenEntry
+    {
+        float cost;
+        unsigned int link;
+    };
+    struct PortalGraph
+    {
+        std::vector<glm::vec3> linkMid;
+        std::vector<unsigned int> linkTarget; // Global poly index, 0xffffffff when the neighbor is invalid
+        std::vector<unsigned int> polyFirstLink, polyLinkCount;
+    };
+
+    std::vector<TileRange> m_Tiles;
+    std::vector<NavPolyRef> m_LandmarkRefs;
+    std::vector<unsigned short> m_Distances; // polyCount x landmarkCount
+    float m_Step;                            // World units per quantization step
+
+    void ComputeDistances(const PortalGraph& graph, unsigned int source, std::vector<float>& polyDistances,
+                          std::vector<float>& linkDistances, std::vector<OpenEntry>& open) const;
+    unsigned int GetPolyIndex(NavPolyRef ref) const;
+
+    static bool OpenEntryGreater(const OpenEntry& a, const OpenEntry& b) { return a.cost > b.cost; }
+};
@@ -0,0 +1,933 @@
+#include "NavMeshQuery.h"
+#include "NavMeshIslands.h"
+#include "NavMeshLandmarks.h"
+#include <algorithm>
+#include <cfloat>
+#include <climits>
+#include <cmath>
+#include <cstring>
+
+static const float H_SCALE = 0.999f; // Keeps the heuristic admissible against float error
+static const float MIN_AREA_COST = 0.01f;
+
+// Positive when c is on the left of a->b, looking down the y axis.
+static float TriArea2D(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c)
+{
+    const float abx = b.x - a.x;
+    const float abz = b.z - a.z;
+    const float acx = c.x - a.x;
+    const float acz = c.z - a.z;
+    return acx * abz - abx * acz;
+}
+
+static bool PointsEqual(const glm::vec3& a, const glm::vec3& b)
+{
+    const glm::vec3 d = b - a;
+    return glm::dot(d, d) < 1e-6f;
+}
+
+static float DistancePtSegSqr2D(const glm::vec3& pt, const glm::vec3& p, const glm::vec3& q)
+{
+    const float dx = q.x - p.x;
+    const float dz = q.z - p.z;
+    const float lengthSqr = dx * dx + dz * dz;
+    float t = lengthSqr > 0.0f ? ((pt.x - p.x) * dx + (pt.z - p.z) * dz) / lengthSqr : 0.0f;
+    t = glm::clamp(t, 0.0f, 1.0f);
+    const float ex = p.x + t * dx - pt.x;
+    const float ez = p.z + t * dz - pt.z;
+    return ex * ex + ez * ez;
+}
+
+// Parameter where a ray leaves the rectangle of the poly, with the axis of the side it leaves through.
+static float GetRectExit(const NavPoly* poly, const glm::vec3& origin, const glm::vec2& dir, int& exitAxis)
+{
+    float tx = FLT_MAX, tz = FLT_MAX;
+    if (dir.x > 1e-6f)
+        tx = (poly->bmax.x - origin.x) / dir.x;
+    else if (dir.x < -1e-6f)
+        tx = (poly->bmin.x - origin.x) / dir.x;
+    if (dir.y > 1e-6f)
+        tz = (poly->bmax.z - origin.z) / dir.y;
+    else if (dir.y < -1e-6f)
+        tz = (poly->bmin.z - origin.z) / dir.y;
+    exitAxis = tx <= tz ? 0 : 2;
+    return std::min(tx, tz);
+}
+
+// --- Node Pool ---
+
+NavNodePool::NavNodePool(int maxNodes, int hashSize) : m_MaxNodes(maxNodes), m_HashSize(hashSize), m_NodeCount(0)
+{
+    m_Nodes = new NavNode[m_MaxNodes];
+    m_Next = new unsigned int[m_MaxNodes];
+    m_First = new unsigned int[m_HashSize];
+    Clear();
+}
+
+NavNodePool::~NavNodePool()
+{
+    delete[] m_Nodes;
+    delete[] m_Next;
+    delete[] m_First;
+}
+
+void NavNodePool::Clear()
+{
+    memset(m_First, 0xff, sizeof(unsigned int) * m_HashSize);
+    m_NodeCount = 0;
+}
+
+unsigned int NavNodePool::HashRef(NavPolyRef ref) const
+{
+    ref ^= ref >> 33;
+    ref *= 0xff51afd7ed558ccdull;
+    ref ^= ref >> 33;
+    return (unsigned int)(ref & (NavPolyRef)(m_HashSize - 1));
+}
+
+NavNode* NavNodePool::FindNode(NavPolyRef ref) const
+{
+    for (unsigned int i = m_First[HashRef(ref)]; i != NAV_NULL_NODE; i = m_Next[i])
+    {
+        if (m_Nodes[i].ref == ref)
+            return &m_Nodes[i];
+    }
+    return nullptr;
+}
+
+NavNode* NavNodePool::GetNode(NavPolyRef ref)
+{
+    const unsigned int bucket = HashRef(ref);
+    for (unsigned int i = m_First[bucket]; i != NAV_NULL_NODE; i = m_Next[i])
+    {
+        if (m_Nodes[i].ref == ref)
+            return &m_Nodes[i];
+    }
+    if (m_NodeCount >= m_MaxNodes)
+        return nullptr;
+
+    const unsigned int index = (unsigned int)m_NodeCount++;
+    NavNode* node = &m_Nodes[index];
+    node->pos = glm::vec3(0.0f);
+    node->cost = 0.0f;
+    node->total = 0.0f;
+    node->parentIndex = NAV_NULL_NODE;
+    node->flags = 0;
+    node->ref = ref;
+
+    m_Next[index] = m_First[bucket];
+    m_First[bucket] = index;
+    return node;
+}
+
+// --- Node Queue ---
+
+NavNodeQueue::NavNodeQueue(int capacity) : m_Capacity(capacity), m_Size(0)
+{
+    m_Heap = new NavNode*[m_Capacity + 1];
+}
+
+NavNodeQueue::~NavNodeQueue()
+{
+    delete[] m_Heap;
+}
+
+NavNode* NavNodeQueue::Pop()
+{
+    NavNode* result = m_Heap[0];
+    m_Size--;
+    TrickleDown(0, m_Heap[m_Size]);
+    return result;
+}
+
+void NavNodeQueue::Push(NavNode* node)
+{
+    if (m_Size >= m_Capacity)
+        return;
+    m_Size++;
+    BubbleUp(m_Size - 1, node);
+}
+
+void NavNodeQueue::Modify(NavNode* node)
+{
+    for (int i = 0; i < m_Size; ++i)
+    {
+        if (m_Heap[i] == node)
+        {
+            BubbleUp(i, node);
+            return;
+        }
+    }
+}
+
+void NavNodeQueue::BubbleUp(int i, NavNode* node)
+{
+    int parent = (i - 1) / 2;
+    while (i > 0 && m_Heap[parent]->total > node->total)
+    {
+        m_Heap[i] = m_Heap[parent];
+        i = parent;
+        parent = (i - 1) / 2;
+    }
+    m_Heap[i] = node;
+}
+
+void NavNodeQueue::TrickleDown(int i, NavNode* node)
+{
+    int child = i * 2 + 1;
+    while (child < m_Size)
+    {
+        if (child + 1 < m_Size && m_Heap[child]->total > m_Heap[child + 1]->total)
+            child++;
+        m_Heap[i] = m_Heap[child];
+        i = child;
+        child = i * 2 + 1;
+    }
+    BubbleUp(i, node);
+}
+
+// --- Filter ---
+
+NavQueryFilter::NavQueryFilter() : m_MinAreaCost(1.0f), m_IncludeFlags(NAVPOLYFLAG_ALL), m_ExcludeFlags(0)
+{
+    for (int i = 0; i < NAV_MAX_AREAS; ++i)
+        m_AreaCost[i] = 1.0f;
+}
+
+void NavQueryFilter::SetAreaCost(int area, float cost)
+{
+    if (area < 0 || area >= NAV_MAX_AREAS)
+        return;
+    m_AreaCost[area] = std::max(cost, MIN_AREA_COST);
+    m_MinAreaCost = m_AreaCost[0];
+    for (int i = 1; i < NAV_MAX_AREAS; ++i)
+        m_MinAreaCost = std::min(m_MinAreaCost, m_AreaCost[i]);
+}
+
+// --- Query ---
+
+NavMeshQuery::NavMeshQuery()
+    : m_NavMesh(nullptr), m_Islands(nullptr), m_Landmarks(nullptr), m_CorridorTileStamps(nullptr), m_CorridorStamp(0),
+      m_NodePool(nullptr), m_OpenList(nullptr), m_Sliced()
+{
+}
+
+NavMeshQuery::~NavMeshQuery()
+{
+    delete m_NodePool;
+    delete m_OpenList;
+}
+
+bool NavMeshQuery::Init(const NavMesh* navMesh, int maxNodes)
+{
+    if (!navMesh || maxNodes <= 0)
+        return false;
+    m_NavMesh = navMesh;
+
+    if (!m_NodePool || m_NodePool->GetMaxNodes() < maxNodes)
+    {
+        int hashSize = 1;
+        while (hashSize < maxNodes / 4)
+            hashSize <<= 1;
+
+        delete m_NodePool;
+        delete m_OpenList;
+        m_NodePool = new NavNodePool(maxNodes, hashSize);
+        m_OpenList = new NavNodeQueue(maxNodes);
+    }
+    return true;
+}
+
+bool NavMeshQuery::ClosestPointOnPoly(NavPolyRef ref, const glm::vec3& pos, glm::vec3& closest) const
+{
+    if (!m_NavMesh || !m_NavMesh->IsValidPolyRef(ref))
+        return false;
+    const NavMeshTile* tile;
+    const NavPoly* poly;
+    m_NavMesh->GetTileAndPoly(ref, tile, poly);
+
+    closest.x = glm::clamp(pos.x, poly->bmin.x, poly->bmax.x);
+    closest.y = poly->bmin.y;
+    closest.z = glm::clamp(pos.z, poly->bmin.z, poly->bmax.z);
+    return true;
+}
+
+bool NavMeshQuery::GetPortalPoints(NavPolyRef from, NavPolyRef to, glm::vec3& left, glm::vec3& right) const
+{
+    if (!m_NavMesh || !m_NavMesh->IsValidPolyRef(from))
+        return false;
+    const NavMeshTile* tile;
+    const NavPoly* poly;
+    m_NavMesh->GetTileAndPoly(from, tile, poly);
+
+    for (unsigned int i = poly->firstLink; i < poly->firstLink + poly->linkCount; ++i)
+    {
+        const NavPolyLink& link = tile->links[i];
+        if (link.neighbor == to)
+        {
+            left = link.left;
+            right = link.right;
+            return true;
+        }
+    }
+    return false;
+}
+
+NavQueryStatus NavMeshQuery::Raycast(NavPolyRef startRef, const glm::vec3& startPos, const glm::vec3& endPos, const NavQueryFilter& filter,
+                                     float& t, glm::vec3& hitNormal, NavPolyRef* path, int& pathCount, int maxPath) const
+{
+    t = 0.0f;
+    hitNormal = glm::vec3(0.0f);
+    pathCount = 0;
+    if (!m_NavMesh || !m_NavMesh->IsValidPolyRef(startRef))
+        return NAVQUERY_FAILURE;
+
+    const float portalEpsilon = m_NavMesh->cellSize * 0.01f;
+    const glm::vec2 dir(endPos.x - startPos.x, endPos.z - startPos.z);
+    NavQueryStatus status = NAVQUERY_SUCCESS;
+    NavPolyRef curRef = startRef;
+    const NavMeshTile* tile;
+    const NavPoly* poly;
+    m_NavMesh->GetTileAndPoly(curRef, tile, poly);
+    int exitAxis;
+    float exitT = GetRectExit(poly, startPos, dir, exitAxis);
+    while (true)
+    {
+        if (path)
+        {
+            if (pathCount < maxPath)
+                path[pathCount++] = curRef;
+            else
+                status = NAVQUERY_PARTIAL_RESULT;
+        }
+        if (exitT >= 1.0f)
+        {
+            t = FLT_MAX;
+            return status;
+        }
+
+        // Continue through a portal containing the exit point. At a corner several can, take one the ray
+        // actually moves on through so the walk always advances.
+        const glm::vec3 exitPos(startPos.x + dir.x * exitT, startPos.y, startPos.z + dir.y * exitT);
+        NavPolyRef nextRef = 0;
+        const NavPoly* nextPoly = nullptr;
+        float nextExitT = 0.0f;
+        int nextExitAxis = 0;
+        for (unsigned int i = poly->firstLink; i < poly->firstLink + poly->linkCount && !nextRef; ++i)
+        {
+            const NavPolyLink& link = tile->links[i];
+            if (!m_NavMesh->IsValidPolyRef(link.neighbor))
+                continue;
+            if (exitPos.x < std::min(link.left.x, link.right.x) - portalEpsilon || exitPos.x > std::max(link.left.x, link.right.x) + portalEpsilon ||
+                exitPos.z < std::min(link.left.z, link.right.z) - portalEpsilon || exitPos.z > std::max(link.left.z, link.right.z) + portalEpsilon)
+                continue;
+            const NavMeshTile* neighborTile;
+            const NavPoly* neighborPoly;
+            m_NavMesh->GetTileAndPoly(link.neighbor, neighborTile, neighborPoly);
+            // Off-mesh connections are not part of the surface the ray moves along.
+            if (neighborPoly->type != NAVPOLYTYPE_GROUND || !filter.PassFilter(link.neighbor, neighborTile, neighborPoly))
+                continue;
+            int axis;
+            const float neighborExitT = GetRectExit(neighborPoly, startPos, dir, axis);
+            if (neighborExitT <= exitT)
+                continue;
+            nextRef = link.neighbor;
+            nextPoly = neighborPoly;
+            tile = neighborTile;
+            nextExitT = neighborExitT;
+            nextExitAxis = axis;
+        }
+
+        if (!nextRef)
+        {
+            t = exitT;
+            if (exitAxis == 0)
+                hitNormal = glm::vec3(dir.x > 0.0f ? -1.0f : 1.0f, 0.0f, 0.0f);
+            else
+                hitNormal = glm::vec3(0.0f, 0.0f, dir.y > 0.0f ? -1.0f : 1.0f);
+            return status;
+        }
+        curRef = nextRef;
+        poly = nextPoly;
+        exitT = nextExitT;
+        exitAxis = nextExitAxis;
+    }
+}
+
+NavQueryStatus NavMeshQuery::MoveAlongSurface(NavPolyRef startRef, const glm::vec3& startPos, const glm::vec3& endPos,
+                                              const NavQueryFilter& filter, glm::vec3& resultPos, NavPolyRef* visited, int& visitedCount,
+                                              int maxVisited) const
+{
+    static const int MAX_MOVE_POLYS = 48;
+    visitedCount = 0;
+    if (!m_NavMesh || !m_NavMesh->IsValidPolyRef(startRef) || !visited || maxVisited <= 0)
+        return NAVQUERY_FAILURE;
+
+    // Breadth first over the polys whose portals touch the circle around the move, the constrained position
+    // is the closest point to endPos on any of them.
+    NavPolyRef refs[MAX_MOVE_POLYS];
+    int parents[MAX_MOVE_POLYS];
+    int refCount = 1;
+    refs[0] = startRef;
+    parents[0] = -1;
+    const glm::vec3 searchPos = (startPos + endPos) * 0.5f;
+    const float searchRadius = glm::length(glm::vec2(endPos.x - startPos.x, endPos.z - startPos.z)) * 0.5f + 0.001f;
+    const float searchRadiusSqr = searchRadius * searchRadius;
+
+    int bestIndex = 0;
+    float bestDistSqr = FLT_MAX;
+    glm::vec3 bestPos = startPos;
+    for (int i = 0; i < refCount; ++i)
+    {
+        const NavMeshTile* tile;
+        const NavPoly* poly;
+        m_NavMesh->GetTileAndPoly(refs[i], tile, poly);
+        const glm::vec3 closest(glm::clamp(endPos.x, poly->bmin.x, poly->bmax.x), poly->bmin.y, glm::clamp(endPos.z, poly->bmin.z, poly->bmax.z));
+        const float distSqr = (closest.x - endPos.x) * (closest.x - endPos.x) + (closest.z - endPos.z) * (closest.z - endPos.z);
+        if (distSqr < bestDistSqr)
+        {
+            bestDistSqr = distSqr;
+            bestIndex = i;
+            bestPos = closest;
+            if (distSqr == 0.0f)
+                break;
+        }
+
+        for (unsigned int l = poly->firstLink; l < poly->firstLink + poly->linkCount && refCount < MAX_MOVE_POLYS; ++l)
+        {
+            const NavPolyLink& link = tile->links[l];
+            if (!m_NavMesh->IsValidPolyRef(link.neighbor) || DistancePtSegSqr2D(searchPos, link.left, link.right) > searchRadiusSqr)
+                continue;
+            bool seen = false;
+            for (int j = 0; j < refCount && !seen; ++j)
+                seen = refs[j] == link.neighbor;
+            if (seen)
+                continue;
+            const NavMeshTile* neighborTile;
+            const NavPoly* neighborPoly;
+            m_NavMesh->GetTileAndPoly(link.neighbor, neighborTile, neighborPoly);
+            if (neighborPoly->type != NAVPOLYTYPE_GROUND || !filter.PassFilter(link.neighbor, neighborTile, neighborPoly))
+                continue;
+            refs[refCount] = link.neighbor;
+            parents[refCount] = i;
+            refCount++;
+        }
+    }
+
+    int length = 0;
+    for (int i = bestIndex; i != -1; i = parents[i])
+        length++;
+    int index = bestIndex;
+    for (int i = length; i > maxVisited; --i)
+        index = parents[index];
+    visitedCount = std::min(length, maxVisited);
+    for (int i = visitedCount - 1; i >= 0; --i)
+    {
+        visited[i] = refs[index];
+        index = parents[index];
+    }
+    resultPos = bestPos;
+    return length <= maxVisited ? NAVQUERY_SUCCESS : NAVQUERY_PARTIAL_RESULT;
+}
+
+bool NavMeshQuery::IsReachable(NavPolyRef startRef, NavPolyRef endRef) const
+{
+    return !m_Islands || m_Islands->AreConnected(startRef, endRef);
+}
+
+// Landmark distances are stored for the closest portal of a poly, a point inside it can be up to the
+// poly extent plus one quantization step further from the landmark.
+static int GetLandmarkSlack(const NavPoly* poly, float invStep)
+{
+    const glm::vec3 extent = poly->bmax - poly->bmin;
+    return (int)ceilf((extent.x + extent.y + extent.z) * invStep) + 1;
+}
+
+static int GetLandmarkBound(unsigned short node, int nodeSlack, unsigned short goal, int goalSlack)
+{
+    return std::max((int)goal - (int)node - nodeSlack, (int)node - (int)goal - goalSlack);
+}
+
+// Keeps the landmarks giving the best bound at the start, evaluating all of them per node costs more
+// than it saves. Landmarks that do not beat the Euclidean bound at the start are skipped, on open
+// levels that leaves none and the query runs at plain A* speed.
+void NavMeshQuery::SelectLandmarks(NavPolyRef startRef, const NavPoly* startPoly, NavPolyRef endRef, const NavPoly* endPoly)
+{
+    m_Sliced.activeLandmarkCount = 0;
+    const unsigned short* startLandmarks = m_Landmarks ? m_Landmarks->GetPolyDistances(startRef) : nullptr;
+    m_Sliced.goalLandmarks = m_Landmarks ? m_Landmarks->GetPolyDistances(endRef) : nullptr;
+    if (!startLandmarks || !m_Sliced.goalLandmarks)
+        return;
+
+    const float invStep = 1.0f / m_Landmarks->GetQuantizationStep();
+    const int startSlack = GetLandmarkSlack(startPoly, invStep);
+    m_Sliced.goalLandmarkSlack = GetLandmarkSlack(endPoly, invStep);
+    const int minBound = (int)(glm::distance(m_Sliced.startPos, m_Sliced.endPos) * invStep);
+    int bounds[NAV_MAX_LANDMARKS];
+    for (int i = 0; i < m_Landmarks->GetLandmarkCount(); ++i)
+    {
+        if (startLandmarks[i] == NAV_LANDMARK_UNREACHABLE || m_Sliced.goalLandmarks[i] == NAV_LANDMARK_UNREACHABLE)
+            continue;
+        const int bound = GetLandmarkBound(startLandmarks[i], startSlack, m_Sliced.goalLandmarks[i], m_Sliced.goalLandmarkSlack);
+        if (bound <= minBound)
+            continue;
+
+        int slot = std::min(m_Sliced.activeLandmarkCount, NAV_ACTIVE_LANDMARKS - 1);
+        if (m_Sliced.activeLandmarkCount == NAV_ACTIVE_LANDMARKS && bound <= bounds[slot])
+            continue;
+        for (; slot > 0 && bounds[slot - 1] < bound; --slot)
+        {
+            bounds[slot] = bounds[slot - 1];
+            m_Sliced.activeLandmarks[slot] = m_Sliced.activeLandmarks[slot - 1];
+        }
+        bounds[slot] = bound;
+        m_Sliced.activeLandmarks[slot] = i;
+        m_Sliced.activeLandmarkCount = std::min(m_Sliced.activeLandmarkCount + 1, NAV_ACTIVE_LANDMARKS);
+    }
+}
+
+float NavMeshQuery::GetHeuristic(const glm::vec3& pos, NavPolyRef ref, const NavPoly* poly) const
+{
+    float heuristic = glm::distance(pos, m_Sliced.endPos);
+    const unsigned short* nodeLandmarks = m_Sliced.activeLandmarkCount ? m_Landmarks->GetPolyDistances(ref) : nullptr;
+    if (nodeLandmarks)
+    {
+        const float step = m_Landmarks->GetQuantizationStep();
+        const int nodeSlack = GetLandmarkSlack(poly, 1.0f / step);
+        int bound = 0;
+        for (int i = 0; i < m_Sliced.activeLandmarkCount; ++i)
+        {
+            const int landmark = m_Sliced.activeLandmarks[i];
+            bound = std::max(bound, GetLandmarkBound(nodeLandmarks[landmark], nodeSlack, m_Sliced.goalLandmarks[landmark],
+                                                     m_Sliced.goalLandmarkSlack));
+        }
+        heuristic = std::max(heuristic, bound * step);
+    }
+    return heuristic * m_Sliced.heuristicScale;
+}
+
+// Walks the BV tree of every tile touching the box and calls fn(ref, tile, poly) for polys overlapping it.
+template <typename Fn>
+static void ForEachPolyInBox(const NavMesh& navMesh, const glm::vec3& qmin, const glm::vec3& qmax, Fn&& fn)
+{
+    if (navMesh.tiles.empty())
+        return;
+
+    const float invCellSize = 1.0f / navMesh.cellSize;
+    const float invCellHeight = 1.0f / navMesh.cellHeight;
+    auto quantize = [](float v, bool roundUp) -> unsigned short
+    {
+        const float q = roundUp ? ceilf(v) : floorf(v);
+        return (unsigned short)glm::clamp(q, 0.0f, 65535.0f);
+    };
+
+    int minTileX, minTileZ, maxTileX, maxTileZ;
+    navMesh.GetTileRange(qmin, qmax, minTileX, minTileZ, maxTileX, maxTileZ);
+    for (int tz = minTileZ; tz <= maxTileZ; ++tz)
+    {
+        for (int tx = minTileX; tx <= maxTileX; ++tx)
+        {
+            const NavMeshTile& tile = navMesh.tiles[tx + tz * navMesh.tilesX];
+            if (tile.bvTree.empty() || qmin.y > tile.bmax.y || qmax.y < tile.bmin.y)
+                continue;
+
+            const float originX = (float)(tile.tileX * navMesh.tileSize);
+            const float originZ = (float)(tile.tileZ * navMesh.tileSize);
+            const float originY = floorf((tile.bmin.y - navMesh.bmin.y) * invCellHeight + 0.5f);
+            unsigned short bmin[3], bmax[3];
+            bmin[0] = quantize((qmin.x - navMesh.bmin.x) * invCellSize - originX, false);
+            bmin[1] = quantize((qmin.y - navMesh.bmin.y) * invCellHeight - originY, false);
+            bmin[2] = quantize((qmin.z - navMesh.bmin.z) * invCellSize - originZ, false);
+            bmax[0] = quantize((qmax.x - navMesh.bmin.x) * invCellSize - originX, true);
+            bmax[1] = quantize((qmax.y - navMesh.bmin.y) * invCellHeight - originY, true);
+            bmax[2] = quantize((qmax.z - navMesh.bmin.z) * invCellSize - originZ, true);
+
+            const NavPolyRef base = navMesh.GetPolyRefBase(tile);
+            const NavBVNode* nodes = tile.bvTree.data();
+            const int nodeCount = (int)tile.bvTree.size();
+            int cur = 0;
+            while (cur < nodeCount)
+            {
+                const NavBVNode& node = nodes[cur];
+                const bool overlap = bmin[0] <= node.bmax[0] && bmax[0] >= node.bmin[0] &&
+                                     bmin[1] <= node.bmax[1] && bmax[1] >= node.bmin[1] &&
+                                     bmin[2] <= node.bmax[2] && bmax[2] >= node.bmin[2];
+                const bool isLeaf = node.i >= 0;
+
+                if (isLeaf && overlap)
+                {
+                    const NavPoly& poly = tile.polys[node.i];
+                    if (qmin.x <= poly.bmax.x && qmax.x >= poly.bmin.x && qmin.y <= poly.bmax.y &&
+                        qmax.y >= poly.bmin.y && qmin.z <= poly.bmax.z && qmax.z >= poly.bmin.z)
+                        fn(base | (NavPolyRef)node.i, tile, poly);
+                }
+
+                if (overlap || isLeaf)
+                    cur++;
+                else
+                    cur += -node.i;
+            }
+        }
+    }
+}
+
+NavQueryStatus NavMeshQuery::QueryPolygons(const glm::vec3& center, const glm::vec3& halfExtents, const NavQueryFilter& filter,
+                                           NavPolyRef* polys, int& polyCount, int maxPolys) const
+{
+    polyCount = 0;
+    if (!m_NavMesh || !polys || maxPolys <= 0)
+        return NAVQUERY_FAILURE;
+
+    bool overflow = false;
+    ForEachPolyInBox(*m_NavMesh, center - halfExtents, center + halfExtents,
+        [&](NavPolyRef ref, const NavMeshTile& tile, const NavPoly& poly)
+        {
+            if (!filter.PassFilter(ref, &tile, &poly))
+                return;
+            if (polyCount < maxPolys)
+                polys[polyCount++] = ref;
+            else
+                overflow = true;
+        });
+    return overflow ? NAVQUERY_PARTIAL_RESULT : NAVQUERY_SUCCESS;
+}
+
+NavQueryStatus NavMeshQuery::FindNearestPoly(const glm::vec3& center, const glm::vec3& halfExtents, const NavQueryFilter& filter,
+                                             NavPolyRef& nearestRef, glm::vec3& nearestPoint) const
+{
+    nearestRef = 0;
+    if (!m_NavMesh)
+        return NAVQUERY_FAILURE;
+
+    float nearestDistSqr = FLT_MAX;
+    ForEachPolyInBox(*m_NavMesh, center - halfExtents, center + halfExtents,
+        [&](NavPolyRef ref, const NavMeshTile& tile, const NavPoly& poly)
+        {
+            if (!filter.PassFilter(ref, &tile, &poly))
+                return;
+
+            const glm::vec3 closest(glm::clamp(center.x, poly.bmin.x, poly.bmax.x), poly.bmin.y,
+                                    glm::clamp(center.z, poly.bmin.z, poly.bmax.z));
+            const glm::vec3 diff = center - closest;
+            const float distSqr = glm::dot(diff, diff);
+            if (distSqr < nearestDistSqr)
+            {
+                nearestDistSqr = distSqr;
+                nearestRef = ref;
+                nearestPoint = closest;
+            }
+        });
+    return NAVQUERY_SUCCESS;
+}
+
+NavQueryStatus NavMeshQuery::FindPath(NavPolyRef startRef, NavPolyRef endRef, const glm::vec3& startPos, const glm::vec3& endPos,
+                                      const NavQueryFilter& filter, NavPolyRef* path, int& pathCount, int maxPath)
+{
+    pathCount = 0;
+    if (!path || maxPath <= 0)
+        return NAVQUERY_FAILURE;
+    if (InitSlicedFindPath(startRef, endRef, startPos, endPos, filter) == NAVQUERY_FAILURE)
+        return NAVQUERY_FAILURE;
+
+    int doneIters = 0;
+    UpdateSlicedFindPath(INT_MAX, doneIters);
+    return FinalizeSlicedFindPath(path, pathCount, maxPath);
+}
+
+NavQueryStatus NavMeshQuery::InitSlicedFindPath(NavPolyRef startRef, NavPolyRef endRef, const glm::vec3& startPos, const glm::vec3& endPos,
+                                                const NavQueryFilter& filter)
+{
+    m_Sliced = SlicedQuery();
+    m_Sliced.startRef = startRef;
+    m_Sliced.endRef = endRef;
+    m_Sliced.startPos = startPos;
+    m_Sliced.endPos = endPos;
+    m_Sliced.filter = &filter;
+    m_Sliced.heuristicScale = filter.GetMinAreaCost() * H_SCALE;
+    m_Sliced.status = NAVQUERY_FAILURE;
+
+    if (!m_NavMesh || !m_NodePool || !m_NavMesh->IsValidPolyRef(startRef) || !m_NavMesh->IsValidPolyRef(endRef))
+        return NAVQUERY_FAILURE;
+
+    m_NodePool->Clear();
+    m_OpenList->Clear();
+
+    const NavMeshTile* tile;
+    const NavPoly* poly;
+    const NavPoly* endPoly;
+    m_NavMesh->GetTileAndPoly(endRef, tile, endPoly);
+    m_NavMesh->GetTileAndPoly(startRef, tile, poly);
+    SelectLandmarks(startRef, poly, endRef, endPoly);
+
+    NavNode* startNode = m_NodePool->GetNode(startRef);
+    startNode->pos = startPos;
+    startNode->cost = 0.0f;
+    startNode->total = GetHeuristic(startPos, startRef, poly);
+    startNode->flags = NAVNODE_OPEN;
+    m_OpenList->Push(startNode);
+
+    m_Sliced.lastBestNode = startNode;
+    m_Sliced.lastBestNodeCost = startNode->total;
+    m_Sliced.status = startRef == endRef ? NAVQUERY_SUCCESS : NAVQUERY_IN_PROGRESS;
+    return m_Sliced.status;
+}
+
+NavQueryStatus NavMeshQuery::UpdateSlicedFindPath(int maxIters, int& doneIters)
+{
+    doneIters = 0;
+    if (m_Sliced.status != NAVQUERY_IN_PROGRESS)
+        return m_Sliced.status;
+
+    // The mesh may have changed between slices, a stale end ref cannot be reached anymore.
+    if (!m_NavMesh->IsValidPolyRef(m_Sliced.startRef) || !m_NavMesh->IsValidPolyRef(m_Sliced.endRef))
+    {
+        m_Sliced.status = NAVQUERY_FAILURE;
+        return m_Sliced.status;
+    }
+
+    const NavQueryFilter& filter = *m_Sliced.filter;
+    const NavPolyRef endRef = m_Sliced.endRef;
+    const glm::vec3& endPos = m_Sliced.endPos;
+
+    while (!m_OpenList->Empty() && doneIters < maxIters)
+    {
+        doneIters++;
+        NavNode* bestNode = m_OpenList->Pop();
+        bestNode->flags &= ~NAVNODE_OPEN;
+        bestNode->flags |= NAVNODE_CLOSED;
+
+        if (bestNode->ref == endRef)
+        {
+            m_Sliced.lastBestNode = bestNode;
+            m_Sliced.status = NAVQUERY_SUCCESS;
+            return m_Sliced.status;
+        }
+        if (!m_NavMesh->IsValidPolyRef(bestNode->ref))
+            continue;
+
+        const NavMeshTile* bestTile;
+        const NavPoly* bestPoly;
+        m_NavMesh->GetTileAndPoly(bestNode->ref, bestTile, bestPoly);
+
+        const NavNode* parentNode = m_NodePool->GetNodeAtIndex(bestNode->parentIndex);
+        const NavPolyRef parentRef = parentNode ? parentNode->ref : 0;
+
+        for (unsigned int i = bestPoly->firstLink; i < bestPoly->firstLink + bestPoly->linkCount; ++i)
+        {
+            const NavPolyLink& link = bestTile->links[i];
+            const NavPolyRef neighborRef = link.neighbor;
+            if (neighborRef == parentRef || !m_NavMesh->IsValidPolyRef(neighborRef))
+                continue;
+            if (m_CorridorTileStamps && m_CorridorTileStamps[DecodePolyRefTile(neighborRef)] != m_CorridorStamp)
+                continue;
+
+            const NavMeshTile* neighborTile;
+            const NavPoly* neighborPoly;
+            m_NavMesh->GetTileAndPoly(neighborRef, neighborTile, neighborPoly);
+            if (!filter.PassFilter(neighborRef, neighborTile, neighborPoly))
+                continue;
+
+            NavNode* neighborNode = m_NodePool->GetNode(neighborRef);
+            if (!neighborNode)
+                continue;
+
+            if (neighborNode->flags == 0)
+                neighborNode->pos = (link.left + link.right) * 0.5f;
+
+            float cost, heuristic;
+            if (neighborRef == endRef)
+            {
+                cost = bestNode->cost + filter.GetCost(bestNode->pos, neighborNode->pos, bestPoly) +
+                       filter.GetCost(neighborNode->pos, endPos, neighborPoly);
+                heuristic = 0.0f;
+            }
+            else
+            {
+                cost = bestNode->cost + filter.GetCost(bestNode->pos, neighborNode->pos, bestPoly);
+                heuristic = GetHeuristic(neighborNode->pos, neighborRef, neighborPoly);
+            }
+            const float total = cost + heuristic;
+
+            if ((neighborNode->flags & (NAVNODE_OPEN | NAVNODE_CLOSED)) && total >= neighborNode->total)
+                continue;
+
+            neighborNode->parentIndex = m_NodePool->GetNodeIndex(bestNode);
+            neighborNode->flags &= ~NAVNODE_CLOSED;
+            neighborNode->cost = cost;
+            neighborNode->total = total;
+
+            if (neighborNode->flags & NAVNODE_OPEN)
+            {
+                m_OpenList->Modify(neighborNode);
+            }
+            else
+            {
+                neighborNode->flags |= NAVNODE_OPEN;
+                m_OpenList->Push(neighborNode);
+            }
+
+            if (heuristic < m_Sliced.lastBestNodeCost)
+            {
+                m_Sliced.lastBestNodeCost = heuristic;
+                m_Sliced.lastBestNode = neighborNode;
+            }
+        }
+    }
+
+    if (m_OpenList->Empty())
+        m_Sliced.status = NAVQUERY_PARTIAL_RESULT;
+    return m_Sliced.status;
+}
+
+NavQueryStatus NavMeshQuery::FinalizeSlicedFindPath(NavPolyRef* path, int& pathCount, int maxPath)
+{
+    pathCount = 0;
+    const NavNode* lastBestNode = m_Sliced.lastBestNode;
+    if (m_Sliced.status == NAVQUERY_FAILURE || !lastBestNode || !path || maxPath <= 0)
+    {
+        m_Sliced = SlicedQuery();
+        return NAVQUERY_FAILURE;
+    }
+
+    // Walk the parent chain back to the start, dropping the tail polys if the buffer is too small.
+    int length = 0;
+    for (const NavNode* node = lastBestNode; node; node = m_NodePool->GetNodeAtIndex(node->parentIndex))
+        length++;
+
+    const NavNode* node = lastBestNode;
+    for (int i = length; i > maxPath; --i)
+        node = m_NodePool->GetNodeAtIndex(node->parentIndex);
+
+    pathCount = std::min(length, maxPath);
+    for (int i = pathCount - 1; i >= 0; --i)
+    {
+        path[i] = node->ref;
+        node = m_NodePool->GetNodeAtIndex(node->parentIndex);
+    }
+
+    const bool reachedEnd = lastBestNode->ref == m_Sliced.endRef && length <= maxPath;
+    m_Sliced = SlicedQuery();
+    return reachedEnd ? NAVQUERY_SUCCESS : NAVQUERY_PARTIAL_RESULT;
+}
+
+NavQueryStatus NavMeshQuery::FindStraightPath(const glm::vec3& startPos, const glm::vec3& endPos, const NavPolyRef* path, int pathCount,
+                                              glm::vec3* straightPath, int& straightPathCount, int maxStraightPath) const
+{
+    straightPathCount = 0;
+    if (!m_NavMesh || !path || pathCount <= 0 || !straightPath || maxStraightPath <= 0)
+        return NAVQUERY_FAILURE;
+
+    glm::vec3 closestStart, closestEnd;
+    if (!ClosestPointOnPoly(path[0], startPos, closestStart) || !ClosestPointOnPoly(path[pathCount - 1], endPos, closestEnd))
+        return NAVQUERY_FAILURE;
+
+    straightPath[straightPathCount++] = closestStart;
+
+    // --- Funnel over the portal edges of the corridor ---
+    glm::vec3 portalApex = closestStart;
+    glm::vec3 portalLeft = portalApex;
+    glm::vec3 portalRight = portalApex;
+    int apexIndex = 0, leftIndex = 0, rightIndex = 0;
+
+    for (int i = 0; i < pathCount; ++i)
+    {
+        glm::vec3 left, right;
+        if (i + 1 < pathCount)
+        {
+            if (!GetPortalPoints(path[i], path[i + 1], left, right))
+            {
+                // Corridor is broken, stop at the last reachable poly.
+                ClosestPointOnPoly(path[i], endPos, closestEnd);
+                break;
+            }
+        }
+        else
+        {
+            left = closestEnd;
+            right = closestEnd;
+        }
+
+        // Tighten the right side, or restart from the left corner when the funnel crosses over.
+        if (TriArea2D(portalApex, portalRight, right) >= 0.0f)
+        {
+            if (PointsEqual(portalApex, portalRight) || TriArea2D(portalApex, portalLeft, right) < 0.0f)
+            {
+                portalRight = right;
+                rightIndex = i;
+            }
+            else
+            {
+                if (straightPathCount >= maxStraightPath)
+                    return NAVQUERY_PARTIAL_RESULT;
+                if (!PointsEqual(straightPath[straightPathCount - 1], portalLeft))
+                    straightPath[straightPathCount++] = portalLeft;
+
+                portalApex = portalLeft;
+                apexIndex = leftIndex;
+                portalRight = portalApex;
+                rightIndex = apexIndex;
+                i = apexIndex;
+                continue;
+            }
+        }
+
+        // Tighten the left side, mirrored.
+        if (TriArea2D(portalApex, portalLeft, left) <= 0.0f)
+        {
+            if (PointsEqual(portalApex, portalLeft) || TriArea2D(portalApex, portalRight, left) > 0.0f)
+            {
+                portalLeft = left;
+                leftIndex = i;
+            }
+            else
+            {
+                if (straightPathCount >= maxStraightPath)
+                    return NAVQUERY_PARTIAL_RESULT;
+                if (!PointsEqual(straightPath[straightPathCount - 1], portalRight))
+                    straightPath[straightPathCount++] = portalRight;
+
+                portalApex = portalRight;
+                apexIndex = rightIndex;
+                portalLeft = portalApex;
+                leftIndex = apexIndex;
+                i = apexIndex;
+                continue;
+            }
+        }
+
+        // Off-mesh connections are taken from their entry point to their exit point whatever the funnel looks like,
+        // both are corners and the funnel starts over at the exit.
+        const NavMeshTile* nextTile;
+        const NavPoly* nextPoly;
+        if (i + 1 >= pathCount || !m_NavMesh->IsValidPolyRef(path[i + 1]))
+            continue;
+        m_NavMesh->GetTileAndPoly(path[i + 1], nextTile, nextPoly);
+        if (nextPoly->type != NAVPOLYTYPE_OFFMESH)
+            continue;
+        if (straightPathCount >= maxStraightPath)
+            return NAVQUERY_PARTIAL_RESULT;
+        if (!PointsEqual(straightPath[straightPathCount - 1], left))
+            straightPath[straightPathCount++] = left;
+        glm::vec3 exitPos;
+        if (i + 2 >= pathCount || !GetPortalPoints(path[i + 1], path[i + 2], exitPos, right))
+        {
+            // The corridor ends on the connection, stop at its entry.
+            closestEnd = left;
+            break;
+        }
+        if (straightPathCount >= maxStraightPath)
+            return NAVQUERY_PARTIAL_RESULT;
+        straightPath[straightPathCount++] = exitPos;
+        portalApex = exitPos;
+        portalLeft = portalApex;
+        portalRight = portalApex;
+        apexIndex = leftIndex = rightIndex = i + 1;
+        i = apexIndex;
+    }
+
+    if (straightPathCount >= maxStraightPath)
+        return NAVQUERY_PARTIAL_RESULT;
+    if (!PointsEqual(straightPath[straightPathCount - 1], closestEnd))
+        straightPath[straightPathCount++] = closestEnd;
+    return NAVQUERY_SUCCESS;
+}
@@ -0,0 +1,186 @@
+#pragma once
+#include "NavMesh.h"
+
+class NavMeshIslands;
+class NavMeshLandmarks;
+
+enum NavQueryStatus
+{
+    NAVQUERY_FAILURE,
+    NAVQUERY_SUCCESS,
+    NAVQUERY_PARTIAL_RESULT, // Goal not reached, path leads to the closest explored poly
+    NAVQUERY_IN_PROGRESS     // Sliced query still has open nodes
+};
+
+enum NavNodeFlags
+{
+    NAVNODE_OPEN = 0x01,
+    NAVNODE_CLOSED = 0x02
+};
+
+static const unsigned int NAV_NULL_NODE = 0xffffffff;
+static const int NAV_ACTIVE_LANDMARKS = 4; // Landmarks evaluated per query
+
+struct NavNode
+{
+    glm::vec3 pos;
+    float cost;  // Cost from start
+    float total; // Cost from start + heuristic
+    unsigned int parentIndex;
+    unsigned int flags;
+    NavPolyRef ref;
+};
+
+// Fixed capacity node storage with a hash lookup from poly ref, allocated once and cleared per query.
+class NavNodePool
+{
+public:
+    NavNodePool(int maxNodes, int hashSize);
+    ~NavNodePool();
+
+    void Clear();
+    NavNode* GetNode(NavPolyRef ref); // Finds or allocates, nullptr when the pool is exhausted
+    NavNode* FindNode(NavPolyRef ref) const;
+
+    unsigned int GetNodeIndex(const NavNode* node) const { return node ? (unsigned int)(node - m_Nodes) : NAV_NULL_NODE; }
+    NavNode* GetNodeAtIndex(unsigned int index) { return index != NAV_NULL_NODE ? &m_Nodes[index] : nullptr; }
+    const NavNode* GetNodeAtIndex(unsigned int index) const { return index != NAV_NULL_NODE ? &m_Nodes[index] : nullptr; }
+    int GetNodeCount() const { return m_NodeCount; }
+    int GetMaxNodes() const { return m_MaxNodes; }
+private:
+    NavNode* m_Nodes;
+    unsigned int* m_First;
+    unsigned int* m_Next;
+    int m_MaxNodes, m_HashSize, m_NodeCount;
+
+    unsigned int HashRef(NavPolyRef ref) const;
+};
+
+// Binary min-heap on NavNode::total.
+class NavNodeQueue
+{
+public:
+    explicit NavNodeQueue(int capacity);
+    ~NavNodeQueue();
+
+    void Clear() { m_Size = 0; }
+    bool Empty() const { return m_Size == 0; }
+    NavNode* Top() const { return m_Heap[0]; }
+    NavNode* Pop();
+    void Push(NavNode* node);
+    void Modify(NavNode* node); // Call after lowering node->total
+private:
+    NavNode** m_Heap;
+    int m_Capacity, m_Size;
+
+    void BubbleUp(int i, NavNode* node);
+    void TrickleDown(int i, NavNode* node);
+};
+
+// Polys pass when their flags contain one of the include flags and none of the exclude flags, crossing a poly
+// costs the distance times the cost of its area plus the poly's own cost, which only off-mesh connections have.
+// Both are a mask test and a table read on the A* hot path, kept non-virtual so they inline there.
+class NavQueryFilter
+{
+public:
+    NavQueryFilter();
+    bool PassFilter(NavPolyRef /*ref*/, const NavMeshTile* /*tile*/, const NavPoly* poly) const
+    {
+        return ((poly->flags & m_IncludeFlags) != 0) & ((poly->flags & m_ExcludeFlags) == 0);
+    }
+    float GetCost(const glm::vec3& pa, const glm::vec3& pb, const NavPoly* poly) const
+    {
+        // Masked so the area of a corrupt file cannot read past the table.
+        return glm::distance(pa, pb) * m_AreaCost[poly->area & (NAV_MAX_AREAS - 1)] + poly->cost;
+    }
+
+    void SetAreaCost(int area, float cost); // Costs are clamped to a small positive minimum
+    float GetAreaCost(int area) const { return m_AreaCost[area & (NAV_MAX_AREAS - 1)]; }
+    // The A* heuristic is scaled by the cheapest area so it stays a lower bound of the cost.
+    float GetMinAreaCost() const { return m_MinAreaCost; }
+    void SetIncludeFlags(unsigned short flags) { m_IncludeFlags = flags; }
+    void SetExcludeFlags(unsigned short flags) { m_ExcludeFlags = flags; }
+    unsigned short GetIncludeFlags() const { return m_IncludeFlags; }
+    unsigned short GetExcludeFlags() const { return m_ExcludeFlags; }
+private:
+    float m_AreaCost[NAV_MAX_AREAS];
+    float m_MinAreaCost;
+    unsigned short m_IncludeFlags, m_ExcludeFlags;
+};
+
+class NavMeshQuery
+{
+public:
+    NavMeshQuery();
+    ~NavMeshQuery();
+
+    bool Init(const NavMesh* navMesh, int maxNodes);
+    // Optional island labels, lets callers reject unreachable goals before searching.
+    void SetIslands(const NavMeshIslands* islands) { m_Islands = islands; }
+    bool IsReachable(NavPolyRef startRef, NavPolyRef endRef) const; // True when no labels are set
+    // Optional ALT landmarks, the heuristic becomes the larger of the Euclidean and the landmark bound.
+    // Like the Euclidean bound it is scaled by the cheapest area cost of the filter.
+    void SetLandmarks(const NavMeshLandmarks* landmarks) { m_Landmarks = landmarks; }
+    // Optional corridor for FindPath, only the tiles whose stamp equals stamp are entered. nullptr lifts it.
+    void SetTileCorridor(const unsigned int* tileStamps, unsigned int stamp) { m_CorridorTileStamps = tileStamps; m_CorridorStamp = stamp; }
+
+    // Polys whose bounds overlap the box, found through the per-tile BV trees.
+    NavQueryStatus QueryPolygons(const glm::vec3& center, const glm::vec3& halfExtents, const NavQueryFilter& filter,
+                                 NavPolyRef* polys, int& polyCount, int maxPolys) const;
+    NavQueryStatus FindNearestPoly(const glm::vec3& center, const glm::vec3& halfExtents, const NavQueryFilter& filter,
+                                   NavPolyRef& nearestRef, glm::vec3& nearestPoint) const;
+    NavQueryStatus FindPath(NavPolyRef startRef, NavPolyRef endRef, const glm::vec3& startPos, const glm::vec3& endPos,
+                            const NavQueryFilter& filter, NavPolyRef* path, int& pathCount, int maxPath);
+
+    // Sliced A*: the search state lives in the query so it can be spread over several frames.
+    // The filter must outlive the sliced query. Finalizing before the search is done returns the best partial path.
+    NavQueryStatus InitSlicedFindPath(NavPolyRef startRef, NavPolyRef endRef, const glm::vec3& startPos, const glm::vec3& endPos,
+                                      const NavQueryFilter& filter);
+    NavQueryStatus UpdateSlicedFindPath(int maxIters, int& doneIters);
+    NavQueryStatus FinalizeSlicedFindPath(NavPolyRef* path, int& pathCount, int maxPath);
+
+    NavQueryStatus FindStraightPath(const glm::vec3& startPos, const glm::vec3& endPos, const NavPolyRef* path, int pathCount,
+                                    glm::vec3* straightPath, int& straightPathCount, int maxStraightPath) const;
+
+    // Walks the polys under the segment in the xz plane. t is FLT_MAX when the segment ends on the mesh, otherwise the
+    // fraction where it hits a wall with hitNormal facing back along the ray. path receives the polys crossed.
+    NavQueryStatus Raycast(NavPolyRef startRef, const glm::vec3& startPos, const glm::vec3& endPos, const NavQueryFilter& filter,
+                           float& t, glm::vec3& hitNormal, NavPolyRef* path, int& pathCount, int maxPath) const;
+    // Moves from startPos toward endPos constrained to the mesh, searching only the polys near the move.
+    // visited receives the polys from startRef to the poly of resultPos.
+    NavQueryStatus MoveAlongSurface(NavPolyRef startRef, const glm::vec3& startPos, const glm::vec3& endPos, const NavQueryFilter& filter,
+                                    glm::vec3& resultPos, NavPolyRef* visited, int& visitedCount, int maxVisited) const;
+
+    bool ClosestPointOnPoly(NavPolyRef ref, const glm::vec3& pos, glm::vec3& closest) const;
+    bool GetPortalPoints(NavPolyRef from, NavPolyRef to, glm::vec3& left, glm::vec3& right) const;
+
+    const NavMesh* GetNavMesh() const { return m_NavMesh; }
+    const NavNodePool* GetNodePool() const { return m_NodePool; }
+private:
+    struct SlicedQuery
+    {
+        NavQueryStatus status;
+        NavPolyRef startRef, endRef;
+        glm::vec3 startPos, endPos;
+        const NavQueryFilter* filter;
+        float heuristicScale;
+        NavNode* lastBestNode;
+        float lastBestNodeCost;
+        const unsigned short* goalLandmarks; // Landmark distances of the end poly
+        int goalLandmarkSlack;               // Quantization steps a point in the end poly can lie beyond them
+        int activeLandmarks[NAV_ACTIVE_LANDMARKS];
+        int activeLandmarkCount;             // 0 = Euclidean heuristic only
+    };
+
+    const NavMesh* m_NavMesh;
+    const NavMeshIslands* m_Islands;
+    const NavMeshLandmarks* m_Landmarks;
+    const unsigned int* m_CorridorTileStamps;
+    unsigned int m_CorridorStamp;
+    NavNodePool* m_NodePool;
+    NavNodeQueue* m_OpenList;
+    SlicedQuery m_Sliced;
+
+    void SelectLandmarks(NavPolyRef startRef, const NavPoly* startPoly, NavPolyRef endRef, const NavPoly* endPoly);
+    float GetHeuristic(const glm::vec3& pos, NavPolyRef ref, const NavPoly* poly) const;
+};
@@ -0,0 +1,282 @@
+#include "NavMeshStreamer.h"
+#include <algorithm>
+#include <cfloat>
+#include <filesystem>
+#include <iostream>
+
+static const size_t DEFAULT_STREAM_MEMORY_BUDGET = 16 << 20;
+static const float DEFAULT_STREAM_LOAD_RADIUS = 64.0f;
+static const int MAX_PENDING_TILE_LOADS = 32;
+
+static bool SeekFile(FILE* file, uint64_t offset)
+{
+#ifdef _WIN32
+    return _fseeki64(file, (long long)offset, SEEK_SET) == 0;
+#else
+    return fseeko(file, (off_t)offset, SEEK_SET) == 0;
+#endif
+}
+
+static size_t GetTileBytes(const NavMeshTile& tile)
+{
+    return tile.polys.size() * sizeof(NavPoly) + tile.links.size() * sizeof(NavPolyLink) + tile.bvTree.size() * sizeof(NavBVNode);
+}
+
+NavMeshStreamer::NavMeshStreamer()
+    : m_File(nullptr), m_MemoryBudget(DEFAULT_STREAM_MEMORY_BUDGET), m_ResidentBytes(0), m_PeakResidentBytes(0),
+      m_LoadRadius(DEFAULT_STREAM_LOAD_RADIUS), m_UpdateCount(0), m_LoadedTileCount(0), m_PendingTileCount(0), m_InFlight(0),
+      m_bShutdown(false)
+{
+}
+
+NavMeshStreamer::~NavMeshStreamer()
+{
+    Close();
+}
+
+bool NavMeshStreamer::Open(const char* path, NavMesh& navMesh)
+{
+    Close();
+    std::error_code error;
+    const uint64_t fileSize = std::filesystem::file_size(path, error);
+    FILE* file = error ? nullptr : fopen(path, "rb");
+    if (!file)
+    {
+        std::cout << "NavMeshStreamer: could not open " << path << "." << std::endl;
+        return false;
+    }
+
+    NavMeshFileHeader header;
+    std::vector<NavMeshFileTileEntry> entries;
+    bool valid = fread(&header, sizeof(header), 1, file) == 1 && ValidateNavMeshFileHeader(header, fileSize);
+    if (valid)
+    {
+        entries.resize(header.tileCount);
+        valid = SeekFile(file, header.tileTableOffset) &&
+                fread(entries.data(), sizeof(NavMeshFileTileEntry), entries.size(), file) == entries.size();
+    }
+    if (!valid)
+    {
+        std::cout << "NavMeshStreamer: " << path << " is not a valid navmesh file." << std::endl;
+        fclose(file);
+        return false;
+    }
+
+    navMesh = NavMesh();
+    navMesh.bmin = glm::vec3(header.bmin[0], header.bmin[1], header.bmin[2]);
+    navMesh.cellSize = header.cellSize;
+    navMesh.cellHeight = header.cellHeight;
+    navMesh.tileSize = header.tileSize;
+    navMesh.tilesX = header.tilesX;
+    navMesh.tilesZ = header.tilesZ;
+    navMesh.tiles.resize(header.tileCount);
+    m_Tiles.resize(header.tileCount);
+    const float tileWorldSize = navMesh.tileSize * navMesh.cellSize;
+    for (uint32_t i = 0; i < header.tileCount; ++i)
+    {
+        NavMeshTile& tile = navMesh.tiles[i];
+        tile.tileX = i % navMesh.tilesX;
+        tile.tileZ = i / navMesh.tilesX;
+        tile.salt = 0;
+        tile.bmin = navMesh.bmin + glm::vec3(tile.tileX * tileWorldSize, 0.0f, tile.tileZ * tileWorldSize);
+        tile.bmax = tile.bmin + glm::vec3(tileWorldSize, 0.0f, tileWorldSize);
+
+        StreamedTile& streamed = m_Tiles[i];
+        streamed.entry = entries[i];
+        streamed.state = entries[i].size > 0 && IsValidNavMeshFileTileEntry(entries[i], fileSize) ? TILE_UNLOADED : TILE_MISSING;
+        streamed.lastUsed = 0;
+        streamed.bytes = 0;
+    }
+
+    m_File = file;
+    m_ResidentBytes = 0;
+    m_PeakResidentBytes = 0;
+    m_UpdateCount = 0;
+    m_LoadedTileCount = 0;
+    m_PendingTileCount = 0;
+    m_InFlight = 0;
+    m_bShutdown = false;
+    m_Thread = std::thread(&NavMeshStreamer::LoaderLoop, this);
+    return true;
+}
+
+void NavMeshStreamer::Close()
+{
+    if (!m_File)
+        return;
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_bShutdown = true;
+        m_Requests.clear();
+    }
+    m_WakeCondition.notify_all();
+    m_Thread.join();
+    fclose(m_File);
+    m_File = nullptr;
+    m_Tiles.clear();
+    m_Loaded.clear();
+    m_ResidentBytes = 0;
+    m_LoadedTileCount = 0;
+    m_PendingTileCount = 0;
+}
+
+void NavMeshStreamer::Update(NavMesh& navMesh, const glm::vec3* focusPoints, int focusCount, std::vector<int>& changedTiles)
+{
+    changedTiles.clear();
+    if (!m_File)
+        return;
+    m_UpdateCount++;
+
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Installing.swap(m_Loaded);
+    }
+    for (LoadedTile& loaded : m_Installing)
+    {
+        StreamedTile& streamed = m_Tiles[loaded.tileIndex];
+        NavMeshTile& tile = navMesh.tiles[loaded.tileIndex];
+        m_ResidentBytes -= streamed.bytes;
+        m_PendingTileCount--;
+        if (!loaded.valid || loaded.tile.tileX != tile.tileX || loaded.tile.tileZ != tile.tileZ)
+        {
+            std::cout << "NavMeshStreamer: tile " << loaded.tileIndex << " is corrupt, it stays unloaded." << std::endl;
+            streamed.state = TILE_MISSING;
+            streamed.bytes = 0;
+            continue;
+        }
+        tile = std::move(loaded.tile);
+        streamed.state = TILE_LOADED;
+        streamed.bytes = GetTileBytes(tile);
+        m_ResidentBytes += streamed.bytes;
+        m_LoadedTileCount++;
+        changedTiles.push_back(loaded.tileIndex);
+    }
+    m_Installing.clear();
+
+    // Every tile within the radius of a focus point is in use this update, the unloaded ones are requested nearest first.
+    m_Candidates.clear();
+    const float radiusSqr = m_LoadRadius * m_LoadRadius;
+    for (int i = 0; i < focusCount; ++i)
+    {
+        const glm::vec3& focus = focusPoints[i];
+        int minTileX, minTileZ, maxTileX, maxTileZ;
+        navMesh.GetTileRange(focus - glm::vec3(m_LoadRadius), focus + glm::vec3(m_LoadRadius), minTileX, minTileZ, maxTileX, maxTileZ);
+        const float tileWorldSize = navMesh.tileSize * navMesh.cellSize;
+        for (int tz = minTileZ; tz <= maxTileZ; ++tz)
+        {
+            for (int tx = minTileX; tx <= maxTileX; ++tx)
+            {
+                const float x0 = navMesh.bmin.x + tx * tileWorldSize, z0 = navMesh.bmin.z + tz * tileWorldSize;
+                const float dx = std::max(std::max(x0 - focus.x, focus.x - (x0 + tileWorldSize)), 0.0f);
+                const float dz = std::max(std::max(z0 - focus.z, focus.z - (z0 + tileWorldSize)), 0.0f);
+                const float distSqr = dx * dx + dz * dz;
+                if (distSqr > radiusSqr)
+                    continue;
+                const int tileIndex = tx + tz * navMesh.tilesX;
+                StreamedTile& streamed = m_Tiles[tileIndex];
+                if (streamed.state == TILE_UNLOADED && streamed.lastUsed != m_UpdateCount)
+                    m_Candidates.push_back({distSqr, tileIndex});
+                streamed.lastUsed = m_UpdateCount;
+            }
+        }
+    }
+    std::sort(m_Candidates.begin(), m_Candidates.end());
+
+    m_EvictionOrder.clear();
+    bool requested = false;
+    MakeRoom(navMesh, 0, changedTiles); // The budget may have been lowered
+    for (const auto& candidate : m_Candidates)
+    {
+        if (m_PendingTileCount >= MAX_PENDING_TILE_LOADS)
+            break;
+        StreamedTile& streamed = m_Tiles[candidate.second];
+        // The stored size bounds the arrays, reserving it keeps the budget while the tile is in flight.
+        if (!MakeRoom(navMesh, (size_t)streamed.entry.size, changedTiles))
+            break;
+        streamed.state = TILE_PENDING;
+        streamed.bytes = (size_t)streamed.entry.size;
+        m_ResidentBytes += streamed.bytes;
+        m_PendingTileCount++;
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_Requests.push_back({candidate.second, streamed.entry});
+        m_InFlight++;
+        requested = true;
+    }
+    m_PeakResidentBytes = std::max(m_PeakResidentBytes, m_ResidentBytes);
+    if (requested)
+        m_WakeCondition.notify_one();
+}
+
+// Evicts loaded tiles that are out of range of every focus point, least recently used first, until bytes more fit the budget.
+bool NavMeshStreamer::MakeRoom(NavMesh& navMesh, size_t bytes, std::vector<int>& changedTiles)
+{
+    if (m_ResidentBytes + bytes <= m_MemoryBudget)
+        return true;
+    if (m_EvictionOrder.empty())
+    {
+        for (int i = 0; i < (int)m_Tiles.size(); ++i)
+            if (m_Tiles[i].state == TILE_LOADED && m_Tiles[i].lastUsed != m_UpdateCount)
+                m_EvictionOrder.push_back(i);
+        // Most recently used first, so the next victim is popped off the back.
+        std::sort(m_EvictionOrder.begin(), m_EvictionOrder.end(),
+                  [this](int a, int b) { return m_Tiles[a].lastUsed > m_Tiles[b].lastUsed; });
+    }
+    while (m_ResidentBytes + bytes > m_MemoryBudget && !m_EvictionOrder.empty())
+    {
+        const int tileIndex = m_EvictionOrder.back();
+        m_EvictionOrder.pop_back();
+        EvictTile(navMesh, tileIndex);
+        changedTiles.push_back(tileIndex);
+    }
+    return m_ResidentBytes + bytes <= m_MemoryBudget;
+}
+
+void NavMeshStreamer::EvictTile(NavMesh& navMesh, int tileIndex)
+{
+    StreamedTile& streamed = m_Tiles[tileIndex];
+    NavMeshTile& tile = navMesh.tiles[tileIndex];
+    // Assigning empty arrays releases the storage, clear would keep the capacity.
+    tile.polys = NavTileArray<NavPoly>();
+    tile.links = NavTileArray<NavPolyLink>();
+    tile.bvTree = NavTileArray<NavBVNode>();
+    m_ResidentBytes -= streamed.bytes;
+    streamed.bytes = 0;
+    streamed.state = TILE_UNLOADED;
+    m_LoadedTileCount--;
+}
+
+void NavMeshStreamer::WaitForLoads()
+{
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    m_DoneCondition.wait(lock, [this] { return m_InFlight == 0; });
+}
+
+void NavMeshStreamer::LoaderLoop()
+{
+    std::vector<unsigned char> buffer;
+    for (;;)
+    {
+        LoadRequest request;
+        {
+            std::unique_lock<std::mutex> lock(m_Mutex);
+            m_WakeCondition.wait(lock, [this] { return m_bShutdown || !m_Requests.empty(); });
+            if (m_bShutdown)
+                return;
+            request = m_Requests.front();
+            m_Requests.pop_front();
+        }
+
+        LoadedTile loaded;
+        loaded.tileIndex = request.tileIndex;
+        buffer.resize((size_t)request.entry.size);
+        loaded.valid = SeekFile(m_File, request.entry.offset) && fread(buffer.data(), 1, buffer.size(), m_File) == buffer.size() &&
+                       ReadNavMeshFileTile(buffer.data(), buffer.size(), true, loaded.tile);
+
+        {
+            std::lock_guard<std::mutex> lock(m_Mutex);
+            m_Loaded.push_back(std::move(loaded));
+            m_InFlight--;
+        }
+        m_DoneCondition.notify_all();
+    }
+}
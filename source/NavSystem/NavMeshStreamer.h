@@ -0,0 +1,90 @@
+#pragma once
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "NavMesh.h"
+#include "NavMeshFile.h"
+
+// Keeps the tiles of a navmesh file resident around focus points. A loader thread reads missing tiles from the
+// file, nearest first, and Update installs them in the mesh, so queries never see a half loaded tile. Under memory
+// pressure the least recently needed tiles are evicted, and a tile is only requested once the budget has room for
+// it, so the tile data stays under the budget however large the world is. Unloaded tiles are empty: refs into them
+// are invalid until they are loaded again and the queries skip links into them.
+class NavMeshStreamer
+{
+public:
+    NavMeshStreamer();
+    ~NavMeshStreamer();
+    NavMeshStreamer(const NavMeshStreamer&) = delete;
+    NavMeshStreamer& operator=(const NavMeshStreamer&) = delete;
+
+    // navMesh receives the tile grid of the file with every tile unloaded.
+    bool Open(const char* path, NavMesh& navMesh);
+    void Close();
+    bool IsOpen() const { return m_File != nullptr; }
+
+    void SetMemoryBudget(size_t bytes) { m_MemoryBudget = bytes; }
+    void SetLoadRadius(float radius) { m_LoadRadius = radius; }
+    // Installs the tiles loaded since the last update, then requests the missing tiles within the load radius of
+    // the focus points. changedTiles receives every tile that was installed or evicted.
+    void Update(NavMesh& navMesh, const glm::vec3* focusPoints, int focusCount, std::vector<int>& changedTiles);
+    void WaitForLoads(); // Blocks until every requested tile is read, the next Update installs them
+
+    bool IsTileLoaded(int tileIndex) const { return m_Tiles[tileIndex].state == TILE_LOADED; }
+    int GetLoadedTileCount() const { return m_LoadedTileCount; }
+    int GetPendingTileCount() const { return m_PendingTileCount; }
+    size_t GetResidentBytes() const { return m_ResidentBytes; } // Loaded tiles plus the reservations of pending ones
+    size_t GetPeakResidentBytes() const { return m_PeakResidentBytes; }
+    size_t GetMemoryBudget() const { return m_MemoryBudget; }
+private:
+    enum TileState
+    {
+        TILE_UNLOADED,
+        TILE_PENDING,
+        TILE_LOADED,
+        TILE_MISSING // Not stored in the file or corrupt, never requested again
+    };
+    struct StreamedTile
+    {
+        NavMeshFileTileEntry entry;
+        TileState state;
+        unsigned int lastUsed; // Update in which the tile was last within the load radius
+        size_t bytes;          // Stored size while pending, size of the arrays once loaded
+    };
+    struct LoadRequest
+    {
+        int tileIndex;
+        NavMeshFileTileEntry entry;
+    };
+    struct LoadedTile
+    {
+        int tileIndex;
+        NavMeshTile tile;
+        bool valid;
+    };
+
+    FILE* m_File; // Read by the loader thread only once it runs
+    std::vector<StreamedTile> m_Tiles;
+    size_t m_MemoryBudget, m_ResidentBytes, m_PeakResidentBytes;
+    float m_LoadRadius;
+    unsigned int m_UpdateCount;
+    int m_LoadedTileCount, m_PendingTileCount;
+    std::vector<std::pair<float, int>> m_Candidates; // Scratch, distance and tile
+    std::vector<int> m_EvictionOrder;
+    std::vector<LoadedTile> m_Installing;
+
+    std::thread m_Thread;
+    std::mutex m_Mutex;
+    std::condition_variable m_WakeCondition, m_DoneCondition;
+    std::deque<LoadRequest> m_Requests;  // Guarded by m_Mutex
+    std::vector<LoadedTile> m_Loaded;    // Guarded by m_Mutex
+    int m_InFlight;                      // Guarded by m_Mutex, requested but not yet in m_Loaded
+    bool m_bShutdown;
+
+    bool MakeRoom(NavMesh& navMesh, size_t bytes, std::vector<int>& changedTiles);
+    void EvictTile(NavMesh& navMesh, int tileIndex);
+    void LoaderLoop();
+};
@@ -0,0 +1,364 @@
+#include "NavMeshTileCache.h"
+#include "NavigationSystem.h"
+#include "NavCompression.h"
+#include <algorithm>
+#include <cmath>
+
+static const unsigned int MAX_OBSTACLES = 1u << 16;
+
+static NavObstacleRef EncodeObstacleRef(unsigned int salt, unsigned int slot)
+{
+    return (salt << 16) | slot;
+}
+
+// Cell centers are tested against the shape grown by half a cell, so partly covered cells are blocked as well.
+static bool ObstacleContains(const NavObstacle& obstacle, float x, float z, float margin)
+{
+    const float dx = x - obstacle.center.x;
+    const float dz = z - obstacle.center.z;
+    switch (obstacle.type)
+    {
+    case NAVOBSTACLE_CYLINDER:
+    {
+        const float radius = obstacle.halfExtents.x + margin;
+        return dx * dx + dz * dz <= radius * radius;
+    }
+    case NAVOBSTACLE_BOX:
+        return fabsf(dx) <= obstacle.halfExtents.x + margin && fabsf(dz) <= obstacle.halfExtents.z + margin;
+    case NAVOBSTACLE_ORIENTED_BOX:
+    {
+        const float localX = dx * obstacle.rotationCos + dz * obstacle.rotationSin;
+        const float localZ = -dx * obstacle.rotationSin + dz * obstacle.rotationCos;
+        return fabsf(localX) <= obstacle.halfExtents.x + margin && fabsf(localZ) <= obstacle.halfExtents.z + margin;
+    }
+    }
+    return false;
+}
+
+NavMeshTileCache::NavMeshTileCache()
+    : m_Width(0), m_Depth(0), m_TileSize(0), m_TilesX(0), m_TilesZ(0), m_WalkableClimb(0), m_Bmin(0.0f), m_CellSize(1.0f),
+      m_CellHeight(1.0f), m_NextRegion(2), m_CompressedBytes(0), m_RawBytes(0)
+{
+}
+
+void NavMeshTileCache::Init(const HeightField& heightField, const std::vector<unsigned int>& walkableAreas, int tileSize, int walkableClimb)
+{
+    Clear();
+    if (heightField.width == 0 || heightField.depth == 0 || heightField.spanPool.empty() || tileSize <= 0)
+        return;
+
+    m_Width = heightField.width;
+    m_Depth = heightField.depth;
+    m_TileSize = tileSize;
+    m_TilesX = (m_Width + tileSize - 1) / tileSize;
+    m_TilesZ = (m_Depth + tileSize - 1) / tileSize;
+    m_WalkableClimb = walkableClimb;
+    m_Bmin = heightField.bmin;
+    m_CellSize = heightField.cellSize;
+    m_CellHeight = heightField.cellHeight;
+    m_Layers.resize(m_TilesX * m_TilesZ);
+    m_TileDirty.assign(m_TilesX * m_TilesZ, 0);
+
+    m_NextRegion = 2;
+    for (const HeightFieldSpan& span : heightField.spanPool)
+        m_NextRegion = std::max(m_NextRegion, span.areaID + 1);
+
+    for (int tz = 0; tz < m_TilesZ; ++tz)
+    {
+        for (int tx = 0; tx < m_TilesX; ++tx)
+        {
+            const int x0 = tx * tileSize, z0 = tz * tileSize;
+            const size_t deltaBytes = BuildLayer(heightField, walkableAreas, x0, z0, std::min(m_Width, x0 + tileSize), std::min(m_Depth, z0 + tileSize), m_Layer);
+
+            // The delta pass only pays on sloped ground and costs decode speed, so it is kept only when it is smaller.
+            CompressedLayer& layer = m_Layers[tx + tz * m_TilesX];
+            m_Compressed.resize(GetCompressBound(m_Layer.size()));
+            const size_t plainSize = CompressTileData(m_Layer.data(), m_Layer.size(), m_Compressed.data());
+            layer.data.assign(m_Compressed.begin(), m_Compressed.begin() + plainSize);
+            DeltaEncode(m_Layer.data(), deltaBytes);
+            const size_t deltaSize = CompressTileData(m_Layer.data(), m_Layer.size(), m_Compressed.data());
+            layer.deltaCoded = deltaSize < plainSize;
+            if (layer.deltaCoded)
+                layer.data.assign(m_Compressed.begin(), m_Compressed.begin() + deltaSize);
+            layer.rawSize = (unsigned int)m_Layer.size();
+            m_CompressedBytes += layer.data.size();
+            m_RawBytes += m_Layer.size();
+        }
+    }
+
+    for (const NavObstacle& obstacle : m_Obstacles)
+        if (obstacle.used)
+            MarkObstacleTiles(obstacle);
+}
+
+// Planar layout, column span counts then span heights as low and high byte planes, then the walkable flags.
+// The count and height planes get the delta prefilter, so flat ground and steady slopes turn into runs.
+size_t NavMeshTileCache::BuildLayer(const HeightField& heightField, const std::vector<unsigned int>& walkableAreas, int x0, int z0, int x1, int z1,
+                                    std::vector<unsigned char>& layer)
+{
+    const HeightFieldSpan* pool = &heightField.spanPool[0];
+    const bool useWalkableAreas = walkableAreas.size() == heightField.spanPool.size();
+    const size_t columns = (size_t)(x1 - x0) * (z1 - z0);
+    size_t spanCount = 0;
+    for (int z = z0; z < z1; ++z)
+        for (int x = x0; x < x1; ++x)
+            for (const HeightFieldSpan* span = heightField.spans[x + z * heightField.width]; span; span = span->next)
+                spanCount++;
+
+    layer.resize(columns * 2 + spanCount * 3);
+    unsigned char* countLow = layer.data();
+    unsigned char* countHigh = countLow + columns;
+    unsigned char* heightLow = countHigh + columns;
+    unsigned char* heightHigh = heightLow + spanCount;
+    unsigned char* areas = heightHigh + spanCount;
+    for (int z = z0; z < z1; ++z)
+    {
+        for (int x = x0; x < x1; ++x)
+        {
+            unsigned int count = 0;
+            for (const HeightFieldSpan* span = heightField.spans[x + z * heightField.width]; span; span = span->next)
+            {
+                const unsigned int area = useWalkableAreas ? walkableAreas[span - pool] : span->areaID;
+                *heightLow++ = (unsigned char)(span->spanMax & 0xff);
+                *heightHigh++ = (unsigned char)(span->spanMax >> 8);
+                *areas++ = area != 0 ? 1 : 0;
+                count++;
+            }
+            *countLow++ = (unsigned char)(count & 0xff);
+            *countHigh++ = (unsigned char)(count >> 8);
+        }
+    }
+    return (columns + spanCount) * 2;
+}
+
+void NavMeshTileCache::Clear()
+{
+    m_Width = m_Depth = 0;
+    m_TilesX = m_TilesZ = 0;
+    m_Layers.clear();
+    m_CompressedBytes = 0;
+    m_RawBytes = 0;
+    m_DirtyTiles.clear();
+    m_TileDirty.clear();
+}
+
+NavObstacleRef NavMeshTileCache::AddCylinderObstacle(const glm::vec3& baseCenter, float radius, float height)
+{
+    NavObstacle obstacle;
+    obstacle.type = NAVOBSTACLE_CYLINDER;
+    obstacle.center = baseCenter;
+    obstacle.halfExtents = glm::vec3(radius, height, radius);
+    obstacle.rotationCos = 1.0f;
+    obstacle.rotationSin = 0.0f;
+    obstacle.bmin = glm::vec3(baseCenter.x - radius, baseCenter.y, baseCenter.z - radius);
+    obstacle.bmax = glm::vec3(baseCenter.x + radius, baseCenter.y + height, baseCenter.z + radius);
+    return AddObstacle(obstacle);
+}
+
+NavObstacleRef NavMeshTileCache::AddBoxObstacle(const glm::vec3& bmin, const glm::vec3& bmax)
+{
+    NavObstacle obstacle;
+    obstacle.type = NAVOBSTACLE_BOX;
+    obstacle.center = (bmin + bmax) * 0.5f;
+    obstacle.halfExtents = glm::abs(bmax - bmin) * 0.5f;
+    obstacle.rotationCos = 1.0f;
+    obstacle.rotationSin = 0.0f;
+    obstacle.bmin = glm::min(bmin, bmax);
+    obstacle.bmax = glm::max(bmin, bmax);
+    return AddObstacle(obstacle);
+}
+
+NavObstacleRef NavMeshTileCache::AddOrientedBoxObstacle(const glm::vec3& center, const glm::vec3& halfExtents, float yRotation)
+{
+    NavObstacle obstacle;
+    obstacle.type = NAVOBSTACLE_ORIENTED_BOX;
+    obstacle.center = center;
+    obstacle.halfExtents = glm::abs(halfExtents);
+    obstacle.rotationCos = cosf(yRotation);
+    obstacle.rotationSin = sinf(yRotation);
+    const float extentX = fabsf(obstacle.rotationCos) * obstacle.halfExtents.x + fabsf(obstacle.rotationSin) * obstacle.halfExtents.z;
+    const float extentZ = fabsf(obstacle.rotationSin) * obstacle.halfExtents.x + fabsf(obstacle.rotationCos) * obstacle.halfExtents.z;
+    obstacle.bmin = glm::vec3(center.x - extentX, center.y - obstacle.halfExtents.y, center.z - extentZ);
+    obstacle.bmax = glm::vec3(center.x + extentX, center.y + obstacle.halfExtents.y, center.z + extentZ);
+    return AddObstacle(obstacle);
+}
+
+NavObstacleRef NavMeshTileCache::AddObstacle(const NavObstacle& obstacle)
+{
+    unsigned int slot;
+    if (!m_FreeObstacles.empty())
+    {
+        slot = m_FreeObstacles.back();
+        m_FreeObstacles.pop_back();
+    }
+    else
+    {
+        if (m_Obstacles.size() >= MAX_OBSTACLES)
+            return 0;
+        slot = (unsigned int)m_Obstacles.size();
+        m_Obstacles.push_back(NavObstacle());
+        m_Obstacles.back().salt = 0;
+    }
+
+    NavObstacle& stored = m_Obstacles[slot];
+    const unsigned int salt = stored.salt % 0xffff + 1;
+    stored = obstacle;
+    stored.salt = salt;
+    stored.used = true;
+    MarkObstacleTiles(stored);
+    return EncodeObstacleRef(salt, slot);
+}
+
+bool NavMeshTileCache::RemoveObstacle(NavObstacleRef ref)
+{
+    const unsigned int slot = ref & 0xffff;
+    if (!GetObstacle(ref))
+        return false;
+    NavObstacle& obstacle = m_Obstacles[slot];
+    obstacle.used = false;
+    m_FreeObstacles.push_back(slot);
+    MarkObstacleTiles(obstacle);
+    return true;
+}
+
+void NavMeshTileCache::RemoveAllObstacles()
+{
+    for (unsigned int slot = 0; slot < m_Obstacles.size(); ++slot)
+        if (m_Obstacles[slot].used)
+            RemoveObstacle(EncodeObstacleRef(m_Obstacles[slot].salt, slot));
+}
+
+const NavObstacle* NavMeshTileCache::GetObstacle(NavObstacleRef ref) const
+{
+    const unsigned int slot = ref & 0xffff;
+    if (slot >= m_Obstacles.size() || !m_Obstacles[slot].used || m_Obstacles[slot].salt != ref >> 16)
+        return nullptr;
+    return &m_Obstacles[slot];
+}
+
+void NavMeshTileCache::MarkObstacleTiles(const NavObstacle& obstacle)
+{
+    if (m_TilesX == 0 || m_TilesZ == 0)
+        return;
+    const float tileWorldSize = m_TileSize * m_CellSize;
+    const int minX = std::max((int)floorf((obstacle.bmin.x - m_CellSize - m_Bmin.x) / tileWorldSize), 0);
+    const int minZ = std::max((int)floorf((obstacle.bmin.z - m_CellSize - m_Bmin.z) / tileWorldSize), 0);
+    const int maxX = std::min((int)floorf((obstacle.bmax.x + m_CellSize - m_Bmin.x) / tileWorldSize), m_TilesX - 1);
+    const int maxZ = std::min((int)floorf((obstacle.bmax.z + m_CellSize - m_Bmin.z) / tileWorldSize), m_TilesZ - 1);
+    for (int tz = minZ; tz <= maxZ; ++tz)
+    {
+        for (int tx = minX; tx <= maxX; ++tx)
+        {
+            const int tileIndex = tx + tz * m_TilesX;
+            if (!m_TileDirty[tileIndex])
+            {
+                m_TileDirty[tileIndex] = 1;
+                m_DirtyTiles.push_back(tileIndex);
+            }
+        }
+    }
+}
+
+bool NavMeshTileCache::BuildTileAreas(int tileIndex, HeightField& heightField)
+{
+    const CompressedLayer& layer = m_Layers[tileIndex];
+    m_Layer.resize(layer.rawSize);
+    if (!DecompressTileData(layer.data.data(), layer.data.size(), m_Layer.data(), layer.rawSize))
+        return false;
+
+    const int tx = tileIndex % m_TilesX, tz = tileIndex / m_TilesX;
+    const int x0 = tx * m_TileSize, x1 = std::min(m_Width, x0 + m_TileSize);
+    const int z0 = tz * m_TileSize, z1 = std::min(m_Depth, z0 + m_TileSize);
+    const int columns = (x1 - x0) * (z1 - z0);
+    const int spanCount = ((int)m_Layer.size() - columns * 2) / 3;
+    if (layer.deltaCoded)
+        DeltaDecode(m_Layer.data(), (columns + spanCount) * 2);
+    const unsigned char* countLow = &m_Layer[0];
+    const unsigned char* countHigh = countLow + columns;
+    const unsigned char* heightLow = countHigh + columns;
+    const unsigned char* heightHigh = heightLow + spanCount;
+    const unsigned char* areas = heightHigh + spanCount;
+
+    const glm::vec3 tileMin(m_Bmin.x + x0 * m_CellSize, 0.0f, m_Bmin.z + z0 * m_CellSize);
+    const glm::vec3 tileMax(m_Bmin.x + x1 * m_CellSize, 0.0f, m_Bmin.z + z1 * m_CellSize);
+    m_TileObstacles.clear();
+    for (const NavObstacle& obstacle : m_Obstacles)
+    {
+        if (obstacle.used && obstacle.bmin.x <= tileMax.x + m_CellSize && obstacle.bmax.x >= tileMin.x - m_CellSize &&
+            obstacle.bmin.z <= tileMax.z + m_CellSize && obstacle.bmax.z >= tileMin.z - m_CellSize)
+            m_TileObstacles.push_back(&obstacle);
+    }
+
+    const float margin = m_CellSize * 0.5f;
+    int column = 0, spanIndex = 0;
+    for (int z = z0; z < z1; ++z)
+    {
+        for (int x = x0; x < x1; ++x, ++column)
+        {
+            const int count = countLow[column] | (countHigh[column] << 8);
+            const float cellX = m_Bmin.x + (x + 0.5f) * m_CellSize;
+            const float cellZ = m_Bmin.z + (z + 0.5f) * m_CellSize;
+            HeightFieldSpan* span = heightField.spans[x + z * m_Width];
+            for (int i = 0; i < count; ++i, ++spanIndex, span = span->next)
+            {
+                const unsigned int height = heightLow[spanIndex] | (heightHigh[spanIndex] << 8);
+                if (!span || span->spanMax != height)
+                    return false;
+
+                unsigned int area = areas[spanIndex];
+                if (area)
+                {
+                    // Surfaces from one cell below the obstacle's base up to its top are covered.
+                    const float surfaceY = m_Bmin.y + (height + 1) * m_CellHeight;
+                    for (const NavObstacle* obstacle : m_TileObstacles)
+                    {
+                        if (surfaceY >= obstacle->bmin.y - m_CellHeight && surfaceY <= obstacle->bmax.y &&
+                            ObstacleContains(*obstacle, cellX, cellZ, margin))
+                        {
+                            area = 0;
+                            break;
+                        }
+                    }
+                }
+                span->areaID = area;
+            }
+            if (span)
+                return false;
+        }
+    }
+    return true;
+}
+
+int NavMeshTileCache::Update(HeightField& heightField, NavMesh& navMesh, std::vector<unsigned int>& spanPolys, std::vector<int>& changedTiles)
+{
+    changedTiles.clear();
+    if (m_DirtyTiles.empty())
+        return 0;
+
+    std::vector<int> tiles;
+    tiles.swap(m_DirtyTiles);
+    for (int tileIndex : tiles)
+        m_TileDirty[tileIndex] = 0;
+    if (heightField.width != m_Width || heightField.depth != m_Depth || navMesh.tileSize != m_TileSize ||
+        (int)navMesh.tiles.size() != m_TilesX * m_TilesZ || spanPolys.size() != heightField.spanPool.size())
+        return 0;
+
+    // Areas first for all tiles, the connections along a tile border read the areas on both sides.
+    tiles.erase(std::remove_if(tiles.begin(), tiles.end(), [&](int tileIndex) { return !BuildTileAreas(tileIndex, heightField); }),
+                tiles.end());
+    for (int tileIndex : tiles)
+    {
+        const int x0 = (tileIndex % m_TilesX) * m_TileSize, x1 = std::min(m_Width, x0 + m_TileSize);
+        const int z0 = (tileIndex / m_TilesX) * m_TileSize, z1 = std::min(m_Depth, z0 + m_TileSize);
+        m_NextRegion = NavigationSystem::BuildRegions(heightField, m_WalkableClimb, x0, z0, x1, z1, m_NextRegion);
+    }
+    for (int tileIndex : tiles)
+    {
+        const int x0 = (tileIndex % m_TilesX) * m_TileSize, x1 = std::min(m_Width, x0 + m_TileSize);
+        const int z0 = (tileIndex / m_TilesX) * m_TileSize, z1 = std::min(m_Depth, z0 + m_TileSize);
+        NavigationSystem::BuildConnections(heightField, m_WalkableClimb, std::max(x0 - 1, 0), std::max(z0 - 1, 0), std::min(x1 + 1, m_Width),
+                                           std::min(z1 + 1, m_Depth));
+    }
+    NavigationSystem::RebuildPolyMeshTiles(heightField, tiles, navMesh, spanPolys, changedTiles);
+    return (int)tiles.size();
+}
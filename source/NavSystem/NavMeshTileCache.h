@@ -0,0 +1,85 @@
+#pragma once
+#include <vector>
+#include <glm/glm.hpp>
+
+struct HeightField;
+struct NavMesh;
+
+// Obstacle references pack salt | slot so the ref of a removed obstacle never matches a later one in the same slot.
+typedef unsigned int NavObstacleRef;
+
+enum NavObstacleType
+{
+    NAVOBSTACLE_CYLINDER,
+    NAVOBSTACLE_BOX,
+    NAVOBSTACLE_ORIENTED_BOX
+};
+struct NavObstacle
+{
+    NavObstacleType type;
+    glm::vec3 center;      // Cylinder: center of the base. Boxes: center
+    glm::vec3 halfExtents; // Cylinder: radius in x and z, height in y
+    float rotationCos, rotationSin; // Oriented box rotation about y
+    glm::vec3 bmin, bmax;  // World bounds
+    unsigned int salt;
+    bool used;
+};
+
+// Keeps the walkable layer of every tile compressed in memory, the span areas right after the walkable filter.
+// Obstacles are stamped into a decompressed copy of the layers of the tiles they touch and written back to the
+// heightfield, then only those tiles get new regions, connections and polys and only they and their neighbors are
+// relinked. Geometry is never rasterized again.
+class NavMeshTileCache
+{
+public:
+    NavMeshTileCache();
+
+    // walkableAreas per span of the heightfield, nonzero when walkable. Tiles under existing obstacles are marked dirty.
+    void Init(const HeightField& heightField, const std::vector<unsigned int>& walkableAreas, int tileSize, int walkableClimb);
+    void Clear(); // Drops the layers, the obstacles are kept and stamped again after the next Init
+
+    NavObstacleRef AddCylinderObstacle(const glm::vec3& baseCenter, float radius, float height);
+    NavObstacleRef AddBoxObstacle(const glm::vec3& bmin, const glm::vec3& bmax);
+    NavObstacleRef AddOrientedBoxObstacle(const glm::vec3& center, const glm::vec3& halfExtents, float yRotation);
+    bool RemoveObstacle(NavObstacleRef ref);
+    void RemoveAllObstacles();
+    const NavObstacle* GetObstacle(NavObstacleRef ref) const;
+    int GetObstacleCount() const { return (int)(m_Obstacles.size() - m_FreeObstacles.size()); }
+
+    bool HasDirtyTiles() const { return !m_DirtyTiles.empty(); }
+    // Rebuilds the tiles touched by obstacles added or removed since the last update. spanPolys as filled by
+    // NavigationSystem::BuildPolyMesh, changedTiles receives every tile whose polys or links were rebuilt.
+    int Update(HeightField& heightField, NavMesh& navMesh, std::vector<unsigned int>& spanPolys, std::vector<int>& changedTiles);
+
+    // Uncompressed layer of a cell rectangle, returns the length of the prefix the delta prefilter applies to.
+    static size_t BuildLayer(const HeightField& heightField, const std::vector<unsigned int>& walkableAreas, int x0, int z0, int x1, int z1,
+                             std::vector<unsigned char>& layer);
+
+    size_t GetCompressedBytes() const { return m_CompressedBytes; }
+    size_t GetRawBytes() const { return m_RawBytes; }
+private:
+    struct CompressedLayer
+    {
+        std::vector<unsigned char> data;
+        unsigned int rawSize;
+        bool deltaCoded;
+    };
+
+    int m_Width, m_Depth, m_TileSize, m_TilesX, m_TilesZ, m_WalkableClimb;
+    glm::vec3 m_Bmin;
+    float m_CellSize, m_CellHeight;
+    unsigned int m_NextRegion;
+    std::vector<CompressedLayer> m_Layers;
+    size_t m_CompressedBytes, m_RawBytes;
+    std::vector<NavObstacle> m_Obstacles;
+    std::vector<unsigned int> m_FreeObstacles;
+    std::vector<int> m_DirtyTiles;
+    std::vector<unsigned char> m_TileDirty;
+    std::vector<unsigned char> m_Layer, m_Compressed; // Scratch
+    std::vector<const NavObstacle*> m_TileObstacles;
+
+    NavObstacleRef AddObstacle(const NavObstacle& obstacle);
+    void MarkObstacleTiles(const NavObstacle& obstacle);
+    // Decompresses the tile's layer, stamps the obstacles over it and writes the areas to the tile's spans, 1 walkable and 0 blocked.
+    bool BuildTileAreas(int tileIndex, HeightField& heightField);
+};
@@ -1,20 +1,69 @@
 
 #include "NavigationSystem.h"
+#include "NavigationSystemBenchmarks.h"
+#include "NavMeshFile.h"
+#include "Core/JobSystem.h"
+#include "Core/MappedFile.h"
+#include <cfloat>
+#include <chrono>
+#include <cstdlib>
 #include <deque>
 
-NavigationSystem::NavigationSystem() : m_InputTriangles(), m_NavMesh()
+static const int MAX_PATH_POLYS = 256;
+static const int MAX_STRAIGHT_PATH = 256;
+static const int MAX_QUERY_NODES = 2048;
+static const int MAX_PATH_REQUESTS = 4096;
+static const int HPA_CLUSTER_TILES = 4;
+static const int LANDMARK_COUNT = 8;
+static const int FLOW_FIELD_CACHE_SIZE = 8;
+static const int FLOW_FIELD_GOAL_RADIUS = 2;
+static const int MAX_CROWD_AGENTS = 5000;
+static const char* HEIGHTFIELD_CACHE_DIRECTORY = "navcache";
+static const unsigned int NO_SPAN_POLY = 0xffffffff;
+static const float ROAD_AREA_COST = 0.5f;
+static const float WATER_AREA_COST = 4.0f;
+static const int CHUNKY_TRIS_PER_CHUNK = 256;
+static const char* NAVSTAGE_NAMES[NAVSTAGE_COUNT] = {"Rasterize", "Heightfield", "Walkable filter", "Regions", "Connections", "Contours",
+                                                     "Polymesh"};
+
+NavigationSystem::NavigationSystem() : m_InputGeometry(), m_NavMesh()
 {
     std::cout << "NavigationSystem initialized." << std::endl;
     m_AgentHeight = 2.0f;
     m_AgentRadius = 0.6f;
     m_MaxClimb = 0.9f;
+    m_TileSize = 16;
+    m_CellSize = 1.0f;
+    m_CellHeight = 1.0f;
+    m_HeightField.width = 0;
+    m_HeightField.depth = 0;
+    m_HeightField.spans = nullptr;
+    for (int stage = 0; stage < NAVSTAGE_COUNT; ++stage)
+        m_StageKeys[stage] = 0;
+    m_ChunkyTriMeshKey = 0;
     m_DebugTools = new NavigationSystemDebugTools();
+    m_NavQuery = new NavMeshQuery();
+    m_BatchQuery = new NavMeshBatchQuery();
+    m_JobSystem = new JobSystem();
+    m_LandmarksEnabled = false;
+    m_NavMeshFile = nullptr;
+    m_HeightFieldCache.SetDirectory(HEIGHTFIELD_CACHE_DIRECTORY);
+    m_QueryFilter.SetAreaCost(NAVAREA_ROAD, ROAD_AREA_COST);
+    m_QueryFilter.SetAreaCost(NAVAREA_WATER, WATER_AREA_COST);
 }
 
 NavigationSystem::~NavigationSystem()
 {
     delete m_DebugTools;
     m_DebugTools = nullptr;
+    delete m_NavQuery;
+    m_NavQuery = nullptr;
+    delete m_BatchQuery;
+    m_BatchQuery = nullptr;
+    delete m_JobSystem;
+    m_JobSystem = nullptr;
+    delete m_NavMeshFile;
+    m_NavMeshFile = nullptr;
     if (m_HeightField.spans)
     {
         delete[] m_HeightField.spans;
@@ -25,159 +74,1012 @@ NavigationSystem::~NavigationSystem()
 void NavigationSystem::BuildNavMesh(const Scene& scene)
 {
     std::cout << "Building NavMesh from scene..." << std::endl;
-    m_InputTriangles.clear();
-    const auto& objects = scene.GetObjects();
-
-    for (const auto& obj : objects)
+    m_InputGeometry.Clear();
+    for (const auto& obj : scene.GetObjects())
     {
         if (!obj.mesh)
             continue;
-        const glm::mat4& modelMatrix = obj.modelMatrix;
         const MeshData* mesh = obj.mesh;
+        AppendNavInputMesh(m_InputGeometry, mesh->vertices.data(), (int)mesh->vertices.size(), mesh->indices.data(), (int)mesh->indices.size(),
+                           obj.modelMatrix, obj.navArea);
+    }
+    std::cout << "Collected " << m_InputGeometry.GetTriangleCount() << " triangles over " << m_InputGeometry.verts.size() << " vertices for NavMesh."
+              << std::endl;
+
+    // Each stage is keyed by the key of the stage before it and the config fields it reads, a stage whose
+    // key is unchanged keeps its output from the last build.
+    uint64_t keys[NAVSTAGE_COUNT];
+    uint64_t key = HeightFieldCache::Hash(m_InputGeometry.verts.data(), m_InputGeometry.verts.size() * sizeof(glm::vec3));
+    key = HeightFieldCache::Hash(m_InputGeometry.indices.data(), m_InputGeometry.indices.size() * sizeof(unsigned int), key);
+    if (key != m_ChunkyTriMeshKey)
+    {
+        const auto begin = std::chrono::high_resolution_clock::now();
+        m_ChunkyTriMesh.Build(m_InputGeometry, CHUNKY_TRIS_PER_CHUNK, m_JobSystem);
+        m_ChunkyTriMeshKey = key;
+        std::cout << "Chunky mesh built with " << m_ChunkyTriMesh.GetChunkCount() << " chunks, "
+                  << std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - begin).count() << " ms." << std::endl;
+    }
+    key = HeightFieldCache::Hash(&m_CellSize, sizeof(float), key);
+    keys[NAVSTAGE_RASTERIZE] = HeightFieldCache::Hash(&m_CellHeight, sizeof(float), key);
+    keys[NAVSTAGE_HEIGHTFIELD] = keys[NAVSTAGE_RASTERIZE];
+    // Erosion runs with the walkable filter and follows the surface within the climb, so the filter reads all three agent fields.
+    key = HeightFieldCache::Hash(&m_AgentHeight, sizeof(float), keys[NAVSTAGE_HEIGHTFIELD]);
+    key = HeightFieldCache::Hash(&m_AgentRadius, sizeof(float), key);
+    key = HeightFieldCache::Hash(&m_MaxClimb, sizeof(float), key);
+    // Areas are marked with the filter, rasterization does not depend on them.
+    key = HeightFieldCache::Hash(m_InputGeometry.areas.data(), m_InputGeometry.areas.size(), key);
+    for (const NavConvexVolume& volume : m_ConvexVolumes)
+    {
+        key = HeightFieldCache::Hash(volume.verts.data(), volume.verts.size() * sizeof(glm::vec3), key);
+        key = HeightFieldCache::Hash(&volume.hmin, sizeof(float), key);
+        key = HeightFieldCache::Hash(&volume.hmax, sizeof(float), key);
+        key = HeightFieldCache::Hash(&volume.area, sizeof(unsigned char), key);
+    }
+    keys[NAVSTAGE_FILTER] = key;
+    keys[NAVSTAGE_REGIONS] = HeightFieldCache::Hash(&m_MaxClimb, sizeof(float), keys[NAVSTAGE_FILTER]);
+    keys[NAVSTAGE_CONNECTIONS] = keys[NAVSTAGE_REGIONS];
+    keys[NAVSTAGE_CONTOURS] = keys[NAVSTAGE_CONNECTIONS];
+    key = HeightFieldCache::Hash(&m_TileSize, sizeof(int), keys[NAVSTAGE_CONTOURS]);
+    for (const NavOffMeshConnection& connection : m_OffMeshConnections)
+    {
+        key = HeightFieldCache::Hash(&connection.start, sizeof(glm::vec3), key);
+        key = HeightFieldCache::Hash(&connection.end, sizeof(glm::vec3), key);
+        key = HeightFieldCache::Hash(&connection.radius, sizeof(float), key);
+        key = HeightFieldCache::Hash(&connection.cost, sizeof(float), key);
+        key = HeightFieldCache::Hash(&connection.area, sizeof(unsigned char), key);
+        key = HeightFieldCache::Hash(&connection.bidirectional, sizeof(bool), key);
+    }
+    keys[NAVSTAGE_POLYMESH] = key;
+
+    int firstStage = 0;
+    while (firstStage < NAVSTAGE_COUNT && keys[firstStage] == m_StageKeys[firstStage])
+        firstStage++;
+    if (firstStage == NAVSTAGE_COUNT)
+    {
+        std::cout << "NavMesh is up to date." << std::endl;
+        return;
+    }
 
-        for (size_t i = 0; i < mesh->indices.size() / 3; ++i)
+    for (int stage = firstStage; stage < NAVSTAGE_COUNT; ++stage)
+    {
+        auto begin = std::chrono::high_resolution_clock::now();
+        switch (stage)
         {
-            unsigned int idx0 = mesh->indices[i * 3];
-            unsigned int idx1 = mesh->indices[i * 3 + 1];
-            unsigned int idx2 = mesh->indices[i * 3 + 2];
-
-            const Vec3f& local_v0 = mesh->vertices[idx0];
-            const Vec3f& local_v1 = mesh->vertices[idx1];
-            const Vec3f& local_v2 = mesh->vertices[idx2];
-
-            glm::vec4 world_v0 = modelMatrix * glm::vec4(local_v0.x, local_v0.y, local_v0.z, 1.0f);
-            glm::vec4 world_v1 = modelMatrix * glm::vec4(local_v1.x, local_v1.y, local_v1.z, 1.0f);
-            glm::vec4 world_v2 = modelMatrix * glm::vec4(local_v2.x, local_v2.y, local_v2.z, 1.0f);
-
-            Triangle tri;
-            tri.verts[0] = { world_v0.x, world_v0.y, world_v0.z };
-            tri.verts[1] = { world_v1.x, world_v1.y, world_v1.z };
-            tri.verts[2] = { world_v2.x, world_v2.y, world_v2.z };
-            m_InputTriangles.push_back(tri);
+        case NAVSTAGE_RASTERIZE: Voxelize(); break;
+        case NAVSTAGE_HEIGHTFIELD: BuildHeightField(); break;
+        case NAVSTAGE_FILTER: FilterWalkableSurfaces(); break;
+        case NAVSTAGE_REGIONS: BuldRegions(); break;
+        case NAVSTAGE_CONNECTIONS: BuildConnections(); break;
+        case NAVSTAGE_CONTOURS: BuildContours(); break;
+        case NAVSTAGE_POLYMESH: BuildPolyMesh(); break;
         }
+        m_StageKeys[stage] = keys[stage];
+        std::cout << "  " << NAVSTAGE_NAMES[stage] << ": "
+                  << std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - begin).count() << " ms" << std::endl;
     }
-    std::cout << "Collected " << m_InputTriangles.size() << " triangles for NavMesh." << std::endl;
-    Voxelize();
-    BuildHeightField();
-    FilterWalkableSurfaces();
-    BuldRegions();
-    BuildConnections();
-    BuildContours();
+    std::cout << "Reran " << NAVSTAGE_COUNT - firstStage << " of " << NAVSTAGE_COUNT << " stages from " << NAVSTAGE_NAMES[firstStage] << "."
+              << std::endl;
+    delete m_NavMeshFile;
+    m_NavMeshFile = nullptr;
+    m_NavMeshStreamer.Close();
+
+    // The layers keep the filtered areas, obstacles that are still placed get stamped into the new tiles.
+    const int walkableClimb = m_MaxClimb > 0 ? (int)floorf(m_MaxClimb / m_HeightField.cellHeight) : 0;
+    m_TileCache.Init(m_HeightField, m_WalkableAreas, m_TileSize, walkableClimb);
+    m_TileCache.Update(m_HeightField, m_NavMesh, m_SpanPolys, m_RebuiltTiles);
+
+    InitNavMeshQueries();
+    m_SpanPathfinder.Init(&m_HeightField);
+    m_FlowFields.Init(&m_HeightField, m_TileSize, FLOW_FIELD_CACHE_SIZE, FLOW_FIELD_GOAL_RADIUS);
+    m_HeightFieldPyramid.Init(&m_HeightField, m_TileSize);
 
     if (m_DebugTools)
-        m_DebugTools->UpdateDebugBuffers(m_InputTriangles);
+        m_DebugTools->UpdateDebugBuffers(m_InputGeometry);
+}
+
+NavBuildConfig NavigationSystem::GetBuildConfig() const
+{
+    NavBuildConfig config;
+    config.cellSize = m_CellSize;
+    config.cellHeight = m_CellHeight;
+    config.agentHeight = m_AgentHeight;
+    config.agentRadius = m_AgentRadius;
+    config.maxClimb = m_MaxClimb;
+    config.tileSize = m_TileSize;
+    return config;
+}
+
+// Takes effect on the next BuildNavMesh, which reruns the stages that read a changed field.
+void NavigationSystem::SetBuildConfig(const NavBuildConfig& config)
+{
+    m_CellSize = std::max(config.cellSize, 0.1f);
+    m_CellHeight = std::max(config.cellHeight, 0.1f);
+    m_AgentHeight = std::max(config.agentHeight, 0.0f);
+    m_AgentRadius = std::max(config.agentRadius, 0.1f); // Query extents and the crowd grid scale with it
+    m_MaxClimb = std::max(config.maxClimb, 0.0f);
+    m_TileSize = std::max(config.tileSize, 1);
+}
+
+bool NavigationSystem::SaveNavMesh(const char* path) const
+{
+    if (m_NavMesh.tiles.empty() || !::SaveNavMesh(m_NavMesh, path))
+        return false;
+    std::cout << "Saved NavMesh with " << m_NavMesh.GetPolyCount() << " polys to " << path << "." << std::endl;
+    return true;
+}
+
+// The tiles are used in place in the mapped file. Queries on the heightfield keep the field of the last build.
+bool NavigationSystem::LoadNavMesh(const char* path)
+{
+    MappedFile* file = new MappedFile();
+    NavMesh loaded;
+    if (!file->Open(path) || !::LoadNavMesh(*file, loaded))
+    {
+        std::cout << "LoadNavMesh: could not load " << path << "." << std::endl;
+        delete file;
+        return false;
+    }
+    m_NavMeshStreamer.Close();
+    m_NavMesh = std::move(loaded);
+    delete m_NavMeshFile;
+    m_NavMeshFile = file;
+    m_TileSize = m_NavMesh.tileSize;
+    m_StageKeys[NAVSTAGE_POLYMESH] = 0;
+    m_TileCache.Clear(); // The layers belong to the built heightfield, not to the loaded tiles
+
+    InitNavMeshQueries();
+    std::cout << "Loaded NavMesh with " << m_NavMesh.GetPolyCount() << " polys in " << m_NavMesh.tiles.size() << " tiles from " << path
+              << "." << std::endl;
+    return true;
+}
+
+// Starts with every tile unloaded, UpdateNavMeshStreaming brings in the ones around the focus points.
+bool NavigationSystem::StartNavMeshStreaming(const char* path)
+{
+    NavMesh streamed;
+    if (!m_NavMeshStreamer.Open(path, streamed))
+        return false;
+    m_NavMesh = std::move(streamed);
+    delete m_NavMeshFile;
+    m_NavMeshFile = nullptr;
+    m_TileSize = m_NavMesh.tileSize;
+    m_StageKeys[NAVSTAGE_POLYMESH] = 0;
+    m_TileCache.Clear();
+
+    InitNavMeshQueries();
+    std::cout << "Streaming NavMesh with " << m_NavMesh.tiles.size() << " tiles from " << path << ", budget " << (m_NavMeshStreamer.GetMemoryBudget() >> 10)
+              << " KB." << std::endl;
+    return true;
+}
+
+void NavigationSystem::UpdateNavMeshStreaming(const std::vector<glm::vec3>& focusPoints)
+{
+    if (!m_NavMeshStreamer.IsOpen())
+        return;
+    m_NavMeshStreamer.Update(m_NavMesh, focusPoints.data(), (int)focusPoints.size(), m_RebuiltTiles);
+    for (int tileIndex : m_RebuiltTiles)
+        OnTileRebuilt(tileIndex);
+}
+
+// Everything derived from the polymesh alone, shared by building and loading.
+void NavigationSystem::InitNavMeshQueries()
+{
+    m_NavMeshIslands.Build(m_NavMesh);
+    m_NavQuery->Init(&m_NavMesh, MAX_QUERY_NODES);
+    m_NavQuery->SetIslands(&m_NavMeshIslands);
+    m_BatchQuery->Init(&m_NavMesh, MAX_QUERY_NODES, m_JobSystem);
+    m_BatchQuery->SetIslands(&m_NavMeshIslands);
+    m_PathRequests.Init(&m_NavMesh, MAX_QUERY_NODES, MAX_PATH_REQUESTS, MAX_STRAIGHT_PATH);
+    m_PathRequests.SetIslands(&m_NavMeshIslands);
+    SetLandmarksEnabled(m_LandmarksEnabled);
+    m_QueuedPathRequests.clear();
+    m_HierarchicalPathfinder.Init(&m_NavMesh, HPA_CLUSTER_TILES, MAX_QUERY_NODES);
+    m_HierarchicalPathfinder.Build();
+    m_Crowd.Init(&m_NavMesh, m_JobSystem, MAX_CROWD_AGENTS, m_AgentRadius, MAX_QUERY_NODES);
+    SetQueryFilter(m_QueryFilter);
+    m_DebugPath.clear();
+}
+
+void NavigationSystem::SetQueryFilter(const NavQueryFilter& filter)
+{
+    m_QueryFilter = filter;
+    m_BatchQuery->SetDefaultFilter(m_QueryFilter);
+    m_PathRequests.SetDefaultFilter(m_QueryFilter);
+    m_Crowd.SetFilter(m_QueryFilter);
+}
+
+bool NavigationSystem::FindPath(const glm::vec3& start, const glm::vec3& end, std::vector<glm::vec3>& outPath)
+{
+    outPath.clear();
+    m_DebugPath.clear();
+    if (m_NavMesh.tiles.empty())
+        return false;
+
+    const glm::vec3 halfExtents(m_AgentRadius * 2.0f, m_AgentHeight, m_AgentRadius * 2.0f);
+    const NavQueryFilter& filter = m_QueryFilter;
+    NavPolyRef startRef, endRef;
+    glm::vec3 startPos, endPos;
+    m_NavQuery->FindNearestPoly(start, halfExtents, filter, startRef, startPos);
+    m_NavQuery->FindNearestPoly(end, halfExtents, filter, endRef, endPos);
+    if (!startRef || !endRef)
+    {
+        std::cout << "FindPath: start or end is not on the navmesh." << std::endl;
+        return false;
+    }
+    if (!m_NavMeshIslands.AreConnected(startRef, endRef))
+    {
+        std::cout << "FindPath: end is not reachable from start." << std::endl;
+        return false;
+    }
+
+    NavPolyRef polys[MAX_PATH_POLYS];
+    int polyCount = 0;
+    if (m_NavQuery->FindPath(startRef, endRef, startPos, endPos, filter, polys, polyCount, MAX_PATH_POLYS) == NAVQUERY_FAILURE)
+        return false;
+
+    glm::vec3 straightPath[MAX_STRAIGHT_PATH];
+    int straightPathCount = 0;
+    m_NavQuery->FindStraightPath(startPos, endPos, polys, polyCount, straightPath, straightPathCount, MAX_STRAIGHT_PATH);
+
+    outPath.assign(straightPath, straightPath + straightPathCount);
+    m_DebugPath = outPath;
+    std::cout << "FindPath: " << polyCount << " polys, " << straightPathCount << " corners." << std::endl;
+    return straightPathCount > 0;
+}
+
+bool NavigationSystem::ArePointsConnected(const glm::vec3& a, const glm::vec3& b)
+{
+    const glm::vec3 halfExtents(m_AgentRadius * 2.0f, m_AgentHeight, m_AgentRadius * 2.0f);
+    const NavQueryFilter& filter = m_QueryFilter;
+    NavPolyRef refA, refB;
+    glm::vec3 pointA, pointB;
+    m_NavQuery->FindNearestPoly(a, halfExtents, filter, refA, pointA);
+    m_NavQuery->FindNearestPoly(b, halfExtents, filter, refB, pointB);
+    return m_NavMeshIslands.AreConnected(refA, refB);
+}
+
+void NavigationSystem::SetLandmarksEnabled(bool enabled)
+{
+    m_LandmarksEnabled = enabled;
+    if (enabled)
+    {
+        m_NavMeshLandmarks.Build(m_NavMesh, LANDMARK_COUNT);
+        std::cout << "Built " << m_NavMeshLandmarks.GetLandmarkCount() << " landmarks, "
+                  << m_NavMeshLandmarks.GetMemoryBytes() / 1024 << " KB." << std::endl;
+    }
+    else
+    {
+        m_NavMeshLandmarks.Clear();
+    }
+
+    const NavMeshLandmarks* landmarks = enabled ? &m_NavMeshLandmarks : nullptr;
+    m_NavQuery->SetLandmarks(landmarks);
+    m_BatchQuery->SetLandmarks(landmarks);
+    m_PathRequests.SetLandmarks(landmarks);
+}
+
+bool NavigationSystem::FindHierarchicalPath(const glm::vec3& start, const glm::vec3& end, std::vector<glm::vec3>& outPath)
+{
+    outPath.clear();
+    m_DebugPath.clear();
+    if (m_NavMesh.tiles.empty())
+        return false;
+
+    const glm::vec3 halfExtents(m_AgentRadius * 2.0f, m_AgentHeight, m_AgentRadius * 2.0f);
+    const NavQueryFilter& filter = m_QueryFilter;
+    NavPolyRef startRef, endRef;
+    glm::vec3 startPos, endPos;
+    m_NavQuery->FindNearestPoly(start, halfExtents, filter, startRef, startPos);
+    m_NavQuery->FindNearestPoly(end, halfExtents, filter, endRef, endPos);
+    if (!startRef || !endRef)
+    {
+        std::cout << "FindHierarchicalPath: start or end is not on the navmesh." << std::endl;
+        return false;
+    }
+    if (!m_NavMeshIslands.AreConnected(startRef, endRef))
+    {
+        std::cout << "FindHierarchicalPath: end is not reachable from start." << std::endl;
+        return false;
+    }
+
+    NavPolyRef polys[MAX_PATH_POLYS];
+    int polyCount = 0;
+    if (m_HierarchicalPathfinder.FindPath(startRef, endRef, startPos, endPos, filter, polys, polyCount, MAX_PATH_POLYS) == NAVQUERY_FAILURE)
+        return false;
+
+    glm::vec3 straightPath[MAX_STRAIGHT_PATH];
+    int straightPathCount = 0;
+    m_NavQuery->FindStraightPath(startPos, endPos, polys, polyCount, straightPath, straightPathCount, MAX_STRAIGHT_PATH);
+
+    outPath.assign(straightPath, straightPath + straightPathCount);
+    m_DebugPath = outPath;
+    std::cout << "FindHierarchicalPath: " << m_HierarchicalPathfinder.GetLastAbstractExpansions() << " entrances and "
+              << m_HierarchicalPathfinder.GetLastRefineExpansions() << " polys expanded, " << straightPathCount << " corners." << std::endl;
+    return straightPathCount > 0;
+}
+
+void NavigationSystem::FindPaths(NavPathBatch& batch)
+{
+    if (m_NavMesh.tiles.empty())
+        return;
+    batch.halfExtents = glm::vec3(m_AgentRadius * 2.0f, m_AgentHeight, m_AgentRadius * 2.0f);
+    m_BatchQuery->Run(batch);
+}
+
+PathRequestHandle NavigationSystem::RequestPath(const glm::vec3& start, const glm::vec3& end)
+{
+    const glm::vec3 halfExtents(m_AgentRadius * 2.0f, m_AgentHeight, m_AgentRadius * 2.0f);
+    const PathRequestHandle handle = m_PathRequests.RequestPath(start, end, halfExtents, &m_QueryFilter);
+    if (handle)
+        m_QueuedPathRequests.push_back(handle);
+    return handle;
+}
+
+void NavigationSystem::RequestRandomPaths(int count)
+{
+    std::vector<glm::vec3> centers;
+    for (const auto& tile : m_NavMesh.tiles)
+        for (const auto& poly : tile.polys)
+            if (poly.type == NAVPOLYTYPE_GROUND)
+                centers.push_back((poly.bmin + poly.bmax) * 0.5f);
+    if (centers.empty())
+        return;
+
+    for (int i = 0; i < count; ++i)
+    {
+        if (!RequestPath(centers[rand() % centers.size()], centers[rand() % centers.size()]))
+        {
+            std::cout << "RequestRandomPaths: request queue is full after " << i << " requests." << std::endl;
+            break;
+        }
+    }
+}
+
+void NavigationSystem::UpdatePathRequests(float budgetMicroseconds, const glm::vec3& focusPoint)
+{
+    m_PathRequests.SetFocusPoint(focusPoint);
+    m_PathRequests.Update(budgetMicroseconds);
+
+    // Keep the latest finished path for debug drawing.
+    size_t kept = 0;
+    for (size_t i = 0; i < m_QueuedPathRequests.size(); ++i)
+    {
+        const PathRequestHandle handle = m_QueuedPathRequests[i];
+        const PathRequestState state = m_PathRequests.GetRequestState(handle);
+        if (state == PATHREQUEST_PENDING || state == PATHREQUEST_WORKING)
+        {
+            m_QueuedPathRequests[kept++] = handle;
+            continue;
+        }
+        std::vector<glm::vec3> corners;
+        NavQueryStatus status;
+        if (m_PathRequests.GetPathResult(handle, corners, status) && status != NAVQUERY_FAILURE)
+            m_DebugPath = corners;
+    }
+    m_QueuedPathRequests.resize(kept);
+}
+
+bool NavigationSystem::FindSpanPath(const glm::vec3& start, const glm::vec3& end, std::vector<glm::vec3>& outPath)
+{
+    outPath.clear();
+    m_DebugPath.clear();
+
+    const unsigned int startSpan = m_SpanPathfinder.FindSpan(start, m_AgentHeight);
+    const unsigned int endSpan = m_SpanPathfinder.FindSpan(end, m_AgentHeight);
+    if (startSpan == NAV_NULL_SPAN || endSpan == NAV_NULL_SPAN)
+    {
+        std::cout << "FindSpanPath: start or end is not on a walkable span." << std::endl;
+        return false;
+    }
+
+    unsigned int jumpPoints[MAX_STRAIGHT_PATH];
+    int jumpPointCount = 0;
+    const bool found = m_SpanPathfinder.FindPath(startSpan, endSpan, jumpPoints, jumpPointCount, MAX_STRAIGHT_PATH);
+    for (int i = 0; i < jumpPointCount; ++i)
+        outPath.push_back(m_SpanPathfinder.GetSpanPosition(jumpPoints[i]));
+
+    m_DebugPath = outPath;
+    std::cout << "FindSpanPath: " << jumpPointCount << " jump points, " << m_SpanPathfinder.GetExpandedNodes() << " nodes expanded." << std::endl;
+    return found;
+}
+
+glm::vec3 NavigationSystem::SampleFlowField(const glm::vec3& goal, const glm::vec3& pos)
+{
+    const int field = m_FlowFields.AcquireField(m_SpanPathfinder.FindSpan(goal, m_AgentHeight));
+    const unsigned int span = m_SpanPathfinder.FindSpan(pos, m_AgentHeight);
+    if (field < 0 || span == NAV_NULL_SPAN)
+        return glm::vec3(0.0f);
+    return FlowFieldCache::GetDirectionVector(m_FlowFields.GetDirection(field, span));
+}
+
+bool NavigationSystem::FindFlowFieldPath(const glm::vec3& start, const glm::vec3& goal, std::vector<glm::vec3>& outPath)
+{
+    outPath.clear();
+    m_DebugPath.clear();
+
+    const unsigned int startSpan = m_SpanPathfinder.FindSpan(start, m_AgentHeight);
+    const int field = m_FlowFields.AcquireField(m_SpanPathfinder.FindSpan(goal, m_AgentHeight));
+    if (startSpan == NAV_NULL_SPAN || field < 0)
+    {
+        std::cout << "FindFlowFieldPath: start or goal is not on a walkable span." << std::endl;
+        return false;
+    }
+
+    std::vector<unsigned int> spans(m_HeightField.width * m_HeightField.depth);
+    const int spanCount = m_FlowFields.TracePath(field, startSpan, spans.data(), (int)spans.size());
+    const bool found = m_FlowFields.GetDirection(field, spans[spanCount - 1]) == FLOW_DIRECTION_GOAL;
+    for (int i = 0; i < spanCount; ++i)
+        outPath.push_back(m_SpanPathfinder.GetSpanPosition(spans[i]));
+
+    m_DebugPath = outPath;
+    std::cout << "FindFlowFieldPath: " << spanCount << " spans, " << m_FlowFields.GetComputedTileCount(field) << " of "
+              << m_FlowFields.GetTileCount() << " tiles computed, " << m_FlowFields.GetMemoryBytes() / 1024 << " KB cached." << std::endl;
+    return found;
+}
+
+void NavigationSystem::SpawnCrowdAgents(int count)
+{
+    std::vector<const NavPoly*> polys;
+    for (const auto& tile : m_NavMesh.tiles)
+        for (const auto& poly : tile.polys)
+            if (poly.type == NAVPOLYTYPE_GROUND)
+                polys.push_back(&poly);
+    if (polys.empty())
+        return;
+    auto randomPoint = [&polys]()
+    {
+        const NavPoly* poly = polys[rand() % polys.size()];
+        const float u = (float)rand() / RAND_MAX, v = (float)rand() / RAND_MAX;
+        return glm::vec3(poly->bmin.x + (poly->bmax.x - poly->bmin.x) * u, poly->bmin.y, poly->bmin.z + (poly->bmax.z - poly->bmin.z) * v);
+    };
+
+    CrowdAgentParams params;
+    params.radius = m_AgentRadius;
+    params.maxSpeed = 3.5f;
+    params.maxAcceleration = 8.0f;
+    int spawned = 0;
+    for (int i = 0; i < count; ++i)
+    {
+        const int agent = m_Crowd.AddAgent(randomPoint(), params);
+        if (agent < 0)
+            break;
+        m_Crowd.RequestMoveTarget(agent, randomPoint());
+        spawned++;
+    }
+    std::cout << "SpawnCrowdAgents: " << spawned << " agents spawned, " << m_Crowd.GetActiveAgentCount() << " active." << std::endl;
+}
+
+void NavigationSystem::SetCrowdTarget(const glm::vec3& target)
+{
+    int accepted = 0;
+    for (int i = 0; i < m_Crowd.GetMaxAgents(); ++i)
+        if (m_Crowd.IsAgentActive(i) && m_Crowd.RequestMoveTarget(i, target))
+            accepted++;
+    std::cout << "SetCrowdTarget: " << accepted << " agents moving." << std::endl;
+}
+
+void NavigationSystem::UpdateCrowd(float dt)
+{
+    m_Crowd.Update(dt);
+}
+
+bool NavigationSystem::HasLineOfSight(const glm::vec3& from, const glm::vec3& to)
+{
+    if (!m_NavMesh.tiles.empty())
+    {
+        const glm::vec3 halfExtents(m_AgentRadius * 2.0f, m_AgentHeight, m_AgentRadius * 2.0f);
+        const NavQueryFilter& filter = m_QueryFilter;
+        NavPolyRef startRef;
+        glm::vec3 startPos;
+        m_NavQuery->FindNearestPoly(from, halfExtents, filter, startRef, startPos);
+        if (startRef)
+        {
+            float t;
+            glm::vec3 hitNormal;
+            int pathCount = 0;
+            m_NavQuery->Raycast(startRef, startPos, to, filter, t, hitNormal, nullptr, pathCount, 0);
+            return t == FLT_MAX;
+        }
+    }
+    m_HeightFieldPyramid.RebuildDirtyTiles();
+    return m_HeightFieldPyramid.HasLineOfSight(from, to);
+}
+
+bool NavigationSystem::IsBoxObstructed(const glm::vec3& bmin, const glm::vec3& bmax)
+{
+    m_HeightFieldPyramid.RebuildDirtyTiles();
+    return m_HeightFieldPyramid.IsBoxObstructed(bmin, bmax);
+}
+
+bool NavigationSystem::FindSurfaceBelow(const glm::vec3& pos, float radius, float& height)
+{
+    m_HeightFieldPyramid.RebuildDirtyTiles();
+    return m_HeightFieldPyramid.FindSurfaceBelow(pos, radius, height);
+}
+
+NavObstacleRef NavigationSystem::AddCylinderObstacle(const glm::vec3& baseCenter, float radius, float height)
+{
+    return m_TileCache.AddCylinderObstacle(baseCenter, radius, height);
+}
+
+NavObstacleRef NavigationSystem::AddBoxObstacle(const glm::vec3& bmin, const glm::vec3& bmax)
+{
+    return m_TileCache.AddBoxObstacle(bmin, bmax);
+}
+
+NavObstacleRef NavigationSystem::AddOrientedBoxObstacle(const glm::vec3& center, const glm::vec3& halfExtents, float yRotation)
+{
+    return m_TileCache.AddOrientedBoxObstacle(center, halfExtents, yRotation);
+}
+
+bool NavigationSystem::RemoveObstacle(NavObstacleRef ref)
+{
+    return m_TileCache.RemoveObstacle(ref);
+}
+
+void NavigationSystem::RemoveAllObstacles()
+{
+    m_TileCache.RemoveAllObstacles();
+}
+
+void NavigationSystem::AddRandomObstacles(int count)
+{
+    std::vector<const NavPoly*> polys;
+    for (const auto& tile : m_NavMesh.tiles)
+        for (const auto& poly : tile.polys)
+            if (poly.type == NAVPOLYTYPE_GROUND)
+                polys.push_back(&poly);
+    if (polys.empty())
+        return;
+
+    int added = 0;
+    for (int i = 0; i < count; ++i)
+    {
+        const NavPoly* poly = polys[rand() % polys.size()];
+        const float u = (float)rand() / RAND_MAX, v = (float)rand() / RAND_MAX;
+        const glm::vec3 pos(poly->bmin.x + (poly->bmax.x - poly->bmin.x) * u, poly->bmin.y, poly->bmin.z + (poly->bmax.z - poly->bmin.z) * v);
+        const float size = 0.5f + (float)rand() / RAND_MAX;
+        NavObstacleRef ref = 0;
+        switch (i % 3)
+        {
+        case 0: ref = AddCylinderObstacle(pos, size, 2.0f); break;
+        case 1: ref = AddBoxObstacle(pos - glm::vec3(size, 0.0f, size), pos + glm::vec3(size, 2.0f, size)); break;
+        case 2: ref = AddOrientedBoxObstacle(pos + glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(size * 2.0f, 1.0f, size * 0.5f), (float)rand() / RAND_MAX * 3.14159f); break;
+        }
+        if (ref)
+            added++;
+    }
+    std::cout << "AddRandomObstacles: " << added << " obstacles added, " << m_TileCache.GetObstacleCount() << " placed." << std::endl;
+}
+
+void NavigationSystem::UpdateObstacles()
+{
+    if (!m_TileCache.HasDirtyTiles())
+        return;
+
+    auto begin = std::chrono::high_resolution_clock::now();
+    const int rebuilt = m_TileCache.Update(m_HeightField, m_NavMesh, m_SpanPolys, m_RebuiltTiles);
+    for (int tileIndex : m_RebuiltTiles)
+        OnTileRebuilt(tileIndex);
+    const double navMeshMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - begin).count();
+    // The span graph queries have no per tile update, their tables are rebuilt from the changed areas.
+    m_SpanPathfinder.Init(&m_HeightField);
+    m_FlowFields.Init(&m_HeightField, m_TileSize, FLOW_FIELD_CACHE_SIZE, FLOW_FIELD_GOAL_RADIUS);
+    std::cout << "UpdateObstacles: " << rebuilt << " tiles rebuilt, " << m_RebuiltTiles.size() << " relinked in " << navMeshMs
+              << " ms, span graph " << std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - begin).count() - navMeshMs
+              << " ms." << std::endl;
+}
+
+void NavigationSystem::RunQueryBenchmark(int numQueries)
+{
+    NavigationSystemBenchmarks::RunQueryBenchmark(m_NavMesh, numQueries);
+}
+
+void NavigationSystem::RunSpanPathBenchmark(int numQueries)
+{
+    NavigationSystemBenchmarks::RunSpanPathBenchmark(m_HeightField, numQueries);
+}
+
+void NavigationSystem::RunBVTreeBenchmark(int numQueries)
+{
+    NavigationSystemBenchmarks::RunBVTreeBenchmark(m_NavMesh, numQueries);
+}
+
+void NavigationSystem::RunBatchQueryBenchmark(int numQueries)
+{
+    NavigationSystemBenchmarks::RunBatchQueryBenchmark(m_NavMesh, *m_JobSystem, numQueries);
+}
+
+void NavigationSystem::RunHierarchicalPathBenchmark(int numQueries)
+{
+    NavigationSystemBenchmarks::RunHierarchicalPathBenchmark(numQueries);
+}
+
+void NavigationSystem::RunFlowFieldBenchmark(int numAgents)
+{
+    NavigationSystemBenchmarks::RunFlowFieldBenchmark(numAgents);
+}
+
+void NavigationSystem::RunCrowdBenchmark(int numAgents)
+{
+    NavigationSystemBenchmarks::RunCrowdBenchmark(*m_JobSystem, numAgents, 300);
+}
+
+void NavigationSystem::RunPathCorridorBenchmark(int numAgents)
+{
+    NavigationSystemBenchmarks::RunPathCorridorBenchmark(numAgents, 300);
+}
+
+void NavigationSystem::RunRaycastBenchmark(int numRays)
+{
+    NavigationSystemBenchmarks::RunRaycastBenchmark(numRays);
+}
+
+void NavigationSystem::RunHeightPyramidBenchmark(int numQueries)
+{
+    NavigationSystemBenchmarks::RunHeightPyramidBenchmark(numQueries);
+}
+
+void NavigationSystem::RunNavMeshFileBenchmark()
+{
+    NavigationSystemBenchmarks::RunNavMeshFileBenchmark();
+}
+
+void NavigationSystem::RunTileCacheBenchmark(int numObstacles)
+{
+    NavigationSystemBenchmarks::RunTileCacheBenchmark(numObstacles);
+}
+
+void NavigationSystem::RunCompressionBenchmark()
+{
+    NavigationSystemBenchmarks::RunCompressionBenchmark();
+}
+
+void NavigationSystem::RunStreamingBenchmark()
+{
+    NavigationSystemBenchmarks::RunStreamingBenchmark();
+}
+
+void NavigationSystem::RunAgentProfileBenchmark()
+{
+    NavigationSystemBenchmarks::RunAgentProfileBenchmark(*m_JobSystem);
+}
+
+void NavigationSystem::RunAreaCostBenchmark(int numQueries)
+{
+    NavigationSystemBenchmarks::RunAreaCostBenchmark(numQueries);
+}
+
+void NavigationSystem::RunOffMeshBenchmark(int numConnections)
+{
+    NavigationSystemBenchmarks::RunOffMeshBenchmark(numConnections);
+}
+
+void NavigationSystem::RunChunkyTriMeshBenchmark()
+{
+    NavigationSystemBenchmarks::RunChunkyTriMeshBenchmark(*m_JobSystem);
+}
+
+void NavigationSystem::RunInputGeometryBenchmark(int numObjects)
+{
+    NavigationSystemBenchmarks::RunInputGeometryBenchmark(numObjects);
+}
+
+void NavigationSystem::RunBoxRasterizationBenchmark(int numBoxes)
+{
+    NavigationSystemBenchmarks::RunBoxRasterizationBenchmark(numBoxes);
+}
+
+void NavigationSystem::RunLandmarkBenchmark(int numQueries)
+{
+    NavigationSystemBenchmarks::RunLandmarkBenchmark(numQueries, LANDMARK_COUNT);
 }
 
 void NavigationSystem::RenderDebugData(Camera& camera, Shader* debugShader, const Scene& scene)
 {
     if (m_DebugTools)
-        m_DebugTools->RenderDebugData(camera, debugShader, scene, m_InputTriangles, m_VoxelGrid, m_HeightField, m_ContourSet, m_DebugDrawMode);
+        m_DebugTools->RenderDebugData(camera, debugShader, scene, m_VoxelGrid, m_HeightField, m_ContourSet, m_NavMesh,
+                                      m_DebugPath, m_DebugDrawMode);
 }
 
 void NavigationSystem::Voxelize()
 {
     std::cout << "Voxelization step (placeholder)..." << std::endl;
-    if (m_InputTriangles.empty())
+    if (m_InputGeometry.indices.empty())
     {
         std::cout << "No input triangles to voxelize." << std::endl;
         return;
     }
 
-    m_VoxelGrid.minimumCorner = glm::vec3(-15.0f, -1.0f, -15.0f);
-    m_VoxelGrid.maximumCorner = glm::vec3(15.0f, 10.0f, 15.0f);
-    m_VoxelGrid.cellSize = 1.f;
-    m_VoxelGrid.cellHeight = 1.f;
+    m_VoxelGrid.minimumCorner = glm::vec3(-15.0f, -1.0f, -15.0f);
+    m_VoxelGrid.maximumCorner = glm::vec3(15.0f, 10.0f, 15.0f);
+    m_VoxelGrid.cellSize = m_CellSize;
+    m_VoxelGrid.cellHeight = m_CellHeight;
+
+    if (m_VoxelGrid.minimumCorner.x >= m_VoxelGrid.maximumCorner.x ||
+        m_VoxelGrid.minimumCorner.y >= m_VoxelGrid.maximumCorner.y ||
+        m_VoxelGrid.minimumCorner.z >= m_VoxelGrid.maximumCorner.z ||
+        m_VoxelGrid.cellSize <= 0.0f || m_VoxelGrid.cellHeight <= 0.0f)
+    {
+        std::cout << "Invalid voxel grid parameters." << std::endl;
+        return;
+    }
+
+    m_VoxelGrid.width = (int)((m_VoxelGrid.maximumCorner.x - m_VoxelGrid.minimumCorner.x) / m_VoxelGrid.cellSize);
+    m_VoxelGrid.depth = (int)((m_VoxelGrid.maximumCorner.z - m_VoxelGrid.minimumCorner.z) / m_VoxelGrid.cellSize);
+    m_VoxelGrid.height = (int)((m_VoxelGrid.maximumCorner.y - m_VoxelGrid.minimumCorner.y) / m_VoxelGrid.cellHeight);
+    int totalVoxels = m_VoxelGrid.width * m_VoxelGrid.depth * m_VoxelGrid.height;
+    std::cout << "Voxel Grid Dimensions: " << m_VoxelGrid.width << " x " << m_VoxelGrid.depth << " x " << m_VoxelGrid.height << " = " << totalVoxels << " voxels." << std::endl;
+
+    m_VoxelGrid.data.assign(totalVoxels, false);
+
+    Rasterization();
+}
+
+// Voxel bounds of the triangle clamped to the grid, empty when maxs are below mins.
+static void GetTriangleVoxelBounds(const glm::vec3 tri[3], const VoxelGrid& grid, int mins[3], int maxs[3])
+{
+    const glm::vec3 triMin = glm::min(tri[0], glm::min(tri[1], tri[2]));
+    const glm::vec3 triMax = glm::max(tri[0], glm::max(tri[1], tri[2]));
+
+    mins[0] = std::max(0, (int)((triMin[0] - grid.minimumCorner.x) / grid.cellSize));
+    mins[1] = std::max(0, (int)((triMin[1] - grid.minimumCorner.y) / grid.cellHeight));
+    mins[2] = std::max(0, (int)((triMin[2] - grid.minimumCorner.z) / grid.cellSize));
+
+    maxs[0] = std::min(grid.width - 1, (int)((triMax[0] - grid.minimumCorner.x) / grid.cellSize));
+    maxs[1] = std::min(grid.height - 1, (int)((triMax[1] - grid.minimumCorner.y) / grid.cellHeight));
+    maxs[2] = std::min(grid.depth - 1, (int)((triMax[2] - grid.minimumCorner.z) / grid.cellSize));
+}
+
+// Rasterizes tile by tile. A tile whose triangles and config hash to a key already in the heightfield cache
+// takes its spans from there, other tiles are rasterized and stored.
+void NavigationSystem::Rasterization()
+{
+    auto begin = std::chrono::high_resolution_clock::now();
+    const int tilesX = (m_VoxelGrid.width + m_TileSize - 1) / m_TileSize;
+    const int tilesZ = (m_VoxelGrid.depth + m_TileSize - 1) / m_TileSize;
+
+    uint64_t configKey = HeightFieldCache::Hash(&m_VoxelGrid.minimumCorner, sizeof(glm::vec3));
+    configKey = HeightFieldCache::Hash(&m_VoxelGrid.maximumCorner, sizeof(glm::vec3), configKey);
+    configKey = HeightFieldCache::Hash(&m_VoxelGrid.cellSize, sizeof(float), configKey);
+    configKey = HeightFieldCache::Hash(&m_VoxelGrid.cellHeight, sizeof(float), configKey);
+    configKey = HeightFieldCache::Hash(&m_TileSize, sizeof(int), configKey);
+
+    int solidVoxels = 0, cachedTiles = 0;
+    HeightFieldTileSpans tile;
+    std::vector<int> candidates, triangles;
+    const float cs = m_VoxelGrid.cellSize;
+    for (int tz = 0; tz < tilesZ; ++tz)
+    {
+        for (int tx = 0; tx < tilesX; ++tx)
+        {
+            const int x0 = tx * m_TileSize, z0 = tz * m_TileSize;
+            const int x1 = std::min(x0 + m_TileSize, m_VoxelGrid.width), z1 = std::min(z0 + m_TileSize, m_VoxelGrid.depth);
+            // The chunky mesh narrows the triangles down to the tile's rectangle grown by a cell, the voxel bounds decide.
+            const glm::vec2 qmin(m_VoxelGrid.minimumCorner.x + (x0 - 1) * cs, m_VoxelGrid.minimumCorner.z + (z0 - 1) * cs);
+            const glm::vec2 qmax(m_VoxelGrid.minimumCorner.x + (x1 + 1) * cs, m_VoxelGrid.minimumCorner.z + (z1 + 1) * cs);
+            m_ChunkyTriMesh.QueryTriangles(qmin, qmax, candidates);
+            triangles.clear();
+            for (int i : candidates)
+            {
+                glm::vec3 tri[3];
+                m_InputGeometry.GetTriangle(i, tri);
+                int mins[3], maxs[3];
+                GetTriangleVoxelBounds(tri, m_VoxelGrid, mins, maxs);
+                if (mins[1] <= maxs[1] && mins[0] < x1 && maxs[0] >= x0 && mins[2] < z1 && maxs[2] >= z0)
+                    triangles.push_back(i);
+            }
+            const int tileCoords[2] = { tx, tz };
+            uint64_t key = HeightFieldCache::Hash(tileCoords, sizeof(tileCoords), configKey);
+            for (int i : triangles)
+            {
+                glm::vec3 tri[3];
+                m_InputGeometry.GetTriangle(i, tri);
+                key = HeightFieldCache::Hash(tri, sizeof(tri), key);
+            }
+
+            if (m_HeightFieldCache.Load(key, x1 - x0, z1 - z0, tile))
+            {
+                for (int z = z0; z < z1; ++z)
+                {
+                    for (int x = x0; x < x1; ++x)
+                    {
+                        const int column = (x - x0) + (z - z0) * tile.width;
+                        for (unsigned int s = tile.columnStart[column]; s < tile.columnStart[column + 1]; ++s)
+                            for (int y = (int)tile.spans[s * 2]; y <= std::min((int)tile.spans[s * 2 + 1], m_VoxelGrid.height - 1); ++y)
+                                m_VoxelGrid.data[x + z * m_VoxelGrid.width + y * m_VoxelGrid.width * m_VoxelGrid.depth] = true;
+                    }
+                }
+                cachedTiles++;
+                continue;
+            }
+
+            // Triangles ascend, so a box's triangles come together and it is stamped once.
+            int lastBox = -1;
+            for (int i : triangles)
+            {
+                const int box = m_InputGeometry.FindBox(i);
+                if (box >= 0)
+                {
+                    if (box != lastBox)
+                        RasterizeBox(m_VoxelGrid, m_InputGeometry.boxes[box], x0, z0, x1, z1, solidVoxels);
+                    lastBox = box;
+                    continue;
+                }
+                glm::vec3 tri[3];
+                m_InputGeometry.GetTriangle(i, tri);
+                RasterizeTriangle(m_VoxelGrid, tri, x0, z0, x1, z1, solidVoxels);
+            }
+
+            // Runs of solid voxels per column, the same spans BuildHeightField makes of them.
+            tile.width = x1 - x0;
+            tile.depth = z1 - z0;
+            tile.columnStart.clear();
+            tile.spans.clear();
+            for (int z = z0; z < z1; ++z)
+            {
+                for (int x = x0; x < x1; ++x)
+                {
+                    tile.columnStart.push_back((unsigned int)(tile.spans.size() / 2));
+                    for (int y = 0; y < m_VoxelGrid.height; ++y)
+                    {
+                        if (!m_VoxelGrid.data[x + z * m_VoxelGrid.width + y * m_VoxelGrid.width * m_VoxelGrid.depth])
+                            continue;
+                        const int spanMin = y;
+                        while (y + 1 < m_VoxelGrid.height && m_VoxelGrid.data[x + z * m_VoxelGrid.width + (y + 1) * m_VoxelGrid.width * m_VoxelGrid.depth])
+                            y++;
+                        tile.spans.push_back((unsigned int)spanMin);
+                        tile.spans.push_back((unsigned int)y);
+                    }
+                }
+            }
+            tile.columnStart.push_back((unsigned int)(tile.spans.size() / 2));
+            m_HeightFieldCache.Save(key, tile);
+        }
+    }
+    if (cachedTiles < tilesX * tilesZ)
+        m_HeightFieldCache.Prune();
+    const double milliseconds = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - begin).count();
+    std::cout << "Rasterization complete. Solid voxels: " << solidVoxels << ", " << cachedTiles << " of " << tilesX * tilesZ
+              << " tiles from the heightfield cache, " << milliseconds << " ms." << std::endl;
+}
+
+void NavigationSystem::RasterizeTriangle(VoxelGrid& grid, const glm::vec3 tri[3], int x0, int z0, int x1, int z1, int& solidVoxels)
+{
+    int mins[3], maxs[3];
+    GetTriangleVoxelBounds(tri, grid, mins, maxs);
+    const int minX = std::max(mins[0], x0), minZ = std::max(mins[2], z0);
+    const int maxX = std::min(maxs[0], x1 - 1), maxZ = std::min(maxs[2], z1 - 1);
+
+    for (int z = minZ; z <= maxZ; ++z)
+    {
+        for (int y = mins[1]; y <= maxs[1]; ++y)
+        {
+            for (int x = minX; x <= maxX; ++x)
+            {
+                int index = x + z * grid.width + y * grid.width * grid.depth;
+                if (grid.data[index])
+                    continue;
+
+                float boxcenter[3] = {
+                    grid.minimumCorner.x + (x + 0.5f) * grid.cellSize,
+                    grid.minimumCorner.y + (y + 0.5f) * grid.cellHeight,
+                    grid.minimumCorner.z + (z + 0.5f) * grid.cellSize
+                };
+                float boxhalfsize[3] = {
+                    grid.cellSize * 0.5f,
+                    grid.cellHeight * 0.5f,
+                    grid.cellSize * 0.5f
+                };
+                float triverts[3][3] = {
+                    { tri[0].x, tri[0].y, tri[0].z },
+                    { tri[1].x, tri[1].y, tri[1].z },
+                    { tri[2].x, tri[2].y, tri[2].z }
+                };
+
+                if (TriBoxOverlap(boxcenter, boxhalfsize, triverts))
+                {
+                    grid.data[index] = true;
+                    solidVoxels++;
+                }
+            }
+        }
+    }
+}
+
+// Cells lo..hi an interval covers, truncated like GetTriangleVoxelBounds. False when it misses the grid.
+static bool GetCellRange(float vmin, float vmax, float origin, float size, int count, int& lo, int& hi)
+{
+    const float cmin = (vmin - origin) / size, cmax = (vmax - origin) / size;
+    lo = std::max(0, (int)cmin);
+    hi = std::min(count - 1, (int)cmax);
+    return cmax >= 0.0f && cmin <= (float)count && lo <= hi;
+}
 
-    if (m_VoxelGrid.minimumCorner.x >= m_VoxelGrid.maximumCorner.x ||
-        m_VoxelGrid.minimumCorner.y >= m_VoxelGrid.maximumCorner.y ||
-        m_VoxelGrid.minimumCorner.z >= m_VoxelGrid.maximumCorner.z ||
-        m_VoxelGrid.cellSize <= 0.0f || m_VoxelGrid.cellHeight <= 0.0f)
+// Overlap of the projections of the cell square and the segment or parallelogram on the normal of edge, touching counts.
+static bool CellOverlapsAlong(const glm::vec2& edge, const glm::vec2& cellCenter, float halfCell, const glm::vec2* points, int count)
+{
+    const glm::vec2 normal(-edge.y, edge.x);
+    const float center = glm::dot(normal, cellCenter);
+    const float radius = (fabsf(normal.x) + fabsf(normal.y)) * halfCell;
+    float pmin = glm::dot(normal, points[0]), pmax = pmin;
+    for (int i = 1; i < count; ++i)
     {
-        std::cout << "Invalid voxel grid parameters." << std::endl;
-        return;
+        const float d = glm::dot(normal, points[i]);
+        pmin = std::min(pmin, d);
+        pmax = std::max(pmax, d);
     }
-
-    m_VoxelGrid.width = (int)((m_VoxelGrid.maximumCorner.x - m_VoxelGrid.minimumCorner.x) / m_VoxelGrid.cellSize);
-    m_VoxelGrid.depth = (int)((m_VoxelGrid.maximumCorner.z - m_VoxelGrid.minimumCorner.z) / m_VoxelGrid.cellSize);
-    m_VoxelGrid.height = (int)((m_VoxelGrid.maximumCorner.y - m_VoxelGrid.minimumCorner.y) / m_VoxelGrid.cellHeight);
-    int totalVoxels = m_VoxelGrid.width * m_VoxelGrid.depth * m_VoxelGrid.height;
-    std::cout << "Voxel Grid Dimensions: " << m_VoxelGrid.width << " x " << m_VoxelGrid.depth << " x " << m_VoxelGrid.height << " = " << totalVoxels << " voxels." << std::endl;
-
-    m_VoxelGrid.data.assign(totalVoxels, false);
-
-    Rasterization();
+    return center - radius <= pmax && center + radius >= pmin;
 }
 
-void NavigationSystem::Rasterization()
+void NavigationSystem::RasterizeBox(VoxelGrid& grid, const NavInputBox& box, int x0, int z0, int x1, int z1, int& solidVoxels)
 {
-    int solidVoxels = 0;
-    for (const auto& tri : m_InputTriangles)
+    int minX, maxX, minZ, maxZ;
+    if (!GetCellRange(box.bmin.x, box.bmax.x, grid.minimumCorner.x, grid.cellSize, grid.width, minX, maxX) ||
+        !GetCellRange(box.bmin.z, box.bmax.z, grid.minimumCorner.z, grid.cellSize, grid.depth, minZ, maxZ))
+        return;
+    minX = std::max(minX, x0);
+    minZ = std::max(minZ, z0);
+    maxX = std::min(maxX, x1 - 1);
+    maxZ = std::min(maxZ, z1 - 1);
+
+    // Rows of the side faces and of the top and bottom face, a face outside the grid sets none.
+    int wallMinY, wallMaxY, bottomY, topY, unused;
+    if (!GetCellRange(box.bmin.y, box.bmax.y, grid.minimumCorner.y, grid.cellHeight, grid.height, wallMinY, wallMaxY))
+        return;
+    if (!GetCellRange(box.bmin.y, box.bmin.y, grid.minimumCorner.y, grid.cellHeight, grid.height, bottomY, unused))
+        bottomY = -1;
+    if (!GetCellRange(box.bmax.y, box.bmax.y, grid.minimumCorner.y, grid.cellHeight, grid.height, topY, unused))
+        topY = -1;
+
+    // Cell bounds of each side face, they bound the columns under it like the voxel bounds of its triangles.
+    int edgeMinX[4], edgeMaxX[4], edgeMinZ[4], edgeMaxZ[4];
+    glm::vec2 edges[4];
+    for (int k = 0; k < 4; ++k)
     {
-        float triMin[3] = { tri.verts[0].x, tri.verts[0].y, tri.verts[0].z };
-        float triMax[3] = { tri.verts[0].x, tri.verts[0].y, tri.verts[0].z };
-        for (int i = 1; i < 3; ++i)
+        const glm::vec2& a = box.footprint[k];
+        const glm::vec2& b = box.footprint[(k + 1) & 3];
+        edges[k] = b - a;
+        if (!GetCellRange(std::min(a.x, b.x), std::max(a.x, b.x), grid.minimumCorner.x, grid.cellSize, grid.width, edgeMinX[k], edgeMaxX[k]) ||
+            !GetCellRange(std::min(a.y, b.y), std::max(a.y, b.y), grid.minimumCorner.z, grid.cellSize, grid.depth, edgeMinZ[k], edgeMaxZ[k]))
         {
-            triMin[0] = std::min(triMin[0], tri.verts[i].x);
-            triMin[1] = std::min(triMin[1], tri.verts[i].y);
-            triMin[2] = std::min(triMin[2], tri.verts[i].z);
-            
-            triMax[0] = std::max(triMax[0], tri.verts[i].x);
-            triMax[1] = std::max(triMax[1], tri.verts[i].y);
-            triMax[2] = std::max(triMax[2], tri.verts[i].z);
+            edgeMinX[k] = grid.width;
+            edgeMaxX[k] = -1;
         }
+    }
 
-        int minX = (int)((triMin[0] - m_VoxelGrid.minimumCorner.x) / m_VoxelGrid.cellSize);
-        int minY = (int)((triMin[1] - m_VoxelGrid.minimumCorner.y) / m_VoxelGrid.cellHeight);
-        int minZ = (int)((triMin[2] - m_VoxelGrid.minimumCorner.z) / m_VoxelGrid.cellSize);
-        
-        int maxX = (int)((triMax[0] - m_VoxelGrid.minimumCorner.x) / m_VoxelGrid.cellSize);
-        int maxY = (int)((triMax[1] - m_VoxelGrid.minimumCorner.y) / m_VoxelGrid.cellHeight);
-        int maxZ = (int)((triMax[2] - m_VoxelGrid.minimumCorner.z) / m_VoxelGrid.cellSize);
-
-        minX = std::max(0, minX);
-        minY = std::max(0, minY);
-        minZ = std::max(0, minZ);
-
-        maxX = std::min(m_VoxelGrid.width - 1, maxX);
-        maxY = std::min(m_VoxelGrid.height - 1, maxY);
-        maxZ = std::min(m_VoxelGrid.depth - 1, maxZ);
-
-        for (int z = minZ; z <= maxZ; ++z)
+    const int layer = grid.width * grid.depth;
+    const float halfCell = grid.cellSize * 0.5f;
+    for (int z = minZ; z <= maxZ; ++z)
+    {
+        for (int x = minX; x <= maxX; ++x)
         {
-            for (int y = minY; y <= maxY; ++y)
+            const glm::vec2 cellCenter(grid.minimumCorner.x + (x + 0.5f) * grid.cellSize, grid.minimumCorner.z + (z + 0.5f) * grid.cellSize);
+            // Axis aligned footprints cover their whole cell range, the others are tested on their two edge normals.
+            if (!box.axisAligned && (!CellOverlapsAlong(edges[0], cellCenter, halfCell, box.footprint, 4) ||
+                                     !CellOverlapsAlong(edges[1], cellCenter, halfCell, box.footprint, 4)))
+                continue;
+
+            bool wall = false;
+            for (int k = 0; k < 4 && !wall; ++k)
             {
-                for (int x = minX; x <= maxX; ++x)
-                {
-                    int index = x + z * m_VoxelGrid.width + y * m_VoxelGrid.width * m_VoxelGrid.depth;
-                    if (m_VoxelGrid.data[index])
-                        continue;
+                if (x < edgeMinX[k] || x > edgeMaxX[k] || z < edgeMinZ[k] || z > edgeMaxZ[k])
+                    continue;
+                wall = box.axisAligned || CellOverlapsAlong(edges[k], cellCenter, halfCell, &box.footprint[k], 1);
+            }
 
-                    float boxcenter[3] = {
-                        m_VoxelGrid.minimumCorner.x + (x + 0.5f) * m_VoxelGrid.cellSize,
-                        m_VoxelGrid.minimumCorner.y + (y + 0.5f) * m_VoxelGrid.cellHeight,
-                        m_VoxelGrid.minimumCorner.z + (z + 0.5f) * m_VoxelGrid.cellSize
-                    };
-                    float boxhalfsize[3] = {
-                        m_VoxelGrid.cellSize * 0.5f,
-                        m_VoxelGrid.cellHeight * 0.5f,
-                        m_VoxelGrid.cellSize * 0.5f
-                    };
-                    float triverts[3][3] = {
-                        { tri.verts[0].x, tri.verts[0].y, tri.verts[0].z },
-                        { tri.verts[1].x, tri.verts[1].y, tri.verts[1].z },
-                        { tri.verts[2].x, tri.verts[2].y, tri.verts[2].z }
-                    };
-
-                    if (TriBoxOverlap(boxcenter, boxhalfsize, triverts))
-                    {
-                        m_VoxelGrid.data[index] = true;
-                        solidVoxels++;
-                    }
-                }
+            const int column = x + z * grid.width;
+            for (int y = wallMinY; y <= wallMaxY; ++y)
+            {
+                if (!wall && y != bottomY && y != topY)
+                    continue;
+                if (grid.data[column + y * layer])
+                    continue;
+                grid.data[column + y * layer] = true;
+                solidVoxels++;
             }
         }
     }
-    std::cout << "Rasterization complete. Solid voxels: " << solidVoxels << std::endl;
 }
 
 void NavigationSystem::BuildHeightField()
@@ -189,6 +1091,7 @@ void NavigationSystem::BuildHeightField()
     m_HeightField.bmin = m_VoxelGrid.minimumCorner;
 
     const int numColumns = m_HeightField.width * m_HeightField.depth;
+    delete[] m_HeightField.spans;
     m_HeightField.spans = new HeightFieldSpan*[numColumns];
     memset(m_HeightField.spans, 0, sizeof(HeightFieldSpan*) * numColumns);
 
@@ -216,6 +1119,7 @@ void NavigationSystem::BuildHeightField()
                         newSpan.spanMin = y;
                         newSpan.spanMax = y;
                         newSpan.areaID = 0;
+                        newSpan.area = NAVAREA_GROUND;
                         newSpan.next = nullptr;
 
                         m_HeightField.spanPool.push_back(newSpan);
@@ -241,19 +1145,35 @@ void NavigationSystem::BuildHeightField()
 void NavigationSystem::FilterWalkableSurfaces()
 {
     const int walkableHeight = (int)ceilf(m_AgentHeight / m_HeightField.cellHeight);
-    
+    const int walkableRadius = (int)ceilf(m_AgentRadius / m_HeightField.cellSize);
+    const int walkableClimb = m_MaxClimb > 0 ? (int)floorf(m_MaxClimb / m_HeightField.cellHeight) : 0;
+    FilterWalkableSurfaces(m_HeightField, walkableHeight, m_VoxelGrid.height);
+    ErodeWalkableArea(m_HeightField, walkableRadius, walkableClimb);
     for (auto& span : m_HeightField.spanPool)
+        span.area = NAVAREA_GROUND;
+    MarkTriangleAreas(m_HeightField, m_InputGeometry);
+    for (const NavConvexVolume& volume : m_ConvexVolumes)
+        MarkConvexVolumeArea(m_HeightField, volume);
+    m_WalkableAreas.resize(m_HeightField.spanPool.size());
+    for (size_t i = 0; i < m_HeightField.spanPool.size(); ++i)
+        m_WalkableAreas[i] = m_HeightField.spanPool[i].areaID;
+    std::cout << "Walkable surfaces filtered." << std::endl;
+}
+
+void NavigationSystem::FilterWalkableSurfaces(HeightField& heightField, int walkableHeight, int fieldHeight)
+{
+    for (auto& span : heightField.spanPool)
         span.areaID = 1;
-    
-    for (int z = 0; z < m_HeightField.depth; ++z)
+
+    for (int z = 0; z < heightField.depth; ++z)
     {
-        for (int x = 0; x < m_HeightField.width; ++x)
+        for (int x = 0; x < heightField.width; ++x)
         {
-            for (HeightFieldSpan* span = m_HeightField.spans[x + z * m_HeightField.width]; span; span = span->next)
+            for (HeightFieldSpan* span = heightField.spans[x + z * heightField.width]; span; span = span->next)
             {
-                const int upperSpanFloor = span->next ? (int)span->next->spanMin : m_VoxelGrid.height;
+                const int upperSpanFloor = span->next ? (int)span->next->spanMin : fieldHeight;
                 const int headroom = upperSpanFloor - (int)span->spanMax;
-                
+
                 if (headroom < walkableHeight)
                 {
                     span->areaID = 0;
@@ -261,7 +1181,229 @@ void NavigationSystem::FilterWalkableSurfaces()
             }
         }
     }
-    std::cout << "Walkable surfaces filtered." << std::endl;
+}
+
+void NavigationSystem::ErodeWalkableArea(HeightField& heightField, int walkableRadius, int walkableClimb)
+{
+    const int w = heightField.width;
+    const int d = heightField.depth;
+    const int dx[] = {-1, 0, 1, 0};
+    const int dz[] = {0, -1, 0, 1};
+    std::vector<HeightFieldSpan*> border;
+    for (int pass = 0; pass < walkableRadius; ++pass)
+    {
+        // A walkable span with a side that has no walkable neighbor within climb, or the field edge, is on the border.
+        border.clear();
+        for (int z = 0; z < d; ++z)
+        {
+            for (int x = 0; x < w; ++x)
+            {
+                for (HeightFieldSpan* span = heightField.spans[x + z * w]; span; span = span->next)
+                {
+                    if (span->areaID == 0)
+                        continue;
+                    for (int dir = 0; dir < 4; ++dir)
+                    {
+                        const int nx = x + dx[dir], nz = z + dz[dir];
+                        const HeightFieldSpan* neighborSpan = nx >= 0 && nz >= 0 && nx < w && nz < d ? heightField.spans[nx + nz * w] : nullptr;
+                        while (neighborSpan && (neighborSpan->areaID == 0 || abs((int)span->spanMax - (int)neighborSpan->spanMax) > walkableClimb))
+                            neighborSpan = neighborSpan->next;
+                        if (!neighborSpan)
+                        {
+                            border.push_back(span);
+                            break;
+                        }
+                    }
+                }
+            }
+        }
+        if (border.empty())
+            break;
+        for (HeightFieldSpan* span : border)
+            span->areaID = 0;
+    }
+}
+
+void NavigationSystem::MarkTriangleAreas(HeightField& heightField, const NavInputGeometry& geometry)
+{
+    const float cs = heightField.cellSize;
+    const float ch = heightField.cellHeight;
+    const std::vector<unsigned char>& areas = geometry.areas;
+    for (int i = 0; i < geometry.GetTriangleCount(); ++i)
+    {
+        if (areas[i] == NAVAREA_GROUND || areas[i] >= NAV_MAX_AREAS)
+            continue;
+        const glm::vec3& a = geometry.verts[geometry.indices[i * 3]];
+        const glm::vec3& b = geometry.verts[geometry.indices[i * 3 + 1]];
+        const glm::vec3& c = geometry.verts[geometry.indices[i * 3 + 2]];
+        // Twice the signed xz area, the same sign as the y of the normal. Walls and downward faces have no walkable top.
+        const float area2 = (b.z - a.z) * (c.x - a.x) - (b.x - a.x) * (c.z - a.z);
+        if (area2 <= 1e-6f)
+            continue;
+
+        const int minX = std::max((int)floorf((std::min(a.x, std::min(b.x, c.x)) - heightField.bmin.x) / cs), 0);
+        const int minZ = std::max((int)floorf((std::min(a.z, std::min(b.z, c.z)) - heightField.bmin.z) / cs), 0);
+        const int maxX = std::min((int)floorf((std::max(a.x, std::max(b.x, c.x)) - heightField.bmin.x) / cs), heightField.width - 1);
+        const int maxZ = std::min((int)floorf((std::max(a.z, std::max(b.z, c.z)) - heightField.bmin.z) / cs), heightField.depth - 1);
+        for (int z = minZ; z <= maxZ; ++z)
+        {
+            for (int x = minX; x <= maxX; ++x)
+            {
+                // Barycentric weights of the cell center, none negative inside the triangle.
+                const float px = heightField.bmin.x + (x + 0.5f) * cs, pz = heightField.bmin.z + (z + 0.5f) * cs;
+                const float wa = ((b.z - pz) * (c.x - px) - (b.x - px) * (c.z - pz)) / area2;
+                const float wb = ((c.z - pz) * (a.x - px) - (c.x - px) * (a.z - pz)) / area2;
+                const float wc = 1.0f - wa - wb;
+                if (wa < 0.0f || wb < 0.0f || wc < 0.0f)
+                    continue;
+                // The span whose top voxel holds the surface, or the one right below when it lies on a voxel boundary.
+                const int surface = (int)floorf((wa * a.y + wb * b.y + wc * c.y - heightField.bmin.y) / ch);
+                for (HeightFieldSpan* span = heightField.spans[x + z * heightField.width]; span; span = span->next)
+                {
+                    if (surface >= (int)span->spanMax && surface <= (int)span->spanMax + 1)
+                    {
+                        span->area = areas[i];
+                        break;
+                    }
+                }
+            }
+        }
+    }
+}
+
+void NavigationSystem::MarkConvexVolumeArea(HeightField& heightField, const NavConvexVolume& volume)
+{
+    if (volume.verts.size() < 3 || volume.area >= NAV_MAX_AREAS)
+        return;
+    glm::vec3 vmin = volume.verts[0], vmax = volume.verts[0];
+    for (const glm::vec3& v : volume.verts)
+    {
+        vmin = glm::min(vmin, v);
+        vmax = glm::max(vmax, v);
+    }
+    const float cs = heightField.cellSize;
+    const int minX = std::max((int)floorf((vmin.x - heightField.bmin.x) / cs), 0);
+    const int minZ = std::max((int)floorf((vmin.z - heightField.bmin.z) / cs), 0);
+    const int maxX = std::min((int)floorf((vmax.x - heightField.bmin.x) / cs), heightField.width - 1);
+    const int maxZ = std::min((int)floorf((vmax.z - heightField.bmin.z) / cs), heightField.depth - 1);
+    const size_t count = volume.verts.size();
+    for (int z = minZ; z <= maxZ; ++z)
+    {
+        for (int x = minX; x <= maxX; ++x)
+        {
+            // Inside when the center is on the same side of every edge, whichever way the polygon winds.
+            const float px = heightField.bmin.x + (x + 0.5f) * cs, pz = heightField.bmin.z + (z + 0.5f) * cs;
+            int positive = 0, negative = 0;
+            for (size_t i = 0, j = count - 1; i < count; j = i++)
+            {
+                const glm::vec3& vi = volume.verts[i];
+                const glm::vec3& vj = volume.verts[j];
+                const float side = (vi.x - vj.x) * (pz - vj.z) - (vi.z - vj.z) * (px - vj.x);
+                positive += side > 0.0f;
+                negative += side < 0.0f;
+            }
+            if (positive && negative)
+                continue;
+            for (HeightFieldSpan* span = heightField.spans[x + z * heightField.width]; span; span = span->next)
+            {
+                const float top = heightField.bmin.y + (span->spanMax + 1) * heightField.cellHeight;
+                if (top >= volume.hmin && top <= volume.hmax)
+                    span->area = volume.area;
+            }
+        }
+    }
+}
+
+void NavigationSystem::AddOffMeshConnection(const glm::vec3& start, const glm::vec3& end, float radius, bool bidirectional, unsigned char area,
+                                            float cost)
+{
+    NavOffMeshConnection connection;
+    connection.start = start;
+    connection.end = end;
+    connection.radius = std::max(radius, 0.0f);
+    connection.cost = std::max(cost, 0.0f);
+    connection.area = area;
+    connection.bidirectional = bidirectional;
+    m_OffMeshConnections.push_back(connection);
+}
+
+void NavigationSystem::AddConvexVolume(const glm::vec3* verts, int count, float hmin, float hmax, unsigned char area)
+{
+    if (count < 3 || area >= NAV_MAX_AREAS)
+        return;
+    NavConvexVolume volume;
+    volume.verts.assign(verts, verts + count);
+    volume.hmin = hmin;
+    volume.hmax = hmax;
+    volume.area = area;
+    m_ConvexVolumes.push_back(volume);
+}
+
+// Deep copy with the span links pointing into the copy's pool.
+static void CopyHeightField(const HeightField& source, HeightField& copy)
+{
+    const int columns = source.width * source.depth;
+    copy.width = source.width;
+    copy.depth = source.depth;
+    copy.bmin = source.bmin;
+    copy.cellSize = source.cellSize;
+    copy.cellHeight = source.cellHeight;
+    copy.spanPool = source.spanPool;
+    copy.spans = new HeightFieldSpan*[columns];
+    const HeightFieldSpan* sourcePool = source.spanPool.data();
+    HeightFieldSpan* pool = copy.spanPool.data();
+    for (int i = 0; i < columns; ++i)
+        copy.spans[i] = source.spans[i] ? pool + (source.spans[i] - sourcePool) : nullptr;
+    for (HeightFieldSpan& span : copy.spanPool)
+        if (span.next)
+            span.next = pool + (span.next - sourcePool);
+}
+
+void NavigationSystem::BuildProfileNavMeshes(const HeightField& heightField, int fieldHeight, int tileSize, const std::vector<NavAgentProfile>& profiles,
+                                             JobSystem* jobSystem, std::vector<NavMesh>& navMeshes)
+{
+    navMeshes.resize(profiles.size());
+    auto buildProfiles = [&](int begin, int end, int)
+    {
+        for (int i = begin; i < end; ++i)
+        {
+            const NavAgentProfile& profile = profiles[i];
+            HeightField field;
+            CopyHeightField(heightField, field);
+            const int walkableHeight = (int)ceilf(profile.agentHeight / field.cellHeight);
+            const int walkableRadius = (int)ceilf(profile.agentRadius / field.cellSize);
+            const int walkableClimb = profile.maxClimb > 0 ? (int)floorf(profile.maxClimb / field.cellHeight) : 0;
+            FilterWalkableSurfaces(field, walkableHeight, fieldHeight);
+            ErodeWalkableArea(field, walkableRadius, walkableClimb);
+            BuildRegions(field, walkableClimb, 0, 0, field.width, field.depth, 2);
+            BuildConnections(field, walkableClimb, 0, 0, field.width, field.depth);
+            BuildPolyMesh(field, tileSize, navMeshes[i]);
+            delete[] field.spans;
+        }
+    };
+    if (jobSystem)
+        jobSystem->ParallelFor((int)profiles.size(), 1, buildProfiles);
+    else
+        buildProfiles(0, (int)profiles.size(), 0);
+}
+
+// Contours are only drawn for the main build, the profile meshes are built from the spans directly.
+void NavigationSystem::BuildNavMeshProfiles(const Scene& scene, const std::vector<NavAgentProfile>& profiles)
+{
+    BuildNavMesh(scene);
+    if (m_HeightField.width == 0 || m_HeightField.depth == 0 || m_HeightField.spanPool.empty())
+        return;
+
+    auto begin = std::chrono::high_resolution_clock::now();
+    m_AgentProfiles = profiles;
+    m_ProfileNavMeshes.resize(profiles.size());
+    for (NavMesh& navMesh : m_ProfileNavMeshes)
+        navMesh.offMeshConnections = m_OffMeshConnections;
+    BuildProfileNavMeshes(m_HeightField, m_VoxelGrid.height, m_TileSize, m_AgentProfiles, m_JobSystem, m_ProfileNavMeshes);
+    std::cout << "Built " << m_AgentProfiles.size() << " agent profiles from the shared heightfield in "
+              << std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - begin).count() << " ms:" << std::endl;
+    for (size_t i = 0; i < m_AgentProfiles.size(); ++i)
+        std::cout << "  " << m_AgentProfiles[i].name << ": " << m_ProfileNavMeshes[i].GetPolyCount() << " polys" << std::endl;
 }
 
 void NavigationSystem::BuldRegions()
@@ -271,19 +1413,30 @@ void NavigationSystem::BuldRegions()
         return;
 
     const int walkableClimb = m_MaxClimb > 0 ? (int)floorf(m_MaxClimb / m_HeightField.cellHeight) : 0;
-    
-    unsigned int regionId = 2;
+
+    // Region IDs overwrite the walkable areas, start again from the filtered ones when only the regions are rebuilt.
+    if (m_WalkableAreas.size() == m_HeightField.spanPool.size())
+        for (size_t i = 0; i < m_HeightField.spanPool.size(); ++i)
+            m_HeightField.spanPool[i].areaID = m_WalkableAreas[i];
+
+    const unsigned int nextRegion = BuildRegions(m_HeightField, walkableClimb, 0, 0, m_HeightField.width, m_HeightField.depth, 2);
+    std::cout << "Regions built. Total regions found: " << nextRegion - 2 << std::endl;
+}
+
+unsigned int NavigationSystem::BuildRegions(HeightField& heightField, int walkableClimb, int x0, int z0, int x1, int z1, unsigned int firstRegion)
+{
+    unsigned int regionId = firstRegion;
     
     struct SpanLocation {
         int x, z;
         HeightFieldSpan* span;
     };
     
-    for (int z = 0; z < m_HeightField.depth; ++z)
+    for (int z = z0; z < z1; ++z)
     {
-        for (int x = 0; x < m_HeightField.width; ++x)
+        for (int x = x0; x < x1; ++x)
         {
-            for (HeightFieldSpan* span = m_HeightField.spans[x + z * m_HeightField.width]; span; span = span->next)
+            for (HeightFieldSpan* span = heightField.spans[x + z * heightField.width]; span; span = span->next)
             {
                 if (span->areaID == 1)
                 {
@@ -303,12 +1456,12 @@ void NavigationSystem::BuldRegions()
                             int nx = current.x + dx[dir];
                             int nz = current.z + dz[dir];
                             
-                            if (nx < 0 || nz < 0 || nx >= m_HeightField.width || nz >= m_HeightField.depth)
+                            if (nx < x0 || nz < z0 || nx >= x1 || nz >= z1)
                                 continue;
                             
-                            for (HeightFieldSpan* neighborSpan = m_HeightField.spans[nx + nz * m_HeightField.width]; neighborSpan; neighborSpan = neighborSpan->next)
+                            for (HeightFieldSpan* neighborSpan = heightField.spans[nx + nz * heightField.width]; neighborSpan; neighborSpan = neighborSpan->next)
                             {
-                                if (neighborSpan->areaID == 1)
+                                if (neighborSpan->areaID == 1 && neighborSpan->area == current.span->area)
                                 {
                                     const int heightDiff = abs((int)current.span->spanMax - (int)neighborSpan->spanMax);
                                     if (heightDiff <= walkableClimb)
@@ -325,24 +1478,27 @@ void NavigationSystem::BuldRegions()
             }
         }
     }
-
-    std::cout << "Regions built. Total regions found: " << regionId - 2 << std::endl;
+    return regionId;
 }
 
 void NavigationSystem::BuildConnections()
 {
     std::cout << "Building connections between spans..." << std::endl;
-
-    const int w = m_HeightField.width;
-    const int d = m_HeightField.depth;
-    
     const int walkableClimb = (m_MaxClimb > 0) ? (int)floorf(m_MaxClimb / m_HeightField.cellHeight) : 0;
+    BuildConnections(m_HeightField, walkableClimb, 0, 0, m_HeightField.width, m_HeightField.depth);
+    std::cout << "Connections built." << std::endl;
+}
+
+void NavigationSystem::BuildConnections(HeightField& heightField, int walkableClimb, int x0, int z0, int x1, int z1)
+{
+    const int w = heightField.width;
+    const int d = heightField.depth;
     
-    for (int z = 0; z < d; ++z)
+    for (int z = z0; z < z1; ++z)
     {
-        for (int x = 0; x < w; ++x)
+        for (int x = x0; x < x1; ++x)
         {
-            for (HeightFieldSpan* span = m_HeightField.spans[x + z * w]; span; span = span->next)
+            for (HeightFieldSpan* span = heightField.spans[x + z * w]; span; span = span->next)
             {
                 for (int i = 0; i < 4; ++i)
                     span->connections[i] = 0;
@@ -360,7 +1516,7 @@ void NavigationSystem::BuildConnections()
                     if (nx < 0 || nz < 0 || nx >= w || nz >= d)
                         continue;
                     
-                    for (HeightFieldSpan* neighborSpan = m_HeightField.spans[nx + nz * w]; neighborSpan; neighborSpan = neighborSpan->next)
+                    for (HeightFieldSpan* neighborSpan = heightField.spans[nx + nz * w]; neighborSpan; neighborSpan = neighborSpan->next)
                     {
                         if (neighborSpan->areaID == 0)
                             continue;
@@ -368,7 +1524,7 @@ void NavigationSystem::BuildConnections()
                         const int heightDiff = abs((int)span->spanMax - (int)neighborSpan->spanMax);
                         if (heightDiff <= walkableClimb)
                         {
-                            const size_t neighborIndex = (neighborSpan - &m_HeightField.spanPool[0]) + 1;
+                            const size_t neighborIndex = (neighborSpan - &heightField.spanPool[0]) + 1;
                             span->connections[dir] = neighborIndex;
                             break; 
                         }
@@ -377,7 +1533,6 @@ void NavigationSystem::BuildConnections()
             }
         }
     }
-    std::cout << "Connections built." << std::endl;
 }
 
 void NavigationSystem::BuildContours()
@@ -505,6 +1660,442 @@ void NavigationSystem::BuildContours()
 }
 
 
+void NavigationSystem::BuildPolyMesh()
+{
+    std::cout << "Building polygon mesh..." << std::endl;
+    m_NavMesh.offMeshConnections = m_OffMeshConnections;
+    BuildPolyMesh(m_HeightField, m_TileSize, m_NavMesh, m_SpanPolys);
+}
+
+// Keeps the derived per tile data in sync after a tile's polys and links were rebuilt.
+void NavigationSystem::OnTileRebuilt(int tileIndex)
+{
+    m_NavMeshIslands.RebuildTile(m_NavMesh, tileIndex);
+    m_HierarchicalPathfinder.MarkTileChanged(tileIndex);
+    const NavMeshTile& tile = m_NavMesh.tiles[tileIndex];
+    m_HeightFieldPyramid.MarkTileDirty(tile.tileX, tile.tileZ);
+}
+
+// Degenerate portal of an off-mesh connection, leaving poly in the tile being linked.
+struct OffMeshLink
+{
+    unsigned int poly;
+    NavPolyRef neighbor;
+    glm::vec3 pos;
+};
+
+static const HeightFieldSpan* GetSpanNeighbor(const HeightFieldSpan* pool, const HeightFieldSpan* span, int dir)
+{
+    return span->connections[dir] > 0 ? &pool[span->connections[dir] - 1] : nullptr;
+}
+
+// Merges spans of the same region and height into rectangles, never crossing the tile border, and records the poly of each span.
+static void BuildTilePolys(const HeightField& heightField, NavMesh& navMesh, int tileIndex, std::vector<unsigned int>& spanPoly)
+{
+    const int w = heightField.width;
+    const int d = heightField.depth;
+    const int tileSize = navMesh.tileSize;
+    const float cs = heightField.cellSize;
+    const float ch = heightField.cellHeight;
+    const glm::vec3& bmin = heightField.bmin;
+    const HeightFieldSpan* pool = &heightField.spanPool[0];
+    std::vector<const HeightFieldSpan*> row, nextRow;
+
+    NavMeshTile& tile = navMesh.tiles[tileIndex];
+    tile.polys.clear();
+    const int x0 = tile.tileX * tileSize, x1 = std::min(w, x0 + tileSize);
+    const int z0 = tile.tileZ * tileSize, z1 = std::min(d, z0 + tileSize);
+    tile.bmin = glm::vec3(bmin.x + x0 * cs, FLT_MAX, bmin.z + z0 * cs);
+    tile.bmax = glm::vec3(bmin.x + x1 * cs, -FLT_MAX, bmin.z + z1 * cs);
+
+    for (int z = z0; z < z1; ++z)
+    {
+        for (int x = x0; x < x1; ++x)
+        {
+            for (const HeightFieldSpan* span = heightField.spans[x + z * w]; span; span = span->next)
+            {
+                if (span->areaID == 0 || spanPoly[span - pool] != NO_SPAN_POLY)
+                    continue;
+
+                const unsigned int polyIndex = (unsigned int)tile.polys.size();
+                auto canMerge = [&](const HeightFieldSpan* candidate)
+                {
+                    return candidate && candidate->areaID == span->areaID && candidate->spanMax == span->spanMax &&
+                           spanPoly[candidate - pool] == NO_SPAN_POLY;
+                };
+
+                row.clear();
+                row.push_back(span);
+                spanPoly[span - pool] = polyIndex;
+                while (x + (int)row.size() < x1)
+                {
+                    const HeightFieldSpan* next = GetSpanNeighbor(pool, row.back(), 2);
+                    if (!canMerge(next))
+                        break;
+                    spanPoly[next - pool] = polyIndex;
+                    row.push_back(next);
+                }
+
+                int rows = 1;
+                while (z + rows < z1)
+                {
+                    nextRow.clear();
+                    for (const HeightFieldSpan* rowSpan : row)
+                    {
+                        const HeightFieldSpan* below = GetSpanNeighbor(pool, rowSpan, 3);
+                        if (!canMerge(below))
+                            break;
+                        nextRow.push_back(below);
+                    }
+                    if (nextRow.size() != row.size())
+                        break;
+                    for (const HeightFieldSpan* rowSpan : nextRow)
+                        spanPoly[rowSpan - pool] = polyIndex;
+                    row.swap(nextRow);
+                    rows++;
+                }
+
+                NavPoly poly;
+                poly.minX = x;
+                poly.minZ = z;
+                poly.maxX = x + (int)row.size() - 1;
+                poly.maxZ = z + rows - 1;
+                poly.spanY = span->spanMax;
+                poly.regionID = span->areaID;
+                poly.cost = 0.0f;
+                poly.area = span->area;
+                poly.flags = GetAreaPolyFlags(span->area);
+                poly.type = NAVPOLYTYPE_GROUND;
+                poly.bmin = glm::vec3(bmin.x + poly.minX * cs, bmin.y + (poly.spanY + 1) * ch, bmin.z + poly.minZ * cs);
+                poly.bmax = glm::vec3(bmin.x + (poly.maxX + 1) * cs, poly.bmin.y, bmin.z + (poly.maxZ + 1) * cs);
+                poly.firstLink = 0;
+                poly.linkCount = 0;
+                tile.polys.push_back(poly);
+
+                tile.bmin.y = std::min(tile.bmin.y, poly.bmin.y);
+                tile.bmax.y = std::max(tile.bmax.y, poly.bmax.y);
+            }
+        }
+    }
+
+    // One poly per connection starting in the tile, after the ground polys so spanPoly keeps indexing those.
+    const unsigned int* offMeshItems;
+    const int offMeshItemCount = navMesh.GetOffMeshTileItems(tileIndex, offMeshItems);
+    for (int i = 0; i < offMeshItemCount; ++i)
+    {
+        if (offMeshItems[i] & 1)
+            continue;
+        const unsigned int connectionIndex = offMeshItems[i] >> 1;
+        const NavOffMeshConnection& connection = navMesh.offMeshConnections[connectionIndex];
+        NavPoly poly;
+        poly.minX = poly.maxX = glm::clamp((int)floorf((connection.start.x - bmin.x) / cs), x0, x1 - 1);
+        poly.minZ = poly.maxZ = glm::clamp((int)floorf((connection.start.z - bmin.z) / cs), z0, z1 - 1);
+        poly.spanY = 0;
+        poly.regionID = 0;
+        poly.cost = std::max(connection.cost, 0.0f);
+        poly.area = connection.area;
+        poly.flags = GetAreaPolyFlags(connection.area) | NAVPOLYFLAG_OFFMESH;
+        poly.type = NAVPOLYTYPE_OFFMESH;
+        poly.bmin = glm::min(connection.start, connection.end);
+        poly.bmax = glm::max(connection.start, connection.end);
+        poly.firstLink = 0;
+        poly.linkCount = 0;
+        navMesh.offMeshPolys[connectionIndex] = (unsigned int)tile.polys.size();
+        tile.polys.push_back(poly);
+    }
+    BuildTileBVTree(navMesh, tile);
+}
+
+// Walkable span closest to an end of an off-mesh connection within radius, searched in the cells of the tile
+// the end lies in. Returns the span's poly, NO_SPAN_POLY when none is in reach, and the point on it in attachPos.
+static unsigned int FindOffMeshAttachPoly(const HeightField& heightField, const NavMesh& navMesh, int tileIndex,
+                                          const std::vector<unsigned int>& spanPoly, const glm::vec3& pos, float radius, glm::vec3& attachPos)
+{
+    const float cs = heightField.cellSize;
+    const float ch = heightField.cellHeight;
+    const glm::vec3& bmin = heightField.bmin;
+    const HeightFieldSpan* pool = &heightField.spanPool[0];
+    const NavMeshTile& tile = navMesh.tiles[tileIndex];
+    radius = std::max(radius, 0.0f);
+    const int x0 = tile.tileX * navMesh.tileSize, x1 = std::min(heightField.width, x0 + navMesh.tileSize) - 1;
+    const int z0 = tile.tileZ * navMesh.tileSize, z1 = std::min(heightField.depth, z0 + navMesh.tileSize) - 1;
+    const int minX = std::max(x0, (int)floorf((pos.x - radius - bmin.x) / cs));
+    const int maxX = std::min(x1, (int)floorf((pos.x + radius - bmin.x) / cs));
+    const int minZ = std::max(z0, (int)floorf((pos.z - radius - bmin.z) / cs));
+    const int maxZ = std::min(z1, (int)floorf((pos.z + radius - bmin.z) / cs));
+
+    unsigned int bestPoly = NO_SPAN_POLY;
+    float bestDistSqr = FLT_MAX;
+    for (int z = minZ; z <= maxZ; ++z)
+    {
+        for (int x = minX; x <= maxX; ++x)
+        {
+            const float cx = glm::clamp(pos.x, bmin.x + x * cs, bmin.x + (x + 1) * cs);
+            const float cz = glm::clamp(pos.z, bmin.z + z * cs, bmin.z + (z + 1) * cs);
+            const float horizontalSqr = (cx - pos.x) * (cx - pos.x) + (cz - pos.z) * (cz - pos.z);
+            if (horizontalSqr > radius * radius)
+                continue;
+            for (const HeightFieldSpan* span = heightField.spans[x + z * heightField.width]; span; span = span->next)
+            {
+                if (span->areaID == 0 || spanPoly[span - pool] == NO_SPAN_POLY)
+                    continue;
+                // Span tops are quantized to the cell height, an end placed on the surface may lie up to a cell off.
+                const float y = bmin.y + (span->spanMax + 1) * ch;
+                if (fabsf(y - pos.y) > radius + ch)
+                    continue;
+                const float distSqr = horizontalSqr + (y - pos.y) * (y - pos.y);
+                if (distSqr < bestDistSqr)
+                {
+                    bestDistSqr = distSqr;
+                    bestPoly = spanPoly[span - pool];
+                    attachPos = glm::vec3(cx, y, cz);
+                }
+            }
+        }
+    }
+    return bestPoly;
+}
+
+// Attaches both ends of a connection to the nearest polys of the tiles they lie in. False when the connection has no
+// poly or an end is out of reach of the mesh, it is left unlinked then.
+static bool AttachOffMeshConnection(const HeightField& heightField, const NavMesh& navMesh, const std::vector<unsigned int>& spanPoly,
+                                    unsigned int connectionIndex, NavPolyRef& offMeshRef, NavPolyRef attachRefs[2], glm::vec3 attachPos[2])
+{
+    const NavOffMeshConnection& connection = navMesh.offMeshConnections[connectionIndex];
+    for (int end = 0; end < 2; ++end)
+    {
+        const glm::vec3& pos = end ? connection.end : connection.start;
+        int tileX, tileZ, maxTileX, maxTileZ;
+        navMesh.GetTileRange(pos, pos, tileX, tileZ, maxTileX, maxTileZ);
+        const int tileIndex = tileX + tileZ * navMesh.tilesX;
+        const NavMeshTile& tile = navMesh.tiles[tileIndex];
+        const unsigned int polyIndex = FindOffMeshAttachPoly(heightField, navMesh, tileIndex, spanPoly, pos, connection.radius, attachPos[end]);
+        if (polyIndex == NO_SPAN_POLY)
+            return false;
+        attachRefs[end] = EncodePolyRef(tile.salt, tileIndex, polyIndex);
+        if (end == 0)
+        {
+            const unsigned int offMeshPoly = navMesh.offMeshPolys[connectionIndex];
+            if (offMeshPoly >= tile.polys.size())
+                return false;
+            offMeshRef = EncodePolyRef(tile.salt, tileIndex, offMeshPoly);
+        }
+    }
+    return true;
+}
+
+// Links the tile's polys across shared edges, one portal per run of cells facing the same neighbor.
+static void BuildTileLinks(const HeightField& heightField, NavMesh& navMesh, int tileIndex, const std::vector<unsigned int>& spanPoly)
+{
+    const int w = heightField.width;
+    const int tileSize = navMesh.tileSize;
+    const float cs = heightField.cellSize;
+    const float ch = heightField.cellHeight;
+    const glm::vec3& bmin = heightField.bmin;
+    const HeightFieldSpan* pool = &heightField.spanPool[0];
+
+    auto polyRefOf = [&](const HeightFieldSpan* span, int x, int z) -> NavPolyRef
+    {
+        const int neighborTile = x / tileSize + (z / tileSize) * navMesh.tilesX;
+        return EncodePolyRef(navMesh.tiles[neighborTile].salt, neighborTile, spanPoly[span - pool]);
+    };
+
+    // Links of the off-mesh connections with an end in the tile: ground poly to connection at the entry points,
+    // and from the connection polys starting here to the ground at their exits. Sorted by the poly they leave.
+    std::vector<OffMeshLink> offMeshLinks;
+    const unsigned int* offMeshItems;
+    const int offMeshItemCount = navMesh.GetOffMeshTileItems(tileIndex, offMeshItems);
+    for (int i = 0; i < offMeshItemCount; ++i)
+    {
+        const unsigned int connectionIndex = offMeshItems[i] >> 1;
+        const bool isEnd = (offMeshItems[i] & 1) != 0;
+        const NavOffMeshConnection& connection = navMesh.offMeshConnections[connectionIndex];
+        NavPolyRef offMeshRef, attachRefs[2];
+        glm::vec3 attachPos[2];
+        if (isEnd && !connection.bidirectional)
+            continue;
+        if (!AttachOffMeshConnection(heightField, navMesh, spanPoly, connectionIndex, offMeshRef, attachRefs, attachPos))
+            continue;
+        if (isEnd)
+        {
+            offMeshLinks.push_back({DecodePolyRefPoly(attachRefs[1]), offMeshRef, attachPos[1]});
+            continue;
+        }
+        const unsigned int offMeshPoly = DecodePolyRefPoly(offMeshRef);
+        offMeshLinks.push_back({DecodePolyRefPoly(attachRefs[0]), offMeshRef, attachPos[0]});
+        offMeshLinks.push_back({offMeshPoly, attachRefs[1], attachPos[1]});
+        if (connection.bidirectional)
+            offMeshLinks.push_back({offMeshPoly, attachRefs[0], attachPos[0]});
+    }
+    std::stable_sort(offMeshLinks.begin(), offMeshLinks.end(), [](const OffMeshLink& a, const OffMeshLink& b) { return a.poly < b.poly; });
+
+    NavMeshTile& tile = navMesh.tiles[tileIndex];
+    tile.links.clear();
+    size_t nextOffMeshLink = 0;
+    for (unsigned int polyIndex = 0; polyIndex < tile.polys.size(); ++polyIndex)
+    {
+        NavPoly& poly = tile.polys[polyIndex];
+        poly.firstLink = (unsigned int)tile.links.size();
+
+        for (int dir = 0; dir < 4 && poly.type == NAVPOLYTYPE_GROUND; ++dir)
+        {
+            const bool alongX = (dir == 1 || dir == 3);
+            const int first = alongX ? poly.minX : poly.minZ;
+            const int last = alongX ? poly.maxX : poly.maxZ;
+
+            NavPolyRef runRef = 0;
+            int runStart = first;
+            unsigned int runMaxY = 0;
+            for (int i = first; i <= last + 1; ++i)
+            {
+                NavPolyRef ref = 0;
+                unsigned int neighborY = 0;
+                if (i <= last)
+                {
+                    const int cx = alongX ? i : (dir == 0 ? poly.minX : poly.maxX);
+                    const int cz = alongX ? (dir == 1 ? poly.minZ : poly.maxZ) : i;
+                    const HeightFieldSpan* span = heightField.spans[cx + cz * w];
+                    while (span && !(span->spanMax == poly.spanY && spanPoly[span - pool] == polyIndex))
+                        span = span->next;
+                    const HeightFieldSpan* neighbor = span ? GetSpanNeighbor(pool, span, dir) : nullptr;
+                    if (neighbor && neighbor->areaID != 0)
+                    {
+                        int dx[] = {-1, 0, 1, 0};
+                        int dz[] = {0, -1, 0, 1};
+                        ref = polyRefOf(neighbor, cx + dx[dir], cz + dz[dir]);
+                        neighborY = neighbor->spanMax;
+                    }
+                }
+
+                if (ref == runRef && i <= last)
+                {
+                    runMaxY = std::max(runMaxY, neighborY);
+                    continue;
+                }
+
+                if (runRef)
+                {
+                    const float y = bmin.y + (std::max(poly.spanY, runMaxY) + 1) * ch;
+                    const float a = (alongX ? bmin.x : bmin.z) + runStart * cs;
+                    const float b = (alongX ? bmin.x : bmin.z) + i * cs;
+                    NavPolyLink link;
+                    link.neighbor = runRef;
+                    switch (dir)
+                    {
+                        case 0: link.left = {poly.bmin.x, y, b}; link.right = {poly.bmin.x, y, a}; break;
+                        case 1: link.left = {a, y, poly.bmin.z}; link.right = {b, y, poly.bmin.z}; break;
+                        case 2: link.left = {poly.bmax.x, y, a}; link.right = {poly.bmax.x, y, b}; break;
+                        case 3: link.left = {b, y, poly.bmax.z}; link.right = {a, y, poly.bmax.z}; break;
+                    }
+                    tile.links.push_back(link);
+                }
+                runRef = ref;
+                runStart = i;
+                runMaxY = neighborY;
+            }
+        }
+        for (; nextOffMeshLink < offMeshLinks.size() && offMeshLinks[nextOffMeshLink].poly == polyIndex; ++nextOffMeshLink)
+        {
+            NavPolyLink link;
+            link.neighbor = offMeshLinks[nextOffMeshLink].neighbor;
+            link.left = link.right = offMeshLinks[nextOffMeshLink].pos;
+            tile.links.push_back(link);
+        }
+        poly.linkCount = (unsigned int)tile.links.size() - poly.firstLink;
+    }
+}
+
+void NavigationSystem::BuildPolyMesh(const HeightField& heightField, int tileSize, NavMesh& navMesh)
+{
+    std::vector<unsigned int> spanPolys;
+    BuildPolyMesh(heightField, tileSize, navMesh, spanPolys);
+}
+
+void NavigationSystem::BuildPolyMesh(const HeightField& heightField, int tileSize, NavMesh& navMesh, std::vector<unsigned int>& spanPolys)
+{
+    std::vector<unsigned int> previousSalts;
+    for (const auto& tile : navMesh.tiles)
+        previousSalts.push_back(tile.salt);
+    navMesh.tiles.clear();
+    spanPolys.clear();
+    if (heightField.width == 0 || heightField.depth == 0 || heightField.spanPool.empty())
+        return;
+
+    navMesh.bmin = heightField.bmin;
+    navMesh.cellSize = heightField.cellSize;
+    navMesh.cellHeight = heightField.cellHeight;
+    navMesh.tileSize = tileSize;
+    navMesh.tilesX = (heightField.width + tileSize - 1) / tileSize;
+    navMesh.tilesZ = (heightField.depth + tileSize - 1) / tileSize;
+    navMesh.tiles.resize(navMesh.tilesX * navMesh.tilesZ);
+    spanPolys.assign(heightField.spanPool.size(), NO_SPAN_POLY);
+    BuildOffMeshIndex(navMesh);
+
+    for (int tz = 0; tz < navMesh.tilesZ; ++tz)
+    {
+        for (int tx = 0; tx < navMesh.tilesX; ++tx)
+        {
+            const int tileIndex = tx + tz * navMesh.tilesX;
+            NavMeshTile& tile = navMesh.tiles[tileIndex];
+            tile.tileX = tx;
+            tile.tileZ = tz;
+            tile.salt = tileIndex < (int)previousSalts.size() ? previousSalts[tileIndex] + 1 : 1;
+            if (tile.salt >= (1u << NAV_SALT_BITS))
+                tile.salt = 1;
+            BuildTilePolys(heightField, navMesh, tileIndex, spanPolys);
+        }
+    }
+    for (int tileIndex = 0; tileIndex < (int)navMesh.tiles.size(); ++tileIndex)
+        BuildTileLinks(heightField, navMesh, tileIndex, spanPolys);
+
+    std::cout << "Polygon mesh built with " << navMesh.GetPolyCount() << " polys in " << navMesh.tiles.size() << " tiles." << std::endl;
+}
+
+void NavigationSystem::RebuildPolyMeshTiles(const HeightField& heightField, const std::vector<int>& tiles, NavMesh& navMesh,
+                                            std::vector<unsigned int>& spanPolys, std::vector<int>& relinkedTiles)
+{
+    relinkedTiles.clear();
+    const HeightFieldSpan* pool = &heightField.spanPool[0];
+    for (int tileIndex : tiles)
+    {
+        NavMeshTile& tile = navMesh.tiles[tileIndex];
+        const int x0 = tile.tileX * navMesh.tileSize, x1 = std::min(heightField.width, x0 + navMesh.tileSize);
+        const int z0 = tile.tileZ * navMesh.tileSize, z1 = std::min(heightField.depth, z0 + navMesh.tileSize);
+        for (int z = z0; z < z1; ++z)
+            for (int x = x0; x < x1; ++x)
+                for (const HeightFieldSpan* span = heightField.spans[x + z * heightField.width]; span; span = span->next)
+                    spanPolys[span - pool] = NO_SPAN_POLY;
+        tile.salt = tile.salt + 1 < (1u << NAV_SALT_BITS) ? tile.salt + 1 : 1;
+        BuildTilePolys(heightField, navMesh, tileIndex, spanPolys);
+
+        // The neighbors' links into the tile point at the old polys.
+        relinkedTiles.push_back(tileIndex);
+        if (tile.tileX > 0)
+            relinkedTiles.push_back(tileIndex - 1);
+        if (tile.tileX < navMesh.tilesX - 1)
+            relinkedTiles.push_back(tileIndex + 1);
+        if (tile.tileZ > 0)
+            relinkedTiles.push_back(tileIndex - navMesh.tilesX);
+        if (tile.tileZ < navMesh.tilesZ - 1)
+            relinkedTiles.push_back(tileIndex + navMesh.tilesX);
+        // So do the tiles at the other end of the connections touching it, wherever they are.
+        const unsigned int* offMeshItems;
+        const int offMeshItemCount = navMesh.GetOffMeshTileItems(tileIndex, offMeshItems);
+        for (int i = 0; i < offMeshItemCount; ++i)
+        {
+            const NavOffMeshConnection& connection = navMesh.offMeshConnections[offMeshItems[i] >> 1];
+            const glm::vec3& otherEnd = (offMeshItems[i] & 1) ? connection.start : connection.end;
+            int tileX, tileZ, maxTileX, maxTileZ;
+            navMesh.GetTileRange(otherEnd, otherEnd, tileX, tileZ, maxTileX, maxTileZ);
+            relinkedTiles.push_back(tileX + tileZ * navMesh.tilesX);
+        }
+    }
+    std::sort(relinkedTiles.begin(), relinkedTiles.end());
+    relinkedTiles.erase(std::unique(relinkedTiles.begin(), relinkedTiles.end()), relinkedTiles.end());
+    for (int tileIndex : relinkedTiles)
+        BuildTileLinks(heightField, navMesh, tileIndex, spanPolys);
+}
+
 // --- Triangle-Box Overlap Test (by Tomas Akenine-Möller) ---
 
 #define X 0
@@ -1,14 +1,27 @@
 #pragma once
 
 #include "NavigationSystemDebugTools.h"
+#include "NavMesh.h"
+#include "NavMeshQuery.h"
+#include "NavMeshBatchQuery.h"
+#include "PathRequestManager.h"
+#include "HierarchicalPathfinder.h"
+#include "NavMeshIslands.h"
+#include "NavMeshLandmarks.h"
+#include "SpanPathfinder.h"
+#include "FlowField.h"
+#include "Crowd.h"
+#include "HeightFieldPyramid.h"
+#include "HeightFieldCache.h"
+#include "NavMeshTileCache.h"
+#include "NavMeshStreamer.h"
+#include "ChunkyTriMesh.h"
+#include "NavInputGeometry.h"
 #include "Core/Camera.h"
 #include "Core/Scene.h"
 
+class MappedFile;
 
-struct NavMesh
-{
-    
-};
 struct VoxelGrid
 {
     glm::vec3 minimumCorner;
@@ -21,7 +34,8 @@ struct VoxelGrid
 struct HeightFieldSpan
 {
     unsigned int spanMin, spanMax;
-    unsigned int areaID;
+    unsigned int areaID;  // 0 unwalkable, 1 walkable, region ID from 2 on
+    unsigned char area;   // NavAreaType of the top surface, kept when areaID turns into a region
     HeightFieldSpan* next;
 
     unsigned int connections[4]; // Connections to neighboring spans
@@ -48,6 +62,40 @@ struct ContourSet
     float cellSize, cellHeight;
 };
 
+// Build stages in pipeline order, each reruns only when its inputs changed since the last build.
+enum NavBuildStage
+{
+    NAVSTAGE_RASTERIZE,
+    NAVSTAGE_HEIGHTFIELD,
+    NAVSTAGE_FILTER,
+    NAVSTAGE_REGIONS,
+    NAVSTAGE_CONNECTIONS,
+    NAVSTAGE_CONTOURS,
+    NAVSTAGE_POLYMESH,
+    NAVSTAGE_COUNT
+};
+struct NavBuildConfig
+{
+    float cellSize, cellHeight;
+    float agentHeight, agentRadius, maxClimb;
+    int tileSize; // In cells
+};
+
+// Spans whose top lies within the heights and whose cell center lies inside the convex xz polygon get the area.
+struct NavConvexVolume
+{
+    std::vector<glm::vec3> verts;
+    float hmin, hmax;
+    unsigned char area;
+};
+
+// Agent size for a multi profile build, the cell sizes and tile size are shared by all profiles.
+struct NavAgentProfile
+{
+    std::string name;
+    float agentHeight, agentRadius, maxClimb;
+};
+
 enum DebugDrawMode
 {
     DRAWMODE_NONE,
@@ -70,18 +118,164 @@ public:
     ~NavigationSystem();
     
     void BuildNavMesh(const Scene& scene);
+    NavBuildConfig GetBuildConfig() const;
+    void SetBuildConfig(const NavBuildConfig& config);
+    // Binary tiles that are mapped and used in place on load instead of rebuilding from the scene.
+    bool SaveNavMesh(const char* path) const;
+    bool LoadNavMesh(const char* path);
+    // Keeps only the tiles of a saved navmesh around the focus points resident, loading them in the background.
+    bool StartNavMeshStreaming(const char* path);
+    void UpdateNavMeshStreaming(const std::vector<glm::vec3>& focusPoints); // Once per frame
+    const NavMeshStreamer& GetNavMeshStreamer() const { return m_NavMeshStreamer; }
+    // One navmesh per agent profile from the heightfield of the last build, which is brought up to date first.
+    // The profiles share its rasterization and are filtered, eroded and meshed in parallel.
+    void BuildNavMeshProfiles(const Scene& scene, const std::vector<NavAgentProfile>& profiles);
+    int GetProfileCount() const { return (int)m_AgentProfiles.size(); }
+    const NavAgentProfile& GetAgentProfile(int profile) const { return m_AgentProfiles[profile]; }
+    const NavMesh& GetProfileNavMesh(int profile) const { return m_ProfileNavMeshes[profile]; }
+    // Area markers applied after the walkable filter of the next build, on top of the areas of the scene objects.
+    void AddConvexVolume(const glm::vec3* verts, int count, float hmin, float hmax, unsigned char area);
+    void ClearConvexVolumes() { m_ConvexVolumes.clear(); }
+    const std::vector<NavConvexVolume>& GetConvexVolumes() const { return m_ConvexVolumes; }
+    // Jumps, ladders and teleports between points of the mesh, attached to the polys around their ends by the next build.
+    void AddOffMeshConnection(const glm::vec3& start, const glm::vec3& end, float radius, bool bidirectional,
+                              unsigned char area = NAVAREA_GROUND, float cost = 0.0f);
+    void ClearOffMeshConnections() { m_OffMeshConnections.clear(); }
+    const std::vector<NavOffMeshConnection>& GetOffMeshConnections() const { return m_OffMeshConnections; }
+    // Area costs and flags of the queries made through the navigation system.
+    const NavQueryFilter& GetQueryFilter() const { return m_QueryFilter; }
+    // Also handed to the crowd, the batch queries and the sliced requests.
+    void SetQueryFilter(const NavQueryFilter& filter);
+    bool FindPath(const glm::vec3& start, const glm::vec3& end, std::vector<glm::vec3>& outPath);
+    bool ArePointsConnected(const glm::vec3& a, const glm::vec3& b);
+    // Optional ALT landmark preprocessing for the A* queries, rebuilt with the navmesh while enabled.
+    void SetLandmarksEnabled(bool enabled);
+    bool AreLandmarksEnabled() const { return m_LandmarksEnabled; }
+    bool FindHierarchicalPath(const glm::vec3& start, const glm::vec3& end, std::vector<glm::vec3>& outPath);
+    void FindPaths(NavPathBatch& batch);
+    // Sliced requests, advanced by UpdatePathRequests within a per frame budget.
+    PathRequestHandle RequestPath(const glm::vec3& start, const glm::vec3& end);
+    void RequestRandomPaths(int count);
+    void UpdatePathRequests(float budgetMicroseconds, const glm::vec3& focusPoint);
+    PathRequestManager& GetPathRequestManager() { return m_PathRequests; }
+    bool FindSpanPath(const glm::vec3& start, const glm::vec3& end, std::vector<glm::vec3>& outPath);
+    // Shared per goal flow fields for groups of agents, a zero vector when the goal is reached or unreachable.
+    glm::vec3 SampleFlowField(const glm::vec3& goal, const glm::vec3& pos);
+    bool FindFlowFieldPath(const glm::vec3& start, const glm::vec3& goal, std::vector<glm::vec3>& outPath);
+    // Crowd agents on the navmesh, reset when the navmesh is rebuilt.
+    void SpawnCrowdAgents(int count);
+    void SetCrowdTarget(const glm::vec3& target);
+    void UpdateCrowd(float dt);
+    const Crowd& GetCrowd() const { return m_Crowd; }
+    // Along the navmesh surface when it is built, otherwise through the solid spans of the heightfield.
+    bool HasLineOfSight(const glm::vec3& from, const glm::vec3& to);
+    // Heightfield queries through the min/max height pyramid, tiles marked dirty are rebuilt first.
+    bool IsBoxObstructed(const glm::vec3& bmin, const glm::vec3& bmax);
+    bool FindSurfaceBelow(const glm::vec3& pos, float radius, float& height);
+    // Dynamic obstacles carved through the tile cache, the touched tiles are rebuilt by the next UpdateObstacles.
+    NavObstacleRef AddCylinderObstacle(const glm::vec3& baseCenter, float radius, float height);
+    NavObstacleRef AddBoxObstacle(const glm::vec3& bmin, const glm::vec3& bmax);
+    NavObstacleRef AddOrientedBoxObstacle(const glm::vec3& center, const glm::vec3& halfExtents, float yRotation);
+    bool RemoveObstacle(NavObstacleRef ref);
+    void RemoveAllObstacles();
+    void AddRandomObstacles(int count);
+    void UpdateObstacles(); // Once per frame
+    const NavMeshTileCache& GetTileCache() const { return m_TileCache; }
+    void RunQueryBenchmark(int numQueries);
+    void RunSpanPathBenchmark(int numQueries);
+    void RunBVTreeBenchmark(int numQueries);
+    void RunBatchQueryBenchmark(int numQueries);
+    void RunHierarchicalPathBenchmark(int numQueries);
+    void RunLandmarkBenchmark(int numQueries);
+    void RunFlowFieldBenchmark(int numAgents);
+    void RunCrowdBenchmark(int numAgents);
+    void RunPathCorridorBenchmark(int numAgents);
+    void RunRaycastBenchmark(int numRays);
+    void RunHeightPyramidBenchmark(int numQueries);
+    void RunNavMeshFileBenchmark();
+    void RunTileCacheBenchmark(int numObstacles);
+    void RunCompressionBenchmark();
+    void RunStreamingBenchmark();
+    void RunAgentProfileBenchmark();
+    void RunAreaCostBenchmark(int numQueries);
+    void RunOffMeshBenchmark(int numConnections);
+    void RunChunkyTriMeshBenchmark();
+    void RunInputGeometryBenchmark(int numObjects);
+    void RunBoxRasterizationBenchmark(int numBoxes);
     
     void RenderDebugData(Camera& camera, Shader* debugShader, const Scene& scene);
+
+    // Sets the voxels of the grid inside the cell rectangle that the triangle touches, solidVoxels counts the newly set ones.
+    static void RasterizeTriangle(VoxelGrid& grid, const glm::vec3 tri[3], int x0, int z0, int x1, int z1, int& solidVoxels);
+    // The voxels the box's triangles would set, stamped per column of its footprint: the full height under its side faces,
+    // the rows of its top and bottom face elsewhere.
+    static void RasterizeBox(VoxelGrid& grid, const NavInputBox& box, int x0, int z0, int x1, int z1, int& solidVoxels);
+
+    // Merges walkable spans into tiled rectangle polys and links them, also used on generated fields by the benchmarks.
+    static void BuildPolyMesh(const HeightField& heightField, int tileSize, NavMesh& navMesh);
+    // spanPolys receives the poly index of every span within its tile, kept for rebuilding single tiles.
+    static void BuildPolyMesh(const HeightField& heightField, int tileSize, NavMesh& navMesh, std::vector<unsigned int>& spanPolys);
+    // New polys for the tiles from the current span areas, relinking them and their neighbors, all of which end up in relinkedTiles.
+    static void RebuildPolyMeshTiles(const HeightField& heightField, const std::vector<int>& tiles, NavMesh& navMesh,
+                                     std::vector<unsigned int>& spanPolys, std::vector<int>& relinkedTiles);
+    // Region flood fill of the walkable spans (areaID 1) inside a cell rectangle, numbered from firstRegion. Regions never
+    // cross area types. Returns the next free region.
+    static unsigned int BuildRegions(HeightField& heightField, int walkableClimb, int x0, int z0, int x1, int z1, unsigned int firstRegion);
+    // Connections of the spans inside a cell rectangle to their walkable neighbors, which may lie outside it.
+    static void BuildConnections(HeightField& heightField, int walkableClimb, int x0, int z0, int x1, int z1);
+    // Marks spans with less than walkableHeight cells of headroom unwalkable (0) and all others walkable (1),
+    // fieldHeight is the top of the rasterized volume in cells.
+    static void FilterWalkableSurfaces(HeightField& heightField, int walkableHeight, int fieldHeight);
+    // Makes walkable spans within walkableRadius cells of an unwalkable neighbor or the field edge unwalkable.
+    static void ErodeWalkableArea(HeightField& heightField, int walkableRadius, int walkableClimb);
+    // Gives the spans under the upward facing triangles the area of their triangle, triangles of NAVAREA_GROUND are skipped.
+    static void MarkTriangleAreas(HeightField& heightField, const NavInputGeometry& geometry);
+    static void MarkConvexVolumeArea(HeightField& heightField, const NavConvexVolume& volume);
+    // Filter, erosion, regions, connections and polys of every profile on its own copy of the heightfield,
+    // one profile per job when a job system is given.
+    static void BuildProfileNavMeshes(const HeightField& heightField, int fieldHeight, int tileSize, const std::vector<NavAgentProfile>& profiles,
+                                      JobSystem* jobSystem, std::vector<NavMesh>& navMeshes);
 private:
     NavigationSystemDebugTools* m_DebugTools;
 
-    std::vector<Triangle> m_InputTriangles;
+    NavInputGeometry m_InputGeometry;
+    ChunkyTriMesh m_ChunkyTriMesh; // Gathers the triangles of each tile for rasterization
+    uint64_t m_ChunkyTriMeshKey;   // Hash of the triangles it was built from
+    std::vector<NavConvexVolume> m_ConvexVolumes;
+    std::vector<NavOffMeshConnection> m_OffMeshConnections;
+    NavQueryFilter m_QueryFilter;
     float m_AgentHeight, m_AgentRadius, m_MaxClimb;
+    float m_CellSize, m_CellHeight;
+    int m_TileSize;
+    uint64_t m_StageKeys[NAVSTAGE_COUNT]; // Inputs each stage's current output was built from
+    std::vector<unsigned int> m_WalkableAreas; // Span areas after the walkable filter, before regions overwrite them
 
     NavMesh m_NavMesh;
+    MappedFile* m_NavMeshFile; // Backs the tiles of a loaded navmesh
+    NavMeshStreamer m_NavMeshStreamer;
+    NavMeshQuery* m_NavQuery;
+    NavMeshBatchQuery* m_BatchQuery;
+    JobSystem* m_JobSystem;
+    PathRequestManager m_PathRequests;
+    HierarchicalPathfinder m_HierarchicalPathfinder;
+    NavMeshIslands m_NavMeshIslands;
+    NavMeshLandmarks m_NavMeshLandmarks;
+    bool m_LandmarksEnabled;
+    std::vector<PathRequestHandle> m_QueuedPathRequests; // Requested through RequestPath, drained in UpdatePathRequests
+    SpanPathfinder m_SpanPathfinder;
+    FlowFieldCache m_FlowFields;
+    Crowd m_Crowd;
+    HeightFieldPyramid m_HeightFieldPyramid;
+    std::vector<glm::vec3> m_DebugPath;
     VoxelGrid m_VoxelGrid;
+    HeightFieldCache m_HeightFieldCache;
     HeightField m_HeightField;
     ContourSet m_ContourSet;
+    std::vector<unsigned int> m_SpanPolys; // Poly of each span in its tile
+    NavMeshTileCache m_TileCache;
+    std::vector<int> m_RebuiltTiles;
+    std::vector<NavAgentProfile> m_AgentProfiles;
+    std::vector<NavMesh> m_ProfileNavMeshes;
     
     void Voxelize();
     void Rasterization();
@@ -90,6 +284,9 @@ private:
     void BuldRegions();
     void BuildConnections();
     void BuildContours();
+    void BuildPolyMesh();
+    void InitNavMeshQueries();
+    void OnTileRebuilt(int tileIndex);
     
-    bool TriBoxOverlap(const float boxcenter[3], const float boxhalfsize[3], const float triverts[3][3]);
+    static bool TriBoxOverlap(const float boxcenter[3], const float boxhalfsize[3], const float triverts[3][3]);
 };
@@ -0,0 +1,2148 @@
+#include "NavigationSystemBenchmarks.h"
+#include "NavMeshQuery.h"
+#include "NavMeshBatchQuery.h"
+#include "NavigationSystem.h"
+#include "SpanPathfinder.h"
+#include "HierarchicalPathfinder.h"
+#include "NavMeshIslands.h"
+#include "NavMeshLandmarks.h"
+#include "FlowField.h"
+#include "Crowd.h"
+#include "PathCorridor.h"
+#include "HeightFieldPyramid.h"
+#include "NavMeshFile.h"
+#include "NavMeshTileCache.h"
+#include "NavCompression.h"
+#include "NavMeshStreamer.h"
+#include "ChunkyTriMesh.h"
+#include "Core/MappedFile.h"
+#include "Core/JobSystem.h"
+#include <algorithm>
+#include <cfloat>
+#include <cstdint>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <random>
+
+static const int BENCH_MAX_PATH_POLYS = 256;
+static const int BENCH_MAX_STRAIGHT_PATH = 256;
+static const int BENCH_MAX_NODES = 4096;
+
+static void CollectPolyCenters(const NavMesh& navMesh, std::vector<glm::vec3>& centers)
+{
+    centers.clear();
+    for (const auto& tile : navMesh.tiles)
+        for (const auto& poly : tile.polys)
+            centers.push_back((poly.bmin + poly.bmax) * 0.5f);
+}
+
+void NavigationSystemBenchmarks::RunQueryBenchmark(const NavMesh& navMesh, int numQueries)
+{
+    std::vector<glm::vec3> centers;
+    CollectPolyCenters(navMesh, centers);
+    if (centers.size() < 2 || numQueries <= 0)
+    {
+        std::cout << "Query benchmark: build a navmesh first." << std::endl;
+        return;
+    }
+
+    NavMeshQuery query;
+    query.Init(&navMesh, BENCH_MAX_NODES);
+    NavQueryFilter filter;
+
+    std::mt19937 rng(1234);
+    std::uniform_int_distribution<size_t> pick(0, centers.size() - 1);
+    std::vector<glm::vec3> starts(numQueries), ends(numQueries);
+    for (int i = 0; i < numQueries; ++i)
+    {
+        starts[i] = centers[pick(rng)];
+        ends[i] = centers[pick(rng)];
+    }
+
+    const glm::vec3 halfExtents(1.0f, 2.0f, 1.0f);
+    NavPolyRef path[BENCH_MAX_PATH_POLYS];
+    glm::vec3 straightPath[BENCH_MAX_STRAIGHT_PATH];
+    long long totalPolys = 0, totalCorners = 0;
+    int failed = 0;
+
+    const auto begin = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < numQueries; ++i)
+    {
+        NavPolyRef startRef, endRef;
+        glm::vec3 startPos, endPos;
+        query.FindNearestPoly(starts[i], halfExtents, filter, startRef, startPos);
+        query.FindNearestPoly(ends[i], halfExtents, filter, endRef, endPos);
+
+        int pathCount = 0, straightCount = 0;
+        if (query.FindPath(startRef, endRef, startPos, endPos, filter, path, pathCount, BENCH_MAX_PATH_POLYS) != NAVQUERY_SUCCESS)
+            failed++;
+        query.FindStraightPath(startPos, endPos, path, pathCount, straightPath, straightCount, BENCH_MAX_STRAIGHT_PATH);
+        totalPolys += pathCount;
+        totalCorners += straightCount;
+    }
+    const auto end = std::chrono::high_resolution_clock::now();
+
+    const double seconds = std::chrono::duration<double>(end - begin).count();
+    std::cout << "Query benchmark: " << numQueries << " queries over " << centers.size() << " polys in " << seconds * 1000.0 << " ms" << std::endl;
+    std::cout << "  " << (seconds > 0.0 ? numQueries / seconds : 0.0) << " queries/s, " << seconds * 1e6 / numQueries << " us/query, "
+              << (double)totalPolys / numQueries << " polys/path, " << (double)totalCorners / numQueries << " corners/path, "
+              << failed << " partial or failed" << std::endl;
+}
+
+void NavigationSystemBenchmarks::RunBatchQueryBenchmark(const NavMesh& navMesh, JobSystem& jobSystem, int numQueries)
+{
+    std::vector<glm::vec3> centers;
+    CollectPolyCenters(navMesh, centers);
+    if (centers.size() < 2 || numQueries <= 0)
+    {
+        std::cout << "Batch query benchmark: build a navmesh first." << std::endl;
+        return;
+    }
+
+    // Every fourth request repeats an earlier one, like agents sharing a target.
+    NavPathBatch batch;
+    batch.Resize(numQueries, BENCH_MAX_STRAIGHT_PATH);
+    std::mt19937 rng(1234);
+    std::uniform_int_distribution<size_t> pick(0, centers.size() - 1);
+    std::uniform_real_distribution<float> jitter(-0.4f, 0.4f);
+    for (int i = 0; i < numQueries; ++i)
+    {
+        if (i % 4 == 3)
+        {
+            const int repeated = (int)(rng() % i);
+            batch.starts[i] = batch.starts[repeated];
+            batch.ends[i] = batch.ends[repeated];
+            continue;
+        }
+        batch.starts[i] = centers[pick(rng)] + glm::vec3(jitter(rng), 0.0f, jitter(rng));
+        batch.ends[i] = centers[pick(rng)] + glm::vec3(jitter(rng), 0.0f, jitter(rng));
+    }
+
+    NavMeshQuery query;
+    query.Init(&navMesh, BENCH_MAX_NODES);
+    NavQueryFilter filter;
+    NavPolyRef path[BENCH_MAX_PATH_POLYS];
+    std::vector<int> serialCorners(numQueries);
+
+    auto begin = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < numQueries; ++i)
+    {
+        NavPolyRef startRef, endRef;
+        glm::vec3 startPos, endPos;
+        query.FindNearestPoly(batch.starts[i], batch.halfExtents, filter, startRef, startPos);
+        query.FindNearestPoly(batch.ends[i], batch.halfExtents, filter, endRef, endPos);
+        int pathCount = 0;
+        serialCorners[i] = 0;
+        if (query.FindPath(startRef, endRef, startPos, endPos, filter, path, pathCount, BENCH_MAX_PATH_POLYS) == NAVQUERY_FAILURE)
+            continue;
+        glm::vec3* corners = &batch.corners[(size_t)i * batch.maxCorners];
+        query.FindStraightPath(startPos, endPos, path, pathCount, corners, serialCorners[i], BENCH_MAX_STRAIGHT_PATH);
+    }
+    const double serialSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - begin).count();
+
+    NavMeshBatchQuery batchQuery;
+    batchQuery.Init(&navMesh, BENCH_MAX_NODES, &jobSystem);
+    begin = std::chrono::high_resolution_clock::now();
+    batchQuery.Run(batch);
+    const double batchSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - begin).count();
+
+    int mismatches = 0;
+    for (int i = 0; i < numQueries; ++i)
+        if (batch.cornerCount[i] != serialCorners[i])
+            mismatches++;
+
+    std::cout << "Batch query benchmark: " << numQueries << " requests (" << batchQuery.GetUniqueRequestCount() << " unique) on "
+              << jobSystem.GetWorkerCount() << " workers" << std::endl;
+    std::cout << "  serial " << serialSeconds * 1000.0 << " ms, batch " << batchSeconds * 1000.0 << " ms, "
+              << (batchSeconds > 0.0 ? serialSeconds / batchSeconds : 0.0) << "x, " << mismatches << " corner count mismatches" << std::endl;
+}
+
+// Tiles filled with 4x4 cell polys at a few random heights, bounds only, no links.
+static void BuildGridNavMesh(NavMesh& navMesh, int tilesPerSide)
+{
+    navMesh.bmin = glm::vec3(0.0f);
+    navMesh.cellSize = 1.0f;
+    navMesh.cellHeight = 0.5f;
+    navMesh.tileSize = 16;
+    navMesh.tilesX = tilesPerSide;
+    navMesh.tilesZ = tilesPerSide;
+    navMesh.tiles.assign(tilesPerSide * tilesPerSide, NavMeshTile());
+
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<unsigned int> height(0, 8);
+    for (int tz = 0; tz < tilesPerSide; ++tz)
+    {
+        for (int tx = 0; tx < tilesPerSide; ++tx)
+        {
+            NavMeshTile& tile = navMesh.tiles[tx + tz * tilesPerSide];
+            tile.tileX = tx;
+            tile.tileZ = tz;
+            tile.salt = 1;
+            tile.bmin = glm::vec3(FLT_MAX);
+            tile.bmax = glm::vec3(-FLT_MAX);
+            for (int pz = 0; pz < navMesh.tileSize; pz += 4)
+            {
+                for (int px = 0; px < navMesh.tileSize; px += 4)
+                {
+                    NavPoly poly = {};
+                    poly.minX = tx * navMesh.tileSize + px;
+                    poly.minZ = tz * navMesh.tileSize + pz;
+                    poly.maxX = poly.minX + 3;
+                    poly.maxZ = poly.minZ + 3;
+                    poly.spanY = height(rng);
+                    poly.area = NAVAREA_GROUND;
+                    poly.flags = GetAreaPolyFlags(NAVAREA_GROUND);
+                    const float y = navMesh.bmin.y + (poly.spanY + 1) * navMesh.cellHeight;
+                    poly.bmin = glm::vec3(navMesh.bmin.x + poly.minX * navMesh.cellSize, y, navMesh.bmin.z + poly.minZ * navMesh.cellSize);
+                    poly.bmax = glm::vec3(navMesh.bmin.x + (poly.maxX + 1) * navMesh.cellSize, y, navMesh.bmin.z + (poly.maxZ + 1) * navMesh.cellSize);
+                    tile.bmin = glm::min(tile.bmin, poly.bmin);
+                    tile.bmax = glm::max(tile.bmax, poly.bmax);
+                    tile.polys.push_back(poly);
+                }
+            }
+            BuildTileBVTree(navMesh, tile);
+        }
+    }
+}
+
+static void BruteForceQueryPolygons(const NavMesh& navMesh, const glm::vec3& qmin, const glm::vec3& qmax, std::vector<NavPolyRef>& refs)
+{
+    refs.clear();
+    for (const auto& tile : navMesh.tiles)
+    {
+        const NavPolyRef base = navMesh.GetPolyRefBase(tile);
+        for (size_t i = 0; i < tile.polys.size(); ++i)
+        {
+            const NavPoly& poly = tile.polys[i];
+            if (qmin.x <= poly.bmax.x && qmax.x >= poly.bmin.x && qmin.y <= poly.bmax.y && qmax.y >= poly.bmin.y &&
+                qmin.z <= poly.bmax.z && qmax.z >= poly.bmin.z)
+                refs.push_back(base | (NavPolyRef)i);
+        }
+    }
+}
+
+static void TimeBVTreeQueries(const char* label, const NavMesh& navMesh, int numQueries)
+{
+    glm::vec3 meshMin(FLT_MAX), meshMax(-FLT_MAX);
+    for (const auto& tile : navMesh.tiles)
+    {
+        if (tile.polys.empty())
+            continue;
+        meshMin = glm::min(meshMin, tile.bmin);
+        meshMax = glm::max(meshMax, tile.bmax);
+    }
+    if (meshMin.x > meshMax.x)
+        return;
+
+    NavMeshQuery query;
+    query.Init(&navMesh, BENCH_MAX_NODES);
+    NavQueryFilter filter;
+
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> px(meshMin.x, meshMax.x), py(meshMin.y, meshMax.y), pz(meshMin.z, meshMax.z);
+    std::vector<glm::vec3> centers(numQueries);
+    for (auto& center : centers)
+        center = glm::vec3(px(rng), py(rng), pz(rng));
+    const glm::vec3 halfExtents(2.0f, 2.0f, 2.0f);
+
+    // The tree must return exactly the brute force set.
+    std::vector<NavPolyRef> expected;
+    std::vector<NavPolyRef> found(navMesh.GetPolyCount() + 1);
+    int mismatches = 0;
+    for (const auto& center : centers)
+    {
+        int count = 0;
+        query.QueryPolygons(center, halfExtents, filter, found.data(), count, (int)found.size());
+        BruteForceQueryPolygons(navMesh, center - halfExtents, center + halfExtents, expected);
+        std::sort(found.begin(), found.begin() + count);
+        std::sort(expected.begin(), expected.end());
+        if (count != (int)expected.size() || !std::equal(expected.begin(), expected.end(), found.begin()))
+            mismatches++;
+    }
+
+    auto begin = std::chrono::high_resolution_clock::now();
+    for (const auto& center : centers)
+    {
+        int count = 0;
+        query.QueryPolygons(center, halfExtents, filter, found.data(), count, (int)found.size());
+    }
+    const double treeSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - begin).count();
+
+    begin = std::chrono::high_resolution_clock::now();
+    for (const auto& center : centers)
+        BruteForceQueryPolygons(navMesh, center - halfExtents, center + halfExtents, expected);
+    const double bruteSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - begin).count();
+
+    std::cout << "BV tree benchmark (" << label << ", " << navMesh.GetPolyCount() << " polys): " << numQueries << " queries, tree "
+              << treeSeconds * 1e6 / numQueries << " us/query, brute force " << bruteSeconds * 1e6 / numQueries << " us/query, "
+              << (treeSeconds > 0.0 ? bruteSeconds / treeSeconds : 0.0) << "x, " << mismatches << " mismatches" << std::endl;
+}
+
+void NavigationSystemBenchmarks::RunBVTreeBenchmark(const NavMesh& navMesh, int numQueries)
+{
+    if (numQueries <= 0)
+        return;
+
+    TimeBVTreeQueries("built mesh", navMesh, numQueries);
+
+    NavMesh gridMesh;
+    BuildGridNavMesh(gridMesh, 16);
+    TimeBVTreeQueries("256x256 generated", gridMesh, numQueries);
+}
+
+// Flat single-level field, one span per cell, blocked cells unwalkable.
+static void BuildFlatField(HeightField& heightField, int size, const std::vector<unsigned char>& blocked)
+{
+    heightField.width = size;
+    heightField.depth = size;
+    heightField.bmin = glm::vec3(0.0f);
+    heightField.cellSize = 1.0f;
+    heightField.cellHeight = 1.0f;
+    heightField.spans = new HeightFieldSpan*[size * size];
+    heightField.spanPool.assign(size * size, HeightFieldSpan());
+
+    for (int i = 0; i < size * size; ++i)
+    {
+        HeightFieldSpan& span = heightField.spanPool[i];
+        span.spanMin = 0;
+        span.spanMax = 0;
+        span.areaID = blocked[i] ? 0 : 2;
+        span.next = nullptr;
+        heightField.spans[i] = &span;
+    }
+
+    const int dx[] = {-1, 0, 1, 0};
+    const int dz[] = {0, -1, 0, 1};
+    for (int z = 0; z < size; ++z)
+    {
+        for (int x = 0; x < size; ++x)
+        {
+            HeightFieldSpan& span = heightField.spanPool[x + z * size];
+            for (int dir = 0; dir < 4; ++dir)
+            {
+                const int nx = x + dx[dir], nz = z + dz[dir];
+                const bool open = !blocked[x + z * size] && nx >= 0 && nz >= 0 && nx < size && nz < size && !blocked[nx + nz * size];
+                span.connections[dir] = open ? (unsigned int)(nx + nz * size) + 1 : 0;
+            }
+        }
+    }
+}
+
+// 4x4 pillars scattered on a lattice of the given spacing.
+static void BuildPillarField(HeightField& heightField, int size, int spacing)
+{
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> offset(spacing / 8, spacing * 3 / 4);
+    std::vector<unsigned char> blocked(size * size, 0);
+    for (int cz = 0; cz < size; cz += spacing)
+    {
+        for (int cx = 0; cx < size; cx += spacing)
+        {
+            const int px = cx + offset(rng), pz = cz + offset(rng);
+            for (int z = pz; z < std::min(size, pz + 4); ++z)
+                for (int x = px; x < std::min(size, px + 4); ++x)
+                    blocked[x + z * size] = 1;
+        }
+    }
+    BuildFlatField(heightField, size, blocked);
+}
+
+// Perfect maze carved by a randomized depth first search, corridors and walls are corridorWidth cells wide.
+static void BuildMazeField(HeightField& heightField, int size, int corridorWidth)
+{
+    const int pitch = corridorWidth * 2;
+    const int cells = size / pitch;
+    std::vector<unsigned char> blocked(size * size, 1);
+    auto carve = [&](int x0, int z0, int x1, int z1)
+    {
+        for (int z = z0; z < z1; ++z)
+            for (int x = x0; x < x1; ++x)
+                blocked[x + z * size] = 0;
+    };
+
+    std::mt19937 rng(42);
+    std::vector<unsigned char> visited(cells * cells, 0);
+    std::vector<int> stack(1, 0);
+    visited[0] = 1;
+    carve(0, 0, corridorWidth, corridorWidth);
+    while (!stack.empty())
+    {
+        const int cell = stack.back();
+        const int cx = cell % cells, cz = cell / cells;
+        int candidates[4], candidateCount = 0;
+        if (cx > 0 && !visited[cell - 1]) candidates[candidateCount++] = cell - 1;
+        if (cz > 0 && !visited[cell - cells]) candidates[candidateCount++] = cell - cells;
+        if (cx < cells - 1 && !visited[cell + 1]) candidates[candidateCount++] = cell + 1;
+        if (cz < cells - 1 && !visited[cell + cells]) candidates[candidateCount++] = cell + cells;
+        if (candidateCount == 0)
+        {
+            stack.pop_back();
+            continue;
+        }
+
+        const int next = candidates[std::uniform_int_distribution<int>(0, candidateCount - 1)(rng)];
+        const int nx = next % cells, nz = next / cells;
+        visited[next] = 1;
+        carve(std::min(cx, nx) * pitch, std::min(cz, nz) * pitch, std::max(cx, nx) * pitch + corridorWidth,
+              std::max(cz, nz) * pitch + corridorWidth);
+        stack.push_back(next);
+    }
+    BuildFlatField(heightField, size, blocked);
+}
+
+static void TimeSpanPaths(const char* label, const HeightField& heightField, const std::vector<unsigned int>& walkable, int numQueries)
+{
+    SpanPathfinder pathfinder;
+    pathfinder.Init(&heightField);
+
+    std::mt19937 rng(1234);
+    std::uniform_int_distribution<size_t> pick(0, walkable.size() - 1);
+    unsigned int path[1024];
+    long long expanded = 0;
+    int found = 0;
+
+    const auto begin = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < numQueries; ++i)
+    {
+        int pathCount = 0;
+        if (pathfinder.FindPath(walkable[pick(rng)], walkable[pick(rng)], path, pathCount, 1024))
+            found++;
+        expanded += pathfinder.GetExpandedNodes();
+    }
+    const auto end = std::chrono::high_resolution_clock::now();
+
+    const double seconds = std::chrono::duration<double>(end - begin).count();
+    std::cout << "Span path benchmark (" << label << "): " << numQueries << " queries, " << seconds * 1000.0 / numQueries << " ms/query, "
+              << (double)expanded / numQueries << " nodes expanded/query, " << found << " found" << std::endl;
+}
+
+void NavigationSystemBenchmarks::RunSpanPathBenchmark(const HeightField& heightField, int numQueries)
+{
+    if (numQueries <= 0)
+        return;
+
+    std::vector<unsigned int> walkable;
+    for (size_t i = 0; i < heightField.spanPool.size(); ++i)
+        if (heightField.spanPool[i].areaID != 0)
+            walkable.push_back((unsigned int)i);
+    if (!walkable.empty())
+        TimeSpanPaths("built heightfield", heightField, walkable, numQueries);
+
+    HeightField pillarField;
+    BuildPillarField(pillarField, 1024, 32);
+    walkable.clear();
+    for (size_t i = 0; i < pillarField.spanPool.size(); ++i)
+        if (pillarField.spanPool[i].areaID != 0)
+            walkable.push_back((unsigned int)i);
+    TimeSpanPaths("1024x1024 pillars", pillarField, walkable, numQueries);
+    delete[] pillarField.spans;
+}
+
+void NavigationSystemBenchmarks::RunHierarchicalPathBenchmark(int numQueries)
+{
+    if (numQueries <= 0)
+        return;
+
+    const int fieldSize = 2048;
+    HeightField field;
+    BuildPillarField(field, fieldSize, 12);
+    NavMesh navMesh;
+    NavigationSystem::BuildPolyMesh(field, 16, navMesh);
+    delete[] field.spans;
+    field.spans = nullptr;
+    field.spanPool.clear();
+    field.spanPool.shrink_to_fit();
+
+    const int maxNodes = 1 << 20;
+    NavMeshQuery query;
+    query.Init(&navMesh, maxNodes);
+    HierarchicalPathfinder hierarchical;
+    hierarchical.Init(&navMesh, 4, maxNodes);
+
+    auto begin = std::chrono::high_resolution_clock::now();
+    hierarchical.Build();
+    const double buildSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - begin).count();
+
+    begin = std::chrono::high_resolution_clock::now();
+    const int rebuiltTile = (int)navMesh.tiles.size() / 2 + navMesh.tilesX / 2;
+    hierarchical.MarkTileChanged(rebuiltTile);
+    hierarchical.RebuildChangedClusters();
+    const double rebuildSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - begin).count();
+
+    std::cout << "HPA* benchmark: " << navMesh.GetPolyCount() << " polys, " << hierarchical.GetClusterCount() << " clusters, "
+              << hierarchical.GetEntranceCount() << " entrances, build " << buildSeconds * 1000.0 << " ms, tile rebuild "
+              << rebuildSeconds * 1000.0 << " ms" << std::endl;
+
+    // Cross map pairs: start in the first quarter, end in the last.
+    std::vector<NavPolyRef> startRefs, endRefs;
+    std::vector<glm::vec3> startPositions, endPositions;
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> nearCorner(16.0f, fieldSize * 0.25f), farCorner(fieldSize * 0.75f, fieldSize - 16.0f);
+    NavQueryFilter filter;
+    const glm::vec3 halfExtents(2.0f, 2.0f, 2.0f);
+    while ((int)startRefs.size() < numQueries)
+    {
+        NavPolyRef startRef, endRef;
+        glm::vec3 startPos, endPos;
+        query.FindNearestPoly(glm::vec3(nearCorner(rng), 1.0f, nearCorner(rng)), halfExtents, filter, startRef, startPos);
+        query.FindNearestPoly(glm::vec3(farCorner(rng), 1.0f, farCorner(rng)), halfExtents, filter, endRef, endPos);
+        if (!startRef || !endRef)
+            continue;
+        startRefs.push_back(startRef);
+        endRefs.push_back(endRef);
+        startPositions.push_back(startPos);
+        endPositions.push_back(endPos);
+    }
+
+    std::vector<NavPolyRef> path(4096);
+    std::vector<glm::vec3> straightPath(4096);
+    auto pathLength = [&](NavMeshQuery& lengthQuery, int i, int pathCount)
+    {
+        int cornerCount = 0;
+        lengthQuery.FindStraightPath(startPositions[i], endPositions[i], path.data(), pathCount, straightPath.data(), cornerCount,
+                                     (int)straightPath.size());
+        float length = 0.0f;
+        for (int c = 1; c < cornerCount; ++c)
+            length += glm::distance(straightPath[c - 1], straightPath[c]);
+        return length;
+    };
+
+    double flatSeconds = 0.0, hierarchicalSeconds = 0.0, flatLength = 0.0, hierarchicalLength = 0.0;
+    long long flatExpanded = 0, abstractExpanded = 0, refineExpanded = 0;
+    int flatFound = 0, hierarchicalFound = 0;
+    for (int i = 0; i < numQueries; ++i)
+    {
+        int pathCount = 0;
+        begin = std::chrono::high_resolution_clock::now();
+        const NavQueryStatus flatStatus = query.FindPath(startRefs[i], endRefs[i], startPositions[i], endPositions[i], filter, path.data(),
+                                                         pathCount, (int)path.size());
+        flatSeconds += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - begin).count();
+        flatExpanded += query.GetNodePool()->GetNodeCount();
+        if (flatStatus == NAVQUERY_SUCCESS)
+        {
+            flatFound++;
+            flatLength += pathLength(query, i, pathCount);
+        }
+
+        begin = std::chrono::high_resolution_clock::now();
+        const NavQueryStatus status = hierarchical.FindPath(startRefs[i], endRefs[i], startPositions[i], endPositions[i], filter, path.data(),
+                                                            pathCount, (int)path.size());
+        hierarchicalSeconds += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - begin).count();
+        abstractExpanded += hierarchical.GetLastAbstractExpansions();
+        refineExpanded += hierarchical.GetLastRefineExpansions();
+        if (status == NAVQUERY_SUCCESS)
+        {
+            hierarchicalFound++;
+            hierarchicalLength += pathLength(query, i, pathCount);
+        }
+    }
+
+    std::cout << "  poly A*: " << flatSeconds * 1000.0 / numQueries << " ms/query, " << (double)flatExpanded / numQueries
+              << " nodes/query, " << flatFound << " found" << std::endl;
+    std::cout << "  HPA*:    " << hierarchicalSeconds * 1000.0 / numQueries << " ms/query, " << (double)abstractExpanded / numQueries
+              << " entrances + " << (double)refineExpanded / numQueries << " polys/query, " << hierarchicalFound << " found, path length "
+              << (flatLength > 0.0 ? hierarchicalLength / flatLength : 0.0) << "x of poly A*" << std::endl;
+}
+
+static void TimeLandmarkQueries(const char* label, HeightField& field, int numQueries, int landmarkCount)
+{
+    NavMesh navMesh;
+    NavigationSystem::BuildPolyMesh(field, 16, navMesh);
+    delete[] field.spans;
+    field.spans = nullptr;
+    field.spanPool.clear();
+    field.spanPool.shrink_to_fit();
+
+    NavMeshIslands islands;
+    islands.Build(navMesh);
+    NavMeshLandmarks landmarks;
+    auto begin = std::chrono::high_resolution_clock::now();
+    landmarks.Build(navMesh, landmarkCount);
+    const double buildSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - begin).count();
+
+    const int polyCount = navMesh.GetPolyCount();
+    std::cout << "ALT benchmark (" << label << "): " << polyCount << " polys, " << landmarks.GetLandmarkCount() << " landmarks, build "
+              << buildSeconds * 1000.0 << " ms, " << landmarks.GetMemoryBytes() / 1024 << " KB ("
+              << (double)landmarks.GetMemoryBytes() / std::max(polyCount, 1) << " bytes/poly)" << std::endl;
+
+    NavMeshQuery plainQuery, landmarkQuery;
+    plainQuery.Init(&navMesh, polyCount + 1);
+    landmarkQuery.Init(&navMesh, polyCount + 1);
+    landmarkQuery.SetLandmarks(&landmarks);
+
+    std::vector<NavPolyRef> refs;
+    std::vector<glm::vec3> centers;
+    for (const auto& tile : navMesh.tiles)
+    {
+        for (unsigned int p = 0; p < tile.polys.size(); ++p)
+        {
+            refs.push_back(navMesh.GetPolyRefBase(tile) | p);
+            centers.push_back((tile.polys[p].bmin + tile.polys[p].bmax) * 0.5f);
+        }
+    }
+    std::vector<int> starts, ends;
+    std::mt19937 rng(1234);
+    std::uniform_int_distribution<int> pick(0, polyCount - 1);
+    while ((int)starts.size() < numQueries)
+    {
+        const int a = pick(rng), b = pick(rng);
+        if (!islands.AreConnected(refs[a], refs[b]))
+            continue;
+        starts.push_back(a);
+        ends.push_back(b);
+    }
+
+    std::vector<NavPolyRef> path(polyCount);
+    std::vector<glm::vec3> straightPath(4096);
+    auto pathLength = [&](NavMeshQuery& query, int i, int pathCount)
+    {
+        int cornerCount = 0;
+        query.FindStraightPath(centers[starts[i]], centers[ends[i]], path.data(), pathCount, straightPath.data(), cornerCount,
+                               (int)straightPath.size());
+        float length = 0.0f;
+        for (int c = 1; c < cornerCount; ++c)
+            length += glm::distance(straightPath[c - 1], straightPath[c]);
+        return length;
+    };
+
+    NavQueryFilter filter;
+    double plainSeconds = 0.0, landmarkSeconds = 0.0, plainLength = 0.0, landmarkLength = 0.0;
+    long long plainNodes = 0, landmarkNodes = 0;
+    int plainFound = 0, landmarkFound = 0;
+    for (int i = 0; i < numQueries; ++i)
+    {
+        const NavPolyRef startRef = refs[starts[i]], endRef = refs[ends[i]];
+        int pathCount = 0;
+        begin = std::chrono::high_resolution_clock::now();
+        NavQueryStatus status = plainQuery.FindPath(startRef, endRef, centers[starts[i]], centers[ends[i]], filter, path.data(), pathCount,
+                                                    (int)path.size());
+        plainSeconds += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - begin).count();
+        plainNodes += plainQuery.GetNodePool()->GetNodeCount();
+        if (status == NAVQUERY_SUCCESS)
+        {
+            plainFound++;
+            plainLength += pathLength(plainQuery, i, pathCount);
+        }
+
+        begin = std::chrono::high_resolution_clock::now();
+        status = landmarkQuery.FindPath(startRef, endRef, centers[starts[i]], centers[ends[i]], filter, path.data(), pathCount,
+                                        (int)path.size());
+        landmarkSeconds += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - begin).count();
+        landmarkNodes += landmarkQuery.GetNodePool()->GetNodeCount();
+        if (status == NAVQUERY_SUCCESS)
+        {
+            landmarkFound++;
+            landmarkLength += pathLength(landmarkQuery, i, pathCount);
+        }
+    }
+
+    std::cout << "  A*:     " << plainSeconds * 1000.0 / numQueries << " ms/query, " << (double)plainNodes / numQueries << " nodes/query, "
+              << plainFound << " found" << std::endl;
+    std::cout << "  ALT A*: " << landmarkSeconds * 1000.0 / numQueries << " ms/query, " << (double)landmarkNodes / numQueries
+              << " nodes/query, " << landmarkFound << " found, path length " << (plainLength > 0.0 ? landmarkLength / plainLength : 0.0)
+              << "x of A*" << std::endl;
+}
+
+void NavigationSystemBenchmarks::RunLandmarkBenchmark(int numQueries, int landmarkCount)
+{
+    if (numQueries <= 0)
+        return;
+
+    HeightField maze;
+    BuildMazeField(maze, 512, 4);
+    TimeLandmarkQueries("512x512 maze", maze, numQueries, landmarkCount);
+
+    HeightField pillars;
+    BuildPillarField(pillars, 1024, 12);
+    TimeLandmarkQueries("1024x1024 pillars", pillars, numQueries, landmarkCount);
+}
+
+static void TimeFlowField(const char* label, const HeightField& field, int numAgents)
+{
+    SpanPathfinder pathfinder;
+    pathfinder.Init(&field);
+    FlowFieldCache flowFields;
+    flowFields.Init(&field, 16, 8, 2);
+
+    const unsigned int goalSpan = pathfinder.FindSpan(glm::vec3(field.width * 0.5f, 0.0f, field.depth * 0.5f), 2.0f);
+    std::vector<unsigned int> agents;
+    std::mt19937 rng(1234);
+    std::uniform_int_distribution<size_t> pick(0, field.spanPool.size() - 1);
+    while ((int)agents.size() < numAgents)
+    {
+        const unsigned int span = (unsigned int)pick(rng);
+        if (field.spanPool[span].areaID != 0 && pathfinder.AreConnected(span, goalSpan))
+            agents.push_back(span);
+    }
+
+    std::vector<unsigned int> path(field.width * field.depth);
+    auto begin = std::chrono::high_resolution_clock::now();
+    int found = 0;
+    for (unsigned int agent : agents)
+    {
+        int pathCount = 0;
+        if (pathfinder.FindPath(agent, goalSpan, path.data(), pathCount, (int)path.size()))
+            found++;
+    }
+    const double searchSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - begin).count();
+
+    std::vector<glm::vec3> directions(agents.size());
+    begin = std::chrono::high_resolution_clock::now();
+    const int fieldIndex = flowFields.AcquireField(goalSpan);
+    flowFields.SampleDirections(fieldIndex, agents.data(), directions.data(), (int)agents.size());
+    const double firstSampleSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - begin).count();
+    const int computedTiles = flowFields.GetComputedTileCount(fieldIndex);
+    const size_t memoryBytes = flowFields.GetMemoryBytes();
+
+    begin = std::chrono::high_resolution_clock::now();
+    flowFields.SampleDirections(flowFields.AcquireField(goalSpan), agents.data(), directions.data(), (int)agents.size());
+    const double sampleSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - begin).count();
+
+    // Every agent walks the field to the goal, which settles the tiles along the way.
+    int arrived = 0;
+    long long steps = 0;
+    begin = std::chrono::high_resolution_clock::now();
+    for (unsigned int agent : agents)
+    {
+        const int spanCount = flowFields.TracePath(fieldIndex, agent, path.data(), (int)path.size());
+        steps += spanCount;
+        if (flowFields.GetDirection(fieldIndex, path[spanCount - 1]) == FLOW_DIRECTION_GOAL)
+            arrived++;
+    }
+    const double traceSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - begin).count();
+
+    std::cout << "Flow field benchmark (" << label << "): " << numAgents << " agents, one goal" << std::endl;
+    std::cout << "  JPS per agent:   " << searchSeconds * 1000.0 << " ms, " << found << " found" << std::endl;
+    std::cout << "  flow field:      " << firstSampleSeconds * 1000.0 << " ms first sample (" << computedTiles << " of "
+              << flowFields.GetTileCount() << " tiles, " << memoryBytes / 1024 << " KB), " << sampleSeconds * 1000000.0 / numAgents
+              << " us/agent cached sample" << std::endl;
+    std::cout << "  followed fields: " << traceSeconds * 1000.0 << " ms, " << (double)steps / numAgents << " spans/agent, "
+              << arrived << " arrived" << std::endl;
+}
+
+void NavigationSystemBenchmarks::RunFlowFieldBenchmark(int numAgents)
+{
+    if (numAgents <= 0)
+        return;
+
+    HeightField pillars;
+    BuildPillarField(pillars, 1024, 32);
+    TimeFlowField("1024x1024 pillars", pillars, numAgents);
+    delete[] pillars.spans;
+
+    HeightField maze;
+    BuildMazeField(maze, 512, 4);
+    TimeFlowField("512x512 maze", maze, numAgents);
+    delete[] maze.spans;
+}
+
+// Stands in for rebuilding a tile with unchanged geometry: new salt, and the links into it from the tile and its neighbors updated.
+static void RebuildTileRefs(NavMesh& navMesh, int tileIndex)
+{
+    NavMeshTile& tile = navMesh.tiles[tileIndex];
+    tile.salt = tile.salt + 1 < (1u << NAV_SALT_BITS) ? tile.salt + 1 : 1;
+    for (int tz = std::max(tile.tileZ - 1, 0); tz <= std::min(tile.tileZ + 1, navMesh.tilesZ - 1); ++tz)
+    {
+        for (int tx = std::max(tile.tileX - 1, 0); tx <= std::min(tile.tileX + 1, navMesh.tilesX - 1); ++tx)
+        {
+            for (NavPolyLink& link : navMesh.tiles[tx + tz * navMesh.tilesX].links)
+                if (link.neighbor && DecodePolyRefTile(link.neighbor) == (unsigned int)tileIndex)
+                    link.neighbor = EncodePolyRef(tile.salt, tileIndex, DecodePolyRefPoly(link.neighbor));
+        }
+    }
+}
+
+void NavigationSystemBenchmarks::RunPathCorridorBenchmark(int numAgents, int numTicks)
+{
+    if (numAgents <= 0 || numTicks <= 0)
+        return;
+
+    const int fieldSize = 384;
+    HeightField field;
+    BuildPillarField(field, fieldSize, 12);
+    NavMesh navMesh;
+    NavigationSystem::BuildPolyMesh(field, 16, navMesh);
+    delete[] field.spans;
+
+    NavMeshQuery query;
+    query.Init(&navMesh, BENCH_MAX_NODES * 4);
+    NavQueryFilter filter;
+    const glm::vec3 halfExtents(2.0f, 2.0f, 2.0f);
+    std::vector<NavPolyRef> path(BENCH_MAX_PATH_POLYS * 4);
+    std::vector<glm::vec3> straightPath(BENCH_MAX_STRAIGHT_PATH);
+
+    // Agents cross from the left edge to the right edge.
+    std::vector<PathCorridor> corridors(numAgents);
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> coordinate(4.0f, fieldSize - 4.0f), leftEdge(4.0f, 32.0f), rightEdge(fieldSize - 32.0f, fieldSize - 4.0f);
+    for (PathCorridor& corridor : corridors)
+    {
+        corridor.Init((int)path.size());
+        int pathCount = 0;
+        while (pathCount == 0)
+        {
+            NavPolyRef startRef, endRef;
+            glm::vec3 startPos, endPos;
+            query.FindNearestPoly(glm::vec3(leftEdge(rng), 1.0f, coordinate(rng)), halfExtents, filter, startRef, startPos);
+            query.FindNearestPoly(glm::vec3(rightEdge(rng), 1.0f, coordinate(rng)), halfExtents, filter, endRef, endPos);
+            if (!startRef || !endRef ||
+                query.FindPath(startRef, endRef, startPos, endPos, filter, path.data(), pathCount, (int)path.size()) != NAVQUERY_SUCCESS)
+            {
+                pathCount = 0;
+                continue;
+            }
+            corridor.Reset(startRef, startPos);
+            corridor.SetCorridor(endPos, path.data(), pathCount);
+        }
+    }
+
+    // Steady state: walk toward the next corner, shortcut, move along the surface. Every tenth tick the naive
+    // version, a full search and straight path from the current position, is timed on the same agents.
+    const float step = 3.5f / 60.0f;
+    double corridorSeconds = 0.0, searchSeconds = 0.0;
+    int searchTicks = 0;
+    for (int tick = 0; tick < numTicks; ++tick)
+    {
+        if (tick % 10 == 0)
+        {
+            auto begin = std::chrono::high_resolution_clock::now();
+            for (const PathCorridor& corridor : corridors)
+            {
+                int pathCount = 0, cornerCount = 0;
+                query.FindPath(corridor.GetFirstPoly(), corridor.GetLastPoly(), corridor.GetPos(), corridor.GetTarget(), filter, path.data(),
+                               pathCount, (int)path.size());
+                query.FindStraightPath(corridor.GetPos(), corridor.GetTarget(), path.data(), pathCount, straightPath.data(), cornerCount, 3);
+            }
+            searchSeconds += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - begin).count();
+            searchTicks++;
+        }
+
+        auto begin = std::chrono::high_resolution_clock::now();
+        for (PathCorridor& corridor : corridors)
+        {
+            glm::vec3 corners[2];
+            const int cornerCount = corridor.FindCorners(corners, 2, query);
+            if (cornerCount == 0)
+                continue;
+            corridor.OptimizePathVisibility(corners[cornerCount - 1], 18.0f, query, filter);
+            const glm::vec3 delta = corners[0] - corridor.GetPos();
+            const float distance = glm::length(glm::vec2(delta.x, delta.z));
+            corridor.MovePosition(corridor.GetPos() + delta * std::min(1.0f, step / std::max(distance, 0.0001f)), query, filter);
+        }
+        corridorSeconds += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - begin).count();
+    }
+
+    // Rebuild a band of tiles across the middle of the field, every corridor crosses it.
+    const int bandX = navMesh.tilesX / 2;
+    for (int tz = 0; tz < navMesh.tilesZ; ++tz)
+        RebuildTileRefs(navMesh, bandX + tz * navMesh.tilesX);
+
+    auto begin = std::chrono::high_resolution_clock::now();
+    int repaired = 0, valid = 0;
+    for (PathCorridor& corridor : corridors)
+    {
+        if (corridor.IsValid(corridor.GetPathCount(), navMesh, filter))
+            continue;
+        if (corridor.Repair(query, filter, halfExtents) == NAVQUERY_SUCCESS)
+            repaired++;
+    }
+    const double repairSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - begin).count();
+    for (const PathCorridor& corridor : corridors)
+        if (corridor.IsValid(corridor.GetPathCount(), navMesh, filter))
+            valid++;
+
+    begin = std::chrono::high_resolution_clock::now();
+    for (const PathCorridor& corridor : corridors)
+    {
+        int pathCount = 0;
+        query.FindPath(corridor.GetFirstPoly(), corridor.GetLastPoly(), corridor.GetPos(), corridor.GetTarget(), filter, path.data(),
+                       pathCount, (int)path.size());
+    }
+    const double replanSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - begin).count();
+
+    std::cout << "Path corridor benchmark: " << numAgents << " agents, " << navMesh.GetPolyCount() << " polys, " << numTicks << " ticks"
+              << std::endl;
+    std::cout << "  corridor update: " << corridorSeconds * 1000000.0 / ((double)numTicks * numAgents) << " us/agent/tick" << std::endl;
+    std::cout << "  full search:     " << searchSeconds * 1000000.0 / ((double)searchTicks * numAgents) << " us/agent/tick" << std::endl;
+    std::cout << "  tile band rebuilt: repair " << repairSeconds * 1000.0 << " ms (" << repaired << " repaired, " << valid
+              << " valid after), full replan " << replanSeconds * 1000.0 << " ms" << std::endl;
+}
+
+void NavigationSystemBenchmarks::RunCrowdBenchmark(JobSystem& jobSystem, int numAgents, int numTicks)
+{
+    if (numAgents <= 0 || numTicks <= 0)
+        return;
+
+    const int fieldSize = 384;
+    HeightField field;
+    BuildPillarField(field, fieldSize, 12);
+    NavMesh navMesh;
+    NavigationSystem::BuildPolyMesh(field, 16, navMesh);
+    delete[] field.spans;
+
+    const float agentRadius = 0.6f;
+    Crowd crowd;
+    crowd.Init(&navMesh, &jobSystem, numAgents, agentRadius, BENCH_MAX_NODES);
+    CrowdAgentParams params;
+    params.radius = agentRadius;
+    params.maxSpeed = 3.5f;
+    params.maxAcceleration = 8.0f;
+
+    // Agents start on the left half and cross to random points on the right half.
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> coordinate(4.0f, fieldSize - 4.0f), leftHalf(4.0f, fieldSize * 0.5f),
+        rightHalf(fieldSize * 0.5f, fieldSize - 4.0f);
+    int attempts = 0;
+    while (crowd.GetActiveAgentCount() < numAgents && attempts++ < numAgents * 10)
+    {
+        const int agent = crowd.AddAgent(glm::vec3(leftHalf(rng), 1.0f, coordinate(rng)), params);
+        if (agent >= 0)
+            crowd.RequestMoveTarget(agent, glm::vec3(rightHalf(rng), 1.0f, coordinate(rng)));
+    }
+
+    const float dt = 1.0f / 60.0f;
+    CrowdTimings total = CrowdTimings();
+    float worstMs = 0.0f;
+    for (int tick = 0; tick < numTicks; ++tick)
+    {
+        crowd.Update(dt);
+        const CrowdTimings& timings = crowd.GetLastTimings();
+        total.replanMs += timings.replanMs;
+        total.steerMs += timings.steerMs;
+        total.gridMs += timings.gridMs;
+        total.avoidanceMs += timings.avoidanceMs;
+        total.integrateMs += timings.integrateMs;
+        total.totalMs += timings.totalMs;
+        total.replans += timings.replans;
+        worstMs = std::max(worstMs, timings.totalMs);
+    }
+
+    int moving = 0;
+    for (int i = 0; i < crowd.GetMaxAgents(); ++i)
+        if (crowd.IsAgentActive(i) && crowd.GetAgentState(i) == CROWDAGENT_MOVING)
+            moving++;
+
+    const float averageMs = total.totalMs / numTicks;
+    std::cout << "Crowd benchmark: " << crowd.GetActiveAgentCount() << " agents, " << navMesh.GetPolyCount() << " polys, " << numTicks
+              << " ticks, " << jobSystem.GetWorkerCount() << " workers" << std::endl;
+    std::cout << "  replan " << total.replanMs / numTicks << " ms (" << (double)total.replans / numTicks << " agents), steer "
+              << total.steerMs / numTicks << " ms, grid " << total.gridMs / numTicks << " ms, avoidance " << total.avoidanceMs / numTicks
+              << " ms, integrate " << total.integrateMs / numTicks << " ms" << std::endl;
+    std::cout << "  " << averageMs << " ms/tick average, " << worstMs << " ms worst, " << (averageMs <= 1000.0f / 60.0f ? "fits" : "exceeds")
+              << " a 60 Hz frame, " << moving << " agents still moving" << std::endl;
+}
+
+// Reference line of sight: samples the segment every 1/32 cell and tests the point against the column's solid spans.
+static bool SampleSegmentBlocked(const HeightField& field, const glm::vec3& start, const glm::vec3& end)
+{
+    const float length = glm::length(glm::vec2(end.x - start.x, end.z - start.z));
+    const int samples = std::max(1, (int)ceilf(length / (field.cellSize * (1.0f / 32.0f))));
+    for (int i = 0; i <= samples; ++i)
+    {
+        const glm::vec3 p = start + (end - start) * ((float)i / samples);
+        const int x = (int)floorf((p.x - field.bmin.x) / field.cellSize), z = (int)floorf((p.z - field.bmin.z) / field.cellSize);
+        if (x < 0 || z < 0 || x >= field.width || z >= field.depth)
+            continue;
+        for (const HeightFieldSpan* span = field.spans[x + z * field.width]; span; span = span->next)
+            if (p.y > field.bmin.y + span->spanMin * field.cellHeight && p.y < field.bmin.y + (span->spanMax + 1) * field.cellHeight)
+                return true;
+    }
+    return false;
+}
+
+void NavigationSystemBenchmarks::RunRaycastBenchmark(int numRays)
+{
+    if (numRays <= 0)
+        return;
+
+    // Pillars stand 8 cells above the floor, rays above that pass over them.
+    const int fieldSize = 384, tileSize = 16;
+    HeightField field;
+    BuildPillarField(field, fieldSize, 12);
+    for (HeightFieldSpan& span : field.spanPool)
+        if (span.areaID == 0)
+            span.spanMax = 8;
+    NavMesh navMesh;
+    NavigationSystem::BuildPolyMesh(field, tileSize, navMesh);
+    HeightFieldPyramid pyramid;
+    pyramid.Init(&field, tileSize);
+
+    NavMeshQuery query;
+    query.Init(&navMesh, BENCH_MAX_NODES);
+    NavQueryFilter filter;
+    const glm::vec3 halfExtents(2.0f, 2.0f, 2.0f);
+
+    // Segments up to 64 cells long between open cells, at eye height over the floor and at random heights.
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> coordinate(0.0f, (float)fieldSize), offset(-64.0f, 64.0f), height(1.5f, 14.0f);
+    auto randomOpenPoint = [&](float y)
+    {
+        while (true)
+        {
+            const glm::vec3 p(coordinate(rng), y, coordinate(rng));
+            if (field.spans[(int)p.x + (int)p.z * fieldSize]->areaID != 0)
+                return p;
+        }
+    };
+    std::vector<glm::vec3> starts(numRays), ends(numRays), highStarts(numRays), highEnds(numRays);
+    std::vector<NavPolyRef> startRefs(numRays);
+    for (int i = 0; i < numRays; ++i)
+    {
+        starts[i] = randomOpenPoint(1.5f);
+        do
+        {
+            ends[i] = glm::vec3(starts[i].x + offset(rng), 1.5f, starts[i].z + offset(rng));
+        } while (ends[i].x < 0.0f || ends[i].z < 0.0f || ends[i].x >= fieldSize || ends[i].z >= fieldSize ||
+                 field.spans[(int)ends[i].x + (int)ends[i].z * fieldSize]->areaID == 0);
+        glm::vec3 snapped;
+        query.FindNearestPoly(starts[i], halfExtents, filter, startRefs[i], snapped);
+        highStarts[i] = glm::vec3(starts[i].x, height(rng), starts[i].z);
+        highEnds[i] = glm::vec3(ends[i].x, height(rng), ends[i].z);
+    }
+
+    std::vector<unsigned char> navMeshBlocked(numRays), fieldBlocked(numRays), sampledBlocked(numRays);
+    auto begin = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < numRays; ++i)
+    {
+        float t;
+        glm::vec3 hitNormal;
+        int pathCount = 0;
+        query.Raycast(startRefs[i], starts[i], ends[i], filter, t, hitNormal, nullptr, pathCount, 0);
+        navMeshBlocked[i] = t != FLT_MAX;
+    }
+    const double navMeshSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - begin).count();
+
+    begin = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < numRays; ++i)
+        fieldBlocked[i] = !pyramid.HasLineOfSight(starts[i], ends[i]);
+    const double fieldSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - begin).count();
+
+    begin = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < numRays; ++i)
+        sampledBlocked[i] = SampleSegmentBlocked(field, starts[i], ends[i]);
+    const double sampledSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - begin).count();
+
+    int navMeshAgree = 0, fieldAgree = 0, blocked = 0;
+    for (int i = 0; i < numRays; ++i)
+    {
+        navMeshAgree += navMeshBlocked[i] == sampledBlocked[i];
+        fieldAgree += fieldBlocked[i] == sampledBlocked[i];
+        blocked += sampledBlocked[i];
+    }
+
+    int highFieldAgree = 0, highBlocked = 0;
+    begin = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < numRays; ++i)
+        fieldBlocked[i] = !pyramid.HasLineOfSight(highStarts[i], highEnds[i]);
+    const double highFieldSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - begin).count();
+    begin = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < numRays; ++i)
+        sampledBlocked[i] = SampleSegmentBlocked(field, highStarts[i], highEnds[i]);
+    const double highSampledSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - begin).count();
+    for (int i = 0; i < numRays; ++i)
+    {
+        highFieldAgree += fieldBlocked[i] == sampledBlocked[i];
+        highBlocked += sampledBlocked[i];
+    }
+    delete[] field.spans;
+
+    const double toMicroseconds = 1000000.0 / numRays;
+    std::cout << "Raycast benchmark: " << numRays << " rays, " << navMesh.GetPolyCount() << " polys, "
+              << pyramid.GetMemoryBytes() / 1024 << " KB height pyramid" << std::endl;
+    std::cout << "  eye height (" << blocked << " blocked): navmesh " << navMeshSeconds * toMicroseconds << " us/ray (" << navMeshAgree
+              << " agree), heightfield pyramid " << fieldSeconds * toMicroseconds << " us/ray (" << fieldAgree << " agree), sampling "
+              << sampledSeconds * toMicroseconds << " us/ray" << std::endl;
+    std::cout << "  random heights (" << highBlocked << " blocked): heightfield pyramid " << highFieldSeconds * toMicroseconds << " us/ray ("
+              << highFieldAgree << " agree), sampling " << highSampledSeconds * toMicroseconds << " us/ray" << std::endl;
+}
+
+static bool ScanBoxObstructed(const HeightField& field, const glm::vec3& bmin, const glm::vec3& bmax)
+{
+    for (int z = std::max((int)floorf(bmin.z), 0); z <= std::min((int)ceilf(bmax.z) - 1, field.depth - 1); ++z)
+        for (int x = std::max((int)floorf(bmin.x), 0); x <= std::min((int)ceilf(bmax.x) - 1, field.width - 1); ++x)
+            for (const HeightFieldSpan* span = field.spans[x + z * field.width]; span; span = span->next)
+                if (bmax.y > span->spanMin * field.cellHeight && bmin.y < (span->spanMax + 1) * field.cellHeight)
+                    return true;
+    return false;
+}
+
+static bool ScanSurfaceBelow(const HeightField& field, const glm::vec3& pos, float radius, float& height)
+{
+    height = -FLT_MAX;
+    for (int z = std::max((int)floorf(pos.z - radius), 0); z <= std::min((int)floorf(pos.z + radius), field.depth - 1); ++z)
+        for (int x = std::max((int)floorf(pos.x - radius), 0); x <= std::min((int)floorf(pos.x + radius), field.width - 1); ++x)
+            for (const HeightFieldSpan* span = field.spans[x + z * field.width]; span; span = span->next)
+                if (span->areaID != 0 && (span->spanMax + 1) * field.cellHeight <= pos.y)
+                    height = std::max(height, (span->spanMax + 1) * field.cellHeight);
+    return height > -FLT_MAX;
+}
+
+void NavigationSystemBenchmarks::RunHeightPyramidBenchmark(int numQueries)
+{
+    if (numQueries <= 0)
+        return;
+
+    // Pillars of random heights, their tops are walkable so surface queries have several levels to choose from.
+    const int fieldSize = 1024, tileSize = 16;
+    HeightField field;
+    BuildPillarField(field, fieldSize, 12);
+    std::mt19937 rng(1234);
+    for (int i = 0; i < fieldSize * fieldSize; ++i)
+    {
+        HeightFieldSpan& span = field.spanPool[i];
+        if (span.areaID != 0)
+            continue;
+        const int x = i % fieldSize, z = i / fieldSize;
+        span.spanMax = 2 + ((x / 4) * 7 + (z / 4) * 13) % 11;
+        span.areaID = 1;
+    }
+
+    auto begin = std::chrono::high_resolution_clock::now();
+    HeightFieldPyramid pyramid;
+    pyramid.Init(&field, tileSize);
+    const double buildSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - begin).count();
+
+    // Agent sized boxes and 16x16 footprints at random heights, surface lookups under random points.
+    std::uniform_real_distribution<float> coordinate(0.0f, (float)fieldSize), height(0.5f, 15.0f);
+    std::vector<glm::vec3> boxMins(numQueries), boxMaxs(numQueries), points(numQueries);
+    for (int i = 0; i < numQueries; ++i)
+    {
+        const glm::vec3 extents = i % 2 ? glm::vec3(0.6f, 2.0f, 0.6f) : glm::vec3(8.0f, 2.0f, 8.0f);
+        const glm::vec3 center(coordinate(rng), height(rng), coordinate(rng));
+        boxMins[i] = glm::vec3(center.x - extents.x, center.y, center.z - extents.z);
+        boxMaxs[i] = glm::vec3(center.x + extents.x, center.y + extents.y, center.z + extents.z);
+        points[i] = glm::vec3(coordinate(rng), height(rng), coordinate(rng));
+    }
+    const float surfaceRadius = 4.0f;
+
+    std::vector<unsigned char> pyramidResults(numQueries), scanResults(numQueries);
+    std::vector<float> pyramidHeights(numQueries), scanHeights(numQueries);
+    begin = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < numQueries; ++i)
+        pyramidResults[i] = pyramid.IsBoxObstructed(boxMins[i], boxMaxs[i]);
+    const double pyramidBoxSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - begin).count();
+    begin = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < numQueries; ++i)
+        scanResults[i] = ScanBoxObstructed(field, boxMins[i], boxMaxs[i]);
+    const double scanBoxSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - begin).count();
+    int boxAgree = 0, obstructed = 0;
+    for (int i = 0; i < numQueries; ++i)
+    {
+        boxAgree += pyramidResults[i] == scanResults[i];
+        obstructed += scanResults[i];
+    }
+
+    begin = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < numQueries; ++i)
+        pyramid.FindSurfaceBelow(points[i], surfaceRadius, pyramidHeights[i]);
+    const double pyramidSurfaceSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - begin).count();
+    begin = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < numQueries; ++i)
+        ScanSurfaceBelow(field, points[i], surfaceRadius, scanHeights[i]);
+    const double scanSurfaceSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - begin).count();
+    int surfaceAgree = 0;
+    for (int i = 0; i < numQueries; ++i)
+        surfaceAgree += pyramidHeights[i] == scanHeights[i];
+
+    // Raise the pillars in a few random tiles and rebuild only those against building the whole pyramid.
+    const int tilesPerSide = fieldSize / tileSize, dirtyCount = 32;
+    std::uniform_int_distribution<int> tile(0, tilesPerSide - 1);
+    for (int i = 0; i < dirtyCount; ++i)
+    {
+        const int tileX = tile(rng), tileZ = tile(rng);
+        for (int z = tileZ * tileSize; z < (tileZ + 1) * tileSize; ++z)
+            for (int x = tileX * tileSize; x < (tileX + 1) * tileSize; ++x)
+                if (field.spans[x + z * fieldSize]->spanMax > 0)
+                    field.spans[x + z * fieldSize]->spanMax = 20;
+        pyramid.MarkTileDirty(tileX, tileZ);
+    }
+    begin = std::chrono::high_resolution_clock::now();
+    pyramid.RebuildDirtyTiles();
+    const double rebuildSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - begin).count();
+    int rebuildAgree = 0;
+    for (int i = 0; i < numQueries; ++i)
+        rebuildAgree += pyramid.IsBoxObstructed(boxMins[i], boxMaxs[i]) == ScanBoxObstructed(field, boxMins[i], boxMaxs[i]);
+    delete[] field.spans;
+
+    const double toMicroseconds = 1000000.0 / numQueries;
+    std::cout << "Height pyramid benchmark: " << fieldSize << "x" << fieldSize << " field, " << pyramid.GetLevelCount() << " levels, "
+              << pyramid.GetMemoryBytes() / 1024 << " KB, built in " << buildSeconds * 1000.0 << " ms" << std::endl;
+    std::cout << "  box obstructed (" << obstructed << " of " << numQueries << "): pyramid " << pyramidBoxSeconds * toMicroseconds
+              << " us, column scan " << scanBoxSeconds * toMicroseconds << " us (" << boxAgree << " agree)" << std::endl;
+    std::cout << "  surface below, radius " << surfaceRadius << ": pyramid " << pyramidSurfaceSeconds * toMicroseconds << " us, column scan "
+              << scanSurfaceSeconds * toMicroseconds << " us (" << surfaceAgree << " agree)" << std::endl;
+    std::cout << "  " << dirtyCount << " dirty tiles rebuilt in " << rebuildSeconds * 1000.0 << " ms (" << rebuildAgree << " of " << numQueries
+              << " box queries agree after)" << std::endl;
+}
+
+void NavigationSystemBenchmarks::RunNavMeshFileBenchmark()
+{
+    const char* path = "navmesh_benchmark.bin";
+    HeightField field;
+    BuildPillarField(field, 1024, 12);
+    NavMesh built;
+    auto begin = std::chrono::high_resolution_clock::now();
+    NavigationSystem::BuildPolyMesh(field, 16, built);
+    const double buildSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - begin).count();
+    delete[] field.spans;
+
+    begin = std::chrono::high_resolution_clock::now();
+    if (!SaveNavMesh(built, path))
+        return;
+    const double saveSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - begin).count();
+
+    begin = std::chrono::high_resolution_clock::now();
+    MappedFile file;
+    NavMesh loaded;
+    if (!file.Open(path) || !LoadNavMesh(file, loaded))
+    {
+        std::remove(path);
+        return;
+    }
+    const double loadSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - begin).count();
+
+    // The same paths on both meshes, the first queries on the loaded mesh also page the file in.
+    NavMeshQuery builtQuery, loadedQuery;
+    builtQuery.Init(&built, BENCH_MAX_NODES);
+    loadedQuery.Init(&loaded, BENCH_MAX_NODES);
+    std::vector<glm::vec3> centers;
+    CollectPolyCenters(built, centers);
+    NavQueryFilter filter;
+    const glm::vec3 halfExtents(2.0f, 2.0f, 2.0f);
+    std::mt19937 rng(1234);
+    std::uniform_int_distribution<int> pick(0, (int)centers.size() - 1);
+    std::vector<NavPolyRef> builtPath(BENCH_MAX_PATH_POLYS * 4), loadedPath(BENCH_MAX_PATH_POLYS * 4);
+    const int numQueries = 200;
+    int identical = 0;
+    begin = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < numQueries; ++i)
+    {
+        const glm::vec3 start = centers[pick(rng)], end = centers[pick(rng)];
+        NavPolyRef startRef, endRef;
+        glm::vec3 startPos, endPos;
+        int builtCount = 0, loadedCount = 0;
+        builtQuery.FindNearestPoly(start, halfExtents, filter, startRef, startPos);
+        builtQuery.FindNearestPoly(end, halfExtents, filter, endRef, endPos);
+        builtQuery.FindPath(startRef, endRef, startPos, endPos, filter, builtPath.data(), builtCount, (int)builtPath.size());
+        loadedQuery.FindNearestPoly(start, halfExtents, filter, startRef, startPos);
+        loadedQuery.FindNearestPoly(end, halfExtents, filter, endRef, endPos);
+        loadedQuery.FindPath(startRef, endRef, startPos, endPos, filter, loadedPath.data(), loadedCount, (int)loadedPath.size());
+        if (builtCount == loadedCount && std::equal(builtPath.begin(), builtPath.begin() + builtCount, loadedPath.begin()))
+            identical++;
+    }
+    const double querySeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - begin).count();
+
+    std::cout << "NavMesh file benchmark: " << built.GetPolyCount() << " polys in " << built.tiles.size() << " tiles, "
+              << file.GetSize() / 1024 << " KB file" << std::endl;
+    std::cout << "  polymesh build " << buildSeconds * 1000.0 << " ms, save " << saveSeconds * 1000.0 << " ms, map and load "
+              << loadSeconds * 1000.0 << " ms" << std::endl;
+    std::cout << "  " << identical << " of " << numQueries << " paths identical on the loaded mesh, " << querySeconds * 1000.0
+              << " ms for both" << std::endl;
+    file.Close();
+    std::remove(path);
+}
+
+static int CountPolyCells(const NavMesh& navMesh)
+{
+    int cells = 0;
+    for (const auto& tile : navMesh.tiles)
+        for (const auto& poly : tile.polys)
+            cells += (poly.maxX - poly.minX + 1) * (poly.maxZ - poly.minZ + 1);
+    return cells;
+}
+
+void NavigationSystemBenchmarks::RunTileCacheBenchmark(int numObstacles)
+{
+    if (numObstacles <= 0)
+        return;
+
+    const int fieldSize = 1024, tileSize = 16;
+    HeightField field;
+    BuildPillarField(field, fieldSize, 12);
+    std::vector<unsigned int> walkableAreas(field.spanPool.size());
+    for (size_t i = 0; i < field.spanPool.size(); ++i)
+        walkableAreas[i] = field.spanPool[i].areaID != 0 ? 1 : 0;
+    NavMesh navMesh;
+    std::vector<unsigned int> spanPolys;
+    NavigationSystem::BuildPolyMesh(field, tileSize, navMesh, spanPolys);
+    const int builtCells = CountPolyCells(navMesh);
+
+    NavMeshTileCache tileCache;
+    auto begin = std::chrono::high_resolution_clock::now();
+    tileCache.Init(field, walkableAreas, tileSize, 1);
+    const double initSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - begin).count();
+
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> coord(8.0f, fieldSize - 8.0f), size(1.0f, 4.0f), angle(0.0f, 3.14159f);
+    std::vector<NavObstacleRef> refs;
+    std::vector<int> changedTiles;
+    double addTotal = 0.0, addMax = 0.0;
+    int rebuiltTiles = 0, relinkedTiles = 0;
+    for (int i = 0; i < numObstacles; ++i)
+    {
+        const glm::vec3 pos(coord(rng), 1.0f, coord(rng));
+        const float extent = size(rng);
+        begin = std::chrono::high_resolution_clock::now();
+        switch (i % 3)
+        {
+        case 0: refs.push_back(tileCache.AddCylinderObstacle(pos, extent, 2.0f)); break;
+        case 1: refs.push_back(tileCache.AddBoxObstacle(pos - glm::vec3(extent, 0.0f, extent), pos + glm::vec3(extent, 2.0f, extent))); break;
+        case 2: refs.push_back(tileCache.AddOrientedBoxObstacle(pos + glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(extent * 2.0f, 1.0f, extent * 0.5f), angle(rng))); break;
+        }
+        rebuiltTiles += tileCache.Update(field, navMesh, spanPolys, changedTiles);
+        relinkedTiles += (int)changedTiles.size();
+        const double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - begin).count();
+        addTotal += seconds;
+        addMax = std::max(addMax, seconds);
+    }
+    const int carvedCells = CountPolyCells(navMesh);
+
+    // What the same change costs without the tile cache: regions, connections and polys of the whole field.
+    for (HeightFieldSpan& span : field.spanPool)
+        span.areaID = span.areaID != 0 ? 1 : 0;
+    NavMesh fullMesh;
+    std::vector<unsigned int> fullSpanPolys;
+    begin = std::chrono::high_resolution_clock::now();
+    NavigationSystem::BuildRegions(field, 1, 0, 0, fieldSize, fieldSize, 2);
+    NavigationSystem::BuildConnections(field, 1, 0, 0, fieldSize, fieldSize);
+    NavigationSystem::BuildPolyMesh(field, tileSize, fullMesh, fullSpanPolys);
+    const double fullSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - begin).count();
+
+    double removeTotal = 0.0, removeMax = 0.0;
+    for (NavObstacleRef ref : refs)
+    {
+        begin = std::chrono::high_resolution_clock::now();
+        tileCache.RemoveObstacle(ref);
+        tileCache.Update(field, navMesh, spanPolys, changedTiles);
+        const double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - begin).count();
+        removeTotal += seconds;
+        removeMax = std::max(removeMax, seconds);
+    }
+
+    std::cout << "Tile cache benchmark: " << navMesh.tiles.size() << " tiles, layers " << tileCache.GetCompressedBytes() / 1024 << " KB compressed from "
+              << tileCache.GetRawBytes() / 1024 << " KB, init " << initSeconds * 1000.0 << " ms" << std::endl;
+    std::cout << "  add: " << addTotal * 1000.0 / numObstacles << " ms avg, " << addMax * 1000.0 << " ms max, "
+              << (float)rebuiltTiles / numObstacles << " tiles rebuilt and " << (float)relinkedTiles / numObstacles << " relinked per obstacle" << std::endl;
+    std::cout << "  full regions, connections and polymesh rebuild: " << fullSeconds * 1000.0 << " ms, carved cells " << carvedCells << " ("
+              << (carvedCells == CountPolyCells(fullMesh) ? "matches" : "differs from") << " the full rebuild)" << std::endl;
+    std::cout << "  remove: " << removeTotal * 1000.0 / numObstacles << " ms avg, " << removeMax * 1000.0 << " ms max, cells after removing all "
+              << CountPolyCells(navMesh) << " (built " << builtCells << ")" << std::endl;
+    delete[] field.spans;
+}
+
+// Rolling terrain with a bridge spanning one band of columns, the ground right under the bridge has no headroom.
+static void BuildTerrainField(HeightField& heightField, int size)
+{
+    const int bridgeX0 = size / 2 - 6, bridgeX1 = size / 2 + 6;
+    const unsigned int bridgeMin = 116, bridgeMax = 120;
+    heightField.width = size;
+    heightField.depth = size;
+    heightField.bmin = glm::vec3(0.0f);
+    heightField.cellSize = 1.0f;
+    heightField.cellHeight = 0.25f;
+    heightField.spans = new HeightFieldSpan*[size * size];
+    heightField.spanPool.assign(size * size + (bridgeX1 - bridgeX0) * size, HeightFieldSpan());
+
+    size_t next = 0;
+    for (int z = 0; z < size; ++z)
+    {
+        for (int x = 0; x < size; ++x)
+        {
+            const unsigned int height = (unsigned int)(60.0f + 40.0f * sinf(x * 0.031f) * cosf(z * 0.023f) + 4.0f * sinf(x * 0.17f + z * 0.11f));
+            const bool bridge = x >= bridgeX0 && x < bridgeX1;
+            HeightFieldSpan& ground = heightField.spanPool[next++];
+            ground.spanMin = 0;
+            ground.spanMax = height;
+            ground.areaID = bridge && bridgeMin - height < 8 ? 0 : 1;
+            ground.next = nullptr;
+            heightField.spans[x + z * size] = &ground;
+            if (bridge)
+            {
+                HeightFieldSpan& deck = heightField.spanPool[next++];
+                deck.spanMin = bridgeMin;
+                deck.spanMax = bridgeMax;
+                deck.areaID = 1;
+                deck.next = nullptr;
+                ground.next = &deck;
+            }
+        }
+    }
+}
+
+static void TimeTileCodec(const char* label, const HeightField& field, int tileSize)
+{
+    std::vector<std::vector<unsigned char>> layers;
+    std::vector<size_t> deltaBytes;
+    size_t rawBytes = 0;
+    for (int z = 0; z < field.depth; z += tileSize)
+    {
+        for (int x = 0; x < field.width; x += tileSize)
+        {
+            layers.emplace_back();
+            deltaBytes.push_back(NavMeshTileCache::BuildLayer(field, std::vector<unsigned int>(), x, z, std::min(field.width, x + tileSize),
+                                                              std::min(field.depth, z + tileSize), layers.back()));
+            rawBytes += layers.back().size();
+        }
+    }
+    const int repeats = std::max(1, (int)((256u << 20) / rawBytes));
+    const double gigabytes = (double)rawBytes * repeats / 1e9;
+
+    std::vector<unsigned char> scratch(rawBytes);
+    auto begin = std::chrono::high_resolution_clock::now();
+    for (int r = 0; r < repeats; ++r)
+    {
+        unsigned char* op = scratch.data();
+        for (const auto& layer : layers)
+        {
+            memcpy(op, layer.data(), layer.size());
+            op += layer.size();
+        }
+    }
+    const double copySeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - begin).count();
+    std::cout << "  " << label << ": " << layers.size() << " layers, " << rawBytes / 1024 << " KB, memcpy " << gigabytes / copySeconds << " GB/s" << std::endl;
+
+    std::vector<size_t> bestSizes(layers.size(), SIZE_MAX);
+    int deltaChosen = 0;
+    for (int filtered = 0; filtered < 2; ++filtered)
+    {
+        std::vector<std::vector<unsigned char>> input = layers, compressed(layers.size());
+        if (filtered)
+            for (size_t i = 0; i < input.size(); ++i)
+                DeltaEncode(input[i].data(), deltaBytes[i]);
+
+        size_t compressedBytes = 0;
+        begin = std::chrono::high_resolution_clock::now();
+        for (int r = 0; r < repeats; ++r)
+        {
+            compressedBytes = 0;
+            for (size_t i = 0; i < input.size(); ++i)
+            {
+                compressed[i].resize(GetCompressBound(input[i].size()));
+                compressed[i].resize(CompressTileData(input[i].data(), input[i].size(), compressed[i].data()));
+                compressedBytes += compressed[i].size();
+            }
+        }
+        const double compressSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - begin).count();
+
+        // Decoding includes undoing the delta, that is what a tile rebuild pays.
+        bool roundTrip = true;
+        begin = std::chrono::high_resolution_clock::now();
+        for (int r = 0; r < repeats; ++r)
+        {
+            unsigned char* op = scratch.data();
+            for (size_t i = 0; i < compressed.size(); ++i)
+            {
+                roundTrip &= DecompressTileData(compressed[i].data(), compressed[i].size(), op, layers[i].size());
+                if (filtered)
+                    DeltaDecode(op, deltaBytes[i]);
+                op += layers[i].size();
+            }
+        }
+        const double decompressSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - begin).count();
+        const unsigned char* op = scratch.data();
+        for (const auto& layer : layers)
+        {
+            roundTrip &= memcmp(op, layer.data(), layer.size()) == 0;
+            op += layer.size();
+        }
+
+        for (size_t i = 0; i < compressed.size(); ++i)
+        {
+            if (compressed[i].size() < bestSizes[i])
+            {
+                bestSizes[i] = compressed[i].size();
+                deltaChosen += filtered;
+            }
+        }
+
+        std::cout << "    " << (filtered ? "delta + LZ" : "LZ") << ": ratio " << (double)rawBytes / compressedBytes << ", compress "
+                  << gigabytes / compressSeconds << " GB/s, decompress " << gigabytes / decompressSeconds << " GB/s"
+                  << (roundTrip ? "" : ", ROUND TRIP FAILED") << std::endl;
+    }
+
+    size_t bestBytes = 0;
+    for (size_t size : bestSizes)
+        bestBytes += size;
+    std::cout << "    smaller of the two per layer, as the tile cache stores them: ratio " << (double)rawBytes / bestBytes << ", "
+              << deltaChosen << " layers delta coded" << std::endl;
+}
+
+void NavigationSystemBenchmarks::RunCompressionBenchmark()
+{
+    const int fieldSize = 512, tileSize = 16;
+    std::cout << "Compression benchmark, " << tileSize << "x" << tileSize << " tile layers:" << std::endl;
+    HeightField field;
+    BuildPillarField(field, fieldSize, 12);
+    TimeTileCodec("pillar field", field, tileSize);
+    delete[] field.spans;
+
+    BuildMazeField(field, fieldSize, 4);
+    TimeTileCodec("maze", field, tileSize);
+    delete[] field.spans;
+
+    BuildTerrainField(field, fieldSize);
+    TimeTileCodec("terrain with a bridge", field, tileSize);
+    delete[] field.spans;
+}
+
+void NavigationSystemBenchmarks::RunStreamingBenchmark()
+{
+    const char* path = "navmesh_streaming_benchmark.bin";
+    const int fieldSize = 1024;
+    HeightField field;
+    BuildPillarField(field, fieldSize, 12);
+    NavMesh built;
+    NavigationSystem::BuildPolyMesh(field, 16, built);
+    delete[] field.spans;
+    if (!SaveNavMesh(built, path))
+        return;
+    size_t fullBytes = 0;
+    for (const NavMeshTile& tile : built.tiles)
+        fullBytes += tile.polys.size() * sizeof(NavPoly) + tile.links.size() * sizeof(NavPolyLink) + tile.bvTree.size() * sizeof(NavBVNode);
+
+    NavMesh streamed;
+    NavMeshStreamer streamer;
+    if (!streamer.Open(path, streamed))
+    {
+        std::remove(path);
+        return;
+    }
+    const float loadRadius = 64.0f;
+    streamer.SetMemoryBudget(fullBytes / 16);
+    streamer.SetLoadRadius(loadRadius);
+
+    // The focus walks the diagonal of the field. Each step waits for the loads, as if frames passed until they arrived.
+    NavMeshQuery builtQuery, streamedQuery;
+    builtQuery.Init(&built, BENCH_MAX_NODES);
+    streamedQuery.Init(&streamed, BENCH_MAX_NODES);
+    NavQueryFilter filter;
+    const glm::vec3 halfExtents(2.0f, 2.0f, 2.0f);
+    std::vector<NavPolyRef> builtPath(BENCH_MAX_PATH_POLYS * 4), streamedPath(BENCH_MAX_PATH_POLYS * 4);
+    std::vector<int> changedTiles;
+    double requestTotal = 0.0, requestMax = 0.0, installTotal = 0.0, installMax = 0.0, fillTotal = 0.0, fillMax = 0.0;
+    int steps = 0, loads = 0, evictions = 0, identicalPaths = 0, graceful = 0;
+    for (float t = 64.0f; t <= fieldSize - 64.0f; t += 8.0f, ++steps)
+    {
+        const glm::vec3 focus(t, 0.0f, t);
+        auto begin = std::chrono::high_resolution_clock::now();
+        streamer.Update(streamed, &focus, 1, changedTiles);
+        const double requestSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - begin).count();
+        for (int tileIndex : changedTiles)
+            streamer.IsTileLoaded(tileIndex) ? loads++ : evictions++;
+        double installSeconds = 0.0;
+        while (streamer.GetPendingTileCount() > 0)
+        {
+            streamer.WaitForLoads();
+            const auto installBegin = std::chrono::high_resolution_clock::now();
+            streamer.Update(streamed, &focus, 1, changedTiles);
+            installSeconds = std::max(installSeconds, std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - installBegin).count());
+            for (int tileIndex : changedTiles)
+                streamer.IsTileLoaded(tileIndex) ? loads++ : evictions++;
+        }
+        const double fillSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - begin).count();
+        requestTotal += requestSeconds;
+        requestMax = std::max(requestMax, requestSeconds);
+        installTotal += installSeconds;
+        installMax = std::max(installMax, installSeconds);
+        fillTotal += fillSeconds;
+        fillMax = std::max(fillMax, fillSeconds);
+
+        // A path inside the load radius matches the full mesh, a point far behind the focus is simply not on the mesh.
+        const glm::vec3 end2 = focus + glm::vec3(loadRadius * 0.5f, 0.0f, -loadRadius * 0.5f);
+        NavPolyRef startRef, endRef;
+        glm::vec3 startPos, endPos;
+        int builtCount = 0, streamedCount = 0;
+        builtQuery.FindNearestPoly(focus, halfExtents, filter, startRef, startPos);
+        builtQuery.FindNearestPoly(end2, halfExtents, filter, endRef, endPos);
+        builtQuery.FindPath(startRef, endRef, startPos, endPos, filter, builtPath.data(), builtCount, (int)builtPath.size());
+        streamedQuery.FindNearestPoly(focus, halfExtents, filter, startRef, startPos);
+        streamedQuery.FindNearestPoly(end2, halfExtents, filter, endRef, endPos);
+        streamedQuery.FindPath(startRef, endRef, startPos, endPos, filter, streamedPath.data(), streamedCount, (int)streamedPath.size());
+        if (builtCount > 0 && builtCount == streamedCount && std::equal(builtPath.begin(), builtPath.begin() + builtCount, streamedPath.begin()))
+            identicalPaths++;
+        NavPolyRef farRef;
+        glm::vec3 farPos;
+        streamedQuery.FindNearestPoly(glm::vec3(fieldSize - t, 0.0f, t * 0.5f), halfExtents, filter, farRef, farPos);
+        const unsigned int farTile = farRef ? DecodePolyRefTile(farRef) : 0;
+        if (!farRef || streamer.IsTileLoaded(farTile))
+            graceful++;
+    }
+    streamer.Close();
+    std::remove(path);
+
+    std::cout << "Streaming benchmark: " << built.tiles.size() << " tiles, " << fullBytes / 1024 << " KB of tile data, budget "
+              << streamer.GetMemoryBudget() / 1024 << " KB, radius " << loadRadius << ", " << steps << " steps" << std::endl;
+    std::cout << "  " << loads << " tiles loaded, " << evictions << " evicted, peak resident " << streamer.GetPeakResidentBytes() / 1024 << " KB"
+              << std::endl;
+    std::cout << "  main thread: request " << requestTotal * 1000.0 / steps << " ms avg, " << requestMax * 1000.0 << " ms max, install (slowest update of a step) "
+              << installTotal * 1000.0 / steps << " ms avg, " << installMax * 1000.0 << " ms max" << std::endl;
+    std::cout << "  radius filled " << fillTotal * 1000.0 / steps << " ms avg, " << fillMax * 1000.0 << " ms max after a step" << std::endl;
+    std::cout << "  paths matching the full mesh " << identicalPaths << " of " << steps << ", nearest poly queries outside the radius that found "
+              << "nothing or a resident tile " << graceful << " of " << steps << std::endl;
+}
+
+void NavigationSystemBenchmarks::RunAgentProfileBenchmark(JobSystem& jobSystem)
+{
+    const int fieldSize = 1024, tileSize = 32, fieldHeight = 1 << 16;
+    HeightField field;
+    BuildTerrainField(field, fieldSize);
+    const std::vector<NavAgentProfile> profiles = {
+        {"Infantry", 2.0f, 0.6f, 0.9f},
+        {"Vehicle", 2.5f, 1.5f, 0.5f},
+        {"Large creature", 5.0f, 3.0f, 1.5f},
+    };
+
+    // Every profile on its own, as separate builds would run them after their own rasterization, then all of them in parallel.
+    std::vector<NavMesh> sequentialMeshes, parallelMeshes;
+    std::vector<double> profileSeconds;
+    auto begin = std::chrono::high_resolution_clock::now();
+    for (const NavAgentProfile& profile : profiles)
+    {
+        std::vector<NavMesh> meshes;
+        const auto profileBegin = std::chrono::high_resolution_clock::now();
+        NavigationSystem::BuildProfileNavMeshes(field, fieldHeight, tileSize, std::vector<NavAgentProfile>(1, profile), nullptr, meshes);
+        profileSeconds.push_back(std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - profileBegin).count());
+        sequentialMeshes.push_back(std::move(meshes[0]));
+    }
+    const double sequentialSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - begin).count();
+
+    begin = std::chrono::high_resolution_clock::now();
+    NavigationSystem::BuildProfileNavMeshes(field, fieldHeight, tileSize, profiles, &jobSystem, parallelMeshes);
+    const double parallelSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - begin).count();
+    delete[] field.spans;
+
+    std::cout << "Agent profile benchmark: " << fieldSize << "x" << fieldSize << " terrain, " << profiles.size() << " profiles, "
+              << jobSystem.GetWorkerCount() << " workers" << std::endl;
+    for (size_t i = 0; i < profiles.size(); ++i)
+        std::cout << "  " << profiles[i].name << ": " << parallelMeshes[i].GetPolyCount() << " polys ("
+                  << (parallelMeshes[i].GetPolyCount() == sequentialMeshes[i].GetPolyCount() ? "same" : "differs from") << " on its own), "
+                  << profileSeconds[i] * 1000.0 << " ms on its own" << std::endl;
+    std::cout << "  profiles one after another " << sequentialSeconds * 1000.0 << " ms, in parallel " << parallelSeconds * 1000.0 << " ms ("
+              << sequentialSeconds / parallelSeconds << "x), rasterized once instead of " << profiles.size() << " times" << std::endl;
+}
+
+// Length of the path through each area, from portal midpoint to portal midpoint.
+static void MeasurePathAreas(const NavMeshQuery& query, const glm::vec3& startPos, const glm::vec3& endPos, const NavPolyRef* path, int pathCount,
+                             double* areaLengths)
+{
+    const NavMesh& navMesh = *query.GetNavMesh();
+    glm::vec3 pos = startPos;
+    for (int i = 0; i < pathCount; ++i)
+    {
+        glm::vec3 next = endPos, left, right;
+        if (i + 1 < pathCount && query.GetPortalPoints(path[i], path[i + 1], left, right))
+            next = (left + right) * 0.5f;
+        const NavMeshTile* tile;
+        const NavPoly* poly;
+        navMesh.GetTileAndPoly(path[i], tile, poly);
+        areaLengths[poly->area] += glm::distance(pos, next);
+        pos = next;
+    }
+}
+
+void NavigationSystemBenchmarks::RunAreaCostBenchmark(int numQueries)
+{
+    const int fieldSize = 512, tileSize = 32, roadSpacing = 64, roadWidth = 4, pondCount = 24;
+    HeightField field;
+    BuildFlatField(field, fieldSize, std::vector<unsigned char>(fieldSize * fieldSize, 0));
+
+    // A grid of roads and octagonal ponds, marked as convex volumes over the flat ground.
+    std::vector<NavConvexVolume> volumes;
+    for (int i = roadSpacing / 2; i < fieldSize; i += roadSpacing)
+    {
+        const float a = (float)i, b = (float)(i + roadWidth), size = (float)fieldSize;
+        volumes.push_back({{{a, 0.0f, 0.0f}, {b, 0.0f, 0.0f}, {b, 0.0f, size}, {a, 0.0f, size}}, 0.0f, 2.0f, NAVAREA_ROAD});
+        volumes.push_back({{{0.0f, 0.0f, a}, {size, 0.0f, a}, {size, 0.0f, b}, {0.0f, 0.0f, b}}, 0.0f, 2.0f, NAVAREA_ROAD});
+    }
+    std::mt19937 rng(4321);
+    std::uniform_real_distribution<float> pondPos(0.0f, (float)fieldSize);
+    std::uniform_real_distribution<float> pondRadius(6.0f, 24.0f);
+    for (int i = 0; i < pondCount; ++i)
+    {
+        NavConvexVolume pond;
+        const glm::vec3 center(pondPos(rng), 0.0f, pondPos(rng));
+        const float radius = pondRadius(rng);
+        for (int k = 0; k < 8; ++k)
+            pond.verts.push_back(center + radius * glm::vec3(cosf(k * 0.785398f), 0.0f, sinf(k * 0.785398f)));
+        pond.hmin = 0.0f;
+        pond.hmax = 2.0f;
+        pond.area = NAVAREA_WATER;
+        volumes.push_back(pond);
+    }
+    for (const NavConvexVolume& volume : volumes)
+        NavigationSystem::MarkConvexVolumeArea(field, volume);
+    for (HeightFieldSpan& span : field.spanPool)
+        span.areaID = 1;
+    NavigationSystem::BuildRegions(field, 0, 0, 0, fieldSize, fieldSize, 2);
+    NavMesh navMesh;
+    NavigationSystem::BuildPolyMesh(field, tileSize, navMesh);
+    delete[] field.spans;
+
+    std::vector<glm::vec3> centers;
+    CollectPolyCenters(navMesh, centers);
+    NavMeshQuery query;
+    query.Init(&navMesh, BENCH_MAX_NODES * 4);
+    std::uniform_int_distribution<size_t> pick(0, centers.size() - 1);
+    std::vector<glm::vec3> starts(numQueries), ends(numQueries);
+    for (int i = 0; i < numQueries; ++i)
+    {
+        starts[i] = centers[pick(rng)];
+        ends[i] = centers[pick(rng)];
+    }
+
+    NavQueryFilter uniform, costs, noWater;
+    costs.SetAreaCost(NAVAREA_ROAD, 0.5f);
+    costs.SetAreaCost(NAVAREA_WATER, 4.0f);
+    noWater = costs;
+    noWater.SetExcludeFlags(NAVPOLYFLAG_SWIM);
+    const NavQueryFilter* filters[] = {&uniform, &costs, &noWater};
+    const char* filterNames[] = {"uniform costs", "road 0.5, water 4", "water excluded"};
+
+    std::cout << "Area cost benchmark: " << fieldSize << "x" << fieldSize << " field, " << navMesh.GetPolyCount() << " polys, " << numQueries
+              << " queries" << std::endl;
+    const glm::vec3 halfExtents(2.0f, 4.0f, 2.0f);
+    NavPolyRef path[BENCH_MAX_PATH_POLYS * 4];
+    for (int f = 0; f < 3; ++f)
+    {
+        const NavQueryFilter& filter = *filters[f];
+        double areaLengths[NAV_MAX_AREAS] = {};
+        double seconds = 0.0;
+        long long expanded = 0;
+        int searched = 0, found = 0;
+        for (int i = 0; i < numQueries; ++i)
+        {
+            NavPolyRef startRef, endRef;
+            glm::vec3 startPos, endPos;
+            query.FindNearestPoly(starts[i], halfExtents, filter, startRef, startPos);
+            query.FindNearestPoly(ends[i], halfExtents, filter, endRef, endPos);
+            if (!startRef || !endRef)
+                continue;
+            searched++;
+            int pathCount = 0;
+            const auto begin = std::chrono::high_resolution_clock::now();
+            const NavQueryStatus status = query.FindPath(startRef, endRef, startPos, endPos, filter, path, pathCount, BENCH_MAX_PATH_POLYS * 4);
+            seconds += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - begin).count();
+            expanded += query.GetNodePool()->GetNodeCount();
+            if (status != NAVQUERY_SUCCESS || path[pathCount - 1] != endRef)
+                continue;
+            found++;
+            MeasurePathAreas(query, startPos, endPos, path, pathCount, areaLengths);
+        }
+        const double total = areaLengths[NAVAREA_GROUND] + areaLengths[NAVAREA_ROAD] + areaLengths[NAVAREA_WATER];
+        std::cout << "  " << filterNames[f] << ": " << found << " of " << searched << " paths, " << seconds * 1e6 / std::max(searched, 1)
+                  << " us per query, " << expanded / std::max(searched, 1) << " nodes, travelled " << total / std::max(found, 1) << " with "
+                  << 100.0 * areaLengths[NAVAREA_ROAD] / std::max(total, 1.0) << "% on roads and "
+                  << 100.0 * areaLengths[NAVAREA_WATER] / std::max(total, 1.0) << "% in water" << std::endl;
+    }
+}
+
+void NavigationSystemBenchmarks::RunOffMeshBenchmark(int numConnections)
+{
+    const int fieldSize = 512, tileSize = 32, islandSize = 64, numQueries = 1000;
+    std::vector<unsigned char> blocked(fieldSize * fieldSize, 0);
+    for (int z = 0; z < fieldSize; ++z)
+        for (int x = 0; x < fieldSize; ++x)
+            blocked[x + z * fieldSize] = x % islandSize >= islandSize - 2 || z % islandSize >= islandSize - 2;
+    HeightField field;
+    BuildFlatField(field, fieldSize, blocked);
+    NavigationSystem::BuildRegions(field, 0, 0, 0, fieldSize, fieldSize, 2);
+
+    // Jumps over the walls between islands, a third of them one way.
+    std::mt19937 rng(2024);
+    std::uniform_int_distribution<int> pickIsland(0, fieldSize / islandSize - 1);
+    std::uniform_real_distribution<float> along(2.0f, islandSize - 4.0f);
+    std::vector<NavOffMeshConnection> connections;
+    for (int i = 0; i < numConnections; ++i)
+    {
+        const int ix = pickIsland(rng), iz = pickIsland(rng);
+        const bool acrossX = rng() & 1;
+        if ((acrossX ? ix : iz) == fieldSize / islandSize - 1)
+            continue;
+        const float wall = (float)((acrossX ? ix : iz) * islandSize + islandSize - 1);
+        const float other = (acrossX ? iz : ix) * islandSize + along(rng);
+        NavOffMeshConnection connection;
+        connection.start = acrossX ? glm::vec3(wall - 2.5f, 0.0f, other) : glm::vec3(other, 0.0f, wall - 2.5f);
+        connection.end = acrossX ? glm::vec3(wall + 2.5f, 0.0f, other) : glm::vec3(other, 0.0f, wall + 2.5f);
+        connection.radius = 1.0f;
+        connection.cost = 2.0f;
+        connection.area = NAVAREA_GROUND;
+        connection.bidirectional = i % 3 != 0;
+        connections.push_back(connection);
+    }
+
+    NavMesh islands, linked;
+    auto begin = std::chrono::high_resolution_clock::now();
+    NavigationSystem::BuildPolyMesh(field, tileSize, islands);
+    const double plainSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - begin).count();
+    linked.offMeshConnections = connections;
+    begin = std::chrono::high_resolution_clock::now();
+    NavigationSystem::BuildPolyMesh(field, tileSize, linked);
+    const double linkedSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - begin).count();
+    delete[] field.spans;
+
+    // Every tile scanning every connection for the ones it holds, against the counting sort into tile buckets.
+    begin = std::chrono::high_resolution_clock::now();
+    long long scanned = 0;
+    for (int tz = 0; tz < linked.tilesZ; ++tz)
+    {
+        for (int tx = 0; tx < linked.tilesX; ++tx)
+        {
+            for (const NavOffMeshConnection& connection : linked.offMeshConnections)
+            {
+                int minTileX, minTileZ, maxTileX, maxTileZ;
+                linked.GetTileRange(connection.start, connection.start, minTileX, minTileZ, maxTileX, maxTileZ);
+                scanned += minTileX == tx && minTileZ == tz;
+                linked.GetTileRange(connection.end, connection.end, minTileX, minTileZ, maxTileX, maxTileZ);
+                scanned += minTileX == tx && minTileZ == tz;
+            }
+        }
+    }
+    const double scanSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - begin).count();
+    NavMesh indexed = linked;
+    begin = std::chrono::high_resolution_clock::now();
+    BuildOffMeshIndex(indexed);
+    const double indexSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - begin).count();
+    int attached = 0;
+    for (unsigned int poly : linked.offMeshPolys)
+        attached += poly != 0xffffffff;
+
+    std::vector<glm::vec3> centers;
+    for (const auto& tile : islands.tiles)
+        for (const auto& poly : tile.polys)
+            centers.push_back((poly.bmin + poly.bmax) * 0.5f);
+    std::uniform_int_distribution<size_t> pick(0, centers.size() - 1);
+    std::vector<glm::vec3> starts(numQueries), ends(numQueries);
+    for (int i = 0; i < numQueries; ++i)
+    {
+        starts[i] = centers[pick(rng)];
+        ends[i] = centers[pick(rng)];
+    }
+
+    std::cout << "Off-mesh benchmark: " << fieldSize << "x" << fieldSize << " field of " << islandSize << "x" << islandSize << " islands, "
+              << attached << " of " << connections.size() << " connections attached" << std::endl;
+    std::cout << "  build " << plainSeconds * 1000.0 << " ms without connections, " << linkedSeconds * 1000.0 << " ms with them" << std::endl;
+    std::cout << "  finding the connections of every tile: scan " << scanSeconds * 1000.0 << " ms (" << scanned << " ends), tile buckets "
+              << indexSeconds * 1000.0 << " ms (" << scanSeconds / std::max(indexSeconds, 1e-9) << "x)" << std::endl;
+
+    const glm::vec3 halfExtents(2.0f, 4.0f, 2.0f);
+    NavPolyRef path[BENCH_MAX_PATH_POLYS * 4];
+    glm::vec3 straightPath[BENCH_MAX_STRAIGHT_PATH];
+    const NavMesh* meshes[] = {&islands, &linked};
+    const char* meshNames[] = {"without connections", "with connections"};
+    NavQueryFilter filter;
+    for (int m = 0; m < 2; ++m)
+    {
+        NavMeshQuery query;
+        query.Init(meshes[m], BENCH_MAX_NODES * 8);
+        double seconds = 0.0;
+        int found = 0, crossings = 0;
+        for (int i = 0; i < numQueries; ++i)
+        {
+            NavPolyRef startRef, endRef;
+            glm::vec3 startPos, endPos;
+            query.FindNearestPoly(starts[i], halfExtents, filter, startRef, startPos);
+            query.FindNearestPoly(ends[i], halfExtents, filter, endRef, endPos);
+            int pathCount = 0, straightCount = 0;
+            const auto queryBegin = std::chrono::high_resolution_clock::now();
+            const NavQueryStatus status = query.FindPath(startRef, endRef, startPos, endPos, filter, path, pathCount, BENCH_MAX_PATH_POLYS * 4);
+            query.FindStraightPath(startPos, endPos, path, pathCount, straightPath, straightCount, BENCH_MAX_STRAIGHT_PATH);
+            seconds += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - queryBegin).count();
+            if (status != NAVQUERY_SUCCESS || path[pathCount - 1] != endRef)
+                continue;
+            found++;
+            for (int k = 0; k < pathCount; ++k)
+            {
+                const NavMeshTile* tile;
+                const NavPoly* poly;
+                meshes[m]->GetTileAndPoly(path[k], tile, poly);
+                crossings += poly->type == NAVPOLYTYPE_OFFMESH;
+            }
+        }
+        std::cout << "  " << meshNames[m] << ": " << found << " of " << numQueries << " paths reached their goal, "
+                  << (double)crossings / std::max(found, 1) << " connections per path, " << seconds * 1e6 / numQueries << " us per query" << std::endl;
+    }
+}
+
+void NavigationSystemBenchmarks::RunChunkyTriMeshBenchmark(JobSystem& jobSystem)
+{
+    const int gridSize = 512, tileSize = 32, propCount = 50000, trisPerChunk = 256;
+    const int tilesPerSide = gridSize / tileSize;
+
+    // A terrain grid plus scattered props, triangles shuffled the way objects of a scene end up in one soup.
+    NavInputGeometry geometry;
+    auto height = [](int x, int z) { return 8.0f * sinf(x * 0.031f) * cosf(z * 0.023f); };
+    for (int z = 0; z <= gridSize; ++z)
+        for (int x = 0; x <= gridSize; ++x)
+            geometry.verts.push_back(glm::vec3((float)x, height(x, z), (float)z));
+    std::vector<glm::uvec3> triangles;
+    for (int z = 0; z < gridSize; ++z)
+    {
+        for (int x = 0; x < gridSize; ++x)
+        {
+            const unsigned int a = x + z * (gridSize + 1), b = a + 1, c = a + gridSize + 2, d = a + gridSize + 1;
+            triangles.push_back(glm::uvec3(a, c, b));
+            triangles.push_back(glm::uvec3(a, d, c));
+        }
+    }
+    std::mt19937 rng(48);
+    std::uniform_real_distribution<float> propPos(0.0f, gridSize - 4.0f);
+    std::uniform_real_distribution<float> propSize(0.5f, 4.0f);
+    for (int i = 0; i < propCount; ++i)
+    {
+        const float x = propPos(rng), z = propPos(rng), size = propSize(rng);
+        const unsigned int first = (unsigned int)geometry.verts.size();
+        geometry.verts.push_back(glm::vec3(x, 0.0f, z));
+        geometry.verts.push_back(glm::vec3(x + size, 2.0f, z));
+        geometry.verts.push_back(glm::vec3(x, 2.0f, z + size));
+        triangles.push_back(glm::uvec3(first, first + 1, first + 2));
+    }
+    std::shuffle(triangles.begin(), triangles.end(), rng);
+    for (const glm::uvec3& tri : triangles)
+    {
+        geometry.indices.insert(geometry.indices.end(), {tri.x, tri.y, tri.z});
+        geometry.areas.push_back(NAVAREA_GROUND);
+    }
+    const int triangleCount = geometry.GetTriangleCount();
+
+    auto tileRect = [&](int tx, int tz, glm::vec2& bmin, glm::vec2& bmax)
+    {
+        bmin = glm::vec2((float)(tx * tileSize), (float)(tz * tileSize));
+        bmax = bmin + glm::vec2((float)tileSize);
+    };
+    auto overlapsRect = [&](int i, const glm::vec2& bmin, const glm::vec2& bmax)
+    {
+        glm::vec3 tri[3];
+        geometry.GetTriangle(i, tri);
+        const glm::vec3 triMin = glm::min(tri[0], glm::min(tri[1], tri[2])), triMax = glm::max(tri[0], glm::max(tri[1], tri[2]));
+        return bmin.x <= triMax.x && bmax.x >= triMin.x && bmin.y <= triMax.z && bmax.y >= triMin.z;
+    };
+
+    // Every tile scanning the whole soup, as a tile rebuild without an index would.
+    auto begin = std::chrono::high_resolution_clock::now();
+    long long scanned = 0;
+    for (int tz = 0; tz < tilesPerSide; ++tz)
+    {
+        for (int tx = 0; tx < tilesPerSide; ++tx)
+        {
+            glm::vec2 bmin, bmax;
+            tileRect(tx, tz, bmin, bmax);
+            for (int i = 0; i < triangleCount; ++i)
+                scanned += overlapsRect(i, bmin, bmax);
+        }
+    }
+    const double scanSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - begin).count();
+
+    ChunkyTriMesh sequential, parallel;
+    begin = std::chrono::high_resolution_clock::now();
+    sequential.Build(geometry, trisPerChunk, nullptr);
+    const double sequentialSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - begin).count();
+    begin = std::chrono::high_resolution_clock::now();
+    parallel.Build(geometry, trisPerChunk, &jobSystem);
+    const double parallelSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - begin).count();
+    const bool sameTree = sequential.GetNodes().size() == parallel.GetNodes().size() &&
+                          memcmp(sequential.GetNodes().data(), parallel.GetNodes().data(), sequential.GetNodes().size() * sizeof(ChunkyTriNode)) == 0;
+
+    std::vector<int> tileTriangles;
+    long long gathered = 0;
+    int mismatches = 0;
+    begin = std::chrono::high_resolution_clock::now();
+    for (int tz = 0; tz < tilesPerSide; ++tz)
+    {
+        for (int tx = 0; tx < tilesPerSide; ++tx)
+        {
+            glm::vec2 bmin, bmax;
+            tileRect(tx, tz, bmin, bmax);
+            parallel.QueryTriangles(bmin, bmax, tileTriangles);
+            gathered += tileTriangles.size();
+        }
+    }
+    const double querySeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - begin).count();
+    for (int tz = 0; tz < tilesPerSide; tz += 5)
+    {
+        for (int tx = 0; tx < tilesPerSide; tx += 5)
+        {
+            glm::vec2 bmin, bmax;
+            tileRect(tx, tz, bmin, bmax);
+            parallel.QueryTriangles(bmin, bmax, tileTriangles);
+            int expected = 0;
+            for (int i = 0; i < triangleCount; ++i)
+                expected += overlapsRect(i, bmin, bmax);
+            mismatches += expected != (int)tileTriangles.size();
+        }
+    }
+
+    std::cout << "Chunky tri mesh benchmark: " << triangleCount << " triangles, " << tilesPerSide * tilesPerSide << " tiles of " << tileSize
+              << ", " << parallel.GetChunkCount() << " chunks of at most " << parallel.GetMaxTrisPerChunk() << std::endl;
+    std::cout << "  build " << sequentialSeconds * 1000.0 << " ms on one thread, " << parallelSeconds * 1000.0 << " ms on "
+              << jobSystem.GetWorkerCount() << " workers (" << sequentialSeconds / parallelSeconds << "x), "
+              << (sameTree ? "same tree" : "trees differ") << std::endl;
+    std::cout << "  gathering every tile: scan " << scanSeconds * 1000.0 << " ms (" << scanned << " triangles), chunks " << querySeconds * 1000.0
+              << " ms (" << gathered << " triangles, " << scanSeconds / querySeconds << "x), " << mismatches << " sampled tiles differ" << std::endl;
+}
+
+// The input collection as it was before the indexed format, three transforms and a Triangle per triangle.
+static void CollectTriangleSoup(const std::vector<SceneObject>& objects, std::vector<Triangle>& triangles, std::vector<unsigned char>& areas)
+{
+    for (const SceneObject& obj : objects)
+    {
+        const MeshData* mesh = obj.mesh;
+        for (size_t i = 0; i + 2 < mesh->indices.size(); i += 3)
+        {
+            Triangle tri;
+            for (int k = 0; k < 3; ++k)
+            {
+                const Vec3f& v = mesh->vertices[mesh->indices[i + k]];
+                const glm::vec4 world = obj.modelMatrix * glm::vec4(v.x, v.y, v.z, 1.0f);
+                tri.verts[k] = {world.x, world.y, world.z};
+            }
+            triangles.push_back(tri);
+            areas.push_back(obj.navArea);
+        }
+    }
+}
+
+void NavigationSystemBenchmarks::RunInputGeometryBenchmark(int numObjects)
+{
+    // A shared cube, a cube with its vertices split per face as exporters write them, and a 64x64 terrain patch.
+    MeshData cube, splitCube, terrain;
+    for (int i = 0; i < 8; ++i)
+        cube.vertices.push_back({(float)(i & 1), (float)((i >> 1) & 1), (float)((i >> 2) & 1)});
+    cube.indices = {0, 2, 1, 1, 2, 3, 4, 5, 6, 5, 7, 6, 0, 1, 4, 1, 5, 4, 2, 6, 3, 3, 6, 7, 0, 4, 2, 2, 4, 6, 1, 3, 5, 3, 7, 5};
+    for (size_t i = 0; i < cube.indices.size(); i += 6)
+    {
+        // Each face gets its own copies of its four corners.
+        unsigned int faceVerts[8];
+        std::fill(faceVerts, faceVerts + 8, 0xffffffff);
+        for (size_t k = i; k < i + 6; ++k)
+        {
+            const unsigned int corner = cube.indices[k];
+            if (faceVerts[corner] == 0xffffffff)
+            {
+                faceVerts[corner] = (unsigned int)splitCube.vertices.size();
+                splitCube.vertices.push_back(cube.vertices[corner]);
+            }
+            splitCube.indices.push_back(faceVerts[corner]);
+        }
+    }
+    const int patchSize = 64;
+    for (int z = 0; z <= patchSize; ++z)
+        for (int x = 0; x <= patchSize; ++x)
+            terrain.vertices.push_back({(float)x, 0.5f * sinf(x * 0.3f) * cosf(z * 0.2f), (float)z});
+    for (int z = 0; z < patchSize; ++z)
+    {
+        for (int x = 0; x < patchSize; ++x)
+        {
+            const unsigned int a = x + z * (patchSize + 1), b = a + 1, c = a + patchSize + 2, d = a + patchSize + 1;
+            terrain.indices.insert(terrain.indices.end(), {a, c, b, a, d, c});
+        }
+    }
+
+    std::mt19937 rng(49);
+    std::uniform_real_distribution<float> pos(-500.0f, 500.0f);
+    std::uniform_real_distribution<float> angle(0.0f, 6.283185f);
+    std::vector<SceneObject> objects(numObjects);
+    for (int i = 0; i < numObjects; ++i)
+    {
+        SceneObject& obj = objects[i];
+        obj.mesh = i % 50 == 0 ? &terrain : (i & 1) ? &splitCube : &cube;
+        obj.modelMatrix = glm::rotate(glm::translate(glm::mat4(1.0f), glm::vec3(pos(rng), 0.0f, pos(rng))), angle(rng), glm::vec3(0.0f, 1.0f, 0.0f));
+        obj.navArea = i % 7 == 0 ? NAVAREA_ROAD : NAVAREA_GROUND;
+    }
+
+    std::vector<Triangle> soup;
+    std::vector<unsigned char> soupAreas;
+    auto begin = std::chrono::high_resolution_clock::now();
+    CollectTriangleSoup(objects, soup, soupAreas);
+    const double soupSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - begin).count();
+
+    NavInputGeometry geometry;
+    begin = std::chrono::high_resolution_clock::now();
+    for (const SceneObject& obj : objects)
+        AppendNavInputMesh(geometry, obj.mesh->vertices.data(), (int)obj.mesh->vertices.size(), obj.mesh->indices.data(), (int)obj.mesh->indices.size(),
+                           obj.modelMatrix, obj.navArea);
+    const double indexedSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - begin).count();
+
+    int mismatches = geometry.GetTriangleCount() == (int)soup.size() ? 0 : 1;
+    for (int i = 0; i < geometry.GetTriangleCount() && !mismatches; ++i)
+    {
+        glm::vec3 tri[3];
+        geometry.GetTriangle(i, tri);
+        mismatches += memcmp(tri, &soup[i], sizeof(Triangle)) != 0 || geometry.areas[i] != soupAreas[i];
+    }
+
+    const size_t soupBytes = soup.size() * (sizeof(Triangle) + 1);
+    const size_t indexedBytes = geometry.verts.size() * sizeof(glm::vec3) + geometry.indices.size() * sizeof(unsigned int) + geometry.areas.size();
+    std::cout << "Input geometry benchmark: " << numObjects << " objects, " << soup.size() << " triangles" << std::endl;
+    std::cout << "  triangle soup: " << soup.size() * 3 << " vertex transforms, " << soupBytes / 1024 << " KB, " << soupSeconds * 1000.0 << " ms" << std::endl;
+    std::cout << "  indexed: " << geometry.verts.size() << " vertex transforms (" << (double)soup.size() * 3 / geometry.verts.size() << "x fewer), "
+              << indexedBytes / 1024 << " KB (" << (double)soupBytes / indexedBytes << "x smaller), " << indexedSeconds * 1000.0 << " ms, "
+              << mismatches << " triangles differ" << std::endl;
+}
+
+void NavigationSystemBenchmarks::RunBoxRasterizationBenchmark(int numBoxes)
+{
+    MeshData cube;
+    for (int i = 0; i < 8; ++i)
+        cube.vertices.push_back({(float)(i & 1) - 0.5f, (float)((i >> 1) & 1) - 0.5f, (float)((i >> 2) & 1) - 0.5f});
+    cube.indices = {0, 2, 1, 1, 2, 3, 4, 5, 6, 5, 7, 6, 0, 1, 4, 1, 5, 4, 2, 6, 3, 3, 6, 7, 0, 4, 2, 2, 4, 6, 1, 3, 5, 3, 7, 5};
+
+    VoxelGrid grid;
+    grid.minimumCorner = glm::vec3(-64.0f, -1.0f, -64.0f);
+    grid.maximumCorner = glm::vec3(64.0f, 15.0f, 64.0f);
+    grid.cellSize = 0.25f;
+    grid.cellHeight = 0.2f;
+    grid.width = grid.depth = 512;
+    grid.height = 80;
+
+    // Every other box is turned about y, a few reach out of the grid.
+    std::mt19937 rng(50);
+    std::uniform_real_distribution<float> pos(-66.0f, 66.0f);
+    std::uniform_real_distribution<float> size(0.5f, 6.0f);
+    std::uniform_real_distribution<float> height(-1.0f, 8.0f);
+    std::uniform_real_distribution<float> angle(0.0f, 6.283185f);
+    NavInputGeometry geometry;
+    for (int i = 0; i < numBoxes; ++i)
+    {
+        glm::mat4 transform = glm::translate(glm::mat4(1.0f), glm::vec3(pos(rng), height(rng), pos(rng)));
+        if (i & 1)
+            transform = glm::rotate(transform, angle(rng), glm::vec3(0.0f, 1.0f, 0.0f));
+        transform = glm::scale(transform, glm::vec3(size(rng), size(rng), size(rng)));
+        AppendNavInputMesh(geometry, cube.vertices.data(), (int)cube.vertices.size(), cube.indices.data(), (int)cube.indices.size(), transform,
+                           NAVAREA_GROUND);
+    }
+
+    const int totalVoxels = grid.width * grid.depth * grid.height;
+    grid.data.assign(totalVoxels, false);
+    int triangleVoxels = 0;
+    auto begin = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < geometry.GetTriangleCount(); ++i)
+    {
+        glm::vec3 tri[3];
+        geometry.GetTriangle(i, tri);
+        NavigationSystem::RasterizeTriangle(grid, tri, 0, 0, grid.width, grid.depth, triangleVoxels);
+    }
+    const double triangleSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - begin).count();
+    const std::vector<bool> triangleData = grid.data;
+
+    grid.data.assign(totalVoxels, false);
+    int boxVoxels = 0;
+    begin = std::chrono::high_resolution_clock::now();
+    for (const NavInputBox& box : geometry.boxes)
+        NavigationSystem::RasterizeBox(grid, box, 0, 0, grid.width, grid.depth, boxVoxels);
+    const double boxSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - begin).count();
+
+    int mismatches = 0;
+    for (int i = 0; i < totalVoxels; ++i)
+        mismatches += triangleData[i] != grid.data[i];
+
+    int axisAligned = 0;
+    for (const NavInputBox& box : geometry.boxes)
+        axisAligned += box.axisAligned;
+    std::cout << "Box rasterization benchmark: " << numBoxes << " boxes, " << geometry.boxes.size() << " recognized (" << axisAligned
+              << " axis aligned), " << grid.width << "x" << grid.depth << "x" << grid.height << " voxels" << std::endl;
+    std::cout << "  triangles: " << triangleVoxels << " voxels, " << triangleSeconds * 1000.0 << " ms" << std::endl;
+    std::cout << "  box stamps: " << boxVoxels << " voxels, " << boxSeconds * 1000.0 << " ms (" << triangleSeconds / boxSeconds << "x faster), "
+              << mismatches << " voxels differ" << std::endl;
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include "NavMesh.h"
+
+struct HeightField;
+class JobSystem;
+
+class NavigationSystemBenchmarks
+{
+public:
+    // Nearest poly + A* + string pulling between random poly pairs, reports queries per second.
+    static void RunQueryBenchmark(const NavMesh& navMesh, int numQueries);
+    // Batched paths on the job system against one NavMeshQuery called in a loop, with a share of repeated requests.
+    static void RunBatchQueryBenchmark(const NavMesh& navMesh, JobSystem& jobSystem, int numQueries);
+    // HPA* against plain poly A* for cross map queries on a navmesh built from a generated 2048x2048 field.
+    static void RunHierarchicalPathBenchmark(int numQueries);
+    // A* with and without ALT landmarks between random connected polys, on a generated maze and a pillar field.
+    static void RunLandmarkBenchmark(int numQueries, int landmarkCount);
+    // One shared flow field against a JPS search per agent for agents sent to a common goal, on generated fields.
+    static void RunFlowFieldBenchmark(int numAgents);
+    // Agents walking PathCorridors across a generated field against a full search per tick, then repair after tile rebuilds.
+    static void RunPathCorridorBenchmark(int numAgents, int numTicks);
+    // Crowd updates at 60 Hz for agents crossing a generated pillar field, reports the per phase cost of a tick.
+    static void RunCrowdBenchmark(JobSystem& jobSystem, int numAgents, int numTicks);
+    // Navmesh raycast and heightfield pyramid line of sight against dense sampling of the segment, on a generated field of tall pillars.
+    static void RunRaycastBenchmark(int numRays);
+    // Box overlap and surface below queries on the height pyramid against column scans, and dirty tile rebuilds against a full build.
+    static void RunHeightPyramidBenchmark(int numQueries);
+    // Saving a navmesh built from a generated 1024x1024 field, then mapping it back against building it again.
+    static void RunNavMeshFileBenchmark();
+    // Adding and removing obstacles through the tile cache on a generated 1024x1024 field, against rebuilding regions and polys of the whole field.
+    static void RunTileCacheBenchmark(int numObstacles);
+    // Ratio and speed of the tile codec with and without the delta prefilter, on layers of generated pillar, maze and terrain fields.
+    static void RunCompressionBenchmark();
+    // Streaming the tiles of a saved 1024x1024 field around a focus point that crosses it, under a sixteenth of its memory.
+    static void RunStreamingBenchmark();
+    // Three agent profiles meshed from one generated 1024x1024 terrain, one after another and in parallel.
+    static void RunAgentProfileBenchmark(JobSystem& jobSystem);
+    // A* with uniform costs, with cheap roads and expensive water, and with water excluded, on a generated 512x512 field of marked areas.
+    static void RunAreaCostBenchmark(int numQueries);
+    // Connections jumping the walls of a generated 512x512 field of islands: tile bucketing against a scan, and paths found with and without them.
+    static void RunOffMeshBenchmark(int numConnections);
+    // Gathering the triangles of every tile from a shuffled 574k triangle soup through the chunky mesh against a full scan, and its build on one thread and on the job system.
+    static void RunChunkyTriMeshBenchmark(JobSystem& jobSystem);
+    // Collecting generated scene objects into the indexed input against a triangle soup, vertex transforms, memory and time.
+    static void RunInputGeometryBenchmark(int numObjects);
+    // Generated axis aligned and rotated boxes on a 512x512 grid rasterized triangle by triangle against the box stamps, time and differing voxels.
+    static void RunBoxRasterizationBenchmark(int numBoxes);
+    // BV tree QueryPolygons/FindNearestPoly against a brute force scan, on the built mesh and on a generated 256x256 tile mesh.
+    static void RunBVTreeBenchmark(const NavMesh& navMesh, int numQueries);
+    // JPS over the span graph, on the built heightfield and on a generated 1024x1024 field with pillars.
+    static void RunSpanPathBenchmark(const HeightField& heightField, int numQueries);
+};
@@ -12,12 +12,14 @@ NavigationSystemDebugTools::~NavigationSystemDebugTools()
 {
     glDeleteVertexArrays(1, &m_DebugVAO);
     glDeleteBuffers(1, &m_DebugVBO);
+    glDeleteBuffers(1, &m_DebugEBO);
     m_DebugVAO = 0;
     m_DebugVBO = 0;
+    m_DebugEBO = 0;
 }
 
-void NavigationSystemDebugTools::RenderDebugData(Camera& camera, Shader* debugShader, const Scene& scene, const std::vector<Triangle>& inputTriangles, const VoxelGrid& voxelGrid, HeightField& heightField,
-    const ContourSet& contourSet, DebugDrawMode debugDrawMode)
+void NavigationSystemDebugTools::RenderDebugData(Camera& camera, Shader* debugShader, const Scene& scene, const VoxelGrid& voxelGrid, HeightField& heightField,
+    const ContourSet& contourSet, const NavMesh& navMesh, const std::vector<glm::vec3>& debugPath, DebugDrawMode debugDrawMode)
 {
     debugShader->use();
     glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), 1280.0f/720.0f, 0.1f, 100.0f);
@@ -30,7 +32,7 @@ void NavigationSystemDebugTools::RenderDebugData(Camera& camera, Shader* debugSh
     switch (debugDrawMode)
     {
         case DRAWMODE_INPUT_TRIANGLES:
-            DrawInputTriangles(debugShader, inputTriangles);
+            DrawInputTriangles(debugShader);
             break;
         case DRAWMODE_VOXELS:
             DrawVoxels_Solid(debugShader, scene, voxelGrid);
@@ -43,10 +45,14 @@ void NavigationSystemDebugTools::RenderDebugData(Camera& camera, Shader* debugSh
             break;
         case DRAWMODE_CONNECTIONS:
             DrawConnections(debugShader, heightField);
+            DrawPath(debugShader, debugPath);
             break;
         case DRAWMODE_CONTOURS:
             DrawContours(debugShader, contourSet);
             break;
+        case DRAWMODE_NAVMESH_FINAL:
+            DrawNavMesh(debugShader, navMesh, debugPath);
+            break;
         case DRAWMODE_NONE:
             break;
     }
@@ -54,16 +60,16 @@ void NavigationSystemDebugTools::RenderDebugData(Camera& camera, Shader* debugSh
     glBindVertexArray(0);
 }
 
-void NavigationSystemDebugTools::DrawInputTriangles(Shader* shader, const std::vector<Triangle>& m_InputTriangles)
+void NavigationSystemDebugTools::DrawInputTriangles(Shader* shader)
 {
-    if (m_DebugVAO != 0 && !m_InputTriangles.empty())
+    if (m_DebugVAO != 0 && m_DebugIndexCount > 0)
     {
         shader->setMat4("model", glm::mat4(1.0f));
         glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
         shader->setVec4("ourColor", glm::vec4(1.0f, 1.0f, 0.0f, 1.0f));
         
         glBindVertexArray(m_DebugVAO);
-        glDrawArrays(GL_TRIANGLES, 0, m_InputTriangles.size() * 3);
+        glDrawElements(GL_TRIANGLES, m_DebugIndexCount, GL_UNSIGNED_INT, 0);
         glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
     }
 }
@@ -369,30 +375,139 @@ void NavigationSystemDebugTools::DrawContours(Shader* shader, const ContourSet&
     glBindVertexArray(0);
 }
 
-void NavigationSystemDebugTools::UpdateDebugBuffers(const std::vector<Triangle>& m_InputTriangles)
+// Arc from the entry of a link onto an off-mesh poly to the exit on the far side of the connection.
+static void AddOffMeshArc(const NavMesh& navMesh, NavPolyRef from, const NavPolyLink& link, std::vector<float>& verts)
 {
-    if (m_InputTriangles.empty())
+    if (!navMesh.IsValidPolyRef(link.neighbor))
+        return;
+    const NavMeshTile* tile;
+    const NavPoly* poly;
+    navMesh.GetTileAndPoly(link.neighbor, tile, poly);
+    if (poly->type != NAVPOLYTYPE_OFFMESH)
+        return;
+    for (unsigned int i = 0; i < poly->linkCount; ++i)
+    {
+        const NavPolyLink& exit = tile->links[poly->firstLink + i];
+        if (exit.neighbor == from)
+            continue;
+        const glm::vec3& a = link.left;
+        const glm::vec3& b = exit.left;
+        const float height = 0.25f * glm::distance(a, b);
+        glm::vec3 prev = a;
+        for (int s = 1; s <= 8; ++s)
+        {
+            const float t = s / 8.0f;
+            const glm::vec3 p = glm::mix(a, b, t) + glm::vec3(0.0f, 4.0f * height * t * (1.0f - t), 0.0f);
+            verts.push_back(prev.x); verts.push_back(prev.y + 0.08f); verts.push_back(prev.z);
+            verts.push_back(p.x); verts.push_back(p.y + 0.08f); verts.push_back(p.z);
+            prev = p;
+        }
         return;
+    }
+}
 
-    std::vector<float> debugVerts;
-    debugVerts.reserve(m_InputTriangles.size() * 3 * 3);
-    for (const auto& tri : m_InputTriangles)
-        for (int i = 0; i < 3; ++i)
+void NavigationSystemDebugTools::DrawNavMesh(Shader* shader, const NavMesh& navMesh, const std::vector<glm::vec3>& debugPath)
+{
+    std::vector<float> polyVerts, linkVerts, offMeshVerts;
+    for (const auto& tile : navMesh.tiles)
+    {
+        const NavPolyRef base = navMesh.GetPolyRefBase(tile);
+        for (const auto& poly : tile.polys)
         {
-            debugVerts.push_back(tri.verts[i].x);
-            debugVerts.push_back(tri.verts[i].y);
-            debugVerts.push_back(tri.verts[i].z);
+            if (poly.type == NAVPOLYTYPE_OFFMESH)
+                continue;
+            const NavPolyRef polyRef = base | (unsigned int)(&poly - tile.polys.data());
+            for (unsigned int i = 0; i < poly.linkCount; ++i)
+                AddOffMeshArc(navMesh, polyRef, tile.links[poly.firstLink + i], offMeshVerts);
+            const float y = poly.bmin.y + 0.05f;
+            const glm::vec3 corners[4] =
+            {
+                { poly.bmin.x, y, poly.bmin.z },
+                { poly.bmax.x, y, poly.bmin.z },
+                { poly.bmax.x, y, poly.bmax.z },
+                { poly.bmin.x, y, poly.bmax.z }
+            };
+            for (int i = 0; i < 4; ++i)
+            {
+                const glm::vec3& p0 = corners[i];
+                const glm::vec3& p1 = corners[(i + 1) % 4];
+                polyVerts.push_back(p0.x); polyVerts.push_back(p0.y); polyVerts.push_back(p0.z);
+                polyVerts.push_back(p1.x); polyVerts.push_back(p1.y); polyVerts.push_back(p1.z);
+            }
+        }
+        for (const auto& link : tile.links)
+        {
+            if (link.left == link.right)
+                continue; // Off-mesh attachments, drawn as arcs
+            linkVerts.push_back(link.left.x); linkVerts.push_back(link.left.y + 0.08f); linkVerts.push_back(link.left.z);
+            linkVerts.push_back(link.right.x); linkVerts.push_back(link.right.y + 0.08f); linkVerts.push_back(link.right.z);
         }
+    }
+
+
+    DrawLines(shader, polyVerts, glm::vec4(0.0f, 0.8f, 1.0f, 1.0f), 1.0f);
+    DrawLines(shader, linkVerts, glm::vec4(0.0f, 1.0f, 0.3f, 1.0f), 2.0f);
+    DrawLines(shader, offMeshVerts, glm::vec4(1.0f, 0.4f, 1.0f, 1.0f), 2.0f);
+    DrawPath(shader, debugPath);
+}
+
+void NavigationSystemDebugTools::DrawPath(Shader* shader, const std::vector<glm::vec3>& debugPath)
+{
+    std::vector<float> pathVerts;
+    for (size_t i = 0; i + 1 < debugPath.size(); ++i)
+    {
+        pathVerts.push_back(debugPath[i].x); pathVerts.push_back(debugPath[i].y + 0.15f); pathVerts.push_back(debugPath[i].z);
+        pathVerts.push_back(debugPath[i + 1].x); pathVerts.push_back(debugPath[i + 1].y + 0.15f); pathVerts.push_back(debugPath[i + 1].z);
+    }
+    DrawLines(shader, pathVerts, glm::vec4(1.0f, 1.0f, 0.0f, 1.0f), 4.0f);
+    glBindVertexArray(0);
+}
+
+void NavigationSystemDebugTools::DrawLines(Shader* shader, const std::vector<float>& lineVerts, const glm::vec4& color, float width)
+{
+    if (lineVerts.empty()) return;
+
+    if (m_NavMeshLinesVAO == 0)
+    {
+        glGenVertexArrays(1, &m_NavMeshLinesVAO);
+        glGenBuffers(1, &m_NavMeshLinesVBO);
+    }
+
+    glBindVertexArray(m_NavMeshLinesVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, m_NavMeshLinesVBO);
+    glBufferData(GL_ARRAY_BUFFER, lineVerts.size() * sizeof(float), lineVerts.data(), GL_DYNAMIC_DRAW);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+
+    shader->setMat4("model", glm::mat4(1.0f));
+    shader->setVec4("ourColor", color);
+
+    glLineWidth(width);
+    glDrawArrays(GL_LINES, 0, lineVerts.size() / 3);
+    glLineWidth(1.0f);
+}
+
+void NavigationSystemDebugTools::UpdateDebugBuffers(const NavInputGeometry& inputGeometry)
+{
+    if (inputGeometry.indices.empty())
+    {
+        m_DebugIndexCount = 0;
+        return;
+    }
 
     if (m_DebugVAO == 0)
     {
         glGenVertexArrays(1, &m_DebugVAO);
         glGenBuffers(1, &m_DebugVBO);
+        glGenBuffers(1, &m_DebugEBO);
     }
     
     glBindVertexArray(m_DebugVAO);
     glBindBuffer(GL_ARRAY_BUFFER, m_DebugVBO);
-    glBufferData(GL_ARRAY_BUFFER, debugVerts.size() * sizeof(float), &debugVerts[0], GL_DYNAMIC_DRAW);
+    glBufferData(GL_ARRAY_BUFFER, inputGeometry.verts.size() * sizeof(glm::vec3), inputGeometry.verts.data(), GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_DebugEBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, inputGeometry.indices.size() * sizeof(unsigned int), inputGeometry.indices.data(), GL_DYNAMIC_DRAW);
+    m_DebugIndexCount = (int)inputGeometry.indices.size();
     
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
     glEnableVertexAttribArray(0);
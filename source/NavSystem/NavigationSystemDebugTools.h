@@ -4,10 +4,11 @@
 #include "Core/Shader.h"
 #include <vector>
 
-struct Triangle;
+struct NavInputGeometry;
 struct VoxelGrid;
 struct HeightField;
 struct ContourSet;
+struct NavMesh;
 enum DebugDrawMode;
 
 class NavigationSystemDebugTools
@@ -16,20 +17,24 @@ public:
     NavigationSystemDebugTools();
     ~NavigationSystemDebugTools();
     
-    void RenderDebugData(Camera& camera, Shader* debugShader, const Scene& scene, const std::vector<Triangle>& inputTriangles, const VoxelGrid&
-                         voxelGrid, HeightField& heightField, const ContourSet& contourSet, DebugDrawMode
-                         debugDrawMode);
+    void RenderDebugData(Camera& camera, Shader* debugShader, const Scene& scene, const VoxelGrid& voxelGrid, HeightField& heightField,
+                         const ContourSet& contourSet, const NavMesh& navMesh, const std::vector<glm::vec3>& debugPath, DebugDrawMode debugDrawMode);
 private:
-    unsigned int m_DebugVAO = 0, m_DebugVBO = 0;
+    unsigned int m_DebugVAO = 0, m_DebugVBO = 0, m_DebugEBO = 0;
+    int m_DebugIndexCount = 0;
     unsigned int m_ConnectionLinesVAO = 0, m_ConnectionLinesVBO = 0;
     unsigned int m_ContourLinesVAO = 0, m_ContourLinesVBO = 0;
-    void DrawInputTriangles(Shader* shader, const std::vector<Triangle>& m_InputTriangles);
+    unsigned int m_NavMeshLinesVAO = 0, m_NavMeshLinesVBO = 0;
+    void DrawInputTriangles(Shader* shader);
     void DrawVoxelGridBounds(Shader* shader, const Scene& scene, const VoxelGrid& m_VoxelGrid);
     void DrawVoxels_Solid(Shader* shader, const Scene& scene, const VoxelGrid& m_VoxelGrid);
     void DrawVoxels_Walkable(Shader* shader, const Scene& scene, const HeightField& m_HeightField);
     void DrawVoxels_Regions(Shader* shader, const Scene& scene, const HeightField& m_HeightField);
     void DrawConnections(Shader* shader, HeightField& m_HeightField);
     void DrawContours(Shader* shader, const ContourSet& contourSet);
+    void DrawNavMesh(Shader* shader, const NavMesh& navMesh, const std::vector<glm::vec3>& debugPath);
+    void DrawPath(Shader* shader, const std::vector<glm::vec3>& debugPath);
+    void DrawLines(Shader* shader, const std::vector<float>& lineVerts, const glm::vec4& color, float width);
 public:
-    void UpdateDebugBuffers(const std::vector<Triangle>& m_InputTriangles);
+    void UpdateDebugBuffers(const NavInputGeometry& inputGeometry);
 };
@@ -0,0 +1,305 @@
+#include "PathCorridor.h"
+#include <algorithm>
+#include <cstring>
+
+static const int MAX_CORRIDOR_CORNERS = 16;
+static const int MAX_MOVE_VISITED = 16;
+static const int MAX_SHORTCUT_POLYS = 32;
+static const float MIN_CORNER_DISTANCE = 0.01f;
+
+PathCorridor::PathCorridor() : m_Pos(0.0f), m_Target(0.0f), m_PathCount(0)
+{
+}
+
+void PathCorridor::Init(int maxPath)
+{
+    m_Path.assign(std::max(maxPath, 1), 0);
+    m_PathCount = 0;
+}
+
+void PathCorridor::Reset(NavPolyRef ref, const glm::vec3& pos)
+{
+    m_Pos = pos;
+    m_Target = pos;
+    m_Path[0] = ref;
+    m_PathCount = ref ? 1 : 0;
+}
+
+void PathCorridor::SetCorridor(const glm::vec3& target, const NavPolyRef* path, int pathCount)
+{
+    m_Target = target;
+    m_PathCount = std::min(pathCount, (int)m_Path.size());
+    memcpy(m_Path.data(), path, m_PathCount * sizeof(NavPolyRef));
+}
+
+int PathCorridor::FindCorners(glm::vec3* corners, int maxCorners, NavMeshQuery& query) const
+{
+    if (m_PathCount == 0 || maxCorners <= 0)
+        return 0;
+
+    // The straight path starts at the current position, which is not a corner to steer for.
+    glm::vec3 straightPath[MAX_CORRIDOR_CORNERS + 1];
+    int straightPathCount = 0;
+    query.FindStraightPath(m_Pos, m_Target, m_Path.data(), m_PathCount, straightPath, straightPathCount,
+                           std::min(maxCorners, MAX_CORRIDOR_CORNERS) + 1);
+
+    int cornerCount = 0;
+    for (int i = 1; i < straightPathCount && cornerCount < maxCorners; ++i)
+    {
+        const glm::vec2 offset(straightPath[i].x - m_Pos.x, straightPath[i].z - m_Pos.z);
+        if (cornerCount == 0 && glm::dot(offset, offset) < MIN_CORNER_DISTANCE * MIN_CORNER_DISTANCE)
+            continue;
+        corners[cornerCount++] = straightPath[i];
+    }
+    return cornerCount;
+}
+
+void PathCorridor::OptimizePathVisibility(const glm::vec3& next, float range, NavMeshQuery& query, const NavQueryFilter& filter)
+{
+    if (m_PathCount < 2)
+        return;
+    const glm::vec2 delta(next.x - m_Pos.x, next.z - m_Pos.z);
+    const float distance = glm::length(delta);
+    if (distance < MIN_CORNER_DISTANCE)
+        return;
+
+    // Slightly past the corner so a clear ray ends inside the poly beyond it.
+    const float length = std::min(distance + MIN_CORNER_DISTANCE, range);
+    const glm::vec3 goal(m_Pos.x + delta.x * (length / distance), m_Pos.y, m_Pos.z + delta.y * (length / distance));
+    NavPolyRef polys[MAX_SHORTCUT_POLYS];
+    int polyCount = 0;
+    float t;
+    glm::vec3 hitNormal;
+    query.Raycast(m_Path[0], m_Pos, goal, filter, t, hitNormal, polys, polyCount, MAX_SHORTCUT_POLYS);
+    if (polyCount > 1 && t > 0.99f)
+        m_PathCount = MergeStartShortcut(polys, polyCount);
+}
+
+bool PathCorridor::MovePosition(const glm::vec3& pos, NavMeshQuery& query, const NavQueryFilter& filter)
+{
+    if (m_PathCount == 0)
+        return false;
+
+    glm::vec3 result;
+    NavPolyRef visited[MAX_MOVE_VISITED];
+    int visitedCount = 0;
+    if (query.MoveAlongSurface(m_Path[0], m_Pos, pos, filter, result, visited, visitedCount, MAX_MOVE_VISITED) == NAVQUERY_FAILURE)
+        return false;
+    m_PathCount = MergeStartMoved(visited, visitedCount);
+    m_Pos = result;
+    return true;
+}
+
+bool PathCorridor::MoveOverOffMeshConnection(float range, NavMeshQuery& query, glm::vec3& startPos, glm::vec3& endPos)
+{
+    const NavMesh* navMesh = query.GetNavMesh();
+    if (!navMesh || m_PathCount < 3 || !navMesh->IsValidPolyRef(m_Path[1]))
+        return false;
+    const NavMeshTile* tile;
+    const NavPoly* poly;
+    navMesh->GetTileAndPoly(m_Path[1], tile, poly);
+    glm::vec3 right;
+    if (poly->type != NAVPOLYTYPE_OFFMESH || !query.GetPortalPoints(m_Path[0], m_Path[1], startPos, right) ||
+        !query.GetPortalPoints(m_Path[1], m_Path[2], endPos, right))
+        return false;
+    const glm::vec2 offset(startPos.x - m_Pos.x, startPos.z - m_Pos.z);
+    if (glm::dot(offset, offset) > range * range)
+        return false;
+
+    m_PathCount -= 2;
+    memmove(&m_Path[0], &m_Path[2], m_PathCount * sizeof(NavPolyRef));
+    m_Pos = endPos;
+    return true;
+}
+
+bool PathCorridor::MoveTarget(const glm::vec3& target, NavMeshQuery& query, const NavQueryFilter& filter)
+{
+    if (m_PathCount == 0)
+        return false;
+
+    glm::vec3 result;
+    NavPolyRef visited[MAX_MOVE_VISITED];
+    int visitedCount = 0;
+    if (query.MoveAlongSurface(m_Path[m_PathCount - 1], m_Target, target, filter, result, visited, visitedCount, MAX_MOVE_VISITED) ==
+        NAVQUERY_FAILURE)
+        return false;
+    m_PathCount = MergeEndMoved(visited, visitedCount);
+    m_Target = result;
+    return true;
+}
+
+bool PathCorridor::IsValid(int maxLookAhead, const NavMesh& navMesh, const NavQueryFilter& filter) const
+{
+    const int count = std::min(maxLookAhead, m_PathCount);
+    for (int i = 0; i < count; ++i)
+    {
+        if (!navMesh.IsValidPolyRef(m_Path[i]))
+            return false;
+        const NavMeshTile* tile;
+        const NavPoly* poly;
+        navMesh.GetTileAndPoly(m_Path[i], tile, poly);
+        if (!filter.PassFilter(m_Path[i], tile, poly))
+            return false;
+    }
+    return m_PathCount > 0;
+}
+
+NavQueryStatus PathCorridor::Repair(NavMeshQuery& query, const NavQueryFilter& filter, const glm::vec3& halfExtents)
+{
+    const NavMesh* navMesh = query.GetNavMesh();
+    if (!navMesh || m_PathCount == 0)
+        return NAVQUERY_FAILURE;
+
+    auto isValid = [&](NavPolyRef ref)
+    {
+        if (!navMesh->IsValidPolyRef(ref))
+            return false;
+        const NavMeshTile* tile;
+        const NavPoly* poly;
+        navMesh->GetTileAndPoly(ref, tile, poly);
+        return filter.PassFilter(ref, tile, poly);
+    };
+    int first = 0;
+    while (first < m_PathCount && isValid(m_Path[first]))
+        first++;
+    if (first == m_PathCount)
+        return NAVQUERY_SUCCESS;
+    int last = first;
+    while (last < m_PathCount && !isValid(m_Path[last]))
+        last++;
+
+    // Reconnect from the last valid poly before the stretch, or the poly under the agent when the stretch starts the corridor.
+    NavPolyRef startRef = 0, endRef = 0;
+    glm::vec3 startPos = m_Pos, endPos = m_Target;
+    if (first > 0)
+    {
+        startRef = m_Path[first - 1];
+        query.ClosestPointOnPoly(startRef, m_Pos, startPos);
+    }
+    else
+    {
+        query.FindNearestPoly(m_Pos, halfExtents, filter, startRef, startPos);
+    }
+    if (last < m_PathCount)
+    {
+        endRef = m_Path[last];
+        query.ClosestPointOnPoly(endRef, m_Target, endPos);
+    }
+    else
+    {
+        query.FindNearestPoly(m_Target, halfExtents, filter, endRef, endPos);
+    }
+    if (!startRef || !endRef)
+        return NAVQUERY_FAILURE;
+
+    std::vector<NavPolyRef> segment(m_Path.size());
+    int segmentCount = 0;
+    if (query.FindPath(startRef, endRef, startPos, endPos, filter, segment.data(), segmentCount, (int)segment.size()) != NAVQUERY_SUCCESS)
+        return NAVQUERY_FAILURE;
+
+    // The segment starts at path[first - 1] and ends at path[last], splice it over that range.
+    const bool targetMoved = last == m_PathCount;
+    const int prefixCount = std::max(first - 1, 0);
+    const int suffixStart = std::min(last + 1, m_PathCount);
+    std::vector<NavPolyRef> repaired(m_Path.begin(), m_Path.begin() + prefixCount);
+    repaired.insert(repaired.end(), segment.begin(), segment.begin() + segmentCount);
+    repaired.insert(repaired.end(), m_Path.begin() + suffixStart, m_Path.begin() + m_PathCount);
+    m_PathCount = std::min((int)repaired.size(), (int)m_Path.size());
+    memcpy(m_Path.data(), repaired.data(), m_PathCount * sizeof(NavPolyRef));
+    if (targetMoved)
+        m_Target = endPos;
+    if (first == 0)
+        m_Pos = startPos;
+    return NAVQUERY_SUCCESS;
+}
+
+// visited runs from the old first poly to the poly the position moved onto. The corridor is cut at the furthest
+// poly it shares with visited, and the visited polys up to there are prepended in reverse.
+int PathCorridor::MergeStartMoved(const NavPolyRef* visited, int visitedCount)
+{
+    int furthestPath = -1, furthestVisited = -1;
+    for (int i = m_PathCount - 1; i >= 0 && furthestPath == -1; --i)
+    {
+        for (int j = visitedCount - 1; j >= 0; --j)
+        {
+            if (m_Path[i] == visited[j])
+            {
+                furthestPath = i;
+                furthestVisited = j;
+                break;
+            }
+        }
+    }
+    if (furthestPath == -1)
+        return m_PathCount;
+
+    const int maxPath = (int)m_Path.size();
+    const int required = visitedCount - furthestVisited;
+    const int orig = std::min(furthestPath + 1, m_PathCount);
+    int size = std::max(0, m_PathCount - orig);
+    if (required + size > maxPath)
+        size = maxPath - required;
+    if (size > 0)
+        memmove(&m_Path[required], &m_Path[orig], size * sizeof(NavPolyRef));
+    for (int i = 0; i < required; ++i)
+        m_Path[i] = visited[visitedCount - 1 - i];
+    return required + size;
+}
+
+// visited runs from the old last poly to the poly of the new target, appended after the first corridor poly it contains.
+int PathCorridor::MergeEndMoved(const NavPolyRef* visited, int visitedCount)
+{
+    int furthestPath = -1, furthestVisited = -1;
+    for (int i = 0; i < m_PathCount && furthestPath == -1; ++i)
+    {
+        for (int j = visitedCount - 1; j >= 0; --j)
+        {
+            if (m_Path[i] == visited[j])
+            {
+                furthestPath = i;
+                furthestVisited = j;
+                break;
+            }
+        }
+    }
+    if (furthestPath == -1)
+        return m_PathCount;
+
+    const int pathPos = furthestPath + 1;
+    const int visitedPos = furthestVisited + 1;
+    const int count = std::min(visitedCount - visitedPos, (int)m_Path.size() - pathPos);
+    if (count > 0)
+        memcpy(&m_Path[pathPos], visited + visitedPos, count * sizeof(NavPolyRef));
+    return pathPos + count;
+}
+
+// visited runs along a clear ray from the first poly. The corridor up to the furthest shared poly is replaced by it.
+int PathCorridor::MergeStartShortcut(const NavPolyRef* visited, int visitedCount)
+{
+    int furthestPath = -1, furthestVisited = -1;
+    for (int i = m_PathCount - 1; i >= 0 && furthestPath == -1; --i)
+    {
+        for (int j = visitedCount - 1; j >= 0; --j)
+        {
+            if (m_Path[i] == visited[j])
+            {
+                furthestPath = i;
+                furthestVisited = j;
+                break;
+            }
+        }
+    }
+    if (furthestPath == -1 || furthestVisited <= 0)
+        return m_PathCount;
+
+    const int maxPath = (int)m_Path.size();
+    const int required = furthestVisited;
+    int size = std::max(0, m_PathCount - furthestPath);
+    if (required + size > maxPath)
+        size = maxPath - required;
+    if (size > 0)
+        memmove(&m_Path[required], &m_Path[furthestPath], size * sizeof(NavPolyRef));
+    for (int i = 0; i < required; ++i)
+        m_Path[i] = visited[i];
+    return required + size;
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <vector>
+#include "NavMeshQuery.h"
+
+// Poly corridor from an agent's position to its target. The corridor is kept up to date with small local
+// operations instead of new searches: moving the position or the target only walks the polys next to the
+// move, raycasts cut corners off the start of the corridor, and when tiles are rebuilt under it only the
+// invalidated stretch is searched again.
+class PathCorridor
+{
+public:
+    PathCorridor();
+
+    void Init(int maxPath);
+    void Reset(NavPolyRef ref, const glm::vec3& pos); // Corridor of the single poly the position is on
+    void SetCorridor(const glm::vec3& target, const NavPolyRef* path, int pathCount);
+
+    // Next straight path corners after the current position, the last one is the target when the corridor reaches it.
+    int FindCorners(glm::vec3* corners, int maxCorners, NavMeshQuery& query) const;
+    // Replaces the start of the corridor with a straight shortcut toward next when nothing blocks it within range.
+    void OptimizePathVisibility(const glm::vec3& next, float range, NavMeshQuery& query, const NavQueryFilter& filter);
+
+    bool MovePosition(const glm::vec3& pos, NavMeshQuery& query, const NavQueryFilter& filter);
+    // When the corridor continues over an off-mesh connection whose entry is within range, drops the polys up to the
+    // connection and puts the position at its exit. startPos and endPos receive the entry and exit points.
+    bool MoveOverOffMeshConnection(float range, NavMeshQuery& query, glm::vec3& startPos, glm::vec3& endPos);
+    bool MoveTarget(const glm::vec3& target, NavMeshQuery& query, const NavQueryFilter& filter);
+
+    // True when the first maxLookAhead polys still exist and pass the filter.
+    bool IsValid(int maxLookAhead, const NavMesh& navMesh, const NavQueryFilter& filter) const;
+    // Searches again only from the last valid poly before an invalidated stretch to the first valid poly after it.
+    // Returns NAVQUERY_FAILURE when the corridor could not be reconnected and needs a full replan.
+    NavQueryStatus Repair(NavMeshQuery& query, const NavQueryFilter& filter, const glm::vec3& halfExtents);
+
+    const glm::vec3& GetPos() const { return m_Pos; }
+    const glm::vec3& GetTarget() const { return m_Target; }
+    NavPolyRef GetFirstPoly() const { return m_PathCount ? m_Path[0] : 0; }
+    NavPolyRef GetLastPoly() const { return m_PathCount ? m_Path[m_PathCount - 1] : 0; }
+    const NavPolyRef* GetPath() const { return m_Path.data(); }
+    int GetPathCount() const { return m_PathCount; }
+private:
+    glm::vec3 m_Pos, m_Target;
+    std::vector<NavPolyRef> m_Path;
+    int m_PathCount;
+
+    int MergeStartMoved(const NavPolyRef* visited, int visitedCount);
+    int MergeEndMoved(const NavPolyRef* visited, int visitedCount);
+    int MergeStartShortcut(const NavPolyRef* visited, int visitedCount);
+};
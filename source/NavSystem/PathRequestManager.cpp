@@ -0,0 +1,195 @@
+#include "PathRequestManager.h"
+#include <cfloat>
+#include <chrono>
+
+static const int ITERS_PER_SLICE = 32; // Node expansions between clock checks
+static const int MAX_REQUEST_PATH_POLYS = 256;
+
+static double GetTimeSeconds()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+PathRequestManager::PathRequestManager()
+    : m_NavMesh(nullptr), m_MaxCorners(0), m_ActiveRequest(-1), m_PendingCount(0), m_FocusPoint(0.0f), m_AgeWeight(1.0f),
+      m_DistanceWeight(0.01f), m_LastUpdateMicroseconds(0.0f), m_LastUpdateIterations(0)
+{
+}
+
+bool PathRequestManager::Init(const NavMesh* navMesh, int maxNodes, int maxRequests, int maxCorners)
+{
+    if (!navMesh || maxRequests <= 0 || maxRequests > 0xffff || maxCorners <= 0)
+        return false;
+    if (!m_Query.Init(navMesh, maxNodes))
+        return false;
+
+    m_NavMesh = navMesh;
+    m_MaxCorners = maxCorners;
+    m_Requests.assign(maxRequests, PathRequest());
+    m_Corners.assign((size_t)maxRequests * maxCorners, glm::vec3(0.0f));
+    m_PathBuffer.resize(MAX_REQUEST_PATH_POLYS);
+    m_ActiveRequest = -1;
+    m_PendingCount = 0;
+    return true;
+}
+
+void PathRequestManager::SetPriorityWeights(float ageWeight, float distanceWeight)
+{
+    m_AgeWeight = ageWeight;
+    m_DistanceWeight = distanceWeight;
+}
+
+PathRequestHandle PathRequestManager::RequestPath(const glm::vec3& start, const glm::vec3& end, const glm::vec3& halfExtents,
+                                                  const NavQueryFilter* filter)
+{
+    for (size_t i = 0; i < m_Requests.size(); ++i)
+    {
+        PathRequest& request = m_Requests[i];
+        if (request.state != PATHREQUEST_INVALID)
+            continue;
+
+        request.state = PATHREQUEST_PENDING;
+        request.generation = (request.generation + 1) & 0xffff;
+        request.start = start;
+        request.end = end;
+        request.halfExtents = halfExtents;
+        request.filter = filter ? filter : &m_DefaultFilter;
+        request.requestTime = GetTimeSeconds();
+        request.startRef = request.endRef = 0;
+        request.status = NAVQUERY_FAILURE;
+        request.cornerCount = 0;
+        m_PendingCount++;
+        return (request.generation << 16) | (PathRequestHandle)(i + 1);
+    }
+    return 0;
+}
+
+int PathRequestManager::GetRequestIndex(PathRequestHandle handle) const
+{
+    const int index = (int)(handle & 0xffff) - 1;
+    if (index < 0 || index >= (int)m_Requests.size())
+        return -1;
+    const PathRequest& request = m_Requests[index];
+    if (request.state == PATHREQUEST_INVALID || request.generation != (handle >> 16))
+        return -1;
+    return index;
+}
+
+void PathRequestManager::Cancel(PathRequestHandle handle)
+{
+    const int index = GetRequestIndex(handle);
+    if (index < 0)
+        return;
+    PathRequest& request = m_Requests[index];
+    if (request.state == PATHREQUEST_PENDING || request.state == PATHREQUEST_WORKING)
+        m_PendingCount--;
+    if (m_ActiveRequest == index)
+        m_ActiveRequest = -1;
+    request.state = PATHREQUEST_INVALID;
+}
+
+PathRequestState PathRequestManager::GetRequestState(PathRequestHandle handle) const
+{
+    const int index = GetRequestIndex(handle);
+    return index >= 0 ? m_Requests[index].state : PATHREQUEST_INVALID;
+}
+
+bool PathRequestManager::GetPathResult(PathRequestHandle handle, std::vector<glm::vec3>& corners, NavQueryStatus& status)
+{
+    const int index = GetRequestIndex(handle);
+    if (index < 0)
+        return false;
+    PathRequest& request = m_Requests[index];
+    if (request.state != PATHREQUEST_DONE && request.state != PATHREQUEST_FAILED)
+        return false;
+
+    const glm::vec3* first = &m_Corners[(size_t)index * m_MaxCorners];
+    corners.assign(first, first + request.cornerCount);
+    status = request.status;
+    request.state = PATHREQUEST_INVALID;
+    return true;
+}
+
+int PathRequestManager::PickNextRequest(double now) const
+{
+    int best = -1;
+    float bestPriority = -FLT_MAX;
+    for (size_t i = 0; i < m_Requests.size(); ++i)
+    {
+        const PathRequest& request = m_Requests[i];
+        if (request.state != PATHREQUEST_PENDING)
+            continue;
+        const float age = (float)(now - request.requestTime);
+        const float priority = age * m_AgeWeight - glm::distance(request.start, m_FocusPoint) * m_DistanceWeight;
+        if (priority > bestPriority)
+        {
+            bestPriority = priority;
+            best = (int)i;
+        }
+    }
+    return best;
+}
+
+void PathRequestManager::StartRequest(int index)
+{
+    PathRequest& request = m_Requests[index];
+    m_Query.FindNearestPoly(request.start, request.halfExtents, *request.filter, request.startRef, request.startPos);
+    m_Query.FindNearestPoly(request.end, request.halfExtents, *request.filter, request.endRef, request.endPos);
+
+    request.state = PATHREQUEST_WORKING;
+    m_ActiveRequest = index;
+    if (!request.startRef || !request.endRef || !m_Query.IsReachable(request.startRef, request.endRef) ||
+        m_Query.InitSlicedFindPath(request.startRef, request.endRef, request.startPos, request.endPos, *request.filter) == NAVQUERY_FAILURE)
+    {
+        request.state = PATHREQUEST_FAILED;
+        request.status = NAVQUERY_FAILURE;
+        m_ActiveRequest = -1;
+        m_PendingCount--;
+    }
+}
+
+void PathRequestManager::FinishRequest(int index)
+{
+    PathRequest& request = m_Requests[index];
+    int pathCount = 0;
+    request.status = m_Query.FinalizeSlicedFindPath(m_PathBuffer.data(), pathCount, (int)m_PathBuffer.size());
+    request.cornerCount = 0;
+    if (request.status != NAVQUERY_FAILURE)
+        m_Query.FindStraightPath(request.startPos, request.endPos, m_PathBuffer.data(), pathCount, &m_Corners[(size_t)index * m_MaxCorners],
+                                 request.cornerCount, m_MaxCorners);
+
+    request.state = request.status != NAVQUERY_FAILURE ? PATHREQUEST_DONE : PATHREQUEST_FAILED;
+    m_ActiveRequest = -1;
+    m_PendingCount--;
+}
+
+void PathRequestManager::Update(float budgetMicroseconds)
+{
+    m_LastUpdateIterations = 0;
+    if (!m_NavMesh)
+        return;
+
+    const double begin = GetTimeSeconds();
+    const double budgetSeconds = budgetMicroseconds * 1e-6;
+    double now = begin;
+    while (m_PendingCount > 0 && now - begin < budgetSeconds)
+    {
+        if (m_ActiveRequest < 0)
+        {
+            const int next = PickNextRequest(now);
+            if (next < 0)
+                break;
+            StartRequest(next);
+        }
+        if (m_ActiveRequest >= 0)
+        {
+            int doneIters = 0;
+            const NavQueryStatus status = m_Query.UpdateSlicedFindPath(ITERS_PER_SLICE, doneIters);
+            m_LastUpdateIterations += doneIters;
+            if (status != NAVQUERY_IN_PROGRESS)
+                FinishRequest(m_ActiveRequest);
+        }
+        now = GetTimeSeconds();
+    }
+    m_LastUpdateMicroseconds = (float)((now - begin) * 1e6);
+}
@@ -0,0 +1,80 @@
+#pragma once
+#include <vector>
+#include "NavMeshQuery.h"
+
+typedef unsigned int PathRequestHandle; // 0 = invalid
+
+enum PathRequestState
+{
+    PATHREQUEST_INVALID,
+    PATHREQUEST_PENDING,
+    PATHREQUEST_WORKING,
+    PATHREQUEST_DONE,
+    PATHREQUEST_FAILED
+};
+
+// Queues path requests and advances them with a sliced query under a per frame time budget.
+// One request is searched at a time; when it finishes the pending request with the highest
+// priority (waiting time weighted against distance from the focus point) is started next.
+class PathRequestManager
+{
+public:
+    PathRequestManager();
+
+    bool Init(const NavMesh* navMesh, int maxNodes, int maxRequests, int maxCorners);
+
+    PathRequestHandle RequestPath(const glm::vec3& start, const glm::vec3& end, const glm::vec3& halfExtents,
+                                  const NavQueryFilter* filter = nullptr);
+    void Cancel(PathRequestHandle handle);
+    // Spends at most budgetMicroseconds of search time, to be called once per frame.
+    void Update(float budgetMicroseconds);
+
+    PathRequestState GetRequestState(PathRequestHandle handle) const;
+    // Copies the corners of a finished request and frees its slot.
+    bool GetPathResult(PathRequestHandle handle, std::vector<glm::vec3>& corners, NavQueryStatus& status);
+
+    void SetIslands(const NavMeshIslands* islands) { m_Query.SetIslands(islands); }
+    void SetLandmarks(const NavMeshLandmarks* landmarks) { m_Query.SetLandmarks(landmarks); }
+    // Used by the requests made without a filter.
+    void SetDefaultFilter(const NavQueryFilter& filter) { m_DefaultFilter = filter; }
+    void SetFocusPoint(const glm::vec3& focusPoint) { m_FocusPoint = focusPoint; }
+    void SetPriorityWeights(float ageWeight, float distanceWeight);
+
+    int GetPendingCount() const { return m_PendingCount; }
+    float GetLastUpdateMicroseconds() const { return m_LastUpdateMicroseconds; }
+    int GetLastUpdateIterations() const { return m_LastUpdateIterations; }
+private:
+    struct PathRequest
+    {
+        PathRequestState state;
+        unsigned int generation;
+        glm::vec3 start, end, halfExtents;
+        const NavQueryFilter* filter;
+        double requestTime;
+        NavPolyRef startRef, endRef;
+        glm::vec3 startPos, endPos;
+        NavQueryStatus status;
+        int cornerCount;
+    };
+
+    const NavMesh* m_NavMesh;
+    NavMeshQuery m_Query;
+    NavQueryFilter m_DefaultFilter;
+
+    std::vector<PathRequest> m_Requests;
+    std::vector<glm::vec3> m_Corners;     // maxCorners slots per request
+    std::vector<NavPolyRef> m_PathBuffer;
+    int m_MaxCorners;
+    int m_ActiveRequest;                  // Index of the request owning the sliced query, -1 = none
+    int m_PendingCount;
+
+    glm::vec3 m_FocusPoint;
+    float m_AgeWeight, m_DistanceWeight;
+    float m_LastUpdateMicroseconds;
+    int m_LastUpdateIterations;
+
+    int GetRequestIndex(PathRequestHandle handle) const;
+    int PickNextRequest(double now) const;
+    void StartRequest(int index);
+    void FinishRequest(int index);
+};
@@ -0,0 +1,368 @@
+#include "SpanPathfinder.h"
+#include "NavigationSystem.h"
+#include <algorithm>
+
+static const int OPPOSITE_DIR[4] = { 2, 3, 0, 1 };
+
+SpanPathfinder::SpanPathfinder() : m_HeightField(nullptr), m_QueryStamp(0), m_GoalSpan(NAV_NULL_SPAN), m_ExpandedNodes(0)
+{
+}
+
+void SpanPathfinder::Init(const HeightField* heightField)
+{
+    m_HeightField = heightField;
+    const size_t spanCount = heightField ? heightField->spanPool.size() : 0;
+
+    m_Cost.assign(spanCount, 0.0f);
+    m_Parent.assign(spanCount, NAV_NULL_SPAN);
+    m_Stamp.assign(spanCount, 0);
+    m_Closed.assign((spanCount + 63) / 64, 0);
+    m_Open.clear();
+    m_Open.reserve(1024);
+    m_QueryStamp = 0;
+
+    BuildJumpTables();
+}
+
+void SpanPathfinder::BuildJumpTables()
+{
+    m_Nodes.clear();
+    m_ColumnChainSpans.clear();
+    m_ColumnChainFirst.clear();
+    m_ColumnChainLast.clear();
+    m_SpanIsland.clear();
+    if (!m_HeightField || m_HeightField->spanPool.empty())
+        return;
+
+    const HeightField& hf = *m_HeightField;
+    const HeightFieldSpan* pool = &hf.spanPool[0];
+    const size_t spanCount = hf.spanPool.size();
+    m_Nodes.resize(spanCount);
+
+    for (int z = 0; z < hf.depth; ++z)
+    {
+        for (int x = 0; x < hf.width; ++x)
+        {
+            for (const HeightFieldSpan* span = hf.spans[x + z * hf.width]; span; span = span->next)
+            {
+                m_Nodes[span - pool].x = (uint16_t)x;
+                m_Nodes[span - pool].z = (uint16_t)z;
+            }
+        }
+    }
+
+    // Only links that agree in both directions are used, so every run along an axis is a simple chain.
+    std::vector<unsigned int> neighbors(spanCount * 4);
+    for (size_t i = 0; i < spanCount; ++i)
+    {
+        for (int dir = 0; dir < 4; ++dir)
+        {
+            const unsigned int connection = pool[i].connections[dir];
+            unsigned int neighbor = connection > 0 ? connection - 1 : NAV_NULL_SPAN;
+            if (neighbor != NAV_NULL_SPAN && pool[neighbor].connections[OPPOSITE_DIR[dir]] != i + 1)
+                neighbor = NAV_NULL_SPAN;
+            neighbors[i * 4 + dir] = neighbor;
+        }
+    }
+    auto neighborOf = [&neighbors](unsigned int span, int dir) { return neighbors[span * 4 + dir]; };
+
+    // Island labels by flood fill, so unreachable goals fail without a search.
+    m_SpanIsland.assign(spanCount, 0);
+    unsigned int islandCount = 0;
+    std::vector<unsigned int> stack;
+    for (unsigned int seed = 0; seed < spanCount; ++seed)
+    {
+        if (pool[seed].areaID == 0 || m_SpanIsland[seed] != 0)
+            continue;
+        m_SpanIsland[seed] = ++islandCount;
+        stack.push_back(seed);
+        while (!stack.empty())
+        {
+            const unsigned int span = stack.back();
+            stack.pop_back();
+            for (int dir = 0; dir < 4; ++dir)
+            {
+                const unsigned int neighbor = neighborOf(span, dir);
+                if (neighbor != NAV_NULL_SPAN && m_SpanIsland[neighbor] == 0)
+                {
+                    m_SpanIsland[neighbor] = islandCount;
+                    stack.push_back(neighbor);
+                }
+            }
+        }
+    }
+
+    // A perpendicular neighbor is forced when it cannot be reached just as cheaply by stepping sideways
+    // one span earlier. On a flat grid that reduces to the usual obstacle test, with climb limits it also
+    // catches ledges where both spans exist but are not connected.
+    std::vector<unsigned char> forced(spanCount, 0);
+    for (unsigned int span = 0; span < spanCount; ++span)
+    {
+        for (int dir = 0; dir < 4; ++dir)
+        {
+            const unsigned int previous = neighborOf(span, OPPOSITE_DIR[dir]);
+            if (previous == NAV_NULL_SPAN)
+                continue;
+            for (int side : { (dir + 1) % 4, (dir + 3) % 4 })
+            {
+                const unsigned int currentSide = neighborOf(span, side);
+                if (currentSide == NAV_NULL_SPAN)
+                    continue;
+                const unsigned int previousSide = neighborOf(previous, side);
+                if (previousSide == NAV_NULL_SPAN || neighborOf(previousSide, dir) != currentSide)
+                    forced[span] |= (unsigned char)(1 << dir);
+            }
+        }
+    }
+
+    // --- Rows: chains along x, jumps stop at forced spans ---
+    std::vector<unsigned int> chain;
+    unsigned int rowChainCount = 0;
+    for (unsigned int span = 0; span < spanCount; ++span)
+    {
+        if (neighborOf(span, 0) != NAV_NULL_SPAN)
+            continue;
+        chain.clear();
+        for (unsigned int s = span; s != NAV_NULL_SPAN; s = neighborOf(s, 2))
+        {
+            m_Nodes[s].rowChain = rowChainCount;
+            chain.push_back(s);
+        }
+        rowChainCount++;
+
+        unsigned int next = NAV_NULL_SPAN;
+        for (size_t i = chain.size(); i-- > 0;)
+        {
+            m_Nodes[chain[i]].jump[2] = next == NAV_NULL_SPAN ? NAV_NULL_SPAN : ((forced[next] & (1 << 2)) ? next : m_Nodes[next].jump[2]);
+            next = chain[i];
+        }
+        unsigned int previous = NAV_NULL_SPAN;
+        for (size_t i = 0; i < chain.size(); ++i)
+        {
+            m_Nodes[chain[i]].jump[0] = previous == NAV_NULL_SPAN ? NAV_NULL_SPAN : ((forced[previous] & (1 << 0)) ? previous : m_Nodes[previous].jump[0]);
+            previous = chain[i];
+        }
+    }
+
+    // --- Columns: chains along z, jumps also stop wherever a row jump from the span finds something ---
+    auto isColumnStop = [&](unsigned int span, int dir)
+    {
+        return (forced[span] & (1 << dir)) || m_Nodes[span].jump[0] != NAV_NULL_SPAN || m_Nodes[span].jump[2] != NAV_NULL_SPAN;
+    };
+    for (unsigned int span = 0; span < spanCount; ++span)
+    {
+        if (neighborOf(span, 1) != NAV_NULL_SPAN)
+            continue;
+        const unsigned int chainIndex = (unsigned int)m_ColumnChainFirst.size();
+        m_ColumnChainFirst.push_back((unsigned int)m_ColumnChainSpans.size());
+        chain.clear();
+        for (unsigned int s = span; s != NAV_NULL_SPAN; s = neighborOf(s, 3))
+        {
+            m_Nodes[s].columnChain = chainIndex;
+            m_Nodes[s].columnIndex = (unsigned int)m_ColumnChainSpans.size();
+            m_ColumnChainSpans.push_back(s);
+            chain.push_back(s);
+        }
+        m_ColumnChainLast.push_back((unsigned int)m_ColumnChainSpans.size() - 1);
+
+        unsigned int next = NAV_NULL_SPAN;
+        for (size_t i = chain.size(); i-- > 0;)
+        {
+            m_Nodes[chain[i]].jump[3] = next == NAV_NULL_SPAN ? NAV_NULL_SPAN : (isColumnStop(next, 3) ? next : m_Nodes[next].jump[3]);
+            next = chain[i];
+        }
+        unsigned int previous = NAV_NULL_SPAN;
+        for (size_t i = 0; i < chain.size(); ++i)
+        {
+            m_Nodes[chain[i]].jump[1] = previous == NAV_NULL_SPAN ? NAV_NULL_SPAN : (isColumnStop(previous, 1) ? previous : m_Nodes[previous].jump[1]);
+            previous = chain[i];
+        }
+    }
+}
+
+bool SpanPathfinder::AreConnected(unsigned int a, unsigned int b) const
+{
+    return a < m_SpanIsland.size() && b < m_SpanIsland.size() && m_SpanIsland[a] != 0 && m_SpanIsland[a] == m_SpanIsland[b];
+}
+
+unsigned int SpanPathfinder::FindSpan(const glm::vec3& pos, float maxDistance) const
+{
+    if (!m_HeightField || m_HeightField->spanPool.empty())
+        return NAV_NULL_SPAN;
+
+    const int x = (int)floorf((pos.x - m_HeightField->bmin.x) / m_HeightField->cellSize);
+    const int z = (int)floorf((pos.z - m_HeightField->bmin.z) / m_HeightField->cellSize);
+    if (x < 0 || z < 0 || x >= m_HeightField->width || z >= m_HeightField->depth)
+        return NAV_NULL_SPAN;
+
+    const HeightFieldSpan* pool = &m_HeightField->spanPool[0];
+    unsigned int bestSpan = NAV_NULL_SPAN;
+    float bestDistance = maxDistance;
+    for (const HeightFieldSpan* span = m_HeightField->spans[x + z * m_HeightField->width]; span; span = span->next)
+    {
+        if (span->areaID == 0)
+            continue;
+        const float top = m_HeightField->bmin.y + (span->spanMax + 1) * m_HeightField->cellHeight;
+        const float distance = fabsf(top - pos.y);
+        if (distance <= bestDistance)
+        {
+            bestDistance = distance;
+            bestSpan = (unsigned int)(span - pool);
+        }
+    }
+    return bestSpan;
+}
+
+glm::vec3 SpanPathfinder::GetSpanPosition(unsigned int spanIndex) const
+{
+    const HeightFieldSpan& span = m_HeightField->spanPool[spanIndex];
+    return glm::vec3(m_HeightField->bmin.x + (m_Nodes[spanIndex].x + 0.5f) * m_HeightField->cellSize,
+                     m_HeightField->bmin.y + (span.spanMax + 1) * m_HeightField->cellHeight,
+                     m_HeightField->bmin.z + (m_Nodes[spanIndex].z + 0.5f) * m_HeightField->cellSize);
+}
+
+float SpanPathfinder::Heuristic(unsigned int span) const
+{
+    const JumpNode& node = m_Nodes[span];
+    const JumpNode& goal = m_Nodes[m_GoalSpan];
+    return (float)(abs((int)node.x - (int)goal.x) + abs((int)node.z - (int)goal.z));
+}
+
+// Static jump target, unless the goal (or the row leading to it) is passed first.
+unsigned int SpanPathfinder::Jump(unsigned int from, int dir) const
+{
+    const JumpNode& node = m_Nodes[from];
+    const JumpNode& goal = m_Nodes[m_GoalSpan];
+    const unsigned int target = node.jump[dir];
+    const int sign = dir >= 2 ? 1 : -1;
+
+    if (dir == 0 || dir == 2)
+    {
+        if (goal.rowChain == node.rowChain && ((int)goal.x - (int)node.x) * sign > 0 &&
+            (target == NAV_NULL_SPAN || ((int)goal.x - (int)m_Nodes[target].x) * sign < 0))
+            return m_GoalSpan;
+        return target;
+    }
+
+    const int goalOffset = ((int)goal.z - (int)node.z) * sign;
+    if (goalOffset > 0 && (target == NAV_NULL_SPAN || goalOffset < ((int)m_Nodes[target].z - (int)node.z) * sign))
+    {
+        const long long index = (long long)node.columnIndex + goalOffset * sign;
+        if (index >= m_ColumnChainFirst[node.columnChain] && index <= m_ColumnChainLast[node.columnChain])
+        {
+            const unsigned int rowSpan = m_ColumnChainSpans[(size_t)index];
+            if (m_Nodes[rowSpan].rowChain == goal.rowChain)
+                return rowSpan;
+        }
+    }
+    return target;
+}
+
+// Min-heap order, ties go to the deeper node so equally good paths are not all expanded.
+bool SpanPathfinder::OpenEntryGreater(const OpenEntry& a, const OpenEntry& b)
+{
+    return a.total > b.total || (a.total == b.total && a.cost < b.cost);
+}
+
+void SpanPathfinder::PushOpen(unsigned int span, unsigned int parent, float cost)
+{
+    // The closed bit is left over from an earlier query until the span is first reached in this one.
+    if (m_Stamp[span] != m_QueryStamp)
+        m_Closed[span >> 6] &= ~(1ull << (span & 63));
+    m_Stamp[span] = m_QueryStamp;
+    m_Cost[span] = cost;
+    m_Parent[span] = parent;
+
+    m_Open.push_back({ cost + Heuristic(span), cost, span });
+    std::push_heap(m_Open.begin(), m_Open.end(), OpenEntryGreater);
+}
+
+SpanPathfinder::OpenEntry SpanPathfinder::PopOpen()
+{
+    std::pop_heap(m_Open.begin(), m_Open.end(), OpenEntryGreater);
+    const OpenEntry entry = m_Open.back();
+    m_Open.pop_back();
+    return entry;
+}
+
+bool SpanPathfinder::FindPath(unsigned int startSpan, unsigned int endSpan, unsigned int* path, int& pathCount, int maxPath)
+{
+    pathCount = 0;
+    m_ExpandedNodes = 0;
+    if (!m_HeightField || !path || maxPath <= 0 || !AreConnected(startSpan, endSpan))
+        return false;
+
+    if (++m_QueryStamp == 0)
+    {
+        std::fill(m_Stamp.begin(), m_Stamp.end(), 0);
+        m_QueryStamp = 1;
+    }
+    m_Open.clear();
+    m_GoalSpan = endSpan;
+    m_ExpandedNodes = 0;
+
+    PushOpen(startSpan, NAV_NULL_SPAN, 0.0f);
+
+    bool found = false;
+    while (!m_Open.empty())
+    {
+        const OpenEntry entry = PopOpen();
+        const unsigned int span = entry.span;
+        uint64_t& closedWord = m_Closed[span >> 6];
+        const uint64_t closedBit = 1ull << (span & 63);
+        if (closedWord & closedBit)
+            continue;
+        closedWord |= closedBit;
+        m_ExpandedNodes++;
+
+        if (span == endSpan)
+        {
+            found = true;
+            break;
+        }
+
+        int skipDir = -1;
+        const unsigned int parent = m_Parent[span];
+        if (parent != NAV_NULL_SPAN)
+        {
+            const int dx = (int)m_Nodes[span].x - (int)m_Nodes[parent].x;
+            const int dz = (int)m_Nodes[span].z - (int)m_Nodes[parent].z;
+            const int arrivalDir = dx < 0 ? 0 : dz < 0 ? 1 : dx > 0 ? 2 : 3;
+            skipDir = OPPOSITE_DIR[arrivalDir];
+        }
+
+        for (int dir = 0; dir < 4; ++dir)
+        {
+            if (dir == skipDir)
+                continue;
+            const unsigned int jumpPoint = Jump(span, dir);
+            if (jumpPoint == NAV_NULL_SPAN)
+                continue;
+            const bool reached = m_Stamp[jumpPoint] == m_QueryStamp;
+            if (reached && (m_Closed[jumpPoint >> 6] & (1ull << (jumpPoint & 63))))
+                continue;
+
+            const float cost = m_Cost[span] + (float)(abs((int)m_Nodes[jumpPoint].x - (int)m_Nodes[span].x) +
+                                                      abs((int)m_Nodes[jumpPoint].z - (int)m_Nodes[span].z));
+            if (!reached || cost < m_Cost[jumpPoint])
+                PushOpen(jumpPoint, span, cost);
+        }
+    }
+
+    if (!found)
+        return false;
+
+    int length = 0;
+    for (unsigned int span = endSpan; span != NAV_NULL_SPAN; span = m_Parent[span])
+        length++;
+    pathCount = std::min(length, maxPath);
+
+    unsigned int span = endSpan;
+    for (int i = length - 1; i >= 0; --i)
+    {
+        if (i < pathCount)
+            path[i] = span;
+        span = m_Parent[span];
+    }
+    return length <= maxPath;
+}
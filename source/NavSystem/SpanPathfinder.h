@@ -0,0 +1,68 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+struct HeightField;
+
+static const unsigned int NAV_NULL_SPAN = 0xffffffff;
+
+// Grid A* over the walkable span graph using 4-connected Jump Point Search.
+// Init precomputes the goal independent jump targets per span and direction (JPS+ style), so a jump
+// during the search is a table lookup plus an O(1) test for passing the goal.
+// Span indices are positions in HeightField::spanPool. All buffers are sized once in Init and reused per query.
+class SpanPathfinder
+{
+public:
+    SpanPathfinder();
+
+    void Init(const HeightField* heightField);
+
+    unsigned int FindSpan(const glm::vec3& pos, float maxDistance) const;
+    glm::vec3 GetSpanPosition(unsigned int spanIndex) const;
+
+    // Both spans in the same connected island, checked by FindPath before searching.
+    bool AreConnected(unsigned int a, unsigned int b) const;
+
+    // Writes the jump points from start to end, consecutive points differ along a single axis.
+    bool FindPath(unsigned int startSpan, unsigned int endSpan, unsigned int* path, int& pathCount, int maxPath);
+
+    int GetExpandedNodes() const { return m_ExpandedNodes; }
+private:
+    struct JumpNode
+    {
+        unsigned int jump[4];   // Next static jump point per direction, NAV_NULL_SPAN when the run hits a wall
+        unsigned int rowChain;  // Run of spans linked along x
+        unsigned int columnChain; // Run of spans linked along z
+        unsigned int columnIndex; // Position in m_ColumnChainSpans
+        uint16_t x, z;
+    };
+    struct OpenEntry
+    {
+        float total;
+        float cost;
+        unsigned int span;
+    };
+
+    const HeightField* m_HeightField;
+    std::vector<JumpNode> m_Nodes;
+    std::vector<unsigned int> m_ColumnChainSpans; // Spans of each z chain stored contiguously
+    std::vector<unsigned int> m_ColumnChainFirst, m_ColumnChainLast;
+    std::vector<unsigned int> m_SpanIsland; // Connected component per span over the symmetric links, 0 = unwalkable
+
+    std::vector<float> m_Cost;
+    std::vector<unsigned int> m_Parent;
+    std::vector<unsigned int> m_Stamp; // Cost/parent are valid only when stamp matches the current query
+    std::vector<uint64_t> m_Closed;    // One bit per span, also only valid when the stamp matches
+    std::vector<OpenEntry> m_Open;     // Binary heap, capacity kept between queries
+    unsigned int m_QueryStamp;
+    unsigned int m_GoalSpan;
+    int m_ExpandedNodes;
+
+    void BuildJumpTables();
+    float Heuristic(unsigned int span) const;
+    unsigned int Jump(unsigned int from, int dir) const;
+    static bool OpenEntryGreater(const OpenEntry& a, const OpenEntry& b);
+    void PushOpen(unsigned int span, unsigned int parent, float cost);
+    OpenEntry PopOpen();
+};